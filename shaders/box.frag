@@ -3,12 +3,12 @@
 // Input from vertex shader
 in vec3 FragPos;
 in vec3 Normal;
+flat in vec3 InstanceColor;
 
 // Output color
 out vec4 outColor;
 
 // Uniforms
-uniform vec3 instanceColor;
 uniform bool isLightSource;
 uniform vec3 lightPos;      // Position of the light source
 uniform vec3 viewPos;       // Position of the camera
@@ -16,7 +16,7 @@ uniform vec3 viewPos;       // Position of the camera
 void main() {
     if (isLightSource) {
         // If this is a light source, just emit light color
-        outColor = vec4(instanceColor, 1.0);
+        outColor = vec4(InstanceColor, 1.0);
     } else {
         // Ambient lighting
         float ambientStrength = 0.1;
@@ -36,7 +36,7 @@ void main() {
         vec3 specular = specularStrength * spec * vec3(1.0, 1.0, 1.0);
         
         // Combine lighting
-        vec3 result = (ambient + diffuse + specular) * instanceColor;
+        vec3 result = (ambient + diffuse + specular) * InstanceColor;
         outColor = vec4(result, 1.0);
     }
 }
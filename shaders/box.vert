@@ -4,25 +4,52 @@
 layout (location = 0) in vec3 aPos;      // Vertex position
 layout (location = 1) in vec3 aNormal;   // Vertex normal
 
+// Per-instance attributes (glVertexAttribDivisor 1)
+#ifdef GPU_SIMULATION
+// Read straight from GpuBoxSimulation's buffers
+layout (location = 2) in vec4 aPositionRotation;    // World position, rotation about Y
+layout (location = 3) in vec4 aColorScale;          // Color, uniform scale
+#else
+layout (location = 2) in vec4 aPositionScale;   // World position, uniform scale
+layout (location = 3) in vec4 aColorRotation;   // Color, rotation about Y in radians
+#endif
+
 // Output to fragment shader
 out vec3 FragPos;
 out vec3 Normal;
+flat out vec3 InstanceColor;
 
 // Uniforms
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform vec3 instanceColor;
-uniform bool isLightSource;  // Whether this box is a light source
 
 void main() {
-    // Transform position to world space
-    vec4 worldPos = model * vec4(aPos, 1.0);
+#ifdef GPU_SIMULATION
+    vec3 instancePosition = aPositionRotation.xyz;
+    float instanceScale = aColorScale.w;
+    vec3 instanceColor = aColorScale.rgb;
+    float instanceRotation = aPositionRotation.w;
+#else
+    vec3 instancePosition = aPositionScale.xyz;
+    float instanceScale = aPositionScale.w;
+    vec3 instanceColor = aColorRotation.rgb;
+    float instanceRotation = aColorRotation.w;
+#endif
+
+    // Rotate about Y, scale and translate. With a uniform scale the rotation
+    // alone transforms the normal, so no per-vertex inverse is needed.
+    float c = cos(instanceRotation);
+    float s = sin(instanceRotation);
+    mat3 rotation = mat3(c, 0.0, -s,
+                         0.0, 1.0, 0.0,
+                         s, 0.0, c);
+    vec3 worldPos = instancePosition + instanceScale * (rotation * aPos);
     
     // Pass position and normal to fragment shader
-    FragPos = worldPos.xyz;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    FragPos = worldPos;
+    Normal = rotation * aNormal;
+    InstanceColor = instanceColor;
     
     // Final position
-    gl_Position = projection * view * worldPos;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
 }
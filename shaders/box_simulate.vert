@@ -0,0 +1,29 @@
+#version 330 core
+
+// One moving box per vertex (GpuBoxSimulation); the result is captured with
+// transform feedback and nothing is rasterized
+
+layout (location = 0) in vec4 aPositionRotation;   // Position, rotation about Y
+layout (location = 1) in vec4 aVelocitySpin;       // Velocity, rotation speed
+
+out vec4 outPositionRotation;
+
+uniform float deltaTime;
+uniform float boundary;     // Boxes wrap around inside [-boundary, boundary]
+
+// Frame-rate scale of the original per-box update (tuned at 60 Hz), as in
+// UpdateBoxMotion
+const float SPEED_SCALE = 60.0;
+const float FULL_TURN = 360.0;
+
+void main() {
+    vec3 position = aPositionRotation.xyz + (aVelocitySpin.xyz * deltaTime) * SPEED_SCALE;
+    // Leaving on one face brings a box back at the opposite one
+    position = mix(position, vec3(boundary), lessThan(position, vec3(-boundary)));
+    position = mix(position, vec3(-boundary), greaterThan(position, vec3(boundary)));
+
+    float rotation = aPositionRotation.w + (aVelocitySpin.w * deltaTime) * SPEED_SCALE;
+    if (rotation > FULL_TURN) rotation -= FULL_TURN;
+
+    outPositionRotation = vec4(position, rotation);
+}
@@ -4,16 +4,21 @@ out vec4 FragColor;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+flat in int MaterialIndex;     // Looked up per mesh by butterfly.vert
 
-// Material properties
+// Material properties, one entry per material of the model (see
+// MaterialBlock in obj_loader.cpp). Map fields hold a texture array index
+// (-1: no map) and a layer.
 struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-    bool hasDiffuseMap;
-    bool hasSpecularMap;
-    bool hasNormalMap;
+    vec4 ambient;
+    vec4 diffuse;       // w: dissolve
+    vec4 specular;      // w: shininess
+    ivec4 maps;         // xy: diffuse map, zw: specular map
+    ivec4 opacityMap;   // xy: map_d, sampled from the red channel
+};
+
+layout(std140) uniform Materials {
+    Material materials[64];
 };
 
 // Light properties
@@ -24,44 +29,88 @@ struct Light {
     vec3 specular;
 };
 
-// Textures
-uniform sampler2D diffuseMap;
-uniform sampler2D specularMap;
-uniform sampler2D normalMap;
+// The model's textures, one array per size and format
+uniform sampler2DArray materialTextures[4];
 
-// Material and light uniforms
-uniform Material material;
+// Light uniforms
 uniform Light light;
 uniform vec3 viewPos;
 
+// Everything that discards is compiled only into the ALPHA_TEST variant:
+// any discard in a shader turns off early depth testing for all of its
+// fragments. The base of the model is clipped away when it is loaded.
+#ifdef ALPHA_TEST
+// LOD cross-fade progress (0 when not fading); the outgoing level keeps the
+// pixels the incoming one has not claimed yet
+uniform float lodFade;
+uniform bool lodFadeOut;
+
+float bayerThreshold()
+{
+    const float bayer[16] = float[16](
+         0.0,  8.0,  2.0, 10.0,
+        12.0,  4.0, 14.0,  6.0,
+         3.0, 11.0,  1.0,  9.0,
+        15.0,  7.0, 13.0,  5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+#endif
+
+vec4 sampleMaterialTexture(ivec2 map, vec2 uv)
+{
+    // Sampler arrays can only be indexed by constants in GLSL 3.30
+    vec3 coord = vec3(uv, float(map.y));
+    if (map.x == 0) return texture(materialTextures[0], coord);
+    if (map.x == 1) return texture(materialTextures[1], coord);
+    if (map.x == 2) return texture(materialTextures[2], coord);
+    return texture(materialTextures[3], coord);
+}
+
 void main()
 {
-    // Discard fragments that are part of the base (Y < -0.1)
-    if (FragPos.y < -0.1) {
+    Material material = materials[MaterialIndex];
+    
+#ifdef ALPHA_TEST
+    // Cut out transparent texels
+    float alpha = material.diffuse.w;
+    if (material.opacityMap.x >= 0) {
+        alpha *= sampleMaterialTexture(material.opacityMap.xy, TexCoords).r;
+    }
+    if (alpha < 0.5) {
         discard;
     }
     
+    // Dithered LOD transition
+    if (lodFade > 0.0) {
+        bool incoming = bayerThreshold() < lodFade;
+        if (incoming == lodFadeOut) {
+            discard;
+        }
+    }
+#endif
+    
     // Sample texture maps if available
-    vec3 texDiffuse = material.hasDiffuseMap ? 
-        texture(diffuseMap, TexCoords).rgb : material.diffuse;
+    vec3 texDiffuse = material.maps.x >= 0 ?
+        sampleMaterialTexture(material.maps.xy, TexCoords).rgb : material.diffuse.rgb;
     
-    vec3 texSpecular = material.hasSpecularMap ? 
-        texture(specularMap, TexCoords).rgb : material.specular;
+    vec3 texSpecular = material.maps.z >= 0 ?
+        sampleMaterialTexture(material.maps.zw, TexCoords).rgb : material.specular.rgb;
     
     // Ambient lighting
-    vec3 ambient = light.ambient * texDiffuse * material.ambient;
+    vec3 ambient = light.ambient * texDiffuse * material.ambient.rgb;
     
     // Diffuse lighting
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(light.position - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texDiffuse * material.diffuse;
+    vec3 diffuse = light.diffuse * diff * texDiffuse * material.diffuse.rgb;
     
     // Specular lighting
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texSpecular * material.specular;
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.specular.w);
+    vec3 specular = light.specular * spec * texSpecular * material.specular.rgb;
     
     // Combine lighting components
     vec3 result = ambient + diffuse + specular;
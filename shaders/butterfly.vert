@@ -1,37 +1,59 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec4 aNormal;     // xyz, or octahedral xy when quantized
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out int MaterialIndex;
 
-// Material properties
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-    bool hasDiffuseMap;
-    bool hasSpecularMap;
-    bool hasNormalMap;
-};
-
-uniform Material material;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMatrix;
 
+// Per-mesh decoding of the vertex attributes, one entry per mesh of the
+// model (see MeshBlock in obj_loader.cpp). Quantized meshes (see
+// OBJLoadOptions::quantizeVertices) have positions normalized to the mesh
+// bounds and octahedron-encoded normals; glTF meshes are read as stored and
+// carry their node's translation and scale and a flipped V here.
+struct MeshDecode {
+    vec4 positionOffset;    // w: 1 for quantized vertices
+    vec4 positionScale;
+    vec4 texCoordTransform; // xy: offset, zw: scale
+    ivec4 material;         // x: index into materials[] of butterfly.frag
+};
+
+layout(std140) uniform Meshes {
+    MeshDecode meshDecodes[256];
+};
+uniform int meshIndex;
+
 // Wing animation uniforms (keep for butterfly animation)
 uniform float leftWingAngle;
 uniform float rightWingAngle;
 
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
+    MeshDecode decode = meshDecodes[meshIndex];
+    vec3 position = decode.positionOffset.xyz + aPos * decode.positionScale.xyz;
+    vec3 normal = aNormal.xyz;
+    if (decode.positionOffset.w != 0.0) {
+        normal = decodeOctahedral(aNormal.xy);
+    }
+    
     // Apply model transformations
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(position, 1.0);
     
     // Wing animation temporarily disabled for debugging
     // if (aPos.x < -0.1) {  // Left wing
@@ -49,11 +71,12 @@ void main()
     // }
     
     // Transform normal to world space using normal matrix
-    Normal = normalize(normalMatrix * aNormal);
+    Normal = normalize(normalMatrix * normal);
     
     // Pass data to fragment shader
     FragPos = vec3(worldPos);
-    TexCoords = aTexCoords;
+    TexCoords = decode.texCoordTransform.xy + aTexCoords * decode.texCoordTransform.zw;
+    MaterialIndex = decode.material.x;
     
     // Final position
     gl_Position = projection * view * worldPos;
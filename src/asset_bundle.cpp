@@ -0,0 +1,214 @@
+#include "asset_bundle.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "checksum.h"
+
+namespace {
+    const char ASSET_BUNDLE_MAGIC[8] = {'A', 'S', 'S', 'E', 'T', 'B', 'N', 'D'};
+    const uint32_t ASSET_BUNDLE_FORMAT = 1;
+    // Entry data is aligned for the float and index arrays read in place
+    const size_t DATA_ALIGNMENT = 16;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t entryCount;
+        uint64_t tableSize;     // Entry records and names following the header
+        uint64_t fileSize;
+        uint64_t checksum;      // Of the table
+    };
+
+    struct EntryRecord {
+        uint32_t kind;
+        uint32_t nameLength;
+        uint64_t nameOffset;    // From the start of the file
+        uint64_t dataOffset;
+        uint64_t dataSize;
+        uint64_t contentHash;
+    };
+
+    static_assert(sizeof(FileHeader) == 40, "Unexpected bundle header layout");
+    static_assert(sizeof(EntryRecord) == 40, "Unexpected bundle entry layout");
+
+    size_t AlignUp(size_t value) {
+        return (value + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+    }
+}
+
+AssetBundle& AssetBundle::Instance() {
+    static AssetBundle bundle;
+    return bundle;
+}
+
+std::string AssetBundle::IndexKey(AssetKind kind, const std::string& name) {
+    return std::to_string(static_cast<uint32_t>(kind)) + ":" + name;
+}
+
+bool AssetBundle::Open(const std::string& path) {
+    Close();
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false; // Not built
+    }
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    const char* base = file.Data();
+    size_t size = file.Size();
+    FileHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Asset bundle is truncated: " << path << std::endl;
+        Close();
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, ASSET_BUNDLE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.formatVersion != ASSET_BUNDLE_FORMAT) {
+        std::cerr << "Asset bundle has an unknown format: " << path << std::endl;
+        Close();
+        return false;
+    }
+    if (header.fileSize != size || header.tableSize > size - sizeof(header) ||
+        static_cast<uint64_t>(header.entryCount) * sizeof(EntryRecord) > header.tableSize) {
+        std::cerr << "Asset bundle size mismatch: " << path << std::endl;
+        Close();
+        return false;
+    }
+
+    Checksum checksum;
+    checksum.UpdateWords(base + sizeof(header), header.tableSize);
+    if (checksum.Finish() != header.checksum) {
+        std::cerr << "Asset bundle checksum mismatch: " << path << std::endl;
+        Close();
+        return false;
+    }
+
+    entries.reserve(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        EntryRecord record;
+        std::memcpy(&record, base + sizeof(header) + i * sizeof(EntryRecord), sizeof(record));
+        bool valid = record.nameOffset <= size && record.nameLength <= size - record.nameOffset &&
+                     record.dataOffset % DATA_ALIGNMENT == 0 &&
+                     record.dataOffset <= size && record.dataSize <= size - record.dataOffset;
+        if (!valid) {
+            std::cerr << "Asset bundle entry " << i << " is out of bounds: " << path << std::endl;
+            Close();
+            return false;
+        }
+
+        AssetBundleEntry entry;
+        entry.kind = static_cast<AssetKind>(record.kind);
+        entry.name.assign(base + record.nameOffset, record.nameLength);
+        entry.contentHash = record.contentHash;
+        entry.data = base + record.dataOffset;
+        entry.size = static_cast<size_t>(record.dataSize);
+        index[IndexKey(entry.kind, entry.name)] = entries.size();
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+void AssetBundle::Close() {
+    entries.clear();
+    index.clear();
+    file.Close();
+}
+
+const AssetBundleEntry* AssetBundle::Find(AssetKind kind, const std::string& name) const {
+    if (entries.empty()) {
+        return nullptr;
+    }
+    auto it = index.find(IndexKey(kind, name));
+    return it != index.end() ? &entries[it->second] : nullptr;
+}
+
+void AssetBundleWriter::Add(AssetKind kind, const std::string& name, uint64_t contentHash,
+                            const char* data, size_t size) {
+    PendingEntry entry;
+    entry.kind = kind;
+    entry.name = name;
+    entry.contentHash = contentHash;
+    entry.data.assign(data, data + size);
+    entries.push_back(std::move(entry));
+}
+
+bool AssetBundleWriter::Write(const std::string& path) const {
+    // Lay out the file: header, entry records, names, then aligned entry data
+    std::vector<EntryRecord> records(entries.size());
+    size_t namesSize = 0;
+    for (const PendingEntry& entry : entries) {
+        namesSize += entry.name.size();
+    }
+    size_t tableSize = AlignUp(records.size() * sizeof(EntryRecord) + namesSize);
+    size_t nameOffset = sizeof(FileHeader) + records.size() * sizeof(EntryRecord);
+    size_t dataOffset = AlignUp(sizeof(FileHeader) + tableSize);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EntryRecord& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        record.kind = static_cast<uint32_t>(entries[i].kind);
+        record.nameLength = static_cast<uint32_t>(entries[i].name.size());
+        record.nameOffset = nameOffset;
+        record.dataOffset = dataOffset;
+        record.dataSize = entries[i].data.size();
+        record.contentHash = entries[i].contentHash;
+        nameOffset += entries[i].name.size();
+        dataOffset = AlignUp(dataOffset + entries[i].data.size());
+    }
+
+    std::vector<char> table(tableSize, 0);
+    if (!records.empty()) {
+        std::memcpy(table.data(), records.data(), records.size() * sizeof(EntryRecord));
+    }
+    size_t cursor = records.size() * sizeof(EntryRecord);
+    for (const PendingEntry& entry : entries) {
+        std::memcpy(table.data() + cursor, entry.name.data(), entry.name.size());
+        cursor += entry.name.size();
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ASSET_BUNDLE_MAGIC, sizeof(header.magic));
+    header.formatVersion = ASSET_BUNDLE_FORMAT;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.tableSize = tableSize;
+    header.fileSize = dataOffset;
+    Checksum checksum;
+    checksum.UpdateWords(table.data(), table.size());
+    header.checksum = checksum.Finish();
+
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to create asset bundle: " << tempPath << std::endl;
+        return false;
+    }
+    static const char zeros[DATA_ALIGNMENT] = {};
+    size_t written = sizeof(header) + table.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(table.data(), table.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out.write(zeros, records[i].dataOffset - written);
+        out.write(entries[i].data.data(), entries[i].data.size());
+        written = records[i].dataOffset + entries[i].data.size();
+    }
+    out.write(zeros, header.fileSize - written);
+    out.close();
+
+    if (!out) {
+        std::cerr << "Failed to write asset bundle: " << tempPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to move asset bundle into place: " << path << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
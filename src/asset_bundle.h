@@ -0,0 +1,83 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.h"
+
+// What an entry's bytes are
+enum class AssetKind : uint32_t {
+    Mesh = 1,       // A .meshbin file (mesh_cache.h)
+    Texture = 2     // A .btex file (texture_cache.h)
+};
+
+// One preprocessed asset inside a bundle
+struct AssetBundleEntry {
+    AssetKind kind;
+    std::string name;       // The path the program loads the source asset by
+    uint64_t contentHash;   // Of the source bytes, their dependencies and the build settings
+    const char* data;       // Points into the mapped bundle
+    size_t size;
+};
+
+// A single file of preprocessed meshes and textures written by the assetc
+// tool. Opening it maps the file and reads the entry table only; each entry
+// is validated by its own cache header when it is used, so loaders skip
+// parsing, clipping, optimization and texture compression and read the
+// results in place.
+class AssetBundle {
+public:
+    AssetBundle() = default;
+
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    // The bundle the model and texture loaders look in. Open it before any
+    // loads start; lookups from worker threads are read-only.
+    static AssetBundle& Instance();
+
+    // Map the bundle and read its table. Fails on an unknown format version,
+    // truncation or a corrupt table.
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return file.IsOpen(); }
+
+    // The entry for a source path, or null
+    const AssetBundleEntry* Find(AssetKind kind, const std::string& name) const;
+    const std::vector<AssetBundleEntry>& Entries() const { return entries; }
+    size_t FileSize() const { return file.Size(); }
+
+private:
+    static std::string IndexKey(AssetKind kind, const std::string& name);
+
+    MappedFile file;
+    std::vector<AssetBundleEntry> entries;
+    std::unordered_map<std::string, size_t> index;
+};
+
+// Collects entries and writes a bundle
+class AssetBundleWriter {
+public:
+    void Add(AssetKind kind, const std::string& name, uint64_t contentHash, const char* data, size_t size);
+
+    // Entries are stored in the order they were added. Written to a
+    // temporary file and renamed, so a running program never maps a
+    // partial bundle.
+    bool Write(const std::string& path) const;
+
+    size_t EntryCount() const { return entries.size(); }
+
+private:
+    struct PendingEntry {
+        AssetKind kind;
+        std::string name;
+        uint64_t contentHash;
+        std::vector<char> data;
+    };
+    std::vector<PendingEntry> entries;
+};
+
+#endif // ASSET_BUNDLE_H
@@ -0,0 +1,131 @@
+#include "asset_cache.h"
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include "obj_loader.h"
+#include "texture_array.h"
+
+namespace {
+    // Everything in OBJLoadOptions that changes the loaded model
+    std::string ModelKey(const std::string& canonicalPath, const OBJLoadOptions& options) {
+        std::string key = canonicalPath;
+        key += '|';
+        key += options.useLegacyParser ? 'L' : '-';
+        key += options.deduplicateVertices ? 'D' : '-';
+        key += options.optimizeMeshes ? 'O' : '-';
+        key += options.quantizeVertices ? 'Q' : '-';
+        key += options.buildMeshlets ? 'M' : '-';
+        key += options.meshletConeCulling ? 'C' : '-';
+        key += options.generateLods ? 'S' : '-';
+        if (options.clipToPlane) {
+            key += "|clip " + std::to_string(options.clipPlane.x) + ' ' + std::to_string(options.clipPlane.y) + ' ' +
+                   std::to_string(options.clipPlane.z) + ' ' + std::to_string(options.clipPlane.w);
+        }
+        return key;
+    }
+    
+    // The images of a texture set, in layer order
+    std::string TextureSetKey(const std::vector<std::string>& paths) {
+        std::string key;
+        for (const std::string& path : paths) {
+            key += AssetCache::CanonicalPath(path);
+            key += '\n';
+        }
+        return key;
+    }
+    
+    // Forget freed assets so the maps do not grow with every reload
+    template <typename Map>
+    void PruneExpired(Map& entries) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.expired()) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+AssetCache& AssetCache::Instance() {
+    static AssetCache cache;
+    return cache;
+}
+
+std::string AssetCache::CanonicalPath(const std::string& path) {
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) != nullptr) {
+        return std::string(resolved);
+    }
+    return path;
+}
+
+ModelHandle AssetCache::AcquireModel(Shader& shader, const std::string& path, const OBJLoadOptions& options) {
+    std::string key = ModelKey(CanonicalPath(path), options);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = models.find(key);
+    ModelHandle model = it != models.end() ? it->second.lock() : ModelHandle();
+    if (model) {
+        stats.modelHits++;
+        return model;
+    }
+    
+    stats.modelMisses++;
+    model = std::make_shared<OBJLoader>(shader);
+    model->SetOptions(options);
+    model->LoadModelAsync(path);
+    PruneExpired(models);
+    models[key] = model;
+    return model;
+}
+
+TextureHandle AssetCache::FindTextureSet(const std::vector<std::string>& paths) {
+    std::string key = TextureSetKey(paths);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(key);
+    TextureHandle texture = it != textures.end() ? it->second.lock() : TextureHandle();
+    if (texture) {
+        stats.textureHits++;
+    } else {
+        stats.textureMisses++;
+    }
+    return texture;
+}
+
+TextureHandle AssetCache::AddTextureSet(const std::vector<std::string>& paths, const TextureHandle& texture) {
+    std::string key = TextureSetKey(paths);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(key);
+    TextureHandle existing = it != textures.end() ? it->second.lock() : TextureHandle();
+    if (existing) {
+        return existing;
+    }
+    PruneExpired(textures);
+    textures[key] = texture;
+    return texture;
+}
+
+AssetCacheStats AssetCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    AssetCacheStats result = stats;
+    result.liveModels = 0;
+    result.liveTextures = 0;
+    for (const auto& entry : models) {
+        if (!entry.second.expired()) result.liveModels++;
+    }
+    for (const auto& entry : textures) {
+        if (!entry.second.expired()) result.liveTextures++;
+    }
+    return result;
+}
+
+void AssetCache::PrintStats() const {
+    AssetCacheStats current = GetStats();
+    std::cout << "Asset cache: models " << current.modelHits << " hits / " << current.modelMisses
+              << " misses (" << current.liveModels << " live), texture sets " << current.textureHits
+              << " hits / " << current.textureMisses << " misses (" << current.liveTextures << " live)"
+              << std::endl;
+}
@@ -0,0 +1,69 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class OBJLoader;
+class Shader;
+class TextureArraySet;
+struct OBJLoadOptions;
+
+// A model's material textures, shared by every model whose materials use the
+// same images. The arrays are deleted when the last handle goes away, so
+// handles must be released on the render thread.
+typedef std::shared_ptr<TextureArraySet> TextureHandle;
+typedef std::shared_ptr<OBJLoader> ModelHandle;
+
+struct AssetCacheStats {
+    size_t modelHits;
+    size_t modelMisses;
+    size_t textureHits;
+    size_t textureMisses;   // Texture sets whose images had to be decoded
+    size_t liveModels;
+    size_t liveTextures;
+    
+    AssetCacheStats() : modelHits(0), modelMisses(0), textureHits(0), textureMisses(0),
+                        liveModels(0), liveTextures(0) {}
+};
+
+// Process-wide cache of loaded models and textures keyed by canonical path.
+// Entries are weak: an asset lives exactly as long as someone holds its
+// handle, and the next request after that loads it again.
+class AssetCache {
+public:
+    static AssetCache& Instance();
+    
+    // Shared model for the file and load options. A miss creates the loader
+    // and starts LoadModelAsync; callers drive OBJLoader::UploadPending.
+    ModelHandle AcquireModel(Shader& shader, const std::string& path, const OBJLoadOptions& options);
+    
+    // The live texture set holding exactly these images in this order, or
+    // null (counted as a miss)
+    TextureHandle FindTextureSet(const std::vector<std::string>& paths);
+    // Share a texture set built for paths. If another one was added for the
+    // same images in the meantime, that one is returned instead.
+    TextureHandle AddTextureSet(const std::vector<std::string>& paths, const TextureHandle& textures);
+    
+    AssetCacheStats GetStats() const;
+    void PrintStats() const;
+    
+    // Absolute path with symlinks and "." / ".." resolved; the input itself
+    // if the file does not exist
+    static std::string CanonicalPath(const std::string& path);
+    
+private:
+    AssetCache() = default;
+    
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<OBJLoader>> models;
+    std::unordered_map<std::string, std::weak_ptr<TextureArraySet>> textures;
+    AssetCacheStats stats;
+};
+
+#endif // ASSET_CACHE_H
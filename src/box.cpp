@@ -2,17 +2,45 @@
 #include "shader.h"
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include "job_system.h"
 
 // Debug logging macro
 #define LOG_DEBUG(message) std::cout << "[Box Debug] " << message << std::endl
 
+// Boxes per AVX2 vector; parallel updates split on multiples of it
+const size_t BOX_UPDATE_BLOCK = 8;
+// Blocks per job: 16K boxes, about 0.8 MB of motion state, which keeps the
+// fork overhead small next to the work
+const size_t BOX_UPDATE_GRAIN_BLOCKS = 2048;
+
+// Bounding sphere radius of the unit cube (half its diagonal), times the scale
+const float BOX_BOUNDING_RADIUS = 0.8660254f;
+
 // Initialize static members
-std::vector<Box::InstanceData> Box::instances;
+Box::InstanceArrays Box::boxes;
+std::vector<Box::InstanceData> Box::lights;
+SlotMap Box::boxSlots;
+SlotMap Box::lightSlots;
+SimdKernel Box::updateKernel = BestSimdKernel();
+SimdKernel Box::cullKernel = BestSimdKernel();
+CullStats Box::cullStats;
+std::vector<uint32_t> Box::visibleBoxes;
+LooseOctree Box::spatialIndex(glm::vec3(0.0f), BOX_WRAP_BOUNDARY);
+bool Box::spatialIndexDirty = false;
 bool Box::buffersInitialized = false;
 GLuint Box::VAO = 0;
 GLuint Box::VBO = 0;
 GLuint Box::EBO = 0;
+StreamBuffer Box::instanceStream;
+GpuBoxSimulation Box::gpuSimulation;
+bool Box::gpuSimulationEnabled = false;
+bool Box::gpuStateDirty = false;
+size_t Box::dirtyFirst = 0;
+size_t Box::dirtyLast = 0;
+std::unique_ptr<Shader> Box::gpuDrawShader;
 
 // Cube vertices with positions and normals (interleaved)
 const float cubeVertices[] = {
@@ -71,13 +99,245 @@ const unsigned int cubeIndices[] = {
     6, 7, 3
 };
 
+void Box::InstanceArrays::push_back(const InstanceData& instance) {
+    positionX.push_back(instance.position.x);
+    positionY.push_back(instance.position.y);
+    positionZ.push_back(instance.position.z);
+    velocityX.push_back(instance.velocity.x);
+    velocityY.push_back(instance.velocity.y);
+    velocityZ.push_back(instance.velocity.z);
+    rotation.push_back(instance.rotation);
+    rotationSpeed.push_back(instance.rotationSpeed);
+    scale.push_back(instance.scale);
+    color.push_back(instance.color);
+}
+
+namespace {
+    template <typename T>
+    void SwapRemove(std::vector<T>& values, size_t index) {
+        values[index] = values.back();
+        values.pop_back();
+    }
+}
+
+void Box::InstanceArrays::swapRemove(size_t index) {
+    SwapRemove(positionX, index);
+    SwapRemove(positionY, index);
+    SwapRemove(positionZ, index);
+    SwapRemove(velocityX, index);
+    SwapRemove(velocityY, index);
+    SwapRemove(velocityZ, index);
+    SwapRemove(rotation, index);
+    SwapRemove(rotationSpeed, index);
+    SwapRemove(scale, index);
+    SwapRemove(color, index);
+}
+
+Box::InstanceData Box::InstanceArrays::get(size_t index) const {
+    InstanceData instance(glm::vec3(positionX[index], positionY[index], positionZ[index]), color[index],
+                          scale[index], glm::vec3(velocityX[index], velocityY[index], velocityZ[index]),
+                          rotationSpeed[index]);
+    instance.rotation = rotation[index];
+    return instance;
+}
+
+void Box::InstanceArrays::set(size_t index, const InstanceData& instance) {
+    positionX[index] = instance.position.x;
+    positionY[index] = instance.position.y;
+    positionZ[index] = instance.position.z;
+    velocityX[index] = instance.velocity.x;
+    velocityY[index] = instance.velocity.y;
+    velocityZ[index] = instance.velocity.z;
+    rotation[index] = instance.rotation;
+    rotationSpeed[index] = instance.rotationSpeed;
+    scale[index] = instance.scale;
+    color[index] = instance.color;
+}
+
+void Box::InstanceArrays::clear() {
+    positionX.clear();
+    positionY.clear();
+    positionZ.clear();
+    velocityX.clear();
+    velocityY.clear();
+    velocityZ.clear();
+    rotation.clear();
+    rotationSpeed.clear();
+    scale.clear();
+    color.clear();
+}
+
+BoxMotionArrays Box::InstanceArrays::motion() {
+    BoxMotionArrays arrays;
+    arrays.positionX = positionX.data();
+    arrays.positionY = positionY.data();
+    arrays.positionZ = positionZ.data();
+    arrays.velocityX = velocityX.data();
+    arrays.velocityY = velocityY.data();
+    arrays.velocityZ = velocityZ.data();
+    arrays.rotation = rotation.data();
+    arrays.rotationSpeed = rotationSpeed.data();
+    return arrays;
+}
+
+SphereArrays Box::boxSpheres() {
+    SphereArrays spheres = {boxes.positionX.data(), boxes.positionY.data(), boxes.positionZ.data(),
+                            boxes.scale.data(), BOX_BOUNDING_RADIUS};
+    return spheres;
+}
+
+void Box::syncFromGpu() {
+    if (gpuSimulationEnabled && !gpuStateDirty) {
+        // Edited boxes go up first, so the download returns them unchanged
+        syncToGpu();
+        gpuSimulation.Download(boxes.motion());
+        gpuStateDirty = true;
+    }
+}
+
+void Box::syncToGpu() {
+    if (!gpuSimulationEnabled) {
+        return;
+    }
+    if (gpuStateDirty) {
+        gpuSimulation.Upload(boxes.motion(), boxes.scale.data(), boxes.color.data(), boxes.size());
+        gpuStateDirty = false;
+    } else if (dirtyFirst < dirtyLast) {
+        gpuSimulation.UploadRange(boxes.motion(), boxes.scale.data(), boxes.color.data(), dirtyFirst, dirtyLast);
+    }
+    dirtyFirst = dirtyLast = 0;
+}
+
+void Box::markDirty(size_t first, size_t last) {
+    if (!gpuSimulationEnabled || gpuStateDirty) {
+        return;
+    }
+    if (dirtyFirst < dirtyLast && (last < dirtyFirst || first > dirtyLast)) {
+        syncToGpu();
+    }
+    if (dirtyFirst < dirtyLast) {
+        dirtyFirst = std::min(dirtyFirst, first);
+        dirtyLast = std::max(dirtyLast, last);
+    } else {
+        dirtyFirst = first;
+        dirtyLast = last;
+    }
+}
+
 // Add a box instance
-void Box::addInstance(const InstanceData& instance) {
-    instances.push_back(instance);
+Box::InstanceHandle Box::addInstance(const InstanceData& instance) {
+    if (instance.isLightSource) {
+        lights.push_back(instance);
+        return InstanceHandle(lightSlots.Insert(), true);
+    }
+    boxes.push_back(instance);
+    markDirty(boxes.size() - 1, boxes.size());
+    return InstanceHandle(boxSlots.Insert(), false);
+}
+
+bool Box::removeInstance(InstanceHandle handle) {
+    size_t index = 0;
+    size_t last = 0;
+    if (handle.isLightSource) {
+        if (!lightSlots.Remove(handle.slot, index, last)) {
+            return false;
+        }
+        SwapRemove(lights, index);
+        return true;
+    }
+    if (!boxSlots.Remove(handle.slot, index, last)) {
+        return false;
+    }
+    if (spatialIndex.ObjectCount() == boxes.size()) {
+        spatialIndex.SwapRemove(static_cast<uint32_t>(index));
+    }
+    if (gpuSimulationEnabled && !gpuStateDirty) {
+        // Only the GPU knows where the last box is now, so it moves there;
+        // pending edits go up first so none lands on the wrong box
+        syncToGpu();
+        gpuSimulation.MoveInstance(last, index);
+        gpuSimulation.Truncate(last);
+    }
+    boxes.swapRemove(index);
+    return true;
+}
+
+bool Box::isValid(InstanceHandle handle) {
+    return handle.isLightSource ? lightSlots.Contains(handle.slot) : boxSlots.Contains(handle.slot);
+}
+
+bool Box::getInstance(InstanceHandle handle, InstanceData& instance) {
+    size_t index = 0;
+    if (handle.isLightSource) {
+        if (!lightSlots.Find(handle.slot, index)) {
+            return false;
+        }
+        instance = lights[index];
+        return true;
+    }
+    if (!boxSlots.Find(handle.slot, index)) {
+        return false;
+    }
+    // A box the GPU moves is only current there, unless edited since
+    bool edited = index >= dirtyFirst && index < dirtyLast;
+    if (gpuSimulationEnabled && !gpuStateDirty && !edited) {
+        gpuSimulation.DownloadRange(boxes.motion(), index, index + 1);
+    }
+    instance = boxes.get(index);
+    return true;
+}
+
+bool Box::setInstance(InstanceHandle handle, const InstanceData& instance) {
+    size_t index = 0;
+    if (instance.isLightSource != handle.isLightSource) {
+        return false;
+    }
+    if (handle.isLightSource) {
+        if (!lightSlots.Find(handle.slot, index)) {
+            return false;
+        }
+        lights[index] = instance;
+        return true;
+    }
+    if (!boxSlots.Find(handle.slot, index)) {
+        return false;
+    }
+    boxes.set(index, instance);
+    markDirty(index, index + 1);
+    spatialIndexDirty = true;
+    return true;
 }
 
 void Box::clearInstances() {
-    instances.clear();
+    boxes.clear();
+    lights.clear();
+    boxSlots.Clear();
+    lightSlots.Clear();
+    gpuStateDirty = true;
+    dirtyFirst = dirtyLast = 0;
+}
+
+bool Box::setGpuSimulation(bool enabled) {
+    if (enabled == gpuSimulationEnabled) {
+        return true;
+    }
+    if (enabled) {
+        setupBuffers();
+        if (!gpuSimulation.Create()) {
+            return false;
+        }
+        if (!gpuDrawShader) {
+            gpuDrawShader.reset(new Shader("shaders/box.vert", "shaders/box.frag", "#define GPU_SIMULATION\n"));
+        }
+        gpuSimulationEnabled = true;
+        gpuStateDirty = true;
+    } else {
+        // Carry on from where the GPU left the boxes
+        syncFromGpu();
+        gpuSimulationEnabled = false;
+        spatialIndexDirty = true;
+    }
+    return true;
 }
 
 void Box::setupBuffers() {
@@ -88,10 +348,15 @@ void Box::setupBuffers() {
 }
 
 void Box::cleanup() {
+    syncFromGpu();
+    gpuSimulationEnabled = false;
+    gpuSimulation.Destroy();
+    gpuDrawShader.reset();
     if (VAO != 0) {
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
         glDeleteBuffers(1, &EBO);
+        instanceStream.Destroy();
         VAO = VBO = EBO = 0;
         buffersInitialized = false;
     }
@@ -131,6 +396,14 @@ void Box::initCube() {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
     
+    // Instance attributes advance once per instance. They point into the
+    // stream buffer, which drawInstances creates on first use, once the
+    // scene's boxes have been added, and rebinds on every draw.
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribDivisor(3, 1);
+    
     // Check for OpenGL errors
     GLenum err;
     while ((err = glGetError()) != GL_NO_ERROR) {
@@ -143,110 +416,150 @@ void Box::initCube() {
     LOG_DEBUG("Cube initialization complete");
 }
 
-void Box::drawCube(Shader& shader, const glm::mat4& model, const glm::vec3& color, float rotation) {
-    // Create a rotation matrix
-    glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), rotation, glm::vec3(0.5f, 1.0f, 0.3f));
-    
-    // Combine rotation with the model matrix
-    glm::mat4 finalModel = model * rotationMatrix;
-    
-    // Set the model matrix and color
-    shader.setMat4("model", finalModel);
-    shader.setVec3("instanceColor", color);
-    
-    // Draw the cube
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Box::bindInstanceAttributes(size_t offset) {
+    // Position and scale, then color and rotation
+    glBindBuffer(GL_ARRAY_BUFFER, instanceStream.Buffer());
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GpuInstance),
+                          (void*)(offset + offsetof(GpuInstance, position)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(GpuInstance),
+                          (void*)(offset + offsetof(GpuInstance, color)));
 }
 
 // Update all instances
 void Box::updateInstances(float deltaTime) {
-    for (auto& instance : instances) {
-        instance.update(deltaTime);
+    // On the GPU the boxes move without a CPU update, upload or refit
+    if (gpuSimulationEnabled) {
+        syncToGpu();
+        gpuSimulation.Step(deltaTime);
+        return;
     }
+    
+    // Split on whole 8-box blocks so no two jobs share a vector of the kernel
+    BoxMotionArrays motion = boxes.motion();
+    size_t count = boxes.size();
+    size_t blockCount = (count + BOX_UPDATE_BLOCK - 1) / BOX_UPDATE_BLOCK;
+    JobSystem::Instance().ParallelFor(0, blockCount, BOX_UPDATE_GRAIN_BLOCKS, [&](size_t first, size_t last) {
+        UpdateBoxMotion(motion, first * BOX_UPDATE_BLOCK, std::min(last * BOX_UPDATE_BLOCK, count),
+                        deltaTime, updateKernel);
+    });
+    spatialIndexDirty = true;
+}
+
+const LooseOctree& Box::getSpatialIndex() {
+    // Only boxes that changed cell (including wraparounds) move in the index;
+    // added or removed boxes make it rebuild
+    if (spatialIndexDirty || spatialIndex.ObjectCount() != boxes.size()) {
+        spatialIndex.Refit(boxSpheres(), boxes.size());
+        spatialIndexDirty = false;
+    }
+    return spatialIndex;
 }
 
 // Draw all instances using modern OpenGL
 void Box::drawInstances(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float time) {
-    if (instances.empty()) {
+    // Cull the moving boxes four or eight at a time; the few light sources
+    // are tested one by one. Boxes simulated on the GPU have no positions
+    // here to cull and are all drawn.
+    MeshletFrustum frustum(projection * view);
+    size_t litCount = 0;
+    if (gpuSimulationEnabled) {
+        syncToGpu();
+        litCount = gpuSimulation.Count();
+    } else {
+        visibleBoxes.resize(boxes.size());
+        litCount = CullSpheres(frustum, boxSpheres(), 0, boxes.size(), visibleBoxes.data(), cullKernel);
+    }
+    size_t lightCount = 0;
+    for (const InstanceData& light : lights) {
+        if (frustum.IsSphereVisible(light.position, light.scale * BOX_BOUNDING_RADIUS)) {
+            lightCount++;
+        }
+    }
+    cullStats.tested = instanceCount();
+    cullStats.visible = litCount + lightCount;
+    
+    size_t count = litCount + lightCount;
+    if (count == 0) {
         return;
     }
     
     // Make sure buffers are set up
     setupBuffers();
     
-    // Use the shader
-    shader.use();
-    
-    // Set up view and projection matrices
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
-    
-    // Set view position (camera position) for lighting calculations
-    glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
-    shader.setVec3("viewPos", viewPos);
-    
-    // Find the light source (if any)
-    glm::vec3 lightPos(0.0f, 10.0f, 0.0f); // Default light position (above the scene)
-    bool hasLightSource = false;
-    
-    // First pass: find the light source
-    for (const auto& instance : instances) {
-        if (instance.isLightSource) {
-            lightPos = instance.position;
-            hasLightSource = true;
-            break;
+    // Write the visible lit boxes (unless the GPU already has them), then
+    // the visible light sources, straight into this frame's region of the
+    // stream buffer, so each group is one contiguous range. Light sources
+    // do not rotate.
+    size_t streamedLit = gpuSimulationEnabled ? 0 : litCount;
+    size_t streamed = streamedLit + lightCount;
+    size_t offset = 0;
+    if (streamed > 0) {
+        if (!instanceStream.IsCreated()) {
+            // Room for every instance that could be streamed, with headroom
+            // for boxes added later, so a steady frame never reallocates
+            size_t capacity = gpuSimulationEnabled ? lights.size() : instanceCount();
+            instanceStream.Create((capacity + capacity / 2) * sizeof(GpuInstance));
+            LOG_DEBUG("Created instance stream buffer: " << instanceStream.Buffer()
+                      << (instanceStream.IsPersistent() ? " (persistent)" : ""));
         }
+        GpuInstance* gpuInstances = static_cast<GpuInstance*>(
+            instanceStream.Allocate(streamed * sizeof(GpuInstance), sizeof(GpuInstance), offset));
+        if (!gpuInstances) {
+            return;
+        }
+        for (size_t i = 0; i < streamedLit; ++i) {
+            uint32_t box = visibleBoxes[i];
+            GpuInstance& gpu = gpuInstances[i];
+            gpu.position = glm::vec3(boxes.positionX[box], boxes.positionY[box], boxes.positionZ[box]);
+            gpu.scale = boxes.scale[box];
+            gpu.color = boxes.color[box];
+            gpu.rotation = boxes.rotation[box];
+        }
+        GpuInstance* gpu = gpuInstances + streamedLit;
+        for (const InstanceData& light : lights) {
+            if (!frustum.IsSphereVisible(light.position, light.scale * BOX_BOUNDING_RADIUS)) {
+                continue;
+            }
+            gpu->position = light.position;
+            gpu->scale = light.scale;
+            gpu->color = light.color;
+            gpu->rotation = 0.0f;
+            gpu++;
+        }
+        instanceStream.Commit();
     }
+    glm::vec3 lightPos = lights.empty() ? glm::vec3(0.0f, 10.0f, 0.0f) // Default light position (above the scene)
+                                        : lights.front().position;
+    
+    // Set up view and projection matrices, and the view and light positions
+    // for lighting calculations
+    glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
+    auto setUniforms = [&](Shader& program, bool isLightSource) {
+        program.use();
+        program.setMat4("view", view);
+        program.setMat4("projection", projection);
+        program.setVec3("viewPos", viewPos);
+        program.setVec3("lightPos", lightPos);
+        program.setBool("isLightSource", isLightSource);
+    };
     
-    // Bind the VAO
     glBindVertexArray(VAO);
     
-    // Draw each instance
-    for (const auto& instance : instances) {
-        // Skip light source in the first pass
-        if (instance.isLightSource) {
-            continue;
-        }
-        
-        // Create model matrix for this instance
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, instance.position);
-        model = glm::scale(model, glm::vec3(instance.scale));
-        model = glm::rotate(model, instance.rotation, glm::vec3(0.0f, 1.0f, 0.0f));
-        
-        // Set the model matrix and color
-        shader.setMat4("model", model);
-        shader.setVec3("instanceColor", instance.color);
-        shader.setBool("isLightSource", false);
-        shader.setVec3("lightPos", lightPos);
-        
-        // Draw the cube
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
-    
-    // Second pass: draw light sources
-    if (hasLightSource) {
-        // Use a different shader or set a flag for light sources
-        for (const auto& instance : instances) {
-            if (!instance.isLightSource) {
-                continue;
-            }
-            
-            // Create model matrix for the light source
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, instance.position);
-            model = glm::scale(model, glm::vec3(instance.scale));
-            
-            // Set the model matrix and color
-            shader.setMat4("model", model);
-            shader.setVec3("instanceColor", instance.color);
-            shader.setBool("isLightSource", true);
-            
-            // Draw the light source
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    if (litCount > 0) {
+        if (gpuSimulationEnabled) {
+            // Straight from the simulation's latest state
+            setUniforms(*gpuDrawShader, false);
+            gpuSimulation.BindInstanceAttributes(2, 3);
+        } else {
+            setUniforms(shader, false);
+            bindInstanceAttributes(offset);
         }
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(litCount));
+    }
+    if (lightCount > 0) {
+        setUniforms(shader, true);
+        bindInstanceAttributes(offset + streamedLit * sizeof(GpuInstance));
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(lightCount));
     }
     
     // Unbind VAO
@@ -4,8 +4,15 @@
 #include "../external/glad-3.3/include/glad/gl.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
 #include <vector>
 #include <string>
+#include "box_update.h"
+#include "frustum_cull.h"
+#include "gpu_box_simulation.h"
+#include "loose_octree.h"
+#include "slot_map.h"
+#include "stream_buffer.h"
 
 class Shader;
 
@@ -20,59 +27,132 @@ public:
         float rotationSpeed;
         bool isLightSource;  // Whether this box is a light source
         
+        // A box that stays still
         InstanceData(const glm::vec3& pos, const glm::vec3& col, float scl, bool isLight = false)
-            : position(pos), color(col), scale(scl), rotation(0.0f), isLightSource(isLight) {
-            // Random velocity
-            velocity = glm::vec3(
-                (rand() % 100 - 50) * 0.001f,  // -0.05 to 0.05
-                (rand() % 100 - 50) * 0.001f,
-                (rand() % 100 - 50) * 0.001f
-            );
-            // Random rotation speed
-            rotationSpeed = (rand() % 100) * 0.001f + 0.001f; // 0.001 to 0.1
-        }
+            : position(pos), velocity(0.0f), color(col), scale(scl), rotation(0.0f), rotationSpeed(0.0f),
+              isLightSource(isLight) {}
+        // A moving, spinning box (scene_generator.cpp picks the scene's)
+        InstanceData(const glm::vec3& pos, const glm::vec3& col, float scl, const glm::vec3& vel, float spin)
+            : position(pos), velocity(vel), color(col), scale(scl), rotation(0.0f), rotationSpeed(spin),
+              isLightSource(false) {}
+    };
+
+    // Refers to a box or light source from addInstance until it is removed
+    // or the instances are cleared
+    struct InstanceHandle {
+        SlotHandle slot;
+        bool isLightSource;
         
-        void update(float deltaTime) {
-            // Skip update for light sources to keep them fixed
-            if (isLightSource) {
-                return;
-            }
-            
-            // Update position for non-light boxes
-            position += velocity * deltaTime * 60.0f; // Scale by delta time and a speed factor
-            
-            // Update rotation
-            rotation += rotationSpeed * deltaTime * 60.0f;
-            if (rotation > 360.0f) rotation -= 360.0f;
-            
-            // Simple boundary checking (optional: make boxes wrap around)
-            const float boundary = 10.0f;
-            if (position.x < -boundary) position.x = boundary;
-            if (position.x > boundary) position.x = -boundary;
-            if (position.y < -boundary) position.y = boundary;
-            if (position.y > boundary) position.y = -boundary;
-            if (position.z < -boundary) position.z = boundary;
-            if (position.z > boundary) position.z = -boundary;
-        }
+        InstanceHandle() : isLightSource(false) {}
+        InstanceHandle(SlotHandle slot, bool isLight) : slot(slot), isLightSource(isLight) {}
     };
 
-    static void addInstance(const InstanceData& instance);
+    static InstanceHandle addInstance(const InstanceData& instance);
+    // O(1): the last box (or light source) moves into the removed one's
+    // place, so the arrays stay dense. Returns false for a stale handle.
+    static bool removeInstance(InstanceHandle handle);
+    static bool isValid(InstanceHandle handle);
+    // Current state of an instance; false for a stale handle
+    static bool getInstance(InstanceHandle handle, InstanceData& instance);
+    // Replace an instance's state; it has to stay a box or a light source
+    static bool setInstance(InstanceHandle handle, const InstanceData& instance);
+    // Invalidates every handle
     static void clearInstances();
     static void setupBuffers();
     static void cleanup();
+    // Move every box that is not a light source (see UpdateBoxMotion)
     static void updateInstances(float deltaTime);
+    static size_t instanceCount() { return boxes.size() + lights.size(); }
+    // Defaults to the widest kernel the CPU supports
+    static void setUpdateKernel(SimdKernel kernel) { updateKernel = kernel; }
+    static SimdKernel getUpdateKernel() { return updateKernel; }
+    static void setCullKernel(SimdKernel kernel) { cullKernel = kernel; }
+    static SimdKernel getCullKernel() { return cullKernel; }
+    // Boxes and light sources tested and drawn by the last drawInstances
+    static const CullStats& getCullStats() { return cullStats; }
+    // Frustum, radius and ray queries over the moving boxes, as of the last
+    // updateInstances on the CPU. Results are storage indices of the boxes
+    // (light sources left out), which removeInstance reorders. The index is
+    // refit here, on the first query after the boxes moved, so frames that
+    // never query it don't pay for it.
+    static const LooseOctree& getSpatialIndex();
+    // Handle of the box stored at a spatial index result
+    static InstanceHandle boxHandleAt(size_t index) { return InstanceHandle(boxSlots.HandleAt(index), false); }
+    // Move the boxes on the GPU with transform feedback (GpuBoxSimulation)
+    // instead of on the CPU, for stress scenes. The boxes are then drawn
+    // from the GPU's buffers without culling, and light sources still stay
+    // put and are streamed as before. Needs a current context; returns
+    // false if the simulation program does not build.
+    static bool setGpuSimulation(bool enabled);
+    static bool isGpuSimulation() { return gpuSimulationEnabled; }
+    // Cull the instances against the view frustum, stream the visible ones
+    // to the GPU and draw them with two instanced calls: the lit boxes, then
+    // the light sources
     static void drawInstances(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float time);
     
 private:
-    static void drawCube(Shader& shader, const glm::mat4& model, const glm::vec3& color, float rotation = 0.0f);
-    static std::vector<InstanceData> instances;
+    // Per-instance vertex attributes (locations 2 and 3 in box.vert)
+    struct GpuInstance {
+        glm::vec3 position;
+        float scale;
+        glm::vec3 color;
+        float rotation;     // Radians about the Y axis
+    };
+    
+    // Moving boxes as a structure of arrays: the update streams only the
+    // motion arrays; color and scale are read when drawing
+    struct InstanceArrays {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> rotation, rotationSpeed;
+        std::vector<float> scale;
+        std::vector<glm::vec3> color;
+        
+        size_t size() const { return positionX.size(); }
+        void push_back(const InstanceData& instance);
+        // Move the last box to index and drop the last
+        void swapRemove(size_t index);
+        InstanceData get(size_t index) const;
+        void set(size_t index, const InstanceData& instance);
+        void clear();
+        BoxMotionArrays motion();
+    };
+    
+    static InstanceArrays boxes;
+    static std::vector<InstanceData> lights;        // Light sources stay where they were added
+    static SlotMap boxSlots, lightSlots;            // Handles to indices into boxes and lights
+    static SimdKernel updateKernel;
+    static SimdKernel cullKernel;
+    static CullStats cullStats;
+    static std::vector<uint32_t> visibleBoxes;     // Indices into boxes, rebuilt every draw
+    static LooseOctree spatialIndex;
+    static bool spatialIndexDirty;          // The boxes moved since the last refit
     static bool buffersInitialized;
     static GLuint VAO, VBO, EBO;
+    static StreamBuffer instanceStream;     // Lit boxes first, then light sources, each frame
+    static GpuBoxSimulation gpuSimulation;
+    static bool gpuSimulationEnabled;
+    static bool gpuStateDirty;              // All of boxes needs uploading to gpuSimulation
+    static size_t dirtyFirst, dirtyLast;    // Or just these boxes, edited since the last upload
+    static std::unique_ptr<Shader> gpuDrawShader;   // box.vert reading gpuSimulation's layout
+    
+    // Bounding spheres of the moving boxes, read in place
+    static SphereArrays boxSpheres();
+    // While the GPU simulates, the CPU copies of the positions go stale:
+    // syncFromGpu brings them back, syncToGpu uploads the edited boxes
+    static void syncFromGpu();
+    static void syncToGpu();
+    // Boxes [first, last) were edited on the CPU. Only one contiguous range
+    // is kept, so a disjoint edit uploads the previous range first instead
+    // of overwriting the boxes between them with stale positions.
+    static void markDirty(size_t first, size_t last);
     
-    // Initialize the cube's VAO, VBO, and EBO
+    // Initialize the cube's VAO, VBO, EBO and instance buffer
     static void initCube();
-    // Draw a single cube
-    static void drawCube(Shader& shader, const glm::mat4& model, const glm::vec3& color);
+    // Point the instance attributes at the instances starting at `offset`
+    // bytes into the stream buffer (GL 3.3 has no base instance for
+    // instanced draws)
+    static void bindInstanceAttributes(size_t offset);
 };
 
 #endif // BOX_H
@@ -0,0 +1,116 @@
+#include "box_update.h"
+
+namespace {
+    // Frame-rate scale of the original per-box update (tuned at 60 Hz)
+    const float SPEED_SCALE = 60.0f;
+    const float FULL_TURN = 360.0f;
+
+    inline float Wrap(float value) {
+        if (value < -BOX_WRAP_BOUNDARY) value = BOX_WRAP_BOUNDARY;
+        if (value > BOX_WRAP_BOUNDARY) value = -BOX_WRAP_BOUNDARY;
+        return value;
+    }
+
+    // Same operation order as the vector kernels, (v * dt) * 60, so the
+    // results match bit for bit
+    void UpdateScalar(const BoxMotionArrays& boxes, size_t first, size_t last, float deltaTime) {
+        for (size_t i = first; i < last; ++i) {
+            boxes.positionX[i] = Wrap(boxes.positionX[i] + boxes.velocityX[i] * deltaTime * SPEED_SCALE);
+            boxes.positionY[i] = Wrap(boxes.positionY[i] + boxes.velocityY[i] * deltaTime * SPEED_SCALE);
+            boxes.positionZ[i] = Wrap(boxes.positionZ[i] + boxes.velocityZ[i] * deltaTime * SPEED_SCALE);
+            float rotation = boxes.rotation[i] + boxes.rotationSpeed[i] * deltaTime * SPEED_SCALE;
+            if (rotation > FULL_TURN) rotation -= FULL_TURN;
+            boxes.rotation[i] = rotation;
+        }
+    }
+
+#ifdef SIMD_SSE2
+    // Without SSE4.1 there is no blendv: select with and/andnot/or
+    inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline void MoveSSE2(float* position, const float* velocity, size_t i, __m128 deltaTime, __m128 scale,
+                         __m128 low, __m128 high) {
+        __m128 p = _mm_loadu_ps(position + i);
+        __m128 v = _mm_loadu_ps(velocity + i);
+        p = _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(v, deltaTime), scale));
+        p = Select(_mm_cmplt_ps(p, low), high, p);
+        p = Select(_mm_cmpgt_ps(p, high), low, p);
+        _mm_storeu_ps(position + i, p);
+    }
+
+    size_t UpdateSSE2(const BoxMotionArrays& boxes, size_t first, size_t last, float deltaTime) {
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 scale = _mm_set1_ps(SPEED_SCALE);
+        const __m128 low = _mm_set1_ps(-BOX_WRAP_BOUNDARY);
+        const __m128 high = _mm_set1_ps(BOX_WRAP_BOUNDARY);
+        const __m128 turn = _mm_set1_ps(FULL_TURN);
+        size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            MoveSSE2(boxes.positionX, boxes.velocityX, i, dt, scale, low, high);
+            MoveSSE2(boxes.positionY, boxes.velocityY, i, dt, scale, low, high);
+            MoveSSE2(boxes.positionZ, boxes.velocityZ, i, dt, scale, low, high);
+            __m128 r = _mm_loadu_ps(boxes.rotation + i);
+            __m128 speed = _mm_loadu_ps(boxes.rotationSpeed + i);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(speed, dt), scale));
+            r = _mm_sub_ps(r, _mm_and_ps(_mm_cmpgt_ps(r, turn), turn));
+            _mm_storeu_ps(boxes.rotation + i, r);
+        }
+        return i;
+    }
+#endif
+
+#ifdef SIMD_AVX2
+    SIMD_AVX2_TARGET
+    inline void MoveAVX2(float* position, const float* velocity, size_t i, __m256 deltaTime, __m256 scale,
+                         __m256 low, __m256 high) {
+        __m256 p = _mm256_loadu_ps(position + i);
+        __m256 v = _mm256_loadu_ps(velocity + i);
+        p = _mm256_add_ps(p, _mm256_mul_ps(_mm256_mul_ps(v, deltaTime), scale));
+        p = _mm256_blendv_ps(p, high, _mm256_cmp_ps(p, low, _CMP_LT_OQ));
+        p = _mm256_blendv_ps(p, low, _mm256_cmp_ps(p, high, _CMP_GT_OQ));
+        _mm256_storeu_ps(position + i, p);
+    }
+
+    SIMD_AVX2_TARGET
+    size_t UpdateAVX2(const BoxMotionArrays& boxes, size_t first, size_t last, float deltaTime) {
+        const __m256 dt = _mm256_set1_ps(deltaTime);
+        const __m256 scale = _mm256_set1_ps(SPEED_SCALE);
+        const __m256 low = _mm256_set1_ps(-BOX_WRAP_BOUNDARY);
+        const __m256 high = _mm256_set1_ps(BOX_WRAP_BOUNDARY);
+        const __m256 turn = _mm256_set1_ps(FULL_TURN);
+        size_t i = first;
+        for (; i + 8 <= last; i += 8) {
+            MoveAVX2(boxes.positionX, boxes.velocityX, i, dt, scale, low, high);
+            MoveAVX2(boxes.positionY, boxes.velocityY, i, dt, scale, low, high);
+            MoveAVX2(boxes.positionZ, boxes.velocityZ, i, dt, scale, low, high);
+            __m256 r = _mm256_loadu_ps(boxes.rotation + i);
+            __m256 speed = _mm256_loadu_ps(boxes.rotationSpeed + i);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(speed, dt), scale));
+            r = _mm256_sub_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, turn, _CMP_GT_OQ), turn));
+            _mm256_storeu_ps(boxes.rotation + i, r);
+        }
+        return i;
+    }
+#endif
+}
+
+void UpdateBoxMotion(const BoxMotionArrays& boxes, size_t first, size_t last, float deltaTime,
+                     SimdKernel kernel) {
+    if (!IsSimdKernelSupported(kernel)) {
+        kernel = SimdKernel::Scalar;
+    }
+    // Vector loops stop short of a partial group; the scalar loop finishes it
+#ifdef SIMD_AVX2
+    if (kernel == SimdKernel::AVX2) {
+        first = UpdateAVX2(boxes, first, last, deltaTime);
+    }
+#endif
+#ifdef SIMD_SSE2
+    if (kernel != SimdKernel::Scalar) {
+        first = UpdateSSE2(boxes, first, last, deltaTime);
+    }
+#endif
+    UpdateScalar(boxes, first, last, deltaTime);
+}
@@ -1,17 +1,19 @@
 #include "butterfly.h"
 #include "obj_loader.h"
+#include "asset_cache.h"
 #include <iostream>
-#include <random>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 
-// Random number generation
-std::random_device rd;
-std::mt19937 gen(rd());
-std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+// Largest on-screen error, in pixels, a simplified level may introduce
+const float LOD_PIXEL_ERROR = 1.0f;
+// Seconds a LOD cross-fade lasts
+const float LOD_FADE_TIME = 0.25f;
 
-Butterfly::Butterfly(Shader& shader, const std::string& modelPath) 
-    : shader(shader), animationTime(0.0f) {
+Butterfly::Butterfly(Shader& shader, const std::string& modelPath, const SceneRandom& randomStream) 
+    : shader(shader), modelPath(modelPath), quantizedVertices(false), animationTime(0.0f),
+      lodLevel(0), previousLodLevel(0), lodFade(0.0f), lodCrossFade(false),
+      alphaTestShader(nullptr), forceAlphaTest(false), random(randomStream) {
     // Initialize butterfly properties
     position = glm::vec3(0.0f, 1.5f, -5.0f);  // Position further back in the scene
     direction = GetRandomDirection();
@@ -21,22 +23,53 @@ Butterfly::Butterfly(Shader& shader, const std::string& modelPath)
     scale = 0.01f;  // Reduced scale to make the butterfly smaller
     timeSinceDirectionChange = 0.0f;
     
-    // Initialize the OBJ loader with the butterfly model
-    model = std::make_unique<OBJLoader>(shader);
-    if (model) {
-        std::cout << "Loading butterfly model from: " << modelPath << std::endl;
-        if (!model->LoadModel(modelPath)) {
-            std::cerr << "Failed to load butterfly model: " << modelPath << std::endl;
-        } else {
-            std::cout << "Successfully loaded butterfly model" << std::endl;
-        }
-    } else {
-        std::cerr << "Failed to create OBJLoader instance" << std::endl;
-    }
+    // Every butterfly shares one loaded model; the first one starts loading it
+    // in the background and Draw skips the butterfly until it is resident
+    std::cout << "Loading butterfly model from: " << modelPath << std::endl;
+    model = AssetCache::Instance().AcquireModel(shader, modelPath, OBJLoadOptions());
 }
 
 Butterfly::~Butterfly() = default;
 
+bool Butterfly::UploadPending(std::chrono::steady_clock::time_point deadline) {
+    // Keep drawing the current model until its replacement is ready
+    if (pendingModel && pendingModel->UploadPending(deadline)) {
+        model = std::move(pendingModel);
+    } else if (pendingModel && pendingModel->GetLoadState() == ModelLoadState::Failed) {
+        pendingModel.reset();
+    }
+    if (!model) {
+        return false;
+    }
+    bool wasResident = model->IsResident();
+    bool resident = model->UploadPending(deadline);
+    if (resident && !wasResident) {
+        std::cout << "Successfully loaded butterfly model" << std::endl;
+        AssetCache::Instance().PrintStats();
+    }
+    return resident;
+}
+
+bool Butterfly::SetQuantizedVertices(bool enabled) {
+    // Wait for an in-flight load to finish before starting another
+    if (!model || enabled == quantizedVertices || !model->IsResident() || pendingModel) {
+        return true;
+    }
+    
+    // The model is shared, so switch to the variant with the other layout
+    // rather than reloading it in place
+    OBJLoadOptions options = model->GetOptions();
+    options.quantizeVertices = enabled;
+    quantizedVertices = enabled;
+    
+    std::cout << "Reloading butterfly model with " << (enabled ? "quantized" : "float") << " vertices" << std::endl;
+    pendingModel = AssetCache::Instance().AcquireModel(shader, modelPath, options);
+    if (pendingModel->IsResident()) {
+        model = std::move(pendingModel);
+    }
+    return true;
+}
+
 void Butterfly::Update(float deltaTime) {
     // Update position based on direction and speed
     position += direction * flightSpeed * deltaTime;
@@ -45,10 +78,18 @@ void Butterfly::Update(float deltaTime) {
     wingAngle += wingSpeed * deltaTime;
     animationTime += deltaTime;
     
+    // Advance an in-progress LOD cross-fade
+    if (lodFade > 0.0f) {
+        lodFade += deltaTime / LOD_FADE_TIME;
+        if (lodFade >= 1.0f) {
+            lodFade = 0.0f;
+        }
+    }
+    
     // Randomly change direction occasionally
     timeSinceDirectionChange += deltaTime;
     if (timeSinceDirectionChange > 3.0f) {
-        if (std::rand() % 100 < 5) {  // 5% chance to change direction each second after 3 seconds
+        if (random.Float() < 0.05f) {  // 5% chance to change direction each second after 3 seconds
             UpdateDirection();
             timeSinceDirectionChange = 0.0f;
         }
@@ -70,11 +111,14 @@ void Butterfly::Update(float deltaTime) {
     }
 }
 
-void Butterfly::Draw(const glm::mat4& view, const glm::mat4& projection) {
+void Butterfly::Draw(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
     if (!model) {
         std::cerr << "Butterfly::Draw: No model to draw!" << std::endl;
         return;
     }
+    if (!model->IsResident()) {
+        return;
+    }
     
     static int frameCount = 0;
     frameCount++;
@@ -106,33 +150,45 @@ void Butterfly::Draw(const glm::mat4& view, const glm::mat4& projection) {
         std::cout << "Distance from camera: " << distance << std::endl;
     }
     
-    // Use the shader
-    shader.use();
-    
     // Set view position (extract from view matrix)
     glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
-    shader.setVec3("viewPos", viewPos);
+    
+    // Pick the coarsest level whose error stays under a pixel on screen
+    size_t level = SelectLodLevel(viewPos, projection, viewportHeight);
+    if (level != lodLevel) {
+        previousLodLevel = lodLevel;
+        lodLevel = level;
+        // Start at a small non-zero progress so the first frame already fades;
+        // the dither needs the ALPHA_TEST variant
+        lodFade = lodCrossFade && alphaTestShader ? 0.001f : 0.0f;
+    }
+    
+    // Only pay for discard (and lose early depth testing) while something
+    // actually cuts out fragments
+    bool alphaTest = alphaTestShader &&
+                     (forceAlphaTest || lodFade > 0.0f || model->NeedsAlphaTest());
+    Shader& program = alphaTest ? *alphaTestShader : shader;
+    
+    // Use the shader
+    program.use();
+    program.setVec3("viewPos", viewPos);
     
     // Set up model matrix
     glm::mat4 modelMatrix = GetModelMatrix();
-    shader.setMat4("model", modelMatrix);
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
+    program.setMat4("model", modelMatrix);
+    program.setMat4("view", view);
+    program.setMat4("projection", projection);
     
     // Set light position to be above and slightly in front of the camera
     glm::vec3 lightPos = viewPos + glm::vec3(2.0f, 3.0f, 2.0f);
-    shader.setVec3("light.position", lightPos);
+    program.setVec3("light.position", lightPos);
     
     // Enhanced light properties for better visibility
-    shader.setVec3("light.ambient", 0.3f, 0.3f, 0.3f);  // Increased ambient
-    shader.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);  // Brighter diffuse
-    shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f); // Keep specular bright
+    program.setVec3("light.ambient", 0.3f, 0.3f, 0.3f);  // Increased ambient
+    program.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);  // Brighter diffuse
+    program.setVec3("light.specular", 1.0f, 1.0f, 1.0f); // Keep specular bright
     
-    // Set material properties (in case they're not set in the model)
-    shader.setVec3("material.ambient", 1.0f, 1.0f, 1.0f);
-    shader.setVec3("material.diffuse", 0.8f, 0.8f, 0.8f);
-    shader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
-    shader.setFloat("material.shininess", 32.0f);
+    // Material properties come from the model's material buffer
     
     // Debug output (uncomment if needed)
     // std::cout << "Light position: (" << lightPos.x << ", " << lightPos.y << ", " << lightPos.z << ")" << std::endl;
@@ -143,15 +199,24 @@ void Butterfly::Draw(const glm::mat4& view, const glm::mat4& projection) {
     float rightWingAngle = 0.2f * sin(wingAngle + 3.14159f); // Opposite phase for right wing
     
     // Set wing animation uniforms
-    shader.setFloat("leftWingAngle", leftWingAngle);
-    shader.setFloat("rightWingAngle", rightWingAngle);
+    program.setFloat("leftWingAngle", leftWingAngle);
+    program.setFloat("rightWingAngle", rightWingAngle);
     
     // Calculate normal matrix
     glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-    shader.setMat3("normalMatrix", normalMatrix);
+    program.setMat3("normalMatrix", normalMatrix);
     
-    // Draw the model
-    model->Draw(shader);
+    // Draw the model, skipping meshlets outside the view. While
+    // cross-fading, the outgoing level is drawn with the complementary dither.
+    if (lodFade > 0.0f) {
+        program.setFloat("lodFade", lodFade);
+        program.setBool("lodFadeOut", true);
+        model->Draw(program, modelMatrix, view, projection, previousLodLevel);
+        program.setBool("lodFadeOut", false);
+    } else {
+        program.setFloat("lodFade", 0.0f);
+    }
+    model->Draw(program, modelMatrix, view, projection, lodLevel);
 }
 
 glm::mat4 Butterfly::GetModelMatrix() const {
@@ -175,6 +240,23 @@ glm::mat4 Butterfly::GetModelMatrix() const {
     return model;
 }
 
+size_t Butterfly::SelectLodLevel(const glm::vec3& viewPos, const glm::mat4& projection, int viewportHeight) const {
+    size_t levels = model->GetLodCount();
+    if (levels <= 1) {
+        return 0;
+    }
+    
+    // Pixels covered by one object-space unit at the butterfly's distance
+    float distance = glm::max(glm::distance(position, viewPos), 0.001f);
+    float pixelsPerUnit = scale * projection[1][1] * 0.5f * viewportHeight / distance;
+    
+    size_t level = 0;
+    while (level + 1 < levels && model->GetLodError(level + 1) * pixelsPerUnit <= LOD_PIXEL_ERROR) {
+        level++;
+    }
+    return level;
+}
+
 void Butterfly::UpdateDirection() {
     // Slightly randomize the current direction
     direction = glm::normalize(direction + GetRandomDirection() * 0.3f);
@@ -182,6 +264,6 @@ void Butterfly::UpdateDirection() {
 
 glm::vec3 Butterfly::GetRandomDirection() {
     // Generate a random direction in the XZ plane
-    float angle = dist(gen) * 3.14159f * 2.0f;
+    float angle = random.Float(-1.0f, 1.0f) * 3.14159f * 2.0f;
     return glm::normalize(glm::vec3(cos(angle), 0.0f, sin(angle)));
 }
@@ -9,22 +9,25 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <chrono>
 #include "shader.h"
+#include "scene_random.h"
 
 // Forward declaration to avoid including obj_loader.h here
 class OBJLoader;
 
 class Butterfly {
 public:
-    // Constructor/Destructor
-    Butterfly(Shader& shader, const std::string& modelPath);
+    // Constructor/Destructor. Every random choice the butterfly makes comes
+    // from its own stream, so a seeded scene replays the same flight.
+    Butterfly(Shader& shader, const std::string& modelPath, const SceneRandom& randomStream);
     ~Butterfly();
     
     // Update butterfly state (position, wing flapping, etc.)
     void Update(float deltaTime);
     
-    // Draw the butterfly
-    void Draw(const glm::mat4& view, const glm::mat4& projection);
+    // Draw the butterfly; viewportHeight (in pixels) sizes the LOD error on screen
+    void Draw(const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
     
     // Set/get position
     void SetPosition(const glm::vec3& pos) { position = pos; }
@@ -34,6 +37,25 @@ public:
     void SetScale(float scale) { this->scale = scale; }
     float GetScale() const { return scale; }
     
+    // Create GL objects for the asynchronously loaded model until the
+    // deadline. Returns true once the butterfly can be drawn.
+    bool UploadPending(std::chrono::steady_clock::time_point deadline);
+    
+    // Switch to the model in the quantized or float vertex format, loading it
+    // asynchronously if no other butterfly uses that variant yet
+    bool SetQuantizedVertices(bool enabled);
+    bool HasQuantizedVertices() const { return quantizedVertices; }
+    
+    // Dither between the old and new level for a moment when the LOD changes
+    void SetLodCrossFade(bool enabled) { lodCrossFade = enabled; }
+    size_t GetLodLevel() const { return lodLevel; }
+    
+    // Shader variant compiled with ALPHA_TEST, used for cutout materials and
+    // LOD cross-fades; without one neither is drawn. Forcing it for every
+    // draw shows what the discard costs.
+    void SetAlphaTestShader(Shader* variant) { alphaTestShader = variant; }
+    void SetForceAlphaTest(bool enabled) { forceAlphaTest = enabled; }
+    
 private:
     // Butterfly properties
     glm::vec3 position;
@@ -44,17 +66,33 @@ private:
     float scale;
     float timeSinceDirectionChange;
     
-    // Model and shader
-    std::unique_ptr<OBJLoader> model;
+    // Model (shared through the asset cache) and shader
+    std::shared_ptr<OBJLoader> model;
+    std::shared_ptr<OBJLoader> pendingModel;    // Replaces model once resident
     Shader& shader;
+    std::string modelPath;
+    bool quantizedVertices;
     
     // Animation state
     float animationTime;
     
+    // Level of detail
+    size_t lodLevel;
+    size_t previousLodLevel;
+    float lodFade;          // Cross-fade progress, 0 when not fading
+    bool lodCrossFade;
+    
+    Shader* alphaTestShader;
+    bool forceAlphaTest;
+    
+    // Per butterfly, so butterflies can be updated in parallel
+    SceneRandom random;
+    
     // Helper methods
     void UpdateDirection();
     glm::vec3 GetRandomDirection();
     glm::mat4 GetModelMatrix() const;
+    size_t SelectLodLevel(const glm::vec3& viewPos, const glm::mat4& projection, int viewportHeight) const;
 };
 
 #endif // BUTTERFLY_H
@@ -0,0 +1,57 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// FNV-style hash folded over 64-bit words; cheap enough to run on every load
+class Checksum {
+public:
+    void Update(const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            pending |= static_cast<uint64_t>(bytes[i]) << (8 * pendingBytes);
+            if (++pendingBytes == 8) {
+                Mix(pending);
+                pending = 0;
+                pendingBytes = 0;
+            }
+        }
+    }
+
+    // Fast path for word-aligned buffers with no pending partial word
+    void UpdateWords(const void* data, size_t size) {
+        if (pendingBytes != 0) {
+            Update(data, size);
+            return;
+        }
+        size_t words = size / 8;
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < words; ++i) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i * 8, 8);
+            Mix(word);
+        }
+        Update(bytes + words * 8, size - words * 8);
+    }
+
+    uint64_t Finish() {
+        if (pendingBytes != 0) {
+            Mix(pending ^ (static_cast<uint64_t>(pendingBytes) << 56));
+        }
+        return hash;
+    }
+
+private:
+    void Mix(uint64_t word) {
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t pending = 0;
+    unsigned pendingBytes = 0;
+};
+
+#endif // CHECKSUM_H
@@ -0,0 +1,88 @@
+#ifndef CORNER_INDEX_MAP_H
+#define CORNER_INDEX_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open-addressing (linear probing) hash map from an OBJ "v/vt/vn" index
+// triplet to the vertex it was emitted as. Slots are stored inline so a
+// lookup touches a single cache line in the common case.
+class CornerIndexMap {
+public:
+    // Drop all entries and size the table for roughly expectedCount keys
+    void Reset(size_t expectedCount) {
+        size_t capacity = 16;
+        while (capacity < expectedCount * 2) {
+            capacity <<= 1;
+        }
+        slots.assign(capacity, Slot{EMPTY, 0, 0, 0});
+        mask = capacity - 1;
+        count = 0;
+    }
+
+    // Return the value stored for the key, or store and return value if absent
+    uint32_t FindOrInsert(int v, int vt, int vn, uint32_t value, bool& inserted) {
+        if ((count + 1) * 2 > slots.size()) {
+            Grow();
+        }
+        size_t i = Hash(v, vt, vn) & mask;
+        for (;;) {
+            Slot& slot = slots[i];
+            if (slot.v == EMPTY) {
+                slot = Slot{v, vt, vn, value};
+                count++;
+                inserted = true;
+                return value;
+            }
+            if (slot.v == v && slot.vt == vt && slot.vn == vn) {
+                inserted = false;
+                return slot.value;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    size_t Size() const { return count; }
+
+private:
+    struct Slot {
+        int v;      // EMPTY marks an unused slot; real keys are never negative
+        int vt;
+        int vn;
+        uint32_t value;
+    };
+
+    static const int EMPTY = -2;
+
+    static size_t Hash(int v, int vt, int vn) {
+        uint32_t h = static_cast<uint32_t>(v) * 0x9E3779B1u;
+        h ^= static_cast<uint32_t>(vt) * 0x85EBCA77u;
+        h ^= static_cast<uint32_t>(vn) * 0xC2B2AE3Du;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 13;
+        return h;
+    }
+
+    void Grow() {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, Slot{EMPTY, 0, 0, 0});
+        mask = slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.v == EMPTY) continue;
+            size_t i = Hash(slot.v, slot.vt, slot.vn) & mask;
+            while (slots[i].v != EMPTY) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+};
+
+#endif // CORNER_INDEX_MAP_H
@@ -0,0 +1,139 @@
+#include "frustum_cull.h"
+
+namespace {
+    const int PLANE_COUNT = 6;
+
+    // Plane components split out for broadcasting
+    struct PlaneArrays {
+        float x[PLANE_COUNT], y[PLANE_COUNT], z[PLANE_COUNT], w[PLANE_COUNT];
+
+        explicit PlaneArrays(const MeshletFrustum& frustum) {
+            for (int p = 0; p < PLANE_COUNT; ++p) {
+                x[p] = frustum.planes[p].x;
+                y[p] = frustum.planes[p].y;
+                z[p] = frustum.planes[p].z;
+                w[p] = frustum.planes[p].w;
+            }
+        }
+    };
+
+    // Same operation order as the vector kernels: ((x + y) + z) + w against
+    // -radius, so every kernel culls exactly the same spheres
+    size_t CullScalar(const PlaneArrays& planes, const SphereArrays& spheres, size_t first, size_t last,
+                      uint32_t* visible, size_t count) {
+        for (size_t i = first; i < last; ++i) {
+            float negativeRadius = -(spheres.radius[i] * spheres.radiusScale);
+            bool outside = false;
+            for (int p = 0; p < PLANE_COUNT; ++p) {
+                float distance = planes.x[p] * spheres.centerX[i] + planes.y[p] * spheres.centerY[i];
+                distance = distance + planes.z[p] * spheres.centerZ[i];
+                distance = distance + planes.w[p];
+                outside |= distance < negativeRadius;
+            }
+            // Branchless compaction: always write, advance only if visible
+            visible[count] = static_cast<uint32_t>(i);
+            count += outside ? 0 : 1;
+        }
+        return count;
+    }
+
+#ifdef SIMD_SSE2
+    size_t CullSSE2(const PlaneArrays& planes, const SphereArrays& spheres, size_t& first, size_t last,
+                    uint32_t* visible, size_t count) {
+        const __m128 scale = _mm_set1_ps(spheres.radiusScale);
+        const __m128 zero = _mm_setzero_ps();
+        size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            __m128 x = _mm_loadu_ps(spheres.centerX + i);
+            __m128 y = _mm_loadu_ps(spheres.centerY + i);
+            __m128 z = _mm_loadu_ps(spheres.centerZ + i);
+            __m128 negativeRadius = _mm_sub_ps(zero, _mm_mul_ps(_mm_loadu_ps(spheres.radius + i), scale));
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < PLANE_COUNT; ++p) {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), x),
+                                             _mm_mul_ps(_mm_set1_ps(planes.y[p]), y));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.z[p]), z));
+                distance = _mm_add_ps(distance, _mm_set1_ps(planes.w[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+            }
+            int mask = ~_mm_movemask_ps(outside);
+            for (int lane = 0; lane < 4; ++lane) {
+                visible[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+        first = i;
+        return count;
+    }
+#endif
+
+#ifdef SIMD_AVX2
+    SIMD_AVX2_TARGET
+    size_t CullAVX2(const PlaneArrays& planes, const SphereArrays& spheres, size_t& first, size_t last,
+                    uint32_t* visible, size_t count) {
+        const __m256 scale = _mm256_set1_ps(spheres.radiusScale);
+        const __m256 zero = _mm256_setzero_ps();
+        size_t i = first;
+        for (; i + 8 <= last; i += 8) {
+            __m256 x = _mm256_loadu_ps(spheres.centerX + i);
+            __m256 y = _mm256_loadu_ps(spheres.centerY + i);
+            __m256 z = _mm256_loadu_ps(spheres.centerZ + i);
+            __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_mul_ps(_mm256_loadu_ps(spheres.radius + i), scale));
+            __m256 outside = _mm256_setzero_ps();
+            for (int p = 0; p < PLANE_COUNT; ++p) {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), x),
+                                                _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), y));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), z));
+                distance = _mm256_add_ps(distance, _mm256_set1_ps(planes.w[p]));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+            }
+            int mask = ~_mm256_movemask_ps(outside);
+            for (int lane = 0; lane < 8; ++lane) {
+                visible[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+        first = i;
+        return count;
+    }
+#endif
+}
+
+void BoundingSphereSet::push_back(const glm::vec3& center, float sphereRadius) {
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    radius.push_back(sphereRadius);
+}
+
+void BoundingSphereSet::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+}
+
+SphereArrays BoundingSphereSet::arrays() const {
+    return SphereArrays{centerX.data(), centerY.data(), centerZ.data(), radius.data(), 1.0f};
+}
+
+size_t CullSpheres(const MeshletFrustum& frustum, const SphereArrays& spheres, size_t first, size_t last,
+                   uint32_t* visible, SimdKernel kernel) {
+    if (!IsSimdKernelSupported(kernel)) {
+        kernel = SimdKernel::Scalar;
+    }
+    PlaneArrays planes(frustum);
+    size_t count = 0;
+    // Vector loops stop short of a partial group; the scalar loop finishes it
+#ifdef SIMD_AVX2
+    if (kernel == SimdKernel::AVX2) {
+        count = CullAVX2(planes, spheres, first, last, visible, count);
+    }
+#endif
+#ifdef SIMD_SSE2
+    if (kernel != SimdKernel::Scalar) {
+        count = CullSSE2(planes, spheres, first, last, visible, count);
+    }
+#endif
+    return CullScalar(planes, spheres, first, last, visible, count);
+}
@@ -0,0 +1,48 @@
+#ifndef FRUSTUM_CULL_H
+#define FRUSTUM_CULL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "meshlet.h"
+#include "simd_kernel.h"
+
+// Bounding spheres as a structure of arrays, so the vector kernels load four
+// or eight centers per component at once
+struct SphereArrays {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+    float radiusScale;      // Applied to every radius (e.g. the cube's half-diagonal)
+};
+
+// Owned storage for SphereArrays
+struct BoundingSphereSet {
+    std::vector<float> centerX, centerY, centerZ, radius;
+
+    size_t size() const { return centerX.size(); }
+    void push_back(const glm::vec3& center, float sphereRadius);
+    void clear();
+    SphereArrays arrays() const;
+};
+
+// Objects tested and found visible by the last culling pass
+struct CullStats {
+    size_t tested;
+    size_t visible;
+
+    CullStats() : tested(0), visible(0) {}
+};
+
+// Test spheres [first, last) against the six planes of a frustum (built from
+// projection * view for world-space spheres, or with the model matrix for
+// object-space ones) and write the indices of those not entirely outside
+// to visible, in order. visible needs room for last - first indices.
+// Returns how many were written. Every kernel evaluates the planes in the
+// same order and gives the same list.
+size_t CullSpheres(const MeshletFrustum& frustum, const SphereArrays& spheres, size_t first, size_t last,
+                   uint32_t* visible, SimdKernel kernel);
+
+#endif // FRUSTUM_CULL_H
@@ -0,0 +1,711 @@
+#include "gltf_loader.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "tiny_gltf.h"
+
+namespace {
+    const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+    const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+    const size_t GLB_HEADER_BYTES = 12;
+    const size_t GLB_CHUNK_HEADER_BYTES = 8;
+
+    // Attribute data may sit in a shared range with unrelated bytes between
+    // the bufferViews; beyond this much waste the primitive is packed instead
+    const size_t MAX_DIRECT_SPAN_FACTOR = 2;
+
+    uint32_t ReadU32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    bool IsExternalImage(const tinygltf::Image& image) {
+        return !image.uri.empty() && image.uri.compare(0, 5, "data:") != 0;
+    }
+
+    // Images are decoded by the loader's texture pipeline, not by tinygltf.
+    // External ones are read again from their files; the bytes of embedded
+    // ones are kept, as the BIN chunk and data URIs are not held on to.
+    bool KeepEmbeddedImage(tinygltf::Image* image, const int index, std::string*, std::string*, int, int,
+                           const unsigned char* bytes, int size, void* userData) {
+        if (IsExternalImage(*image) || index < 0 || size <= 0) {
+            return true;
+        }
+        std::vector<GltfImageBytes>& images = *static_cast<std::vector<GltfImageBytes>*>(userData);
+        if (static_cast<size_t>(index) >= images.size()) {
+            images.resize(index + 1);
+        }
+        images[index] = std::make_shared<const std::vector<unsigned char>>(bytes, bytes + size);
+        return true;
+    }
+
+    float ComponentToFloat(const unsigned char* p, int componentType, bool normalized) {
+        switch (componentType) {
+            case TINYGLTF_COMPONENT_TYPE_BYTE: {
+                int8_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return normalized ? std::max(v / 127.0f, -1.0f) : v;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                return normalized ? p[0] / 255.0f : p[0];
+            case TINYGLTF_COMPONENT_TYPE_SHORT: {
+                int16_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                uint16_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return normalized ? v / 65535.0f : v;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+                uint32_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return static_cast<float>(v);
+            }
+            case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+                float v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    // min/max always hold the stored values, even for normalized accessors
+    float NormalizeBound(double value, int componentType, bool normalized) {
+        if (!normalized) {
+            return static_cast<float>(value);
+        }
+        switch (componentType) {
+            case TINYGLTF_COMPONENT_TYPE_BYTE: return std::max(static_cast<float>(value) / 127.0f, -1.0f);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return static_cast<float>(value) / 255.0f;
+            case TINYGLTF_COMPONENT_TYPE_SHORT: return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return static_cast<float>(value) / 65535.0f;
+            default: return static_cast<float>(value);
+        }
+    }
+
+    unsigned int ReadIndex(const unsigned char* p, int componentType) {
+        if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+            return p[0];
+        }
+        if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+            uint16_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Out-of-range indices would make GL read past the vertex buffer
+    bool IndicesInRange(const unsigned char* data, size_t count, size_t stride, int componentType,
+                        size_t vertexCount) {
+        for (size_t i = 0; i < count; ++i) {
+            if (ReadIndex(data + i * stride, componentType) >= vertexCount) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    GLenum ComponentTypeToGL(int componentType) {
+        switch (componentType) {
+            case TINYGLTF_COMPONENT_TYPE_BYTE: return GL_BYTE;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return GL_UNSIGNED_BYTE;
+            case TINYGLTF_COMPONENT_TYPE_SHORT: return GL_SHORT;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return GL_UNSIGNED_SHORT;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return GL_UNSIGNED_INT;
+            default: return GL_FLOAT;
+        }
+    }
+
+    glm::mat4 NodeTransform(const tinygltf::Node& node) {
+        if (node.matrix.size() == 16) {
+            glm::mat4 matrix;
+            for (int i = 0; i < 16; ++i) {
+                glm::value_ptr(matrix)[i] = static_cast<float>(node.matrix[i]);
+            }
+            return matrix;
+        }
+        glm::mat4 matrix(1.0f);
+        if (node.translation.size() == 3) {
+            matrix = glm::translate(matrix, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+        }
+        if (node.rotation.size() == 4) {
+            glm::quat rotation(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+                               static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2]));
+            matrix = matrix * glm::mat4_cast(rotation);
+        }
+        if (node.scale.size() == 3) {
+            matrix = glm::scale(matrix, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+        }
+        return matrix;
+    }
+
+    // Split a transform into translation and uniform scale; false if it rotates,
+    // shears, mirrors or scales unevenly
+    bool IsTranslateUniformScale(const glm::mat4& m, glm::vec3& translation, float& scale) {
+        const float epsilon = 1e-5f;
+        scale = m[0][0];
+        if (scale <= 0.0f) {
+            return false;
+        }
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                float expected = row == column ? scale : 0.0f;
+                if (std::fabs(m[column][row] - expected) > epsilon * std::max(1.0f, scale)) {
+                    return false;
+                }
+            }
+        }
+        translation = glm::vec3(m[3]);
+        return std::fabs(m[3][3] - 1.0f) <= epsilon;
+    }
+
+    // Formats the vertex shader can take as they are
+    bool IsDirectAttribute(const char* name, int componentType, int components, bool normalized) {
+        if (componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+            return true;
+        }
+        bool shortOrByte = componentType == TINYGLTF_COMPONENT_TYPE_BYTE ||
+                           componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+                           componentType == TINYGLTF_COMPONENT_TYPE_SHORT ||
+                           componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+        if (!shortOrByte) {
+            return false;
+        }
+        if (std::strcmp(name, "NORMAL") == 0) {
+            // Signed and normalized, as KHR_mesh_quantization requires
+            return normalized && (componentType == TINYGLTF_COMPONENT_TYPE_BYTE ||
+                                  componentType == TINYGLTF_COMPONENT_TYPE_SHORT);
+        }
+        if (std::strcmp(name, "TEXCOORD_0") == 0) {
+            // Unnormalized ones need KHR_texture_transform to be meaningful
+            return normalized;
+        }
+        return components == 3;
+    }
+
+    // Area-weighted vertex normals for primitives that come without any
+    void GenerateNormals(GltfDecodedPrimitive& primitive) {
+        primitive.normals.assign(primitive.positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+            unsigned int a = primitive.indices[i];
+            unsigned int b = primitive.indices[i + 1];
+            unsigned int c = primitive.indices[i + 2];
+            if (a >= primitive.positions.size() || b >= primitive.positions.size() ||
+                c >= primitive.positions.size()) {
+                continue;
+            }
+            glm::vec3 normal = glm::cross(primitive.positions[b] - primitive.positions[a],
+                                          primitive.positions[c] - primitive.positions[a]);
+            primitive.normals[a] += normal;
+            primitive.normals[b] += normal;
+            primitive.normals[c] += normal;
+        }
+        for (glm::vec3& normal : primitive.normals) {
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+}
+
+bool IsGltfPath(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == "gltf" || extension == "glb";
+}
+
+GltfFile::GltfFile() = default;
+GltfFile::~GltfFile() = default;
+
+bool GltfFile::Open(const std::string& path) {
+    model.reset(new tinygltf::Model());
+    sourcePath = path;
+    binaryChunk = nullptr;
+    binaryChunkSize = 0;
+    embeddedImages.clear();
+
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(KeepEmbeddedImage, &embeddedImages);
+    std::string error;
+    std::string warning;
+    bool loaded = false;
+
+    if (!file.Open(path)) {
+        std::cerr << "ERROR: Failed to open glTF " << path << std::endl;
+        return false;
+    }
+    fileSize = file.Size();
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.Data());
+    std::string baseDir = path.substr(0, path.find_last_of("/\\") + 1);
+
+    // Binary by content rather than by name, so any extension case works
+    bool binary = fileSize >= sizeof(GLB_MAGIC) && ReadU32(bytes) == GLB_MAGIC;
+    if (binary) {
+        if (fileSize < GLB_HEADER_BYTES + GLB_CHUNK_HEADER_BYTES ||
+            ReadU32(bytes + GLB_HEADER_BYTES + 4) != GLB_CHUNK_JSON) {
+            std::cerr << "ERROR: Not a binary glTF file: " << path << std::endl;
+            file.Close();
+            return false;
+        }
+
+        // Locate the BIN chunk so its bytes can be used in place
+        size_t jsonLength = ReadU32(bytes + GLB_HEADER_BYTES);
+        size_t binHeader = GLB_HEADER_BYTES + GLB_CHUNK_HEADER_BYTES + jsonLength;
+        if (binHeader + GLB_CHUNK_HEADER_BYTES <= fileSize && ReadU32(bytes + binHeader + 4) == GLB_CHUNK_BIN) {
+            size_t binLength = ReadU32(bytes + binHeader);
+            if (binHeader + GLB_CHUNK_HEADER_BYTES + binLength <= fileSize) {
+                binaryChunk = bytes + binHeader + GLB_CHUNK_HEADER_BYTES;
+                binaryChunkSize = binLength;
+            }
+        }
+
+        loaded = loader.LoadBinaryFromMemory(model.get(), &error, &warning, bytes,
+                                             static_cast<unsigned int>(fileSize), baseDir);
+
+        // tinygltf copies the BIN chunk into the first buffer; drop the copy
+        if (loaded && binaryChunk && !model->buffers.empty() && model->buffers[0].uri.empty()) {
+            std::vector<unsigned char>().swap(model->buffers[0].data);
+        } else {
+            binaryChunk = nullptr;
+            binaryChunkSize = 0;
+        }
+    } else {
+        // tinygltf copies every buffer, so the JSON's mapping is not kept
+        loaded = fileSize > 0 && loader.LoadASCIIFromString(model.get(), &error, &warning,
+                                                            reinterpret_cast<const char*>(bytes),
+                                                            static_cast<unsigned int>(fileSize), baseDir);
+        file.Close();
+    }
+
+    if (!warning.empty()) {
+        std::cerr << "WARNING: glTF " << path << ": " << warning << std::endl;
+    }
+    if (!loaded) {
+        std::cerr << "ERROR: Failed to load glTF " << path << ": " << error << std::endl;
+        file.Close();
+        return false;
+    }
+    return true;
+}
+
+const unsigned char* GltfFile::BufferData(int buffer) const {
+    if (buffer == 0 && binaryChunk) {
+        return binaryChunk;
+    }
+    const std::vector<unsigned char>& data = model->buffers[buffer].data;
+    return data.empty() ? nullptr : data.data();
+}
+
+size_t GltfFile::BufferSize(int buffer) const {
+    if (buffer == 0 && binaryChunk) {
+        return binaryChunkSize;
+    }
+    return model->buffers[buffer].data.size();
+}
+
+std::vector<GltfPrimitiveRef> GltfFile::ScenePrimitives() const {
+    std::vector<GltfPrimitiveRef> primitives;
+    auto addMesh = [&](int mesh, const glm::mat4& transform) {
+        if (mesh < 0 || mesh >= static_cast<int>(model->meshes.size())) {
+            return;
+        }
+        const tinygltf::Mesh& source = model->meshes[mesh];
+        for (size_t i = 0; i < source.primitives.size(); ++i) {
+            int mode = source.primitives[i].mode;
+            if (mode != -1 && mode != TINYGLTF_MODE_TRIANGLES) {
+                std::cerr << "WARNING: Skipping glTF primitive with mode " << mode << " (only triangles are drawn)"
+                          << std::endl;
+                continue;
+            }
+            GltfPrimitiveRef ref;
+            ref.mesh = mesh;
+            ref.primitive = static_cast<int>(i);
+            ref.transform = transform;
+            primitives.push_back(ref);
+        }
+    };
+
+    // Without scenes, every mesh is drawn once as it is
+    if (model->scenes.empty()) {
+        for (size_t mesh = 0; mesh < model->meshes.size(); ++mesh) {
+            addMesh(static_cast<int>(mesh), glm::mat4(1.0f));
+        }
+        return primitives;
+    }
+
+    int scene = model->defaultScene >= 0 && model->defaultScene < static_cast<int>(model->scenes.size())
+        ? model->defaultScene : 0;
+    struct PendingNode {
+        int node;
+        glm::mat4 parent;
+        size_t depth;
+    };
+    std::vector<PendingNode> stack;
+    const std::vector<int>& roots = model->scenes[scene].nodes;
+    for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+        stack.push_back({*root, glm::mat4(1.0f), 0});
+    }
+    while (!stack.empty()) {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+        // The node graph must be a forest; the depth limit guards against cycles
+        if (pending.node < 0 || pending.node >= static_cast<int>(model->nodes.size()) ||
+            pending.depth > model->nodes.size()) {
+            continue;
+        }
+        const tinygltf::Node& node = model->nodes[pending.node];
+        glm::mat4 transform = pending.parent * NodeTransform(node);
+        addMesh(node.mesh, transform);
+        for (auto child = node.children.rbegin(); child != node.children.rend(); ++child) {
+            stack.push_back({*child, transform, pending.depth + 1});
+        }
+    }
+    return primitives;
+}
+
+bool GltfFile::GetAccessorView(const tinygltf::Accessor& accessor, AccessorView& view) const {
+    if (accessor.bufferView < 0 || accessor.bufferView >= static_cast<int>(model->bufferViews.size())) {
+        return false;
+    }
+    const tinygltf::BufferView& bufferView = model->bufferViews[accessor.bufferView];
+    if (bufferView.buffer < 0 || bufferView.buffer >= static_cast<int>(model->buffers.size())) {
+        return false;
+    }
+    int components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+    int componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+    int stride = accessor.ByteStride(bufferView);
+    if (components <= 0 || componentSize <= 0 || stride <= 0) {
+        return false;
+    }
+
+    view.buffer = bufferView.buffer;
+    view.count = accessor.count;
+    view.stride = static_cast<size_t>(stride);
+    view.elementSize = static_cast<size_t>(components) * componentSize;
+    view.componentType = accessor.componentType;
+    view.components = components;
+    view.normalized = accessor.normalized;
+
+    // The last element has to end inside both the bufferView and the buffer
+    size_t length = accessor.count == 0 ? 0 : (accessor.count - 1) * view.stride + view.elementSize;
+    const unsigned char* data = BufferData(bufferView.buffer);
+    if (!data || accessor.byteOffset + length > bufferView.byteLength ||
+        bufferView.byteOffset + bufferView.byteLength > BufferSize(bufferView.buffer)) {
+        return false;
+    }
+    view.data = data + bufferView.byteOffset + accessor.byteOffset;
+    return true;
+}
+
+bool GltfFile::ReadFloats(int index, int components, std::vector<float>& out) const {
+    if (index < 0 || index >= static_cast<int>(model->accessors.size())) {
+        return false;
+    }
+    const tinygltf::Accessor& accessor = model->accessors[index];
+    int stored = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+    int componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+    if (stored < components || componentSize <= 0) {
+        return false;
+    }
+    out.assign(accessor.count * components, 0.0f);
+
+    // Sparse accessors without a bufferView start out as zeros
+    if (accessor.bufferView >= 0) {
+        AccessorView view;
+        if (!GetAccessorView(accessor, view)) {
+            return false;
+        }
+        for (size_t i = 0; i < view.count; ++i) {
+            const unsigned char* element = view.data + i * view.stride;
+            for (int c = 0; c < components; ++c) {
+                out[i * components + c] = ComponentToFloat(element + c * componentSize, accessor.componentType,
+                                                           accessor.normalized);
+            }
+        }
+    }
+    if (!accessor.sparse.isSparse) {
+        return true;
+    }
+
+    // Substitute the sparse elements: tightly packed indices and values
+    int count = accessor.sparse.count;
+    int indexView = accessor.sparse.indices.bufferView;
+    int valueView = accessor.sparse.values.bufferView;
+    int indexSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.sparse.indices.componentType));
+    size_t elementSize = static_cast<size_t>(stored) * componentSize;
+    if (count < 0 || indexSize <= 0 || indexView < 0 || valueView < 0 ||
+        indexView >= static_cast<int>(model->bufferViews.size()) ||
+        valueView >= static_cast<int>(model->bufferViews.size())) {
+        return false;
+    }
+    const tinygltf::BufferView& indexBufferView = model->bufferViews[indexView];
+    const tinygltf::BufferView& valueBufferView = model->bufferViews[valueView];
+    size_t indexStart = indexBufferView.byteOffset + accessor.sparse.indices.byteOffset;
+    size_t valueStart = valueBufferView.byteOffset + accessor.sparse.values.byteOffset;
+    const unsigned char* indexData = BufferData(indexBufferView.buffer);
+    const unsigned char* valueData = BufferData(valueBufferView.buffer);
+    if (!indexData || !valueData ||
+        indexStart + static_cast<size_t>(count) * indexSize > BufferSize(indexBufferView.buffer) ||
+        valueStart + static_cast<size_t>(count) * elementSize > BufferSize(valueBufferView.buffer)) {
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        size_t target = ReadIndex(indexData + indexStart + static_cast<size_t>(i) * indexSize,
+                                  accessor.sparse.indices.componentType);
+        if (target >= accessor.count) {
+            return false;
+        }
+        const unsigned char* element = valueData + valueStart + static_cast<size_t>(i) * elementSize;
+        for (int c = 0; c < components; ++c) {
+            out[target * components + c] = ComponentToFloat(element + c * componentSize, accessor.componentType,
+                                                            accessor.normalized);
+        }
+    }
+    return true;
+}
+
+bool GltfFile::ReadIndices(int index, std::vector<unsigned int>& out) const {
+    AccessorView view;
+    if (index < 0 || index >= static_cast<int>(model->accessors.size()) ||
+        model->accessors[index].sparse.isSparse || !GetAccessorView(model->accessors[index], view) ||
+        view.components != 1) {
+        return false;
+    }
+    out.resize(view.count);
+    for (size_t i = 0; i < view.count; ++i) {
+        out[i] = ReadIndex(view.data + i * view.stride, view.componentType);
+    }
+    return true;
+}
+
+bool GltfFile::GetDirectPrimitive(const GltfPrimitiveRef& ref, GltfDirectPrimitive& out) const {
+    const tinygltf::Primitive& primitive = model->meshes[ref.mesh].primitives[ref.primitive];
+    glm::vec3 translation;
+    float scale;
+    if (!IsTranslateUniformScale(ref.transform, translation, scale)) {
+        return false;
+    }
+
+    // Position and normal are required, texture coordinates optional
+    static const char* const names[3] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+    static const int componentCounts[3] = { 3, 3, 2 };
+    AccessorView views[3];
+    bool present[3] = { false, false, false };
+    size_t vertexCount = 0;
+    int buffer = -1;
+    size_t spanBegin = 0;
+    size_t spanEnd = 0;
+    size_t usedBytes = 0;
+    for (int i = 0; i < 3; ++i) {
+        auto attribute = primitive.attributes.find(names[i]);
+        if (attribute == primitive.attributes.end()) {
+            if (i < 2) {
+                return false;
+            }
+            continue;
+        }
+        if (attribute->second < 0 || attribute->second >= static_cast<int>(model->accessors.size())) {
+            return false;
+        }
+        const tinygltf::Accessor& accessor = model->accessors[attribute->second];
+        AccessorView& view = views[i];
+        if (accessor.sparse.isSparse || !GetAccessorView(accessor, view) || view.components != componentCounts[i] ||
+            !IsDirectAttribute(names[i], view.componentType, view.components, view.normalized)) {
+            return false;
+        }
+        if (i == 0) {
+            vertexCount = view.count;
+            buffer = view.buffer;
+            if (vertexCount == 0 || accessor.minValues.size() < 3 || accessor.maxValues.size() < 3) {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c) {
+                float low = NormalizeBound(accessor.minValues[c], view.componentType, view.normalized);
+                float high = NormalizeBound(accessor.maxValues[c], view.componentType, view.normalized);
+                out.boundsMin[c] = translation[c] + low * scale;
+                out.boundsMax[c] = translation[c] + high * scale;
+            }
+        } else if (view.count != vertexCount || view.buffer != buffer) {
+            return false;
+        }
+
+        size_t begin = static_cast<size_t>(view.data - BufferData(buffer));
+        size_t end = begin + (view.count - 1) * view.stride + view.elementSize;
+        spanBegin = i == 0 ? begin : std::min(spanBegin, begin);
+        spanEnd = i == 0 ? end : std::max(spanEnd, end);
+        usedBytes += view.count * view.elementSize;
+        present[i] = true;
+    }
+    if (spanEnd - spanBegin > usedBytes * MAX_DIRECT_SPAN_FACTOR) {
+        return false;
+    }
+
+    // 8-bit indices are legal glTF but slow or unsupported on most GPUs
+    AccessorView indexView;
+    if (primitive.indices < 0 || primitive.indices >= static_cast<int>(model->accessors.size()) ||
+        model->accessors[primitive.indices].sparse.isSparse ||
+        !GetAccessorView(model->accessors[primitive.indices], indexView) || indexView.components != 1 ||
+        indexView.stride != indexView.elementSize ||
+        (indexView.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+         indexView.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)) {
+        return false;
+    }
+    // The accessor's max is only a hint from the file, so every index is checked
+    if (!IndicesInRange(indexView.data, indexView.count, indexView.stride, indexView.componentType, vertexCount)) {
+        return false;
+    }
+
+    out.vertexData = BufferData(buffer) + spanBegin;
+    out.vertexBytes = spanEnd - spanBegin;
+    out.vertexCount = vertexCount;
+    for (int i = 0; i < 3; ++i) {
+        VertexAttribute& attribute = out.attributes[i];
+        attribute = VertexAttribute();
+        if (!present[i]) {
+            continue;
+        }
+        attribute.components = views[i].components;
+        attribute.type = ComponentTypeToGL(views[i].componentType);
+        attribute.normalized = views[i].normalized ? GL_TRUE : GL_FALSE;
+        attribute.stride = static_cast<GLsizei>(views[i].stride);
+        attribute.offset = static_cast<size_t>(views[i].data - BufferData(buffer)) - spanBegin;
+    }
+    out.indexData = indexView.data;
+    out.indexCount = indexView.count;
+    out.indexBytes = indexView.count * indexView.elementSize;
+    out.indexType = ComponentTypeToGL(indexView.componentType);
+    out.positionOffset = translation;
+    out.positionScale = glm::vec3(scale);
+    out.material = primitive.material;
+    return true;
+}
+
+bool GltfFile::DecodePrimitive(const GltfPrimitiveRef& ref, GltfDecodedPrimitive& out) const {
+    const tinygltf::Primitive& primitive = model->meshes[ref.mesh].primitives[ref.primitive];
+    auto position = primitive.attributes.find("POSITION");
+    std::vector<float> values;
+    if (position == primitive.attributes.end() || !ReadFloats(position->second, 3, values)) {
+        return false;
+    }
+    size_t vertexCount = values.size() / 3;
+    out.positions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        glm::vec4 p(values[i * 3], values[i * 3 + 1], values[i * 3 + 2], 1.0f);
+        out.positions[i] = glm::vec3(ref.transform * p);
+    }
+
+    out.normals.clear();
+    auto normal = primitive.attributes.find("NORMAL");
+    if (normal != primitive.attributes.end() && ReadFloats(normal->second, 3, values) &&
+        values.size() == vertexCount * 3) {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(ref.transform)));
+        out.normals.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            glm::vec3 n = normalMatrix * glm::vec3(values[i * 3], values[i * 3 + 1], values[i * 3 + 2]);
+            float length = glm::length(n);
+            out.normals[i] = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // glTF's texture origin is the top left, OpenGL's the bottom left
+    out.texCoords.assign(vertexCount, glm::vec2(0.0f));
+    auto texCoord = primitive.attributes.find("TEXCOORD_0");
+    if (texCoord != primitive.attributes.end() && ReadFloats(texCoord->second, 2, values) &&
+        values.size() == vertexCount * 2) {
+        for (size_t i = 0; i < vertexCount; ++i) {
+            out.texCoords[i] = glm::vec2(values[i * 2], 1.0f - values[i * 2 + 1]);
+        }
+    }
+
+    if (primitive.indices >= 0) {
+        if (!ReadIndices(primitive.indices, out.indices)) {
+            return false;
+        }
+        for (unsigned int index : out.indices) {
+            if (index >= vertexCount) {
+                return false;
+            }
+        }
+    } else {
+        out.indices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            out.indices[i] = static_cast<unsigned int>(i);
+        }
+    }
+
+    // A mirroring transform turns the triangles inside out
+    if (glm::determinant(glm::mat3(ref.transform)) < 0.0f) {
+        for (size_t i = 0; i + 2 < out.indices.size(); i += 3) {
+            std::swap(out.indices[i + 1], out.indices[i + 2]);
+        }
+    }
+    if (out.normals.empty()) {
+        GenerateNormals(out);
+    }
+    out.material = primitive.material;
+    return true;
+}
+
+std::vector<GltfMaterial> GltfFile::ReadMaterials(const std::string& baseDir) const {
+    std::vector<GltfMaterial> result;
+    for (const tinygltf::Material& source : model->materials) {
+        GltfMaterial converted;
+        Material& material = converted.material;
+        material.name = source.name;
+
+        const tinygltf::PbrMetallicRoughness& pbr = source.pbrMetallicRoughness;
+        glm::vec4 baseColor(1.0f);
+        if (pbr.baseColorFactor.size() == 4) {
+            baseColor = glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2],
+                                  pbr.baseColorFactor[3]);
+        }
+        material.diffuse = glm::vec3(baseColor);
+        material.ambient = material.diffuse * 0.2f;
+        // There is no blending; masked and blended materials are cut out at
+        // the shader's 0.5 threshold
+        material.dissolve = source.alphaMode == "OPAQUE" ? 1.0f : baseColor.a;
+
+        // Approximate metal/roughness with a Blinn-Phong highlight of similar width
+        float metallic = glm::clamp(static_cast<float>(pbr.metallicFactor), 0.0f, 1.0f);
+        float roughness = glm::clamp(static_cast<float>(pbr.roughnessFactor), 0.05f, 1.0f);
+        material.specular = glm::mix(glm::vec3(0.04f), material.diffuse, metallic);
+        material.shininess = glm::clamp(2.0f / (roughness * roughness * roughness * roughness) - 2.0f, 1.0f, 256.0f);
+
+        int texture = pbr.baseColorTexture.index;
+        if (texture >= 0 && texture < static_cast<int>(model->textures.size())) {
+            int image = model->textures[texture].source;
+            if (image >= 0 && image < static_cast<int>(model->images.size())) {
+                if (IsExternalImage(model->images[image])) {
+                    converted.diffuseImage = baseDir + model->images[image].uri;
+                } else if (static_cast<size_t>(image) < embeddedImages.size() && embeddedImages[image]) {
+                    converted.diffuseImage = sourcePath + "#image" + std::to_string(image);
+                    converted.diffuseImageData = embeddedImages[image];
+                } else {
+                    std::cerr << "WARNING: Embedded glTF image " << image << " could not be read, drawing material "
+                              << source.name << " untextured" << std::endl;
+                }
+            }
+        }
+        result.push_back(converted);
+    }
+    return result;
+}
@@ -0,0 +1,141 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "obj_loader.h"
+
+namespace tinygltf {
+    class Model;
+    struct Accessor;
+}
+
+// A triangle primitive placed in the scene by a node
+struct GltfPrimitiveRef {
+    int mesh;
+    int primitive;
+    glm::mat4 transform;    // World transform of the node
+};
+
+// A primitive whose buffers GL can read exactly as they are stored: the
+// vertex range covers every attribute (interleaved or one bufferView each)
+// and the indices are 16 or 32 bit. Pointers stay valid while the GltfFile
+// is open.
+struct GltfDirectPrimitive {
+    const unsigned char* vertexData;
+    size_t vertexBytes;
+    size_t vertexCount;
+    VertexAttribute attributes[3];  // Position, normal, texture coordinate (locations 0-2)
+    const unsigned char* indexData;
+    size_t indexBytes;
+    size_t indexCount;
+    GLenum indexType;
+    // The node's translation and uniform scale, applied by the vertex shader;
+    // this is also how KHR_mesh_quantization dequantizes positions
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    glm::vec3 boundsMin;    // After positionOffset/positionScale
+    glm::vec3 boundsMax;
+    int material;
+
+    GltfDirectPrimitive()
+        : vertexData(nullptr), vertexBytes(0), vertexCount(0), indexData(nullptr), indexBytes(0), indexCount(0),
+          indexType(GL_UNSIGNED_INT), positionOffset(0.0f), positionScale(1.0f), boundsMin(0.0f), boundsMax(0.0f),
+          material(-1) {}
+};
+
+// A primitive decoded to the loader's float streams (node transform applied,
+// V flipped for OpenGL, normals generated if the file has none)
+struct GltfDecodedPrimitive {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
+    int material;
+
+    GltfDecodedPrimitive() : material(-1) {}
+};
+
+// Encoded bytes (PNG, JPEG) of an image stored inside a glTF file
+typedef std::shared_ptr<const std::vector<unsigned char>> GltfImageBytes;
+
+// A glTF material converted to the shader's Blinn-Phong parameters
+struct GltfMaterial {
+    Material material;
+    std::string diffuseImage;   // Base color image file, empty if none; names an embedded image
+    GltfImageBytes diffuseImageData;    // The embedded image, null for an external file
+};
+
+// A glTF 2.0 model parsed with tinygltf: .gltf with external or embedded
+// buffers, or binary .glb. A .glb stays memory-mapped and its binary chunk
+// is read in place, so geometry can go to the GPU straight from the file.
+// Images are not decoded here; the loader streams them like MTL textures,
+// from their files or from the bytes of embedded ones (data URIs and
+// bufferViews), which are kept while the file is open.
+class GltfFile {
+public:
+    GltfFile();
+    ~GltfFile();
+
+    GltfFile(const GltfFile&) = delete;
+    GltfFile& operator=(const GltfFile&) = delete;
+
+    bool Open(const std::string& path);
+
+    // Every triangle primitive reachable from the default scene
+    std::vector<GltfPrimitiveRef> ScenePrimitives() const;
+
+    // Describe a primitive for upload without conversion. Returns false if
+    // it has to be decoded instead (missing normals, 8-bit or no indices,
+    // sparse accessors, attributes spread over buffers, a rotated node or
+    // indices past the last vertex). DecodePrimitive rejects the latter too.
+    bool GetDirectPrimitive(const GltfPrimitiveRef& ref, GltfDirectPrimitive& out) const;
+    bool DecodePrimitive(const GltfPrimitiveRef& ref, GltfDecodedPrimitive& out) const;
+
+    // Materials in file order, with image paths resolved against baseDir.
+    // Embedded images are named after the file and their index.
+    std::vector<GltfMaterial> ReadMaterials(const std::string& baseDir) const;
+
+    bool IsBinary() const { return binaryChunk != nullptr; }
+    size_t FileSize() const { return fileSize; }
+
+private:
+    // Bytes of a buffer; for the .glb's own buffer a pointer into the mapping
+    const unsigned char* BufferData(int buffer) const;
+    size_t BufferSize(int buffer) const;
+
+    // Elements of an accessor as stored, or false if they cannot be read in place
+    struct AccessorView {
+        int buffer;
+        const unsigned char* data;
+        size_t count;
+        size_t stride;
+        size_t elementSize;
+        int componentType;
+        int components;
+        bool normalized;
+    };
+    bool GetAccessorView(const tinygltf::Accessor& accessor, AccessorView& view) const;
+    // The first `components` values of each element converted to float
+    // (normalized integers to [0, 1] or [-1, 1]), with sparse substitutions
+    bool ReadFloats(int accessor, int components, std::vector<float>& out) const;
+    bool ReadIndices(int accessor, std::vector<unsigned int>& out) const;
+
+    std::unique_ptr<tinygltf::Model> model;
+    std::string sourcePath;
+    MappedFile file;
+    std::vector<GltfImageBytes> embeddedImages;     // By image index, null for external files
+    const unsigned char* binaryChunk = nullptr;
+    size_t binaryChunkSize = 0;
+    size_t fileSize = 0;
+};
+
+// Whether a path names a glTF file (.gltf or .glb)
+bool IsGltfPath(const std::string& path);
+
+#endif // GLTF_LOADER_H
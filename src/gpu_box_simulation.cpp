@@ -0,0 +1,268 @@
+#include "gpu_box_simulation.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    // Attribute locations in box_simulate.vert
+    const GLuint POSITION_ROTATION_ATTRIBUTE = 0;
+    const GLuint VELOCITY_SPIN_ATTRIBUTE = 1;
+
+    GLuint CompileSimulationProgram(const std::string& path) {
+        std::ifstream file(path.c_str());
+        if (!file) {
+            std::cerr << "GpuBoxSimulation: cannot read " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char* codePointer = code.c_str();
+
+        GLint success = 0;
+        char infoLog[1024];
+        GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(shader, 1, &codePointer, NULL);
+        glCompileShader(shader);
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED (" << path << ")\n" << infoLog << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+
+        // The captured output has to be named before linking
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        const char* varyings[] = {"outPositionRotation"};
+        glTransformFeedbackVaryings(program, 1, varyings, GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+            std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED (" << path << ")\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+}
+
+GpuBoxSimulation::GpuBoxSimulation()
+    : program(0), deltaTimeLocation(-1), motionBuffer(0), appearanceBuffer(0), current(0), count(0),
+      capacity(0) {
+    stateBuffers[0] = stateBuffers[1] = 0;
+    simulateVAO[0] = simulateVAO[1] = 0;
+}
+
+bool GpuBoxSimulation::Create(const std::string& shaderPath) {
+    if (program != 0) {
+        return true;
+    }
+    program = CompileSimulationProgram(shaderPath);
+    if (program == 0) {
+        return false;
+    }
+    glUseProgram(program);
+    glUniform1f(glGetUniformLocation(program, "boundary"), BOX_WRAP_BOUNDARY);
+    deltaTimeLocation = glGetUniformLocation(program, "deltaTime");
+    glUseProgram(0);
+
+    glGenBuffers(2, stateBuffers);
+    glGenBuffers(1, &motionBuffer);
+    glGenBuffers(1, &appearanceBuffer);
+
+    // One VAO per direction of the ping-pong; the buffers keep their names
+    // when Upload resizes them, so these never need rebinding
+    glGenVertexArrays(2, simulateVAO);
+    for (int i = 0; i < 2; ++i) {
+        glBindVertexArray(simulateVAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+        glVertexAttribPointer(POSITION_ROTATION_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+        glEnableVertexAttribArray(POSITION_ROTATION_ATTRIBUTE);
+        glBindBuffer(GL_ARRAY_BUFFER, motionBuffer);
+        glVertexAttribPointer(VELOCITY_SPIN_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+        glEnableVertexAttribArray(VELOCITY_SPIN_ATTRIBUTE);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void GpuBoxSimulation::Destroy() {
+    if (program == 0) {
+        return;
+    }
+    glDeleteVertexArrays(2, simulateVAO);
+    glDeleteBuffers(2, stateBuffers);
+    glDeleteBuffers(1, &motionBuffer);
+    glDeleteBuffers(1, &appearanceBuffer);
+    glDeleteProgram(program);
+    program = 0;
+    motionBuffer = appearanceBuffer = 0;
+    stateBuffers[0] = stateBuffers[1] = 0;
+    simulateVAO[0] = simulateVAO[1] = 0;
+    count = capacity = 0;
+}
+
+void GpuBoxSimulation::Upload(const BoxMotionArrays& motion, const float* scale, const glm::vec3* color,
+                              size_t boxCount) {
+    if (program == 0) {
+        return;
+    }
+    std::vector<glm::vec4> state(boxCount), velocity(boxCount), appearance(boxCount);
+    for (size_t i = 0; i < boxCount; ++i) {
+        state[i] = glm::vec4(motion.positionX[i], motion.positionY[i], motion.positionZ[i], motion.rotation[i]);
+        velocity[i] = glm::vec4(motion.velocityX[i], motion.velocityY[i], motion.velocityZ[i],
+                                motion.rotationSpeed[i]);
+        appearance[i] = glm::vec4(color[i], scale[i]);
+    }
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(boxCount * sizeof(glm::vec4));
+    current = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, bytes, state.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, motionBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, velocity.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, appearanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, appearance.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count = capacity = boxCount;
+}
+
+void GpuBoxSimulation::Grow(size_t newCapacity) {
+    // Through a scratch buffer, so the buffers keep their names and the
+    // VAOs stay valid
+    GLsizeiptr keep = static_cast<GLsizeiptr>(count * sizeof(glm::vec4));
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(newCapacity * sizeof(glm::vec4));
+    GLuint scratch = 0;
+    glGenBuffers(1, &scratch);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+    glBufferData(GL_COPY_WRITE_BUFFER, keep > 0 ? keep : 1, NULL, GL_STREAM_COPY);
+    GLuint buffers[] = {stateBuffers[current], stateBuffers[1 - current], motionBuffer, appearanceBuffer};
+    for (int i = 0; i < 4; ++i) {
+        bool contents = keep > 0 && buffers[i] != stateBuffers[1 - current];
+        if (contents) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffers[i]);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keep);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, i < 2 ? GL_DYNAMIC_COPY : GL_STATIC_DRAW);
+        if (contents) {
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keep);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &scratch);
+    capacity = newCapacity;
+}
+
+void GpuBoxSimulation::UploadRange(const BoxMotionArrays& motion, const float* scale, const glm::vec3* color,
+                                   size_t first, size_t last) {
+    if (program == 0 || first >= last) {
+        return;
+    }
+    if (last > capacity) {
+        Grow(std::max(last, capacity + capacity / 2));
+    }
+    size_t boxCount = last - first;
+    std::vector<glm::vec4> state(boxCount), velocity(boxCount), appearance(boxCount);
+    for (size_t i = first; i < last; ++i) {
+        state[i - first] = glm::vec4(motion.positionX[i], motion.positionY[i], motion.positionZ[i],
+                                     motion.rotation[i]);
+        velocity[i - first] = glm::vec4(motion.velocityX[i], motion.velocityY[i], motion.velocityZ[i],
+                                        motion.rotationSpeed[i]);
+        appearance[i - first] = glm::vec4(color[i], scale[i]);
+    }
+    GLintptr offset = static_cast<GLintptr>(first * sizeof(glm::vec4));
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(boxCount * sizeof(glm::vec4));
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, state.data());
+    glBindBuffer(GL_ARRAY_BUFFER, motionBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, velocity.data());
+    glBindBuffer(GL_ARRAY_BUFFER, appearanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, appearance.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count = std::max(count, last);
+}
+
+void GpuBoxSimulation::Download(const BoxMotionArrays& motion) const {
+    DownloadRange(motion, 0, count);
+}
+
+void GpuBoxSimulation::DownloadRange(const BoxMotionArrays& motion, size_t first, size_t last) const {
+    last = std::min(last, count);
+    if (program == 0 || first >= last) {
+        return;
+    }
+    std::vector<glm::vec4> state(last - first);
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(glm::vec4)),
+                       static_cast<GLsizeiptr>(state.size() * sizeof(glm::vec4)), state.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    for (size_t i = first; i < last; ++i) {
+        motion.positionX[i] = state[i - first].x;
+        motion.positionY[i] = state[i - first].y;
+        motion.positionZ[i] = state[i - first].z;
+        motion.rotation[i] = state[i - first].w;
+    }
+}
+
+void GpuBoxSimulation::MoveInstance(size_t from, size_t to) {
+    if (program == 0 || from >= count || to >= count) {
+        return;
+    }
+    if (from != to) {
+        GLuint buffers[] = {stateBuffers[current], motionBuffer, appearanceBuffer};
+        for (GLuint buffer : buffers) {
+            // Disjoint ranges of one buffer may be copied directly
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                static_cast<GLintptr>(from * sizeof(glm::vec4)),
+                                static_cast<GLintptr>(to * sizeof(glm::vec4)), sizeof(glm::vec4));
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void GpuBoxSimulation::Truncate(size_t newCount) {
+    count = std::min(count, newCount);
+}
+
+void GpuBoxSimulation::Step(float deltaTime) {
+    if (program == 0 || count == 0) {
+        return;
+    }
+    int next = 1 - current;
+    glUseProgram(program);
+    glUniform1f(deltaTimeLocation, deltaTime);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(simulateVAO[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateBuffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    current = next;
+}
+
+void GpuBoxSimulation::BindInstanceAttributes(GLuint positionRotation, GLuint colorScale) const {
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+    glVertexAttribPointer(positionRotation, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, appearanceBuffer);
+    glVertexAttribPointer(colorScale, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+}
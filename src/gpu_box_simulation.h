@@ -0,0 +1,78 @@
+#ifndef GPU_BOX_SIMULATION_H
+#define GPU_BOX_SIMULATION_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <string>
+#include "box_update.h"
+
+// Moving boxes simulated on the GPU with transform feedback (GL 3.0+), for
+// scenes too large to update and upload from the CPU every frame.
+//
+// Position and rotation live in two buffers used in turn: each Step runs a
+// vertex-only pass (shaders/box_simulate.vert, rasterizer discarded) that
+// reads one buffer and captures the moved boxes into the other. Velocity
+// and rotation speed, and color and scale, never change and sit in buffers
+// of their own, so a step moves 32 bytes in and 16 out per box. The draw
+// reads the latest state straight from the GPU buffer (BindInstanceAttributes).
+//
+// The integration matches UpdateBoxMotion, including the wrap to the
+// opposite face, up to floating-point differences between CPU and GPU.
+class GpuBoxSimulation {
+public:
+    // GL objects need the context, so they are released by Destroy, not
+    // the destructor
+    GpuBoxSimulation();
+    GpuBoxSimulation(const GpuBoxSimulation&) = delete;
+    GpuBoxSimulation& operator=(const GpuBoxSimulation&) = delete;
+
+    // Compile the simulation program and create the buffers. Needs a
+    // current context; returns false (after logging why) if the program
+    // does not build.
+    bool Create(const std::string& shaderPath = "shaders/box_simulate.vert");
+    void Destroy();
+    bool IsCreated() const { return program != 0; }
+
+    // Replace the simulated boxes with [0, count) of the arrays
+    void Upload(const BoxMotionArrays& motion, const float* scale, const glm::vec3* color, size_t count);
+    // Overwrite (or append) boxes [first, last) from the arrays, leaving the
+    // others where the GPU moved them. The buffers grow when last passes
+    // their capacity, keeping their contents.
+    void UploadRange(const BoxMotionArrays& motion, const float* scale, const glm::vec3* color, size_t first,
+                     size_t last);
+    // Copy the current positions and rotations back into the arrays. Waits
+    // for the GPU, so only for mode switches and edits, not every frame.
+    void Download(const BoxMotionArrays& motion) const;
+    void DownloadRange(const BoxMotionArrays& motion, size_t first, size_t last) const;
+    // Copy box `from` over box `to` in every buffer, on the GPU: with
+    // Truncate, a swap-remove without a CPU round trip
+    void MoveInstance(size_t from, size_t to);
+    // Drop the boxes from newCount on
+    void Truncate(size_t newCount);
+
+    // Advance every box by deltaTime without touching CPU memory
+    void Step(float deltaTime);
+
+    // Point two instanced attributes of the bound VAO at the current state:
+    // vec4(position, rotation) and vec4(color, scale), divisor 1
+    void BindInstanceAttributes(GLuint positionRotation, GLuint colorScale) const;
+
+    size_t Count() const { return count; }
+
+private:
+    GLuint program;
+    GLint deltaTimeLocation;
+    GLuint stateBuffers[2];     // vec4(position, rotation), read and written in turn
+    GLuint motionBuffer;        // vec4(velocity, rotation speed)
+    GLuint appearanceBuffer;    // vec4(color, scale)
+    GLuint simulateVAO[2];      // Reads stateBuffers[i] and the motion buffer
+    int current;                // Buffer holding the latest state
+    size_t count;
+    size_t capacity;            // Boxes the buffers have room for
+
+    // Resize the buffers to newCapacity boxes, keeping the first count
+    void Grow(size_t newCapacity);
+};
+
+#endif // GPU_BOX_SIMULATION_H
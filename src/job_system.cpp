@@ -0,0 +1,199 @@
+#include "job_system.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+    // Which system and deque the current thread works for (workers only)
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local size_t currentQueue = 0;
+
+    bool PinCurrentThread(unsigned core) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (core % (8 * sizeof(DWORD_PTR)))) != 0;
+#else
+        // No affinity API (macOS only offers hints)
+        (void)core;
+        return false;
+#endif
+    }
+
+    unsigned CoreCount() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+}
+
+JobSystem::JobSystem(unsigned threadCount, bool pinThreads)
+    : queuedJobs(0), jobsRun(0), steals(0), pinned(false) {
+    if (threadCount == 0) {
+        threadCount = CoreCount();
+    }
+    queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.emplace_back(new WorkQueue());
+    }
+
+    // Workers take cores 1..n-1; core 0 is left to the thread that created
+    // the system (usually the render thread)
+    pinned = pinThreads;
+    workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back([this, i, pinThreads]() {
+            if (pinThreads && !PinCurrentThread(i % CoreCount())) {
+                pinned = false;
+            }
+            WorkerLoop(i);
+        });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+JobSystem& JobSystem::Instance() {
+    static JobSystem system;
+    return system;
+}
+
+size_t JobSystem::CurrentQueue() const {
+    return currentSystem == this ? currentQueue : 0;
+}
+
+void JobSystem::Run(JobCounter& counter, std::function<void()> job) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted before it is visible, so a sleeping worker never misses it
+    queuedJobs.fetch_add(1, std::memory_order_release);
+    WorkQueue& queue = *queues[CurrentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{std::move(job), &counter});
+    }
+    if (!workers.empty()) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    size_t queueIndex = CurrentQueue();
+    while (!counter.IsDone()) {
+        Job job;
+        if (TakeJob(queueIndex, job)) {
+            Execute(job);
+        } else {
+            // The rest is running on other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::TakeJob(size_t queueIndex, Job& job) {
+    // Newest job of our own deque first (depth-first, cache-warm)
+    {
+        WorkQueue& own = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Then the oldest job of another deque, which is the biggest piece left
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkQueue& victim = *queues[(queueIndex + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::Execute(Job& job) {
+    job.function();
+    jobsRun.fetch_add(1, std::memory_order_relaxed);
+    job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(size_t queueIndex) {
+    currentSystem = this;
+    currentQueue = queueIndex;
+    for (;;) {
+        Job job;
+        if (TakeJob(queueIndex, job)) {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queuedJobs.load(std::memory_order_acquire) > 0; });
+        if (stopping && queuedJobs.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void JobSystem::SplitRange(JobCounter& counter, size_t begin, size_t end, size_t grainSize,
+                           const std::function<void(size_t, size_t)>& body) {
+    // Fork the upper half and keep splitting the lower one; what is left
+    // runs here
+    while (end - begin > grainSize) {
+        size_t middle = begin + (end - begin) / 2;
+        Run(counter, [this, &counter, middle, end, grainSize, &body]() {
+            SplitRange(counter, middle, end, grainSize, body);
+        });
+        end = middle;
+    }
+    body(begin, end);
+}
+
+void JobSystem::ParallelFor(size_t begin, size_t end, size_t grainSize,
+                            const std::function<void(size_t, size_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    if (grainSize == 0) {
+        grainSize = 1;
+    }
+    if (workers.empty() || end - begin <= grainSize) {
+        body(begin, end);
+        return;
+    }
+    JobCounter counter;
+    SplitRange(counter, begin, end, grainSize, body);
+    Wait(counter);
+}
+
+JobSystemStats JobSystem::GetStats() const {
+    JobSystemStats stats;
+    stats.jobsRun = jobsRun.load(std::memory_order_relaxed);
+    stats.steals = steals.load(std::memory_order_relaxed);
+    return stats;
+}
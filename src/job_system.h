@@ -0,0 +1,107 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Outstanding jobs of one fork/join group. Jobs started with a counter
+// increment it and decrement it when they finish; JobSystem::Wait returns
+// once it is back at zero.
+class JobCounter {
+public:
+    JobCounter() : pending(0) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<size_t> pending;
+};
+
+struct JobSystemStats {
+    size_t jobsRun;
+    size_t steals;      // Jobs taken from another thread's deque
+
+    JobSystemStats() : jobsRun(0), steals(0) {}
+};
+
+// Work-stealing scheduler for short, fine-grained frame work (unlike
+// ThreadPool, whose FIFO queue suits independent long tasks such as file
+// loads). Every worker owns a deque: it pushes and pops jobs at the back,
+// so nested forks run depth-first with warm caches, and idle workers steal
+// from the front of the others, taking the largest pieces of split ranges.
+// Threads outside the system share one extra deque. A thread waiting on a
+// counter runs queued jobs instead of blocking, so jobs may fork and wait
+// themselves.
+class JobSystem {
+public:
+    // threadCount counts the calling thread, which helps while it waits:
+    // 0 = one per core, 1 = no workers (everything runs in Wait). With
+    // pinThreads each worker is bound to one core (Linux and Windows only).
+    explicit JobSystem(unsigned threadCount = 0, bool pinThreads = false);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Shared by the per-frame updates
+    static JobSystem& Instance();
+
+    // Fork: queue a job; counter must outlive it
+    void Run(JobCounter& counter, std::function<void()> job);
+    // Join: run queued jobs until every job of the counter has finished
+    void Wait(JobCounter& counter);
+
+    // Call body(first, last) on pieces of [begin, end) at most grainSize
+    // long, in parallel, and return when all are done. The range is split in
+    // halves recursively, so thieves take large pieces and split them further.
+    void ParallelFor(size_t begin, size_t end, size_t grainSize,
+                     const std::function<void(size_t, size_t)>& body);
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+    bool ArePinned() const { return pinned; }
+    JobSystemStats GetStats() const;
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void WorkerLoop(size_t queueIndex);
+    // Pop from the thread's own deque, else steal; false if all are empty
+    bool TakeJob(size_t queueIndex, Job& job);
+    void Execute(Job& job);
+    void SplitRange(JobCounter& counter, size_t begin, size_t end, size_t grainSize,
+                    const std::function<void(size_t, size_t)>& body);
+    // Deque of the calling thread: its own for workers, the shared one otherwise
+    size_t CurrentQueue() const;
+
+    // queues[0] is shared by outside threads; worker i owns queues[i + 1]
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<size_t> jobsRun;
+    std::atomic<size_t> steals;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<bool> pinned;
+};
+
+#endif // JOB_SYSTEM_H
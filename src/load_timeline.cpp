@@ -0,0 +1,80 @@
+#include "load_timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct LoadEvent {
+        std::string label;
+        double startMs;
+        double endMs;
+        int thread;     // 0 is the first thread that recorded anything (normally main)
+    };
+    
+    std::mutex timelineMutex;
+    std::vector<LoadEvent> events;
+    std::map<std::thread::id, int> threadNumbers;
+    bool recording = true;
+    
+    const int TIMELINE_COLUMNS = 60;
+    
+    std::chrono::steady_clock::time_point TimelineOrigin() {
+        static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        return origin;
+    }
+}
+
+double LoadTimelineNow() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - TimelineOrigin()).count();
+}
+
+void RecordLoadEvent(const std::string& label, double startMs, double endMs) {
+    std::lock_guard<std::mutex> lock(timelineMutex);
+    if (!recording) {
+        return;
+    }
+    auto inserted = threadNumbers.insert(std::make_pair(std::this_thread::get_id(),
+                                                        static_cast<int>(threadNumbers.size())));
+    events.push_back(LoadEvent{label, startMs, endMs, inserted.first->second});
+}
+
+void PrintLoadTimeline() {
+    std::lock_guard<std::mutex> lock(timelineMutex);
+    if (!recording) {
+        return;
+    }
+    recording = false;
+    if (events.empty()) {
+        return;
+    }
+    
+    std::sort(events.begin(), events.end(), [](const LoadEvent& a, const LoadEvent& b) {
+        return a.startMs < b.startMs;
+    });
+    double begin = events.front().startMs;
+    double end = begin;
+    for (const LoadEvent& event : events) {
+        end = std::max(end, event.endMs);
+    }
+    double scale = end > begin ? TIMELINE_COLUMNS / (end - begin) : 0.0;
+    
+    std::cout << "\n=== Startup timeline (" << std::fixed << std::setprecision(1) << (end - begin)
+              << " ms, thread 0 = main) ===" << std::endl;
+    for (const LoadEvent& event : events) {
+        int first = static_cast<int>((event.startMs - begin) * scale);
+        int last = std::max(first + 1, static_cast<int>((event.endMs - begin) * scale));
+        first = std::min(first, TIMELINE_COLUMNS - 1);
+        last = std::min(last, TIMELINE_COLUMNS);
+        std::string bar(TIMELINE_COLUMNS, ' ');
+        std::fill(bar.begin() + first, bar.begin() + last, '#');
+        std::cout << "T" << event.thread << " |" << bar << "| " << std::setw(7) << (event.startMs - begin)
+                  << " +" << std::setw(6) << (event.endMs - event.startMs) << " ms  " << event.label << std::endl;
+    }
+    events.clear();
+    events.shrink_to_fit();
+}
@@ -0,0 +1,31 @@
+#ifndef LOAD_TIMELINE_H
+#define LOAD_TIMELINE_H
+
+#include <string>
+
+// Startup timeline: asset loading steps record when and on which thread they
+// ran, and PrintLoadTimeline draws them as one row per step so the overlap of
+// decoding, parsing and GL uploads is visible. Recording stops after the
+// first print.
+void RecordLoadEvent(const std::string& label, double startMs, double endMs);
+
+// Milliseconds since the first timeline call of the process
+double LoadTimelineNow();
+
+void PrintLoadTimeline();
+
+// Records the lifetime of the scope as one event
+class LoadTimelineScope {
+public:
+    explicit LoadTimelineScope(const std::string& label) : label(label), start(LoadTimelineNow()) {}
+    ~LoadTimelineScope() { RecordLoadEvent(label, start, LoadTimelineNow()); }
+    
+    LoadTimelineScope(const LoadTimelineScope&) = delete;
+    LoadTimelineScope& operator=(const LoadTimelineScope&) = delete;
+    
+private:
+    std::string label;
+    double start;
+};
+
+#endif // LOAD_TIMELINE_H
@@ -0,0 +1,372 @@
+#include "loose_octree.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    enum BoundsTest {
+        BOUNDS_OUTSIDE,
+        BOUNDS_INTERSECTS,
+        BOUNDS_INSIDE       // Everything in the bounds passes the query
+    };
+
+    struct FrustumVisitor {
+        const MeshletFrustum& frustum;
+        const SphereArrays& spheres;
+        std::vector<uint32_t>& out;
+        unsigned childMask;
+
+        int TestBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+            glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+            glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+            bool inside = true;
+            for (const glm::vec4& plane : frustum.planes) {
+                float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+                if (distance < -radius) {
+                    return BOUNDS_OUTSIDE;
+                }
+                inside = inside && distance >= radius;
+            }
+            return inside ? BOUNDS_INSIDE : BOUNDS_INTERSECTS;
+        }
+
+        // Same arithmetic as CullSpheres, so both agree on every sphere
+        void TestObject(uint32_t i) {
+            float negativeRadius = -(spheres.radius[i] * spheres.radiusScale);
+            for (const glm::vec4& plane : frustum.planes) {
+                float distance = plane.x * spheres.centerX[i] + plane.y * spheres.centerY[i];
+                distance = distance + plane.z * spheres.centerZ[i];
+                distance = distance + plane.w;
+                if (distance < negativeRadius) {
+                    return;
+                }
+            }
+            out.push_back(i);
+        }
+    };
+
+    struct RadiusVisitor {
+        glm::vec3 center;
+        float radius;
+        const SphereArrays& spheres;
+        std::vector<uint32_t>& out;
+        unsigned childMask;
+
+        int TestBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+            glm::vec3 closest = glm::clamp(center, boundsMin, boundsMax);
+            glm::vec3 toClosest = closest - center;
+            if (glm::dot(toClosest, toClosest) > radius * radius) {
+                return BOUNDS_OUTSIDE;
+            }
+            glm::vec3 farthest = glm::max(glm::abs(boundsMin - center), glm::abs(boundsMax - center));
+            return glm::dot(farthest, farthest) <= radius * radius ? BOUNDS_INSIDE : BOUNDS_INTERSECTS;
+        }
+
+        void TestObject(uint32_t i) {
+            glm::vec3 offset = glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) - center;
+            float reach = radius + spheres.radius[i] * spheres.radiusScale;
+            if (glm::dot(offset, offset) <= reach * reach) {
+                out.push_back(i);
+            }
+        }
+    };
+
+    struct RayVisitor {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        glm::vec3 inverseDirection;
+        const SphereArrays& spheres;
+        std::vector<uint32_t>& out;     // Unused: rays never accept whole subtrees
+        unsigned childMask;             // Visit children nearest the origin first
+        float nearest;
+        uint32_t hit;
+
+        int TestBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+            // Slab test; cells farther than the nearest hit so far are skipped
+            glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+            glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+            glm::vec3 tNear = glm::min(t0, t1);
+            glm::vec3 tFar = glm::max(t0, t1);
+            float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, nearest));
+            return enter <= exit ? BOUNDS_INTERSECTS : BOUNDS_OUTSIDE;
+        }
+
+        void TestObject(uint32_t i) {
+            glm::vec3 toCenter = glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) - origin;
+            float radius = spheres.radius[i] * spheres.radiusScale;
+            float along = glm::dot(toCenter, direction);
+            float missSquared = glm::dot(toCenter, toCenter) - along * along;
+            if (missSquared > radius * radius) {
+                return;
+            }
+            float halfChord = std::sqrt(radius * radius - missSquared);
+            float t = along - halfChord;
+            if (t < 0.0f) {
+                t = along + halfChord; // Origin inside the sphere
+            }
+            if (t >= 0.0f && t <= nearest) {
+                nearest = t;
+                hit = i;
+            }
+        }
+    };
+}
+
+LooseOctree::LooseOctree(const glm::vec3& center, float halfSize, unsigned depth)
+    : origin(center - glm::vec3(halfSize)), size(2.0f * halfSize), maxDepth(depth),
+      spheres{nullptr, nullptr, nullptr, nullptr, 1.0f} {
+    uint32_t offset = 0;
+    for (unsigned level = 0; level <= maxDepth; ++level) {
+        levelOffsets.push_back(offset);
+        uint32_t n = 1u << level;
+        offset += n * n * n;
+    }
+    levelOffsets.push_back(offset);
+}
+
+uint32_t LooseOctree::CellIndex(unsigned level, uint32_t x, uint32_t y, uint32_t z) const {
+    uint32_t n = 1u << level;
+    return levelOffsets[level] + (z * n + y) * n + x;
+}
+
+uint32_t LooseOctree::PlaceObject(size_t i) const {
+    float diameter = 2.0f * spheres.radius[i] * spheres.radiusScale;
+    glm::vec3 local = (glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) - origin) / size;
+    // Written so NaN positions end up outside too
+    bool inRoot = local.x >= 0.0f && local.x <= 1.0f && local.y >= 0.0f && local.y <= 1.0f &&
+                  local.z >= 0.0f && local.z <= 1.0f;
+    if (!inRoot || !(diameter <= size)) {
+        return OUTSIDE;
+    }
+
+    // Deepest level whose cells are at least as wide as the sphere
+    unsigned level = maxDepth;
+    while (level > 0 && size / static_cast<float>(1u << level) < diameter) {
+        level--;
+    }
+    uint32_t n = 1u << level;
+    uint32_t x = std::min(static_cast<uint32_t>(local.x * n), n - 1);
+    uint32_t y = std::min(static_cast<uint32_t>(local.y * n), n - 1);
+    uint32_t z = std::min(static_cast<uint32_t>(local.z * n), n - 1);
+    return CellIndex(level, x, y, z);
+}
+
+void LooseOctree::AddToSubtreeCounts(uint32_t cell, int delta) {
+    unsigned level = static_cast<unsigned>(
+        std::upper_bound(levelOffsets.begin(), levelOffsets.end(), cell) - levelOffsets.begin() - 1);
+    uint32_t n = 1u << level;
+    uint32_t local = cell - levelOffsets[level];
+    uint32_t x = local % n;
+    uint32_t y = (local / n) % n;
+    uint32_t z = local / (n * n);
+    for (;;) {
+        cells[CellIndex(level, x, y, z)].subtreeCount += delta;
+        if (level == 0) {
+            break;
+        }
+        level--;
+        x >>= 1;
+        y >>= 1;
+        z >>= 1;
+    }
+}
+
+void LooseOctree::Insert(uint32_t object, uint32_t cell) {
+    std::vector<uint32_t>& list = cell == OUTSIDE ? outside : cells[cell].objects;
+    objectCell[object] = cell;
+    objectSlot[object] = static_cast<uint32_t>(list.size());
+    list.push_back(object);
+    if (cell != OUTSIDE) {
+        AddToSubtreeCounts(cell, 1);
+    }
+}
+
+void LooseOctree::Remove(uint32_t object) {
+    uint32_t cell = objectCell[object];
+    std::vector<uint32_t>& list = cell == OUTSIDE ? outside : cells[cell].objects;
+    uint32_t slot = objectSlot[object];
+    uint32_t last = list.back();
+    list[slot] = last;
+    objectSlot[last] = slot;
+    list.pop_back();
+    if (cell != OUTSIDE) {
+        AddToSubtreeCounts(cell, -1);
+    }
+}
+
+void LooseOctree::Clear() {
+    for (Cell& cell : cells) {
+        cell.objects.clear();
+        cell.subtreeCount = 0;
+    }
+    outside.clear();
+    objectCell.clear();
+    objectSlot.clear();
+}
+
+void LooseOctree::Build(const SphereArrays& newSpheres, size_t count) {
+    // The grids are allocated on first use, not when the tree is declared
+    if (cells.empty()) {
+        cells.resize(levelOffsets.back());
+    }
+    Clear();
+    spheres = newSpheres;
+    objectCell.resize(count);
+    objectSlot.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        Insert(static_cast<uint32_t>(i), PlaceObject(i));
+    }
+    stats.moved = count;
+}
+
+size_t LooseOctree::Refit(const SphereArrays& newSpheres, size_t count) {
+    if (count < objectCell.size() || cells.empty()) {
+        Build(newSpheres, count);
+        return count;
+    }
+    spheres = newSpheres;
+    size_t known = objectCell.size();
+    objectCell.resize(count);
+    objectSlot.resize(count);
+    for (size_t i = known; i < count; ++i) {
+        Insert(static_cast<uint32_t>(i), PlaceObject(i));
+    }
+    size_t moved = count - known;
+    for (size_t i = 0; i < known; ++i) {
+        uint32_t cell = PlaceObject(i);
+        if (cell != objectCell[i]) {
+            uint32_t object = static_cast<uint32_t>(i);
+            Remove(object);
+            Insert(object, cell);
+            moved++;
+        }
+    }
+    stats.moved = moved;
+    return moved;
+}
+
+void LooseOctree::SwapRemove(uint32_t object) {
+    if (object >= objectCell.size()) {
+        return;
+    }
+    Remove(object);
+    uint32_t last = static_cast<uint32_t>(objectCell.size() - 1);
+    if (object != last) {
+        uint32_t cell = objectCell[last];
+        std::vector<uint32_t>& list = cell == OUTSIDE ? outside : cells[cell].objects;
+        list[objectSlot[last]] = object;
+        objectCell[object] = cell;
+        objectSlot[object] = objectSlot[last];
+    }
+    objectCell.pop_back();
+    objectSlot.pop_back();
+}
+
+void LooseOctree::NodeBounds(const Node& node, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    // The cell, loosened by half its width on every side
+    float cellSize = size / static_cast<float>(1u << node.level);
+    glm::vec3 cellMin = origin + glm::vec3(node.x, node.y, node.z) * cellSize;
+    boundsMin = cellMin - glm::vec3(0.5f * cellSize);
+    boundsMax = cellMin + glm::vec3(1.5f * cellSize);
+}
+
+void LooseOctree::CollectSubtree(const Node& node, std::vector<uint32_t>& out) const {
+    const Cell& cell = cells[CellIndex(node.level, node.x, node.y, node.z)];
+    if (cell.subtreeCount == 0) {
+        return;
+    }
+    stats.nodesVisited++;
+    out.insert(out.end(), cell.objects.begin(), cell.objects.end());
+    if (node.level < maxDepth) {
+        for (unsigned child = 0; child < 8; ++child) {
+            Node next = {node.level + 1, 2 * node.x + (child & 1), 2 * node.y + ((child >> 1) & 1),
+                         2 * node.z + (child >> 2)};
+            CollectSubtree(next, out);
+        }
+    }
+}
+
+template <typename Visitor>
+void LooseOctree::Traverse(const Node& node, Visitor& visitor) const {
+    const Cell& cell = cells[CellIndex(node.level, node.x, node.y, node.z)];
+    if (cell.subtreeCount == 0) {
+        return;
+    }
+    stats.nodesVisited++;
+    glm::vec3 boundsMin, boundsMax;
+    NodeBounds(node, boundsMin, boundsMax);
+    int result = visitor.TestBounds(boundsMin, boundsMax);
+    if (result == BOUNDS_OUTSIDE) {
+        return;
+    }
+    if (result == BOUNDS_INSIDE) {
+        stats.nodesVisited--; // Counted again by CollectSubtree
+        CollectSubtree(node, visitor.out);
+        return;
+    }
+
+    for (uint32_t object : cell.objects) {
+        stats.objectsTested++;
+        visitor.TestObject(object);
+    }
+    if (node.level < maxDepth) {
+        for (unsigned order = 0; order < 8; ++order) {
+            unsigned child = order ^ visitor.childMask;
+            Node next = {node.level + 1, 2 * node.x + (child & 1), 2 * node.y + ((child >> 1) & 1),
+                         2 * node.z + (child >> 2)};
+            Traverse(next, visitor);
+        }
+    }
+}
+
+void LooseOctree::QueryFrustum(const MeshletFrustum& frustum, std::vector<uint32_t>& out) const {
+    stats.nodesVisited = 0;
+    stats.objectsTested = 0;
+    FrustumVisitor visitor = {frustum, spheres, out, 0};
+    for (uint32_t object : outside) {
+        stats.objectsTested++;
+        visitor.TestObject(object);
+    }
+    if (!cells.empty()) {
+        Traverse(Node{0, 0, 0, 0}, visitor);
+    }
+}
+
+void LooseOctree::QueryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+    stats.nodesVisited = 0;
+    stats.objectsTested = 0;
+    RadiusVisitor visitor = {center, radius, spheres, out, 0};
+    for (uint32_t object : outside) {
+        stats.objectsTested++;
+        visitor.TestObject(object);
+    }
+    if (!cells.empty()) {
+        Traverse(Node{0, 0, 0, 0}, visitor);
+    }
+}
+
+bool LooseOctree::Raycast(const glm::vec3& rayOrigin, const glm::vec3& direction, float maxDistance,
+                          uint32_t& hit, float& distance) const {
+    stats.nodesVisited = 0;
+    stats.objectsTested = 0;
+    std::vector<uint32_t> unused;
+    // Children on the side the ray comes from are visited first
+    unsigned childMask = (direction.x < 0.0f ? 1u : 0u) | (direction.y < 0.0f ? 2u : 0u) |
+                         (direction.z < 0.0f ? 4u : 0u);
+    RayVisitor visitor = {rayOrigin, direction, 1.0f / direction, spheres, unused, childMask,
+                          maxDistance, OUTSIDE};
+    for (uint32_t object : outside) {
+        stats.objectsTested++;
+        visitor.TestObject(object);
+    }
+    if (!cells.empty()) {
+        Traverse(Node{0, 0, 0, 0}, visitor);
+    }
+    if (visitor.hit == OUTSIDE) {
+        return false;
+    }
+    hit = visitor.hit;
+    distance = visitor.nearest;
+    return true;
+}
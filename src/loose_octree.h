@@ -0,0 +1,100 @@
+#ifndef LOOSE_OCTREE_H
+#define LOOSE_OCTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum_cull.h"
+#include "meshlet.h"
+
+// Work done by the last refit or query
+struct LooseOctreeStats {
+    size_t moved;           // Objects that changed cell in the last Refit
+    size_t nodesVisited;    // By the last query
+    size_t objectsTested;
+
+    LooseOctreeStats() : moved(0), nodesVisited(0), objectsTested(0) {}
+};
+
+// Spatial index over moving bounding spheres (the Box instances). A loose
+// octree stored as one dense grid per level: level L splits the root cube
+// into 2^L cells per axis, and each cell's bounds are loosened by half a
+// cell on every side. An object lives in the cell containing its center at
+// the deepest level whose cells are at least twice its radius wide, so its
+// sphere always fits the loose bounds and only its center decides where it
+// goes.
+//
+// Refit re-reads the positions and moves just the objects whose cell
+// changed, in constant time each; a box wrapping from one side of the
+// scene to the other is one such move, not a rebuild. Objects outside the
+// root cube are kept in a list every query tests.
+class LooseOctree {
+public:
+    // Root cube centered at center, halfSize to each side. maxDepth bounds
+    // the memory: the finest level has 8^maxDepth cells.
+    LooseOctree(const glm::vec3& center, float halfSize, unsigned maxDepth = 6);
+
+    // Index spheres [0, count), replacing the previous contents
+    void Build(const SphereArrays& spheres, size_t count);
+    // Spheres moved (arrays possibly reallocated): update the cells. Spheres
+    // appended since are inserted; a smaller count builds instead. Returns
+    // the objects moved or inserted.
+    size_t Refit(const SphereArrays& spheres, size_t count);
+    // Mirror a swap-remove of the indexed arrays: drop object, and the last
+    // object takes its index
+    void SwapRemove(uint32_t object);
+    void Clear();
+
+    // Indices of the spheres not entirely outside the frustum, appended to out
+    void QueryFrustum(const MeshletFrustum& frustum, std::vector<uint32_t>& out) const;
+    // Indices of the spheres overlapping the sphere (center, radius)
+    void QueryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+    // Nearest sphere hit by the ray within maxDistance (direction normalized).
+    // Returns false if there is none.
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                 uint32_t& hit, float& distance) const;
+
+    size_t ObjectCount() const { return objectCell.size(); }
+    size_t CellCount() const { return cells.size(); }
+    const LooseOctreeStats& GetStats() const { return stats; }
+
+private:
+    static const uint32_t OUTSIDE = 0xFFFFFFFFu;
+
+    struct Cell {
+        std::vector<uint32_t> objects;
+        uint32_t subtreeCount = 0;      // Objects in this cell and all below it
+    };
+
+    struct Node {
+        unsigned level;
+        uint32_t x, y, z;
+    };
+
+    uint32_t CellIndex(unsigned level, uint32_t x, uint32_t y, uint32_t z) const;
+    // Cell an object belongs in, or OUTSIDE
+    uint32_t PlaceObject(size_t object) const;
+    void Insert(uint32_t object, uint32_t cell);
+    void Remove(uint32_t object);
+    void AddToSubtreeCounts(uint32_t cell, int delta);
+    void NodeBounds(const Node& node, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+    template <typename Visitor>
+    void Traverse(const Node& node, Visitor& visitor) const;
+    // Every object in the subtree, without further tests
+    void CollectSubtree(const Node& node, std::vector<uint32_t>& out) const;
+
+    glm::vec3 origin;           // Minimum corner of the root cube
+    float size;                 // Edge length of the root cube
+    unsigned maxDepth;
+    std::vector<uint32_t> levelOffsets;     // First cell of each level
+    std::vector<Cell> cells;
+    std::vector<uint32_t> objectCell;       // Per object: its cell, or OUTSIDE
+    std::vector<uint32_t> objectSlot;       // Its position in that cell's (or outside) list
+    std::vector<uint32_t> outside;
+    SphereArrays spheres;
+    mutable LooseOctreeStats stats;
+};
+
+#endif // LOOSE_OCTREE_H
@@ -8,6 +8,7 @@
 #include <vector>
 #include <random>
 #include <string>
+#include <chrono>
 
 // Include standard headers
 #include <iostream>
@@ -29,6 +30,12 @@
 #include "butterfly.h"
 #include "text_renderer.h"
 #include "box.h"
+#include "texture_loader.h"
+#include "asset_bundle.h"
+#include "job_system.h"
+#include "stream_buffer.h"
+#include "load_timeline.h"
+#include "scene_generator.h"
 
 // FPS counter variables
 float fps = 0.0f;
@@ -45,6 +52,8 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 // Settings
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
+// Framebuffer height in pixels, kept by framebuffer_size_callback (for LOD selection)
+int viewportHeight = SCR_HEIGHT;
 
 // Camera
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
@@ -63,13 +72,30 @@ float yaw = -90.0f;
 float pitch = 0.0f;
 float fov = 45.0f;
 
+// GL object creation per frame for models still loading in the background
+const int UPLOAD_BUDGET_US = 2000;
+
+// Vertex format benchmark: V toggles quantized butterfly vertices
+bool quantizeButterflies = false;
+// Fragment cost benchmark: C draws every butterfly with the discarding shader
+bool forceButterflyAlphaTest = false;
+// Box simulation benchmark: G moves the boxes on the GPU with transform feedback
+bool gpuBoxSimulation = false;
+
 // Shaders - managed by shader_manager.h
 extern ShaderPtr ourShader;
 extern ShaderPtr skyboxShader;
 extern ShaderPtr lightShader;
 
-int main()
+int main(int argc, char** argv)
 {
+    // Seed, size and time step of the scene, so benchmark runs can be replayed
+    SceneOptions scene;
+    if (!ParseSceneOptions(argc, argv, scene)) {
+        return -1;
+    }
+    gpuBoxSimulation = scene.gpuSimulation;
+    
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -93,6 +119,7 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, NULL, &viewportHeight);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
@@ -109,6 +136,19 @@ int main()
     // Configure global OpenGL state
     glEnable(GL_DEPTH_TEST);
     
+    // Decode textures to BC1/BC3 (cached next to the images) when the driver supports S3TC
+    SetTextureCompression(DetectTextureCompressionSupport());
+    std::cout << "Texture compression: " << (IsTextureCompressionEnabled() ? "S3TC" : "unavailable, using RGBA8") << std::endl;
+    SetPersistentMapping(DetectPersistentMapping(glfwGetProcAddress));
+    std::cout << "Stream buffers: " << (IsPersistentMappingEnabled() ? "persistent mapped"
+                                                                     : "unsynchronized maps with orphaning") << std::endl;
+    
+    // Meshes and compressed textures preprocessed by assetc, used before the per-file caches
+    if (AssetBundle::Instance().Open("assets.bundle")) {
+        std::cout << "Asset bundle: " << AssetBundle::Instance().Entries().size() << " entries ("
+                  << (AssetBundle::Instance().FileSize() / (1024 * 1024)) << " MB)" << std::endl;
+    }
+    
     // Initialize shaders using the shader manager
     InitializeShaderManager();
     
@@ -122,68 +162,33 @@ int main()
     // Initialize Box class
     Box::setupBuffers();
     
-    // Add multiple small boxes with random positions and colors
-    std::srand(static_cast<unsigned int>(std::time(nullptr))); // Seed random number generator
-    
-    // Function to generate a random float between min and max
-    auto randomFloat = [](float min, float max) {
-        return min + static_cast<float>(std::rand()) / (static_cast<float>(RAND_MAX/(max - min)));
-    };
-    
-    // Function to generate a random color
-    auto randomColor = [&randomFloat]() {
-        return glm::vec3(
-            randomFloat(0.2f, 1.0f), // R
-            randomFloat(0.2f, 1.0f), // G
-            randomFloat(0.2f, 1.0f)  // B
-        );
-    };
-    
-    // Create a grid of boxes
-    const int gridSize = 5; // 5x5x5 grid
-    const float spacing = 2.0f;
-    
-    for (int x = -gridSize/2; x <= gridSize/2; ++x) {
-        for (int y = -gridSize/2; y <= gridSize/2; ++y) {
-            for (int z = -gridSize/2; z <= gridSize/2; ++z) {
-                // Skip the center where the butterfly is
-                if (x == 0 && y == 0 && z == 0) continue;
-                
-                // Add some randomness to the positions
-                float randX = x * spacing + randomFloat(-0.5f, 0.5f);
-                float randY = y * spacing + randomFloat(-0.5f, 0.5f);
-                float randZ = z * spacing + randomFloat(-0.5f, 0.5f);
-                
-                // Add the box
-                Box::addInstance(Box::InstanceData{
-                    glm::vec3(randX, randY + 0.5f, randZ - 3.0f), // Position with some offset
-                    randomColor(),                                 // Random color
-                    randomFloat(0.01f, 0.05f)                     // Random scale between 0.01 and 0.05
-                });
-            }
+    // Generate the boxes from the scene options; every box has its own
+    // random stream, so the same options always give the same scene
+    {
+        std::vector<Box::InstanceData> sceneBoxes;
+        GenerateSceneBoxes(scene, sceneBoxes);
+        for (const Box::InstanceData& box : sceneBoxes) {
+            Box::addInstance(box);
         }
+        std::cout << "Scene: seed " << scene.seed << ", " << sceneBoxes.size() << " boxes on a " << scene.gridX
+                  << "x" << scene.gridY << "x" << scene.gridZ << " grid, " << scene.butterflyCount
+                  << " butterflies, hash " << std::hex << HashSceneBoxes(sceneBoxes) << std::dec << std::endl;
     }
     
-    // Add one special box above the butterfly
-    Box::addInstance(Box::InstanceData{
-        glm::vec3(0.0f, 1.5f, -3.0f),  // Position above the butterfly
-        glm::vec3(1.0f, 1.0f, 1.0f),   // White color
-        0.1f                          // Slightly larger scale
-    });
-    
     // Create a shader for the box
     Shader boxShader("shaders/box.vert", "shaders/box.frag");
     std::cout << "Box shader loaded successfully (ID: " << boxShader.ID << ")" << std::endl;
     
     // Initialize text renderer with larger font size for better visibility
-    TextRenderer textRenderer(SCR_WIDTH, SCR_HEIGHT);
-    if (!textRenderer.Load("fonts/Roboto-Regular.ttf", 32)) {
+    // Released before the context goes away at the end of main
+    std::unique_ptr<TextRenderer> textRenderer(new TextRenderer(SCR_WIDTH, SCR_HEIGHT));
+    if (!textRenderer->Load("fonts/Roboto-Regular.ttf", 32)) {
         std::cerr << "Failed to load Roboto font for text rendering" << std::endl;
         // Try system font as fallback
-        if (!textRenderer.Load("/System/Library/Fonts/Supplemental/Arial.ttf", 32)) {
+        if (!textRenderer->Load("/System/Library/Fonts/Supplemental/Arial.ttf", 32)) {
             std::cerr << "Failed to load fallback Arial font" << std::endl;
             // Try another common system font
-            if (!textRenderer.Load("/System/Library/Fonts/SFNS.ttf", 32)) {
+            if (!textRenderer->Load("/System/Library/Fonts/SFNS.ttf", 32)) {
                 std::cerr << "Failed to load any font for text rendering" << std::endl;
             } else {
                 std::cout << "Successfully loaded SFNS system font" << std::endl;
@@ -200,23 +205,12 @@ int main()
     std::cout << "Loading butterfly model from: " << butterflyModelPath << std::endl;
     std::vector<std::unique_ptr<Butterfly>> butterflies;
     
-    // Create a single butterfly for now
-    Butterfly* butterfly = new Butterfly(*butterflyShader, butterflyModelPath);
-    
-    // Position the butterfly in front of the camera
-    butterfly->SetPosition(glm::vec3(0.0f, 0.0f, -3.0f));
-    
-    // Set a reasonable scale
-    butterfly->SetScale(0.1f);
-    
-    // Add to the vector
-    butterflies.emplace_back(butterfly);
-    
-    // Print debug info
-    std::cout << "Butterfly created at position: (" 
-              << butterfly->GetPosition().x << ", " 
-              << butterfly->GetPosition().y << ", " 
-              << butterfly->GetPosition().z << ")" << std::endl;
+    // The butterflies share one model, loaded once by the asset cache
+    for (size_t i = 0; i < scene.butterflyCount; ++i) {
+        Butterfly* butterfly = new Butterfly(*butterflyShader, butterflyModelPath, ButterflyRandom(scene, i));
+        butterfly->SetAlphaTestShader(butterflyAlphaTestShader.get());
+        butterflies.emplace_back(butterfly);
+    }
     
     // Load skybox
     std::vector<std::string> faces = {
@@ -324,7 +318,8 @@ int main()
     for (size_t i = 0; i < butterflies.size(); ++i) {
         // Position butterflies in different locations
         float angle = (float)i / butterflies.size() * 2.0f * 3.14159f;
-        float radius = 3.0f + (i * 2.0f);
+        // Rings 3 to 9 units out, inside the butterflies' boundary however many there are
+        float radius = 3.0f + (i % 4) * 2.0f;
         float x = sin(angle) * radius;
         float z = cos(angle) * radius;
         
@@ -332,50 +327,30 @@ int main()
         butterflies[i]->SetScale(0.005f);
     }
     
-    // Add a stationary light source box at the top of the scene
-    {
-        Box::InstanceData lightBox(
-            glm::vec3(0.0f, 10.0f, 0.0f),  // Position at the top of the scene
-            glm::vec3(1.0f, 0.9f, 0.5f),   // Yellowish-white color for light
-            0.5f,                          // Smaller scale for the light source
-            true                           // Mark as a light source
-        );
-        Box::addInstance(lightBox);
-        std::cout << "Added light source at position: (0.0, 10.0, 0.0)" << std::endl;
-    }
-    
-    // Add a few boxes to be illuminated by the light
-    std::srand(static_cast<unsigned int>(glfwGetTime())); // Seed random number generator
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            // Generate random color (avoiding very dark colors for better visibility)
-            glm::vec3 randomColor(
-                0.2f + static_cast<float>(std::rand()) / (static_cast<float>(RAND_MAX / 0.8f)),
-                0.2f + static_cast<float>(std::rand()) / (static_cast<float>(RAND_MAX / 0.8f)),
-                0.2f + static_cast<float>(std::rand()) / (static_cast<float>(RAND_MAX / 0.8f))
-            );
-            
-            Box::InstanceData box(
-                glm::vec3((i-1) * 2.0f, 0.5f, (j-1) * 2.0f - 5.0f),  // Grid of boxes
-                randomColor,  // Random color
-                0.2f + (i + j) * 0.1f,      // Smaller and more uniform scale
-                false                         // Not a light source
-            );
-            Box::addInstance(box);
-        }
-    }
-    
     // For timing and FPS
     float lastFrame = 0.0f;
     float deltaTime = 0.0f;
     float lastFpsUpdate = 0.0f;
     int frameCount = 0;
     float fps = 0.0f;
+    float simulationTime = 0.0f;
     
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
     
+    // GPU timers for the butterfly pass, one per frame in flight. Results are
+    // only read once available, so the query never stalls the pipeline; a
+    // timer whose frame is still queued when it comes round is dropped.
+    const int BUTTERFLY_TIMER_COUNT = 4;
+    GLuint butterflyTimers[BUTTERFLY_TIMER_COUNT];
+    glGenQueries(BUTTERFLY_TIMER_COUNT, butterflyTimers);
+    int butterflyTimerFrame = 0;    // Timers started
+    int butterflyTimerRead = 0;     // Timers read or dropped
+    double butterflyGpuMs = 0.0;
+    int butterflyGpuSamples = 0;
+    
     // Main render loop
+    bool startupTimelinePrinted = false;
     while (!glfwWindowShouldClose(window)) {
         // Per-frame time logic
         float currentFrame = static_cast<float>(glfwGetTime());
@@ -395,6 +370,20 @@ int main()
             // Update window title with FPS
             std::string title = "Butterfly Scene - " + std::to_string(static_cast<int>(fps)) + " FPS";
             glfwSetWindowTitle(window, title.c_str());
+            
+            if (butterflyGpuSamples > 0) {
+                std::cout << "Butterfly GPU time: " << (butterflyGpuMs / butterflyGpuSamples) << " ms/frame ("
+                          << (quantizeButterflies ? "quantized" : "float") << " vertices, "
+                          << (forceButterflyAlphaTest ? "discard" : "early-Z") << " shader, "
+                          << (1000.0f / fps) << " ms frame)" << std::endl;
+                butterflyGpuMs = 0.0;
+                butterflyGpuSamples = 0;
+            }
+            StreamBuffer::PrintStats();
+            const CullStats& boxCulling = Box::getCullStats();
+            std::cout << "Boxes: " << boxCulling.visible << "/" << boxCulling.tested << " visible ("
+                      << (Box::isGpuSimulation() ? "GPU simulation, no" : SimdKernelName(Box::getCullKernel()))
+                      << " culling)" << std::endl;
         }
         
         // Clear the screen
@@ -405,18 +394,72 @@ int main()
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
         
-        // Update all boxes
-        Box::updateInstances(deltaTime);
+        // Simulation time, fixed per frame when replaying a benchmark
+        float simulationStep = scene.fixedStep > 0.0f ? scene.fixedStep : deltaTime;
+        simulationTime = scene.fixedStep > 0.0f ? simulationTime + simulationStep : currentFrame;
+        
+        // Update all boxes, on the GPU if G or --gpu-boxes asked for it
+        if (Box::isGpuSimulation() != gpuBoxSimulation && !Box::setGpuSimulation(gpuBoxSimulation)) {
+            std::cerr << "GPU box simulation unavailable, staying on the CPU" << std::endl;
+            gpuBoxSimulation = false;
+        }
+        Box::updateInstances(simulationStep);
         
         // Draw all boxes
-        Box::drawInstances(boxShader, view, projection, static_cast<float>(glfwGetTime()));
+        Box::drawInstances(boxShader, view, projection, simulationTime);
+        
+        // Finish asynchronous butterfly and skybox loads within a small per-frame budget
+        std::chrono::steady_clock::time_point uploadDeadline =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(UPLOAD_BUDGET_US);
+        bool assetsResident = skybox.UploadReadyFaces();
+        for (auto& butterfly : butterflies) {
+            if (butterfly && !butterfly->UploadPending(uploadDeadline)) {
+                assetsResident = false;
+            }
+        }
+        if (assetsResident && !startupTimelinePrinted) {
+            PrintLoadTimeline();
+            PrintTextureMemoryReport();
+            startupTimelinePrinted = true;
+        }
+        
+        // Move the butterflies in parallel; drawing stays on this thread
+        JobSystem::Instance().ParallelFor(0, butterflies.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                if (butterflies[i]) {
+                    butterflies[i]->Update(simulationStep);
+                }
+            }
+        });
         
         // Draw butterflies
+        if (butterflyTimerFrame - butterflyTimerRead == BUTTERFLY_TIMER_COUNT) {
+            butterflyTimerRead++;
+        }
+        glBeginQuery(GL_TIME_ELAPSED, butterflyTimers[butterflyTimerFrame % BUTTERFLY_TIMER_COUNT]);
         for (auto& butterfly : butterflies) {
             if (butterfly) {
-                butterfly->Update(deltaTime);
-                butterfly->Draw(view, projection);
+                if (butterfly->HasQuantizedVertices() != quantizeButterflies) {
+                    butterfly->SetQuantizedVertices(quantizeButterflies);
+                }
+                butterfly->SetForceAlphaTest(forceButterflyAlphaTest);
+                butterfly->Draw(view, projection, viewportHeight);
+            }
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        butterflyTimerFrame++;
+        while (butterflyTimerRead < butterflyTimerFrame) {
+            GLuint timer = butterflyTimers[butterflyTimerRead % BUTTERFLY_TIMER_COUNT];
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
             }
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed);
+            butterflyGpuMs += elapsed / 1.0e6;
+            butterflyGpuSamples++;
+            butterflyTimerRead++;
         }
         
         // Draw skybox with depth testing but depth writing disabled
@@ -448,8 +491,8 @@ int main()
         float margin = 10.0f;
         
         // Draw the text with a shadow for better visibility
-        textRenderer.RenderText(fpsText, 20.0f, 40.0f, 1.0f, glm::vec3(0.0f, 0.0f, 0.0f)); // Shadow
-        textRenderer.RenderText(fpsText, 18.0f, 38.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f)); // Main text
+        textRenderer->RenderText(fpsText, 20.0f, 40.0f, 1.0f, glm::vec3(0.0f, 0.0f, 0.0f)); // Shadow
+        textRenderer->RenderText(fpsText, 18.0f, 38.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f)); // Main text
         
         // Re-enable depth testing for 3D rendering
         glEnable(GL_DEPTH_TEST);
@@ -457,11 +500,20 @@ int main()
         // Make sure to use the main shader for other objects
         ourShader->use();
         
+        // Fence this frame's instance and text data
+        StreamBuffer::EndFrame();
+        
         // Swap buffers and poll IO events
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
     
+    glDeleteQueries(BUTTERFLY_TIMER_COUNT, butterflyTimers);
+    
+    TextureStreamer::Instance().Release();
+    textRenderer.reset();
+    Box::cleanup();
+    
     // Cleanup shaders using the shader manager
     cleanupShaders();
     
@@ -512,6 +564,7 @@ void processInput(GLFWwindow* window, float deltaTime) {
 // GLFW: whenever the window size changed (by OS or user resize) this callback function executes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    viewportHeight = height;
 }
 
 // GLFW: whenever the mouse moves, this callback is called
@@ -563,4 +616,22 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    
+    // Toggle the butterfly vertex format to compare memory and frame time
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        quantizeButterflies = !quantizeButterflies;
+        std::cout << "Butterfly vertex format: " << (quantizeButterflies ? "quantized" : "float") << std::endl;
+    }
+    
+    // Toggle the discarding butterfly shader to compare fragment cost
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        forceButterflyAlphaTest = !forceButterflyAlphaTest;
+        std::cout << "Butterfly shader: " << (forceButterflyAlphaTest ? "alpha test (discard)" : "early-Z") << std::endl;
+    }
+    
+    // Toggle the GPU box simulation to compare update and upload cost
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        gpuBoxSimulation = !gpuBoxSimulation;
+        std::cout << "Box simulation: " << (gpuBoxSimulation ? "GPU (transform feedback)" : "CPU") << std::endl;
+    }
 }
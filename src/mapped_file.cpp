@@ -0,0 +1,78 @@
+#include "mapped_file.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(other.data), size(other.size), fd(other.fd) {
+    other.data = nullptr;
+    other.size = 0;
+    other.fd = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(fd, other.fd);
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        std::cerr << "Error: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Failed to stat file: " << path << " (" << strerror(errno) << ")" << std::endl;
+        Close();
+        return false;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        // mmap rejects zero-length mappings; an empty file is still a valid (empty) view
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map file: " << path << " (" << strerror(errno) << ")" << std::endl;
+        Close();
+        return false;
+    }
+
+    // We scan front to back, so let the kernel read ahead aggressively
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    size = 0;
+}
@@ -0,0 +1,350 @@
+#include "mesh_cache.h"
+#include "checksum.h"
+#include <sys/stat.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'B', 'I', 'N', '\0'};
+    const uint32_t MESH_CACHE_FORMAT = 3;
+    const size_t DATA_ALIGNMENT = 16;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t loaderVersion;
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint32_t optionFlags;
+        uint32_t meshCount;
+        uint32_t libraryCount;
+        uint32_t optionHash;
+        uint64_t payloadSize;   // Bytes following the header
+        uint64_t checksum;      // Of the payload
+        uint64_t materialHash;
+    };
+
+    struct MeshRecord {
+        uint64_t vertexOffset;      // From the start of the file
+        uint64_t vertexFloatCount;
+        uint64_t indexOffset;
+        uint64_t indexCount;
+        uint64_t lodOffset;         // MeshLod table
+        int32_t materialIndex;
+        uint32_t lodCount;
+        float bounds[6];            // min xyz, max xyz
+        uint32_t reserved[2];
+    };
+
+    static_assert(sizeof(FileHeader) == 72, "Unexpected cache header layout");
+    static_assert(sizeof(MeshRecord) == 80, "Unexpected cache record layout");
+    static_assert(sizeof(MeshLod) == 12, "Unexpected LOD record layout");
+
+    size_t AlignUp(size_t value) {
+        return (value + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+    }
+
+    // Appends to the buffer while keeping the payload checksum up to date
+    struct PayloadWriter {
+        std::vector<char>& out;
+        Checksum checksum;
+
+        void Write(const void* data, size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+            checksum.UpdateWords(data, size);
+        }
+
+        void Pad() {
+            static const char zeros[DATA_ALIGNMENT] = {};
+            size_t padding = AlignUp(out.size()) - out.size();
+            if (padding) Write(zeros, padding);
+        }
+    };
+}
+
+bool MakeMeshCacheKey(const std::string& sourcePath, uint32_t loaderVersion,
+                      uint32_t optionFlags, MeshCacheKey& key) {
+    struct stat st;
+    if (stat(sourcePath.c_str(), &st) != 0) {
+        return false;
+    }
+    key.sourceSize = static_cast<uint64_t>(st.st_size);
+    key.sourceMtime = static_cast<int64_t>(st.st_mtime);
+    key.loaderVersion = loaderVersion;
+    key.optionFlags = optionFlags;
+    return true;
+}
+
+uint64_t HashMaterialLibraries(const std::string& sourcePath, const std::vector<std::string>& libraries) {
+    Checksum hash;
+    std::string baseDir = sourcePath.substr(0, sourcePath.find_last_of("/\\") + 1);
+    for (const std::string& library : libraries) {
+        hash.Update(library.data(), library.size());
+        MappedFile file;
+        uint64_t size = ~0ull;
+        bool found = file.Open(baseDir + library);
+        if (found) {
+            size = file.Size();
+        }
+        hash.Update(&size, sizeof(size));
+        if (found) {
+            hash.Update(file.Data(), file.Size());
+        }
+    }
+    return hash.Finish();
+}
+
+std::string MeshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshbin";
+}
+
+void SerializeMeshCache(const MeshCacheKey& key, const std::vector<MeshData>& meshes,
+                        const std::vector<std::string>& materialLibraries, std::vector<char>& out) {
+    // Lay out the file: header, mesh table, library names, then aligned buffers
+    size_t tableSize = meshes.size() * sizeof(MeshRecord);
+    size_t namesSize = 0;
+    for (const std::string& name : materialLibraries) {
+        namesSize += sizeof(uint32_t) + name.size();
+    }
+
+    std::vector<MeshRecord> records(meshes.size());
+    size_t offset = AlignUp(sizeof(FileHeader) + tableSize + namesSize);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshData& mesh = meshes[i];
+        MeshRecord& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        record.vertexOffset = offset;
+        record.vertexFloatCount = mesh.vertices.size();
+        offset = AlignUp(offset + mesh.vertices.size() * sizeof(float));
+        record.indexOffset = offset;
+        record.indexCount = mesh.indices.size();
+        offset = AlignUp(offset + mesh.indices.size() * sizeof(unsigned int));
+        record.lodOffset = offset;
+        record.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        offset = AlignUp(offset + mesh.lods.size() * sizeof(MeshLod));
+        record.materialIndex = mesh.materialIndex;
+        record.bounds[0] = mesh.boundsMin.x;
+        record.bounds[1] = mesh.boundsMin.y;
+        record.bounds[2] = mesh.boundsMin.z;
+        record.bounds[3] = mesh.boundsMax.x;
+        record.bounds[4] = mesh.boundsMax.y;
+        record.bounds[5] = mesh.boundsMax.z;
+    }
+
+    // Placeholder header; rewritten once the checksum is known
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    out.clear();
+    out.reserve(offset);
+    out.insert(out.end(), reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header) + sizeof(header));
+
+    PayloadWriter payload{out, Checksum()};
+    if (!records.empty()) {
+        payload.Write(records.data(), tableSize);
+    }
+    for (const std::string& name : materialLibraries) {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        payload.Write(&length, sizeof(length));
+        payload.Write(name.data(), name.size());
+    }
+    payload.Pad();
+    for (const MeshData& mesh : meshes) {
+        payload.Write(mesh.vertices.data(), mesh.vertices.size() * sizeof(float));
+        payload.Pad();
+        payload.Write(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        payload.Pad();
+        payload.Write(mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+        payload.Pad();
+    }
+
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.formatVersion = MESH_CACHE_FORMAT;
+    header.loaderVersion = key.loaderVersion;
+    header.sourceSize = key.sourceSize;
+    header.sourceMtime = key.sourceMtime;
+    header.optionFlags = key.optionFlags;
+    header.optionHash = key.optionHash;
+    header.materialHash = key.materialHash;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.libraryCount = static_cast<uint32_t>(materialLibraries.size());
+    header.payloadSize = out.size() - sizeof(FileHeader);
+    header.checksum = payload.checksum.Finish();
+    std::memcpy(out.data(), &header, sizeof(header));
+}
+
+bool StampMeshCacheSource(const MeshCacheKey& key, std::vector<char>& bytes) {
+    // Outside the checksummed payload, so the rest stays valid
+    if (bytes.size() < sizeof(FileHeader)) {
+        return false;
+    }
+    std::memcpy(bytes.data() + offsetof(FileHeader, sourceSize), &key.sourceSize, sizeof(key.sourceSize));
+    std::memcpy(bytes.data() + offsetof(FileHeader, sourceMtime), &key.sourceMtime, sizeof(key.sourceMtime));
+    return true;
+}
+
+bool WriteMeshCache(const std::string& cachePath, const MeshCacheKey& key,
+                    const std::vector<MeshData>& meshes,
+                    const std::vector<std::string>& materialLibraries) {
+    std::vector<char> bytes;
+    SerializeMeshCache(key, meshes, materialLibraries, bytes);
+
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to create mesh cache: " << tempPath << std::endl;
+        return false;
+    }
+    out.write(bytes.data(), bytes.size());
+    out.close();
+
+    if (!out) {
+        std::cerr << "Failed to write mesh cache: " << tempPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Failed to move mesh cache into place: " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MeshCacheReader::Open(const std::string& cachePath, const MeshCacheKey& expectedKey) {
+    Close();
+
+    struct stat st;
+    if (stat(cachePath.c_str(), &st) != 0) {
+        return false; // No cache yet
+    }
+    if (!file.Open(cachePath)) {
+        return false;
+    }
+    if (!Parse(file.Data(), file.Size(), cachePath, expectedKey, true)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshCacheReader::Open(const char* data, size_t size, const std::string& name,
+                           const MeshCacheKey& expectedKey, bool checkSource) {
+    Close();
+    if (!Parse(data, size, name, expectedKey, checkSource)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshCacheReader::Parse(const char* base, size_t size, const std::string& cachePath,
+                            const MeshCacheKey& expectedKey, bool checkSource) {
+    dataSize = size;
+    FileHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Mesh cache is truncated: " << cachePath << std::endl;
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.formatVersion != MESH_CACHE_FORMAT) {
+        std::cerr << "Mesh cache has an unknown format: " << cachePath << std::endl;
+        return false;
+    }
+    if (header.loaderVersion != expectedKey.loaderVersion ||
+        (checkSource && (header.sourceSize != expectedKey.sourceSize ||
+                         header.sourceMtime != expectedKey.sourceMtime)) ||
+        header.optionFlags != expectedKey.optionFlags ||
+        header.optionHash != expectedKey.optionHash) {
+        std::cout << "Mesh cache is stale: " << cachePath << std::endl;
+        return false;
+    }
+    if (header.payloadSize != size - sizeof(header)) {
+        std::cerr << "Mesh cache size mismatch: " << cachePath << std::endl;
+        return false;
+    }
+
+    Checksum checksum;
+    checksum.UpdateWords(base + sizeof(header), header.payloadSize);
+    if (checksum.Finish() != header.checksum) {
+        std::cerr << "Mesh cache checksum mismatch: " << cachePath << std::endl;
+        return false;
+    }
+    materialHash = header.materialHash;
+
+    // Mesh table
+    size_t cursor = sizeof(header);
+    size_t tableSize = static_cast<size_t>(header.meshCount) * sizeof(MeshRecord);
+    if (tableSize > size - cursor) {
+        std::cerr << "Mesh cache table is out of bounds: " << cachePath << std::endl;
+        return false;
+    }
+    meshes.reserve(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        MeshRecord record;
+        std::memcpy(&record, base + cursor + i * sizeof(MeshRecord), sizeof(record));
+
+        bool valid =
+            record.vertexOffset % DATA_ALIGNMENT == 0 && record.indexOffset % DATA_ALIGNMENT == 0 &&
+            record.vertexOffset <= size && record.vertexFloatCount <= (size - record.vertexOffset) / sizeof(float) &&
+            record.indexOffset <= size && record.indexCount <= (size - record.indexOffset) / sizeof(unsigned int) &&
+            record.lodOffset % DATA_ALIGNMENT == 0 &&
+            record.lodOffset <= size && record.lodCount <= (size - record.lodOffset) / sizeof(MeshLod);
+        if (!valid) {
+            std::cerr << "Mesh cache record " << i << " is out of bounds: " << cachePath << std::endl;
+            return false;
+        }
+
+        MeshCacheEntry entry;
+        entry.vertices = reinterpret_cast<const float*>(base + record.vertexOffset);
+        entry.vertexFloatCount = static_cast<size_t>(record.vertexFloatCount);
+        entry.indices = reinterpret_cast<const unsigned int*>(base + record.indexOffset);
+        entry.indexCount = static_cast<size_t>(record.indexCount);
+        entry.lods = reinterpret_cast<const MeshLod*>(base + record.lodOffset);
+        entry.lodCount = record.lodCount;
+        entry.materialIndex = record.materialIndex;
+        entry.boundsMin = glm::vec3(record.bounds[0], record.bounds[1], record.bounds[2]);
+        entry.boundsMax = glm::vec3(record.bounds[3], record.bounds[4], record.bounds[5]);
+        for (size_t l = 0; l < entry.lodCount; ++l) {
+            MeshLod lod;
+            std::memcpy(&lod, entry.lods + l, sizeof(lod));
+            if (lod.firstIndex > entry.indexCount || lod.indexCount > entry.indexCount - lod.firstIndex) {
+                std::cerr << "Mesh cache record " << i << " has an invalid LOD range: " << cachePath << std::endl;
+                return false;
+            }
+        }
+        meshes.push_back(entry);
+    }
+    cursor += tableSize;
+
+    // Material library names
+    for (uint32_t i = 0; i < header.libraryCount; ++i) {
+        uint32_t length = 0;
+        if (sizeof(length) > size - cursor) {
+            return false;
+        }
+        std::memcpy(&length, base + cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (length > size - cursor) {
+            std::cerr << "Mesh cache library table is out of bounds: " << cachePath << std::endl;
+            return false;
+        }
+        materialLibraries.emplace_back(base + cursor, length);
+        cursor += length;
+    }
+
+    return true;
+}
+
+void MeshCacheReader::Close() {
+    meshes.clear();
+    materialLibraries.clear();
+    materialHash = 0;
+    dataSize = 0;
+    file.Close();
+}
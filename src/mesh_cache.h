@@ -0,0 +1,100 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "mesh_data.h"
+
+// Identifies the exact inputs a cache file was generated from. A cache is only
+// used when every field matches; anything else means it is stale.
+struct MeshCacheKey {
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint32_t loaderVersion;   // Bumped whenever the loader's output changes
+    uint32_t optionFlags;     // Loader options that affect the generated buffers
+    uint32_t optionHash;      // Hash of option values that are not flags (e.g. the clip plane)
+    // HashMaterialLibraries over the libraries the source references. Only
+    // known once the source is parsed, so MeshCacheReader does not compare
+    // it; the loader checks MaterialHash() against the libraries on disk.
+    uint64_t materialHash;
+
+    MeshCacheKey() : sourceSize(0), sourceMtime(0), loaderVersion(0), optionFlags(0), optionHash(0), materialHash(0) {}
+};
+
+// Build the key for a source file; returns false if the file cannot be stat'ed
+bool MakeMeshCacheKey(const std::string& sourcePath, uint32_t loaderVersion,
+                      uint32_t optionFlags, MeshCacheKey& key);
+
+// Hash the names and bytes of a model's material libraries, which sit next
+// to the source. Cached meshes store material indices into these libraries,
+// so any edit to them makes the cache stale. A missing library hashes
+// differently from an empty one.
+uint64_t HashMaterialLibraries(const std::string& sourcePath, const std::vector<std::string>& libraries);
+
+// Cache file that sits next to the source model
+std::string MeshCachePath(const std::string& sourcePath);
+
+// The bytes of a .meshbin file for the meshes and the material libraries they
+// reference (also stored as-is in asset bundles)
+void SerializeMeshCache(const MeshCacheKey& key, const std::vector<MeshData>& meshes,
+                        const std::vector<std::string>& materialLibraries, std::vector<char>& out);
+// Replace the source size and time recorded in .meshbin bytes with the
+// key's (e.g. for a reused bundle entry whose source was touched). Returns
+// false if the bytes are too short to hold a header.
+bool StampMeshCacheSource(const MeshCacheKey& key, std::vector<char>& bytes);
+
+// Write meshes (and the material libraries they reference) to a .meshbin file.
+// The file is written to a temporary name and renamed, so readers never see a
+// partially written cache.
+bool WriteMeshCache(const std::string& cachePath, const MeshCacheKey& key,
+                    const std::vector<MeshData>& meshes,
+                    const std::vector<std::string>& materialLibraries);
+
+// Zero-copy view of one cached mesh; pointers refer into the mapped file
+// (or the caller's memory)
+struct MeshCacheEntry {
+    const float* vertices;
+    size_t vertexFloatCount;
+    const unsigned int* indices;
+    size_t indexCount;
+    const MeshLod* lods;
+    size_t lodCount;
+    int materialIndex;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+// Memory-mapped .meshbin file
+class MeshCacheReader {
+public:
+    // Map and validate the cache. Fails if the key does not match, or the file
+    // is truncated or corrupt.
+    bool Open(const std::string& cachePath, const MeshCacheKey& expectedKey);
+    // Validate .meshbin bytes that stay alive elsewhere (an asset bundle
+    // entry). The source size and time are only compared with checkSource,
+    // for when the source is there to stat.
+    bool Open(const char* data, size_t size, const std::string& name, const MeshCacheKey& expectedKey,
+              bool checkSource);
+    void Close();
+
+    const std::vector<MeshCacheEntry>& Meshes() const { return meshes; }
+    const std::vector<std::string>& MaterialLibraries() const { return materialLibraries; }
+    uint64_t MaterialHash() const { return materialHash; }
+    size_t FileSize() const { return dataSize; }
+
+private:
+    bool Parse(const char* data, size_t size, const std::string& name,
+               const MeshCacheKey& expectedKey, bool checkSource);
+
+    MappedFile file;
+    size_t dataSize = 0;
+    uint64_t materialHash = 0;
+    std::vector<MeshCacheEntry> meshes;
+    std::vector<std::string> materialLibraries;
+};
+
+#endif // MESH_CACHE_H
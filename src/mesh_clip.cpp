@@ -0,0 +1,158 @@
+#include "mesh_clip.h"
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+    const unsigned int UNUSED_VERTEX = 0xFFFFFFFFu;
+
+    float PlaneDistance(const std::vector<float>& vertices, unsigned int vertex, const glm::vec4& plane) {
+        const float* p = vertices.data() + static_cast<size_t>(vertex) * MESH_VERTEX_FLOATS;
+        return plane.x * p[0] + plane.y * p[1] + plane.z * p[2] + plane.w;
+    }
+
+    // Vertex where the edge between a and b meets the plane, created once per edge
+    class EdgeSplitter {
+    public:
+        EdgeSplitter(std::vector<float>& vertices, const std::vector<float>& distances)
+            : vertices(vertices), distances(distances) {}
+
+        unsigned int Split(unsigned int a, unsigned int b) {
+            // Always interpolate from the lower index so both triangles of an
+            // edge get bit-identical vertices
+            if (a > b) {
+                std::swap(a, b);
+            }
+            float t = distances[a] / (distances[a] - distances[b]);
+            if (t <= 0.0f) {
+                return a;
+            }
+            if (t >= 1.0f) {
+                return b;
+            }
+
+            uint64_t key = (static_cast<uint64_t>(a) << 32) | b;
+            auto it = splits.find(key);
+            if (it != splits.end()) {
+                return it->second;
+            }
+
+            unsigned int vertex = static_cast<unsigned int>(vertices.size() / MESH_VERTEX_FLOATS);
+            size_t offsetA = static_cast<size_t>(a) * MESH_VERTEX_FLOATS;
+            size_t offsetB = static_cast<size_t>(b) * MESH_VERTEX_FLOATS;
+            float interpolated[MESH_VERTEX_FLOATS];
+            for (int i = 0; i < MESH_VERTEX_FLOATS; ++i) {
+                interpolated[i] = vertices[offsetA + i] + (vertices[offsetB + i] - vertices[offsetA + i]) * t;
+            }
+            glm::vec3 normal(interpolated[3], interpolated[4], interpolated[5]);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                interpolated[3] = normal.x / length;
+                interpolated[4] = normal.y / length;
+                interpolated[5] = normal.z / length;
+            }
+            vertices.insert(vertices.end(), interpolated, interpolated + MESH_VERTEX_FLOATS);
+            splits[key] = vertex;
+            return vertex;
+        }
+
+        size_t Count() const { return splits.size(); }
+
+    private:
+        std::vector<float>& vertices;
+        const std::vector<float>& distances;
+        std::unordered_map<uint64_t, unsigned int> splits;
+    };
+
+    void EmitTriangle(std::vector<unsigned int>& indices, unsigned int a, unsigned int b, unsigned int c) {
+        // Corners on the plane can collapse a fan triangle
+        if (a != b && b != c && a != c) {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    }
+}
+
+MeshClipStats ClipMesh(MeshData& mesh, const glm::vec4& plane) {
+    MeshClipStats stats;
+    size_t vertexCount = mesh.VertexCount();
+    std::vector<float> distances(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        distances[i] = PlaneDistance(mesh.vertices, static_cast<unsigned int>(i), plane);
+    }
+
+    EdgeSplitter splitter(mesh.vertices, distances);
+    std::vector<unsigned int> clipped;
+    clipped.reserve(mesh.indices.size());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const unsigned int* triangle = mesh.indices.data() + i;
+        stats.trianglesIn++;
+
+        int inside = 0;
+        for (int j = 0; j < 3; ++j) {
+            inside += distances[triangle[j]] >= 0.0f ? 1 : 0;
+        }
+        if (inside == 3) {
+            clipped.insert(clipped.end(), triangle, triangle + 3);
+            stats.trianglesKept++;
+            continue;
+        }
+        if (inside == 0) {
+            stats.trianglesRemoved++;
+            continue;
+        }
+
+        // Walk the edges in order (Sutherland-Hodgman against one plane); the
+        // kept part is a triangle or a quad with the original winding
+        unsigned int polygon[4];
+        int corners = 0;
+        for (int j = 0; j < 3; ++j) {
+            unsigned int a = triangle[j];
+            unsigned int b = triangle[(j + 1) % 3];
+            bool insideA = distances[a] >= 0.0f;
+            bool insideB = distances[b] >= 0.0f;
+            if (insideA) {
+                polygon[corners++] = a;
+            }
+            if (insideA != insideB) {
+                polygon[corners++] = splitter.Split(a, b);
+            }
+        }
+        EmitTriangle(clipped, polygon[0], polygon[1], polygon[2]);
+        if (corners == 4) {
+            EmitTriangle(clipped, polygon[0], polygon[2], polygon[3]);
+        }
+        stats.trianglesClipped++;
+    }
+    stats.verticesAdded = splitter.Count();
+
+    // Compact the vertices in order of first use
+    std::vector<unsigned int> remap(mesh.VertexCount(), UNUSED_VERTEX);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    unsigned int used = 0;
+    for (unsigned int& index : clipped) {
+        if (remap[index] == UNUSED_VERTEX) {
+            const float* source = mesh.vertices.data() + static_cast<size_t>(index) * MESH_VERTEX_FLOATS;
+            glm::vec3 position(source[0], source[1], source[2]);
+            if (used == 0) {
+                mesh.boundsMin = mesh.boundsMax = position;
+            } else {
+                mesh.boundsMin = glm::min(mesh.boundsMin, position);
+                mesh.boundsMax = glm::max(mesh.boundsMax, position);
+            }
+            vertices.insert(vertices.end(), source, source + MESH_VERTEX_FLOATS);
+            remap[index] = used++;
+        }
+        index = remap[index];
+    }
+    if (used == 0) {
+        mesh.boundsMin = mesh.boundsMax = glm::vec3(0.0f);
+    }
+
+    mesh.vertices.swap(vertices);
+    mesh.indices.swap(clipped);
+    return stats;
+}
@@ -0,0 +1,26 @@
+#ifndef MESH_CLIP_H
+#define MESH_CLIP_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include "mesh_data.h"
+
+struct MeshClipStats {
+    size_t trianglesIn;
+    size_t trianglesKept;       // Entirely on the kept side
+    size_t trianglesClipped;    // Straddling the plane, replaced by their kept part
+    size_t trianglesRemoved;    // Entirely on the other side
+    size_t verticesAdded;       // Created where edges cross the plane
+
+    MeshClipStats() : trianglesIn(0), trianglesKept(0), trianglesClipped(0), trianglesRemoved(0), verticesAdded(0) {}
+};
+
+// Keep the part of a mesh where dot(plane.xyz, position) + plane.w >= 0.
+// Triangles crossing the plane are cut exactly: the new vertices interpolate
+// position, normal and texture coordinate along the crossing edge. Each edge
+// is cut once, so triangles that shared it still share the new vertex and the
+// mesh stays watertight. Unused vertices are dropped and the bounds refit.
+// Must run before OptimizeMesh and BuildLodChain.
+MeshClipStats ClipMesh(MeshData& mesh, const glm::vec4& plane);
+
+#endif // MESH_CLIP_H
@@ -0,0 +1,32 @@
+#ifndef MESH_DATA_H
+#define MESH_DATA_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Number of floats per interleaved vertex: position (3), normal (3), texcoord (2)
+const int MESH_VERTEX_FLOATS = 8;
+
+// One level of detail: a range of the mesh's index buffer. All levels share
+// the same vertex buffer.
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error;    // Object-space geometric error relative to level 0
+};
+
+// CPU-side copy of a mesh exactly as it is uploaded to the GPU
+struct MeshData {
+    std::vector<float> vertices;        // Interleaved, MESH_VERTEX_FLOATS per vertex
+    std::vector<unsigned int> indices;  // Triangle list; all LOD levels back to back
+    std::vector<MeshLod> lods;          // Empty when only the full-detail mesh exists
+    int materialIndex;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    MeshData() : materialIndex(-1), boundsMin(0.0f), boundsMax(0.0f) {}
+
+    size_t VertexCount() const { return vertices.size() / MESH_VERTEX_FLOATS; }
+};
+
+#endif // MESH_DATA_H
@@ -0,0 +1,320 @@
+#include "mesh_optimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+
+namespace {
+    const unsigned int INVALID_INDEX = 0xFFFFFFFFu;
+
+    // Triangles touching each vertex, stored as one flat array
+    struct TriangleAdjacency {
+        std::vector<unsigned int> offsets;   // vertexCount + 1 entries
+        std::vector<unsigned int> triangles;
+
+        void Build(const std::vector<unsigned int>& indices, size_t vertexCount) {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices) {
+                offsets[index + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; ++v) {
+                offsets[v + 1] += offsets[v];
+            }
+            triangles.resize(indices.size());
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+    };
+
+    // FIFO cache using insertion timestamps: a vertex is resident if it was
+    // inserted within the last cacheSize misses
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, unsigned cacheSize)
+            : stamps(vertexCount, 0), size(cacheSize), time(cacheSize + 1) {}
+
+        // Returns true on a miss
+        bool Access(unsigned int vertex) {
+            if (time - stamps[vertex] > size) {
+                stamps[vertex] = time++;
+                return true;
+            }
+            return false;
+        }
+
+        void Reset() {
+            time += size + 1;
+        }
+
+    private:
+        std::vector<unsigned int> stamps;
+        unsigned int size;
+        unsigned int time;
+    };
+}
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (cache.Access(indices[i])) {
+            stats.transformedVertices++;
+        }
+    }
+    stats.acmr = static_cast<float>(stats.transformedVertices) / (indexCount / 3);
+    stats.atvr = static_cast<float>(stats.transformedVertices) / vertexCount;
+    return stats;
+}
+
+// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (2007)
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         unsigned cacheSize, std::vector<size_t>* clusters) {
+    size_t triangleCount = indices.size() / 3;
+    if (clusters) {
+        clusters->clear();
+    }
+    if (triangleCount == 0 || vertexCount == 0) {
+        return;
+    }
+
+    TriangleAdjacency adjacency;
+    adjacency.Build(indices, vertexCount);
+
+    // Triangles not yet emitted per vertex
+    std::vector<unsigned int> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+
+    unsigned int time = cacheSize + 1;
+    size_t scan = 0;   // Next vertex to try once the dead-end stack is empty
+    unsigned int fanning = 0;
+
+    // Skip to the first vertex that still has triangles
+    while (scan < vertexCount && live[scan] == 0) {
+        scan++;
+    }
+    if (scan == vertexCount) {
+        return;
+    }
+    fanning = static_cast<unsigned int>(scan);
+    if (clusters) {
+        clusters->push_back(0);
+    }
+
+    for (;;) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (unsigned int k = adjacency.offsets[fanning]; k < adjacency.offsets[fanning + 1]; ++k) {
+            unsigned int triangle = adjacency.triangles[k];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (int j = 0; j < 3; ++j) {
+                unsigned int v = indices[triangle * 3 + j];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer the candidate that will stay in cache longest while its
+        // remaining triangles are emitted
+        unsigned int next = INVALID_INDEX;
+        int bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                priority = static_cast<int>(time - cacheTime[v]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next == INVALID_INDEX) {
+            // Dead end: fall back to recently used vertices, then to a linear scan
+            while (!deadEnd.empty()) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+            while (next == INVALID_INDEX && scan < vertexCount) {
+                if (live[scan] > 0) {
+                    next = static_cast<unsigned int>(scan);
+                }
+                scan++;
+            }
+            if (next == INVALID_INDEX) {
+                break;
+            }
+            if (clusters && result.size() / 3 < triangleCount) {
+                clusters->push_back(result.size() / 3);
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const float* vertices,
+                      size_t vertexCount, size_t vertexStride,
+                      const std::vector<size_t>& clusters, float threshold,
+                      unsigned cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    // Split the hard clusters further wherever doing so costs little cache
+    // efficiency; smaller clusters give the sort more freedom
+    std::vector<size_t> bounds;
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        size_t begin = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+        // The cluster's own miss ratio, on the shared cache: a fresh cache
+        // per cluster would make the pass O(clusters * vertices)
+        cache.Reset();
+        size_t clusterMisses = 0;
+        for (size_t i = begin * 3; i < end * 3; ++i) {
+            if (cache.Access(indices[i])) {
+                clusterMisses++;
+            }
+        }
+        float limit = static_cast<float>(clusterMisses) / (end - begin) * threshold;
+
+        cache.Reset();
+        bounds.push_back(begin);
+        size_t start = begin;
+        size_t misses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            for (int j = 0; j < 3; ++j) {
+                if (cache.Access(indices[t * 3 + j])) {
+                    misses++;
+                }
+            }
+            size_t size = t + 1 - start;
+            if (t + 1 < end && static_cast<float>(misses) <= limit * size) {
+                bounds.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+    bounds.push_back(triangleCount);
+
+    // Area-weighted centroid and normal of each cluster, and of the whole mesh
+    size_t clusterCount = bounds.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float clusterArea = 0.0f;
+        for (size_t t = bounds[c]; t < bounds[c + 1]; ++t) {
+            const float* p0 = vertices + indices[t * 3 + 0] * vertexStride;
+            const float* p1 = vertices + indices[t * 3 + 1] * vertexStride;
+            const float* p2 = vertices + indices[t * 3 + 2] * vertexStride;
+            glm::vec3 a(p0[0], p0[1], p0[2]);
+            glm::vec3 b(p1[0], p1[1], p1[2]);
+            glm::vec3 d(p2[0], p2[1], p2[2]);
+
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + d) * (area / 3.0f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.0f ? centroids[c] / clusterArea : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the centre occlude the rest; draw them first
+    std::vector<float> sortKeys(clusterCount);
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float length = glm::length(normals[c]);
+        glm::vec3 normal = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+        sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normal);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        result.insert(result.end(), indices.begin() + bounds[c] * 3, indices.begin() + bounds[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+void OptimizeVertexFetch(MeshData& mesh) {
+    size_t vertexCount = mesh.VertexCount();
+    std::vector<unsigned int> remap(vertexCount, INVALID_INDEX);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    unsigned int next = 0;
+    for (unsigned int& index : mesh.indices) {
+        if (remap[index] == INVALID_INDEX) {
+            const float* source = mesh.vertices.data() + index * MESH_VERTEX_FLOATS;
+            vertices.insert(vertices.end(), source, source + MESH_VERTEX_FLOATS);
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    // Unreferenced vertices are dropped
+    mesh.vertices.swap(vertices);
+}
+
+MeshOptimizeStats OptimizeMesh(MeshData& mesh) {
+    MeshOptimizeStats stats;
+    size_t vertexCount = mesh.VertexCount();
+    stats.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+    std::vector<size_t> clusters;
+    OptimizeVertexCache(mesh.indices, vertexCount, VERTEX_CACHE_SIZE, &clusters);
+    OptimizeOverdraw(mesh.indices, mesh.vertices.data(), vertexCount, MESH_VERTEX_FLOATS, clusters);
+    OptimizeVertexFetch(mesh);
+
+    stats.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.VertexCount());
+    return stats;
+}
@@ -0,0 +1,52 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+#include "mesh_data.h"
+
+// Post-transform cache size the reordering targets; small enough to hold
+// on every GPU the project runs on
+const unsigned VERTEX_CACHE_SIZE = 16;
+
+// Results of simulating a FIFO post-transform vertex cache over an index buffer
+struct VertexCacheStats {
+    size_t transformedVertices; // Cache misses
+    float acmr;                 // Average cache miss ratio: misses per triangle (0.5 - 3)
+    float atvr;                 // Average transformed vertex ratio: misses per vertex (1 is optimal)
+
+    VertexCacheStats() : transformedVertices(0), acmr(0.0f), atvr(0.0f) {}
+};
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder triangles for vertex cache locality (Tipsify). If clusters is given
+// it receives the first triangle of every cluster, split wherever the
+// traversal had to jump to a vertex outside the cache.
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                         unsigned cacheSize = VERTEX_CACHE_SIZE,
+                         std::vector<size_t>* clusters = nullptr);
+
+// Reorder the clusters produced by OptimizeVertexCache so that outward-facing
+// ones are drawn first, reducing overdraw. Each cluster is split further where
+// the miss ratio of the piece so far stays within threshold times the
+// cluster's own ratio.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const float* vertices,
+                      size_t vertexCount, size_t vertexStride,
+                      const std::vector<size_t>& clusters, float threshold = 1.05f,
+                      unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder the interleaved vertex buffer into first-use order of the indices
+void OptimizeVertexFetch(MeshData& mesh);
+
+// Vertex cache statistics before and after OptimizeMesh
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Run the full pass in order: vertex cache, overdraw, vertex fetch
+MeshOptimizeStats OptimizeMesh(MeshData& mesh);
+
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,68 @@
+#include "mesh_quantize.h"
+#include <glm/gtc/packing.hpp>
+#include <cmath>
+
+glm::vec2 OctahedralEncode(const glm::vec3& normal) {
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (!(sum > 0.0f)) {
+        // Degenerate (zero or NaN) normal
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / sum;
+    if (normal.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        glm::vec2 folded(1.0f - std::fabs(p.y), 1.0f - std::fabs(p.x));
+        p.x = p.x >= 0.0f ? folded.x : -folded.x;
+        p.y = p.y >= 0.0f ? folded.y : -folded.y;
+    }
+    return p;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    float t = glm::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+void QuantizeMesh(const float* vertices, size_t vertexFloatCount,
+                  const unsigned int* indices, size_t indexCount,
+                  const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                  QuantizedMesh& out) {
+    size_t vertexCount = vertexFloatCount / MESH_VERTEX_FLOATS;
+    glm::vec3 extent = boundsMax - boundsMin;
+    out.positionOffset = boundsMin;
+    out.positionScale = extent;
+
+    // Flat axes keep a scale of zero; every value decodes to the offset
+    glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                            extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                            extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    out.vertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* v = vertices + i * MESH_VERTEX_FLOATS;
+        QuantizedVertex& q = out.vertices[i];
+
+        glm::vec3 position = (glm::vec3(v[0], v[1], v[2]) - boundsMin) * inverseExtent;
+        q.position[0] = glm::packUnorm1x16(position.x);
+        q.position[1] = glm::packUnorm1x16(position.y);
+        q.position[2] = glm::packUnorm1x16(position.z);
+        q.position[3] = 0;
+
+        glm::vec2 octahedral = OctahedralEncode(glm::vec3(v[3], v[4], v[5]));
+        q.normal = glm::packSnorm3x10_1x2(glm::vec4(octahedral, 0.0f, 0.0f));
+
+        q.texCoord[0] = glm::packHalf1x16(v[6]);
+        q.texCoord[1] = glm::packHalf1x16(v[7]);
+    }
+
+    out.shortIndices.clear();
+    out.indices.clear();
+    if (vertexCount < SHORT_INDEX_LIMIT) {
+        out.shortIndices.assign(indices, indices + indexCount);
+    } else {
+        out.indices.assign(indices, indices + indexCount);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef MESH_QUANTIZE_H
+#define MESH_QUANTIZE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mesh_data.h"
+
+// Compact vertex layout, 16 bytes instead of MESH_VERTEX_FLOATS * 4 = 32:
+//   position  3 x uint16, normalized to the mesh AABB (plus 2 bytes padding)
+//   normal    octahedral encoding in the x/y fields of a 2_10_10_10_REV word
+//   texcoord  2 x half float
+struct QuantizedVertex {
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t texCoord[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16, "Unexpected quantized vertex layout");
+
+// Meshes below this vertex count use 16-bit indices
+const size_t SHORT_INDEX_LIMIT = 65536;
+
+struct QuantizedMesh {
+    std::vector<QuantizedVertex> vertices;
+    std::vector<uint16_t> shortIndices;     // Used when the mesh has < SHORT_INDEX_LIMIT vertices
+    std::vector<unsigned int> indices;      // Otherwise
+    // Decoded position = positionOffset + quantized * positionScale
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+
+    bool UsesShortIndices() const { return !shortIndices.empty(); }
+    size_t IndexCount() const { return UsesShortIndices() ? shortIndices.size() : indices.size(); }
+    size_t VertexBytes() const { return vertices.size() * sizeof(QuantizedVertex); }
+    size_t IndexBytes() const {
+        return UsesShortIndices() ? shortIndices.size() * sizeof(uint16_t) : indices.size() * sizeof(unsigned int);
+    }
+};
+
+// Quantize an interleaved float mesh (see mesh_data.h) against its bounds
+void QuantizeMesh(const float* vertices, size_t vertexFloatCount,
+                  const unsigned int* indices, size_t indexCount,
+                  const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                  QuantizedMesh& out);
+
+// Octahedral normal encoding; both components are in [-1, 1]
+glm::vec2 OctahedralEncode(const glm::vec3& normal);
+glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+
+#endif // MESH_QUANTIZE_H
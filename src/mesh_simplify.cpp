@@ -0,0 +1,418 @@
+#include "mesh_simplify.h"
+#include "mesh_optimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    // Border edges are held in place by a plane perpendicular to the surface,
+    // weighted well above the face planes
+    const float BORDER_WEIGHT = 10.0f;
+
+    enum VertexKind : unsigned char {
+        KIND_MANIFOLD,  // Free to collapse onto any neighbour
+        KIND_BORDER,    // On an open edge; may only slide along it
+        KIND_LOCKED     // Seam, hard edge or non-manifold; never collapses
+    };
+
+    // Symmetric 4x4 error quadric, plus the total weight that went into it
+    struct Quadric {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+
+        Quadric() : a00(0), a11(0), a22(0), a01(0), a02(0), a12(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+        // Squared distance to the plane dot(normal, p) + d = 0, times weight
+        static Quadric FromPlane(const glm::vec3& normal, float d, float weight) {
+            Quadric q;
+            q.a00 = weight * normal.x * normal.x;
+            q.a11 = weight * normal.y * normal.y;
+            q.a22 = weight * normal.z * normal.z;
+            q.a01 = weight * normal.x * normal.y;
+            q.a02 = weight * normal.x * normal.z;
+            q.a12 = weight * normal.y * normal.z;
+            q.b0 = weight * normal.x * d;
+            q.b1 = weight * normal.y * d;
+            q.b2 = weight * normal.z * d;
+            q.c = weight * d * d;
+            q.weight = weight;
+            return q;
+        }
+
+        void Add(const Quadric& q) {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // Weighted mean squared distance of p to the accumulated planes
+        float Error(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z
+                     + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                     + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? static_cast<float>(std::fabs(e) / weight) : 0.0f;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        float cost;
+    };
+
+    uint64_t EdgeKey(unsigned int a, unsigned int b) {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    glm::vec3 Position(const float* vertices, size_t vertexStride, unsigned int index) {
+        const float* p = vertices + index * vertexStride;
+        return glm::vec3(p[0], p[1], p[2]);
+    }
+
+    // Bitwise position key, so vertices split at seams are found exactly
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey& other) const {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& key) const {
+            uint32_t h = key.bits[0] * 0x9E3779B1u;
+            h ^= key.bits[1] * 0x85EBCA77u;
+            h ^= key.bits[2] * 0xC2B2AE3Du;
+            return h ^ (h >> 16);
+        }
+    };
+
+    // Hash and compare whole vertices, so corners that were never
+    // deduplicated can be welded
+    struct VertexBytes {
+        const float* vertices;
+        size_t vertexStride;
+
+        size_t operator()(unsigned int v) const {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertices + v * vertexStride);
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < vertexStride * sizeof(float); ++i) {
+                h = (h ^ bytes[i]) * 16777619u;
+            }
+            return h;
+        }
+
+        bool operator()(unsigned int a, unsigned int b) const {
+            return std::memcmp(vertices + a * vertexStride, vertices + b * vertexStride,
+                               vertexStride * sizeof(float)) == 0;
+        }
+    };
+
+    // Point every index at the first vertex with identical attributes. With
+    // deduplication off every corner is its own vertex; welded, the mesh is
+    // connected again and the result still indexes the original buffer.
+    void WeldIdenticalVertices(const float* vertices, size_t vertexStride, std::vector<unsigned int>& indices) {
+        VertexBytes bytes = {vertices, vertexStride};
+        std::unordered_map<unsigned int, unsigned int, VertexBytes, VertexBytes> firstVertex(indices.size(), bytes,
+                                                                                          bytes);
+        for (unsigned int& index : indices) {
+            index = firstVertex.emplace(index, index).first->second;
+        }
+    }
+
+    void ClassifyVertices(const float* vertices, size_t vertexCount, size_t vertexStride,
+                          const std::vector<unsigned int>& indices,
+                          std::vector<VertexKind>& kinds,
+                          std::unordered_map<uint64_t, unsigned int>& halfEdges) {
+        kinds.assign(vertexCount, KIND_MANIFOLD);
+
+        // Positions used by more than one (welded) vertex lie on a seam: their
+        // attributes differ
+        std::vector<bool> used(vertexCount, false);
+        for (unsigned int index : indices) {
+            used[index] = true;
+        }
+        std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positions;
+        positions.reserve(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            if (!used[v]) {
+                continue;
+            }
+            PositionKey key;
+            std::memcpy(key.bits, vertices + v * vertexStride, sizeof(key.bits));
+            auto inserted = positions.emplace(key, v);
+            if (!inserted.second) {
+                kinds[v] = KIND_LOCKED;
+                kinds[inserted.first->second] = KIND_LOCKED;
+            }
+        }
+
+        halfEdges.clear();
+        halfEdges.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+                halfEdges[EdgeKey(indices[i + j], indices[i + (j + 1) % 3])]++;
+            }
+        }
+
+        for (const auto& entry : halfEdges) {
+            unsigned int a = static_cast<unsigned int>(entry.first >> 32);
+            unsigned int b = static_cast<unsigned int>(entry.first & 0xFFFFFFFFu);
+            if (entry.second > 1) {
+                // Same directed edge used twice: non-manifold or inconsistent winding
+                kinds[a] = kinds[b] = KIND_LOCKED;
+            } else if (halfEdges.find(EdgeKey(b, a)) == halfEdges.end()) {
+                if (kinds[a] == KIND_MANIFOLD) kinds[a] = KIND_BORDER;
+                if (kinds[b] == KIND_MANIFOLD) kinds[b] = KIND_BORDER;
+            }
+        }
+    }
+
+    // An open edge of the original mesh: exactly one of its directions is used.
+    // Edges created by earlier collapses are in neither direction and do not count.
+    bool IsBorderEdge(const std::unordered_map<uint64_t, unsigned int>& halfEdges, unsigned int a, unsigned int b) {
+        bool forward = halfEdges.find(EdgeKey(a, b)) != halfEdges.end();
+        bool backward = halfEdges.find(EdgeKey(b, a)) != halfEdges.end();
+        return forward != backward;
+    }
+}
+
+float SimplifyMesh(const float* vertices, size_t vertexCount, size_t vertexStride,
+                   const unsigned int* indices, size_t indexCount,
+                   size_t targetIndexCount, float maxError,
+                   std::vector<unsigned int>& result) {
+    result.assign(indices, indices + (indexCount / 3) * 3);
+    if (result.size() <= targetIndexCount || vertexCount == 0) {
+        return 0.0f;
+    }
+
+    WeldIdenticalVertices(vertices, vertexStride, result);
+
+    std::vector<VertexKind> kinds;
+    std::unordered_map<uint64_t, unsigned int> halfEdges;
+    ClassifyVertices(vertices, vertexCount, vertexStride, result, kinds, halfEdges);
+
+    // Face planes, weighted by area, plus border constraint planes
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::vec3 p[3];
+        for (int j = 0; j < 3; ++j) {
+            p[j] = Position(vertices, vertexStride, result[i + j]);
+        }
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float area = glm::length(normal);
+        if (area <= 0.0f) {
+            continue;
+        }
+        normal /= area;
+
+        Quadric face = Quadric::FromPlane(normal, -glm::dot(normal, p[0]), area);
+        for (int j = 0; j < 3; ++j) {
+            quadrics[result[i + j]].Add(face);
+        }
+
+        for (int j = 0; j < 3; ++j) {
+            unsigned int a = result[i + j];
+            unsigned int b = result[i + (j + 1) % 3];
+            if (halfEdges.find(EdgeKey(b, a)) != halfEdges.end()) {
+                continue;
+            }
+            glm::vec3 edge = p[(j + 1) % 3] - p[j];
+            float length = glm::length(edge);
+            if (length <= 0.0f) {
+                continue;
+            }
+            glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+            Quadric border = Quadric::FromPlane(edgeNormal, -glm::dot(edgeNormal, p[j]),
+                                                length * length * BORDER_WEIGHT);
+            quadrics[a].Add(border);
+            quadrics[b].Add(border);
+        }
+    }
+
+    float maxErrorSquared = maxError * maxError;
+    float resultErrorSquared = 0.0f;
+
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> adjacencyOffsets;
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> locked(vertexCount);
+
+    while (result.size() > targetIndexCount) {
+        // Triangles around each vertex
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i) {
+                adjacency[cursor[result[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+
+        // Candidate collapses along every edge, in both directions
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+                unsigned int a = result[i + j];
+                unsigned int b = result[i + (j + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    unsigned int from = direction ? b : a;
+                    unsigned int to = direction ? a : b;
+                    if (kinds[from] == KIND_LOCKED) {
+                        continue;
+                    }
+                    if (kinds[from] == KIND_BORDER && !IsBorderEdge(halfEdges, from, to)) {
+                        continue;
+                    }
+                    float cost = quadrics[from].Error(Position(vertices, vertexStride, to));
+                    if (cost <= maxErrorSquared) {
+                        collapses.push_back(Collapse{from, to, cost});
+                    }
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+            return x.cost < y.cost;
+        });
+
+        // Apply the cheapest collapses whose neighbourhoods do not overlap
+        for (size_t v = 0; v < vertexCount; ++v) {
+            remap[v] = static_cast<unsigned int>(v);
+        }
+        std::fill(locked.begin(), locked.end(), false);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        size_t applied = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (trianglesRemoved >= trianglesToRemove) {
+                break;
+            }
+            if (locked[collapse.from] || locked[collapse.to]) {
+                continue;
+            }
+
+            // Reject collapses that would flip a surviving triangle
+            bool flips = false;
+            size_t removes = 0;
+            glm::vec3 target = Position(vertices, vertexStride, collapse.to);
+            for (unsigned int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; ++k) {
+                const unsigned int* tri = &result[adjacency[k] * 3];
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+                    removes++;
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (int j = 0; j < 3; ++j) {
+                    before[j] = after[j] = Position(vertices, vertexStride, tri[j]);
+                    if (tri[j] == collapse.from) {
+                        after[j] = target;
+                    }
+                }
+                glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(n0, n1) <= 0.0f) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            // Lock the whole one-ring, so later collapses in this pass never
+            // touch a triangle whose flip check is now stale
+            for (unsigned int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; ++k) {
+                const unsigned int* tri = &result[adjacency[k] * 3];
+                locked[tri[0]] = locked[tri[1]] = locked[tri[2]] = true;
+            }
+            locked[collapse.to] = true;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            resultErrorSquared = std::max(resultErrorSquared, collapse.cost);
+            trianglesRemoved += removes;
+            applied++;
+        }
+        if (applied == 0) {
+            break;
+        }
+
+        // Rewrite the triangles, dropping the ones that collapsed
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            unsigned int a = remap[result[i]];
+            unsigned int b = remap[result[i + 1]];
+            unsigned int c = remap[result[i + 2]];
+            if (a != b && a != c && b != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    return std::sqrt(resultErrorSquared);
+}
+
+void BuildLodChain(MeshData& mesh) {
+    mesh.lods.clear();
+    size_t vertexCount = mesh.VertexCount();
+    size_t baseIndexCount = mesh.indices.size();
+    if (baseIndexCount < 3 || vertexCount == 0) {
+        return;
+    }
+
+    // Collapses are capped at a fraction of the mesh size, so a level never
+    // degenerates into something unrecognisable just to hit its triangle budget
+    float maxError = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.05f;
+
+    mesh.lods.push_back(MeshLod{0, static_cast<unsigned int>(baseIndexCount), 0.0f});
+    std::vector<unsigned int> source(mesh.indices.begin(), mesh.indices.end());
+    std::vector<unsigned int> simplified;
+    float error = 0.0f;
+
+    for (size_t level = 1; level <= MAX_LOD_LEVELS; ++level) {
+        size_t target = (source.size() / 6) * 3;
+        if (target < 3) {
+            break;
+        }
+        float levelError = SimplifyMesh(mesh.vertices.data(), vertexCount, MESH_VERTEX_FLOATS,
+                                        source.data(), source.size(), target, maxError, simplified);
+        // Each level builds on the previous one, so errors add up
+        error += levelError;
+
+        // Not worth a level if it saves less than a quarter of the triangles
+        if (simplified.empty() || simplified.size() * 4 > source.size() * 3) {
+            break;
+        }
+
+        OptimizeVertexCache(simplified, vertexCount);
+        mesh.lods.push_back(MeshLod{static_cast<unsigned int>(mesh.indices.size()),
+                                    static_cast<unsigned int>(simplified.size()), error});
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        source.swap(simplified);
+    }
+
+    if (mesh.lods.size() == 1) {
+        mesh.lods.clear();
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+#include "mesh_data.h"
+
+// Simplify a triangle list by quadric-error edge collapses (Garland & Heckbert).
+// Vertices are never moved or created: each collapse snaps one vertex onto a
+// neighbour, so the result indexes the original vertex buffer and every LOD
+// can share it. Vertices with identical attributes are welded first, so
+// meshes loaded without deduplication simplify too. Vertices whose position
+// is shared by several vertices with different attributes (UV seams, hard
+// normal edges) and non-manifold vertices are never collapsed, and open
+// borders only collapse along themselves.
+//
+// Stops once the index count reaches targetIndexCount or the next collapse
+// would exceed maxError (object-space distance). Returns the error of the
+// result, the largest collapse cost applied.
+float SimplifyMesh(const float* vertices, size_t vertexCount, size_t vertexStride,
+                   const unsigned int* indices, size_t indexCount,
+                   size_t targetIndexCount, float maxError,
+                   std::vector<unsigned int>& result);
+
+// Number of levels BuildLodChain generates below the full-detail mesh
+const size_t MAX_LOD_LEVELS = 3;
+
+// Append up to MAX_LOD_LEVELS simplified index ranges to mesh.indices, each
+// roughly half the triangles of the previous one, and fill mesh.lods
+// (level 0 is the original mesh). Levels that barely simplify are skipped.
+void BuildLodChain(MeshData& mesh);
+
+#endif // MESH_SIMPLIFY_H
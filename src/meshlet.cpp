@@ -0,0 +1,152 @@
+#include "meshlet.h"
+#include <cmath>
+
+namespace {
+    glm::vec3 Position(const float* vertices, size_t vertexStride, unsigned int index) {
+        const float* p = vertices + index * vertexStride;
+        return glm::vec3(p[0], p[1], p[2]);
+    }
+
+    // Fill in the bounds and normal cone of a finished meshlet
+    void FinishMeshlet(const float* vertices, size_t vertexStride, const unsigned int* indices,
+                       const std::vector<unsigned int>& meshletVertices, Meshlet& meshlet) {
+        glm::vec3 boundsMin = Position(vertices, vertexStride, meshletVertices[0]);
+        glm::vec3 boundsMax = boundsMin;
+        for (unsigned int v : meshletVertices) {
+            glm::vec3 p = Position(vertices, vertexStride, v);
+            boundsMin = glm::min(boundsMin, p);
+            boundsMax = glm::max(boundsMax, p);
+        }
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        float radiusSquared = 0.0f;
+        for (unsigned int v : meshletVertices) {
+            glm::vec3 d = Position(vertices, vertexStride, v) - meshlet.center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(d, d));
+        }
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        // Axis is the average face normal; the cutoff comes from the widest deviation
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.indexCount / 3);
+        glm::vec3 axis(0.0f);
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+            glm::vec3 a = Position(vertices, vertexStride, indices[i]);
+            glm::vec3 b = Position(vertices, vertexStride, indices[i + 1]);
+            glm::vec3 c = Position(vertices, vertexStride, indices[i + 2]);
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                axis += normal / length;
+            }
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength <= 0.0f) {
+            return;
+        }
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& normal : normals) {
+            minDot = glm::min(minDot, glm::dot(axis, normal));
+        }
+        meshlet.coneAxis = axis;
+        if (minDot > 0.0f) {
+            // Cones wider than a hemisphere can never be entirely backfacing
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+}
+
+void BuildMeshlets(const float* vertices, size_t vertexCount, size_t vertexStride,
+                   const unsigned int* indices, size_t indexCount,
+                   std::vector<Meshlet>& meshlets) {
+    meshlets.clear();
+    if (indexCount < 3 || vertexCount == 0) {
+        return;
+    }
+
+    // Meshlet each vertex was last added to, so membership checks are O(1)
+    std::vector<uint32_t> vertexOwner(vertexCount, UINT32_MAX);
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(MESHLET_MAX_VERTICES);
+
+    Meshlet current;
+    current.firstIndex = 0;
+    current.indexCount = 0;
+    uint32_t meshletId = 0;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        // Repeated corners of a degenerate triangle are only counted once
+        size_t newVertices = (vertexOwner[a] != meshletId) +
+                             (b != a && vertexOwner[b] != meshletId) +
+                             (c != a && c != b && vertexOwner[c] != meshletId);
+
+        bool full = meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES ||
+                    current.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES;
+        if (full && current.indexCount > 0) {
+            FinishMeshlet(vertices, vertexStride, indices, meshletVertices, current);
+            meshlets.push_back(current);
+            meshletId++;
+            meshletVertices.clear();
+            current.firstIndex = static_cast<uint32_t>(i);
+            current.indexCount = 0;
+        }
+
+        for (int j = 0; j < 3; ++j) {
+            unsigned int v = indices[i + j];
+            if (vertexOwner[v] != meshletId) {
+                vertexOwner[v] = meshletId;
+                meshletVertices.push_back(v);
+            }
+        }
+        current.indexCount += 3;
+    }
+
+    if (current.indexCount > 0) {
+        FinishMeshlet(vertices, vertexStride, indices, meshletVertices, current);
+        meshlets.push_back(current);
+    }
+}
+
+MeshletFrustum::MeshletFrustum(const glm::mat4& m) {
+    // Gribb/Hartmann: rows of the matrix combined give the clip planes
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;    // Left
+    planes[1] = row3 - row0;    // Right
+    planes[2] = row3 + row1;    // Bottom
+    planes[3] = row3 - row1;    // Top
+    planes[4] = row3 + row2;    // Near
+    planes[5] = row3 - row2;    // Far
+    for (glm::vec4& plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+}
+
+bool MeshletFrustum::IsSphereVisible(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+    if (meshlet.coneCutoff >= 1.0f) {
+        return false;
+    }
+    glm::vec3 toMeshlet = meshlet.center - cameraPosition;
+    return glm::dot(toMeshlet, meshlet.coneAxis) >=
+           meshlet.coneCutoff * glm::length(toMeshlet) + meshlet.radius;
+}
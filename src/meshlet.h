@@ -0,0 +1,45 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Limits for one meshlet; matches the sizes mesh shader hardware favours so
+// the same clusters can be reused later
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// A run of consecutive triangles in a mesh's index buffer
+struct Meshlet {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Bounding sphere
+    glm::vec3 center;
+    float radius;
+    // Normal cone: every triangle normal lies within the cone around coneAxis
+    glm::vec3 coneAxis;
+    float coneCutoff;   // Sine of the cone's half angle; 1 disables cone culling
+};
+
+// Split a triangle list into meshlets without reordering it: triangles are
+// taken in order (already optimized for locality) until a meshlet runs out of
+// vertices or triangles. vertices points at the first position, vertexStride
+// is in floats.
+void BuildMeshlets(const float* vertices, size_t vertexCount, size_t vertexStride,
+                   const unsigned int* indices, size_t indexCount,
+                   std::vector<Meshlet>& meshlets);
+
+// Object-space view planes, extracted from a model-view-projection matrix
+struct MeshletFrustum {
+    glm::vec4 planes[6];    // Normalized, pointing inwards
+
+    explicit MeshletFrustum(const glm::mat4& modelViewProjection);
+    bool IsSphereVisible(const glm::vec3& center, float radius) const;
+};
+
+// True if the camera only sees the back of every triangle in the meshlet
+bool IsMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+
+#endif // MESHLET_H
@@ -5,29 +5,139 @@
 #include <iomanip>  // For std::setprecision
 #include <chrono>   // For timing
 #include <cstring>  // For strerror
+#include <cstddef>  // For offsetof
+#include <cstdint>  // For SIZE_MAX
 #include <unordered_map>
 #include <unistd.h>  // For getcwd
 #include <map>
 #include <string>
 #include <algorithm>
+#include <cctype>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glad/gl.h>
 #include "shader.h"
+#include "mapped_file.h"
+#include "obj_parser.h"
+#include "thread_pool.h"
+#include "mesh_cache.h"
+#include "asset_bundle.h"
+#include "corner_index_map.h"
+#include "mesh_optimizer.h"
+#include "mesh_quantize.h"
+#include "mesh_simplify.h"
+#include "mesh_clip.h"
+#include "gltf_loader.h"
+#include "checksum.h"
+#include "load_timeline.h"
+#include "texture_compress.h"
 
-// STB image wrapper
-#include "stb_image_wrapper.h"
-
-// Simple wrapper for STB image loading
 namespace {
-    void SetSTBIFlipVertically(bool flip) {
-        stbi_set_flip_vertically_on_load(flip ? 1 : 0);
+    // Workers shared by every asynchronous model load
+    ThreadPool& ModelLoadPool() {
+        static ThreadPool pool(2);
+        return pool;
+    }
+    
+    float SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    void PrintFileSize(const std::string& path, size_t fileSize) {
+        std::cout << "\n=== Loading OBJ file ===" << std::endl;
+        std::cout << "File: " << path << std::endl;
+        std::cout << "Size: ";
+        if (fileSize > 1024 * 1024) {
+            std::cout << (fileSize / (1024 * 1024)) << " MB";
+        } else {
+            std::cout << (fileSize / 1024) << " KB";
+        }
+        std::cout << std::endl;
     }
     
-    const char* GetSTBILoadError() {
-        return stbi_get_error_message();
+    void PrintLoadProgress(size_t bytesDone, size_t fileSize, std::chrono::steady_clock::time_point startTime) {
+        float progress = fileSize > 0 ? (static_cast<float>(bytesDone) / fileSize) * 100.0f : 100.0f;
+        float elapsed = SecondsSince(startTime);
+        float speed = (bytesDone / (1024.0f * 1024.0f)) / (elapsed > 0 ? elapsed : 1);
+        
+        std::cout << "\rProgress: [";
+        int pos = static_cast<int>(progress / 2);
+        for (int i = 0; i < 50; ++i) {
+            if (i < pos) std::cout << "=";
+            else if (i == pos) std::cout << ">";
+            else std::cout << " ";
+        }
+        std::cout << "] " << std::fixed << std::setprecision(1) << progress 
+                 << "% (" << speed << " MB/s)" << std::flush;
+    }
+    
+    // Final throughput line, printed by both parsers so they can be compared directly
+    void PrintParseSummary(const char* parser, size_t fileSize, float seconds) {
+        float megabytes = fileSize / (1024.0f * 1024.0f);
+        std::cout << "\n" << parser << " parser: " << std::fixed << std::setprecision(1)
+                  << megabytes << " MB in " << (seconds * 1000.0f) << " ms ("
+                  << (seconds > 0 ? megabytes / seconds : 0.0f) << " MB/s)" << std::endl;
+    }
+    
+    // File name of an MTL map statement ("map_Kd -bm 0.5 tex/wing.png"):
+    // options are skipped and the rest of the line is the name
+    std::string ParseTexturePath(std::istringstream& iss) {
+        std::vector<std::string> tokens;
+        std::string token;
+        while (iss >> token) {
+            tokens.push_back(token);
+        }
+        
+        size_t i = 0;
+        while (i + 1 < tokens.size() && tokens[i][0] == '-') {
+            const std::string& option = tokens[i++];
+            if (option == "-o" || option == "-s" || option == "-t") {
+                // One to three numbers
+                for (int n = 0; n < 3 && i + 1 < tokens.size() &&
+                     (std::isdigit(static_cast<unsigned char>(tokens[i][0])) || tokens[i][0] == '-' ||
+                      tokens[i][0] == '.'); ++n) {
+                    ++i;
+                }
+            } else {
+                i += option == "-mm" ? 2 : 1;
+            }
+        }
+        
+        std::string path;
+        for (; i < tokens.size(); ++i) {
+            path += path.empty() ? tokens[i] : " " + tokens[i];
+        }
+        std::replace(path.begin(), path.end(), '\\', '/');
+        return path;
     }
+    
+    // One entry of the "Materials" uniform block in butterfly.frag (std140)
+    struct MaterialBlock {
+        glm::vec4 ambient;
+        glm::vec4 diffuse;      // w: dissolve
+        glm::vec4 specular;     // w: shininess
+        glm::ivec4 maps;        // Diffuse array and layer, specular array and layer (array -1: none)
+        glm::ivec4 opacityMap;  // Array and layer
+    };
+    
+    // Length of materials[] in butterfly.frag; the last entry used is the default material
+    const size_t MATERIAL_BLOCK_CAPACITY = 64;
+    const GLuint MATERIAL_BLOCK_BINDING = 0;
+    
+    // One entry of the "Meshes" uniform block in butterfly.vert (std140)
+    struct MeshBlock {
+        glm::vec4 positionOffset;       // w: 1 for quantized vertices
+        glm::vec4 positionScale;
+        glm::vec4 texCoordTransform;    // xy: offset, zw: scale
+        glm::ivec4 material;            // x: entry in the material buffer
+    };
+    
+    // Length of meshDecodes[] in butterfly.vert (16 KB, the smallest block
+    // size GL guarantees). Models with more meshes bind the buffer a block
+    // at a time; block offsets are multiples of 16 KB, so always aligned.
+    const size_t MESH_BLOCK_CAPACITY = 256;
+    const GLuint MESH_BLOCK_BINDING = 1;
 }
 
 // Helper function to split a string by a delimiter
@@ -43,7 +153,89 @@ static std::vector<std::string> split(const std::string &s, char delimiter) {
     return tokens;
 }
 
-OBJLoader::OBJLoader(Shader& shader) : shader(shader) {
+// Bump whenever the generated vertex/index buffers change, to invalidate mesh caches
+static const uint32_t OBJ_LOADER_VERSION = 7;
+
+// Bits of MeshCacheKey::optionFlags
+static const uint32_t CACHE_FLAG_DEDUPLICATED = 1u << 0;
+static const uint32_t CACHE_FLAG_OPTIMIZED = 1u << 1;
+static const uint32_t CACHE_FLAG_LODS = 1u << 2;
+static const uint32_t CACHE_FLAG_CLIPPED = 1u << 3;
+
+static const unsigned int INVALID_INDEX = 0xFFFFFFFFu;
+
+// Interleave one mesh's streams into the uploaded layout, dropping triangles
+// with missing corners and vertices no remaining triangle uses
+static MeshData BuildMeshData(const std::vector<glm::vec3>& vertices,
+                              const std::vector<glm::vec3>& normals,
+                              const std::vector<glm::vec2>& texCoords,
+                              const std::vector<unsigned int>& indices,
+                              int materialIndex) {
+    MeshData mesh;
+    mesh.materialIndex = materialIndex;
+    
+    std::vector<float>& vertexData = mesh.vertices;
+    std::vector<unsigned int>& filteredIndices = mesh.indices;
+    std::vector<unsigned int> indexMap(vertices.size(), INVALID_INDEX); // Maps old indices to new ones
+    unsigned int vertexCount = 0;
+    
+    vertexData.reserve(vertices.size() * MESH_VERTEX_FLOATS);
+    filteredIndices.reserve(indices.size());
+    
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        // Check if any vertex in this triangle is missing
+        bool skipTriangle = false;
+        for (int j = 0; j < 3; j++) {
+            unsigned int idx = indices[i + j];
+            if (idx >= vertices.size()) {
+                skipTriangle = true;
+                break;
+            }
+        }
+        
+        if (!skipTriangle) {
+            // Add all three indices of the triangle
+            for (int j = 0; j < 3; j++) {
+                unsigned int oldIdx = indices[i + j];
+                
+                // If we haven't seen this index before, add it to the vertex data
+                if (indexMap[oldIdx] == INVALID_INDEX) {
+                    // Position
+                    vertexData.push_back(vertices[oldIdx].x);
+                    vertexData.push_back(vertices[oldIdx].y);
+                    vertexData.push_back(vertices[oldIdx].z);
+                    
+                    // Normal
+                    vertexData.push_back(normals[oldIdx].x);
+                    vertexData.push_back(normals[oldIdx].y);
+                    vertexData.push_back(normals[oldIdx].z);
+                    
+                    // Texture coordinates
+                    vertexData.push_back(texCoords[oldIdx].s);
+                    vertexData.push_back(texCoords[oldIdx].t);
+                    
+                    // Track the bounds of what is actually drawn
+                    if (vertexCount == 0) {
+                        mesh.boundsMin = mesh.boundsMax = vertices[oldIdx];
+                    } else {
+                        mesh.boundsMin = glm::min(mesh.boundsMin, vertices[oldIdx]);
+                        mesh.boundsMax = glm::max(mesh.boundsMax, vertices[oldIdx]);
+                    }
+                    
+                    // Map the old index to the new one
+                    indexMap[oldIdx] = vertexCount++;
+                }
+                
+                // Add the new index to the filtered indices
+                filteredIndices.push_back(indexMap[oldIdx]);
+            }
+        }
+    }
+    
+    return mesh;
+}
+
+OBJLoader::OBJLoader(Shader& shader) : shader(&shader) {
     // Initialize with default material
     Material defaultMat;
     defaultMat.name = "default";
@@ -58,23 +250,150 @@ OBJLoader::OBJLoader(Shader& shader) : shader(shader) {
     std::cout << "OBJLoader initialized with shader ID: " << shader.ID << std::endl;
 }
 
+OBJLoader::OBJLoader() : shader(nullptr) {
+    materials.push_back(Material());
+}
+
 OBJLoader::~OBJLoader() {
+    // A worker may still be writing to this loader
+    if (loadResult.valid()) {
+        loadResult.wait();
+    }
+    ReleaseResources();
+}
+
+void OBJLoader::ReleaseResources() {
     // Clean up OpenGL resources
     for (auto& mesh : meshes) {
         glDeleteVertexArrays(1, &mesh.vao);
         glDeleteBuffers(1, &mesh.vbo);
         glDeleteBuffers(1, &mesh.ebo);
     }
+    meshes.clear();
     
-    // Delete textures
-    for (auto& material : materials) {
-        if (material.diffuseMap) glDeleteTextures(1, &material.diffuseMap);
-        if (material.specularMap) glDeleteTextures(1, &material.specularMap);
-        if (material.normalMap) glDeleteTextures(1, &material.normalMap);
+    if (materialBuffer) {
+        glDeleteBuffers(1, &materialBuffer);
+        materialBuffer = 0;
+    }
+    if (meshBlockBuffer) {
+        glDeleteBuffers(1, &meshBlockBuffer);
+        meshBlockBuffer = 0;
     }
+    
+    // Textures are shared through the asset cache and freed with their last user
+    textures.reset();
+    pendingTextures.reset();
+    
+    ClearCpuState();
+}
+
+void OBJLoader::ClearCpuState() {
+    textureDecodes.clear();
+    texturePaths.clear();
+    textureBytes.clear();
+    meshBounds.clear();
+    materials.clear();
+    materialLibraries.clear();
+    pendingMeshes.clear();
+    pendingMeshCursor = 0;
+    gltfSource.reset();
 }
 
 bool OBJLoader::LoadModel(const std::string& path) {
+    // Finish (and discard) any asynchronous load first
+    if (loadResult.valid()) {
+        loadResult.wait();
+        loadResult = std::future<bool>();
+    }
+    deferUploads = false;
+    
+    // GL objects of a previous model; LoadModelData only clears CPU state
+    ReleaseResources();
+    bool loaded = LoadModelData(path);
+    if (loaded) {
+        bool first = true;
+        UploadTextures(std::chrono::steady_clock::time_point::max(), true, first);
+        CreateMaterialBuffer();
+        CreateMeshBlockBuffer();
+    }
+    loadState = loaded ? ModelLoadState::Resident : ModelLoadState::Failed;
+    if (loaded) {
+        PrintMeshStats();
+    }
+    return loaded;
+}
+
+void OBJLoader::LoadModelAsync(const std::string& path) {
+    if (loadResult.valid()) {
+        loadResult.wait();
+    }
+    
+    // GL objects of a previous model have to be released on this thread
+    ReleaseResources();
+    deferUploads = true;
+    loadState = ModelLoadState::Loading;
+    loadStartTime = std::chrono::steady_clock::now();
+    loadResult = ModelLoadPool().Submit([this, path]() {
+        return LoadModelData(path);
+    });
+}
+
+bool OBJLoader::UploadPending(std::chrono::steady_clock::time_point deadline) {
+    if (loadState == ModelLoadState::Loading) {
+        if (loadResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        bool loaded = loadResult.get();
+        if (!loaded) {
+            std::cerr << "Asynchronous model load failed" << std::endl;
+            ReleaseResources();
+            deferUploads = false;
+            loadState = ModelLoadState::Failed;
+            return false;
+        }
+        loadState = ModelLoadState::Uploading;
+    }
+    if (loadState != ModelLoadState::Uploading) {
+        return loadState == ModelLoadState::Resident;
+    }
+    
+    // Create GL objects one at a time until the frame's budget is spent; at
+    // least one per call so loading always makes progress
+    bool first = true;
+    if (!UploadTextures(deadline, false, first)) {
+        return false;
+    }
+    while (pendingMeshCursor < pendingMeshes.size()) {
+        if (!first && std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        PreparedMesh& pending = pendingMeshes[pendingMeshCursor++];
+        LoadTimelineScope timeline("upload mesh " + std::to_string(pending.mesh.indexCount / 3) + " triangles");
+        CreateMeshBuffers(pending);
+        pending.ownedVertices = std::vector<unsigned char>();
+        pending.ownedIndices = std::vector<unsigned char>();
+        first = false;
+    }
+    
+    pendingMeshes.clear();
+    pendingMeshCursor = 0;
+    gltfSource.reset();
+    CreateMaterialBuffer();
+    CreateMeshBlockBuffer();
+    deferUploads = false;
+    loadState = ModelLoadState::Resident;
+    std::cout << "Model resident after " << std::fixed << std::setprecision(1)
+              << (SecondsSince(loadStartTime) * 1000.0f) << " ms" << std::endl;
+    PrintMeshStats();
+    return true;
+}
+
+size_t OBJLoader::LoadedMeshCount() const {
+    return meshes.size() + pendingMeshes.size();
+}
+
+bool OBJLoader::LoadModelData(const std::string& path) {
+    LoadTimelineScope timeline("load model " + path.substr(path.find_last_of("/\\") + 1));
     std::cout << "Loading OBJ model: " << path << std::endl;
     
     // Get current working directory for debugging
@@ -83,11 +402,158 @@ bool OBJLoader::LoadModel(const std::string& path) {
         std::cout << "Current working directory: " << cwd << std::endl;
     }
     
-    // Clear any existing meshes
-    meshes.clear();
-    materials.clear();
+    // Clear what is left of a previous model. This may run on a worker, so
+    // GL objects and textures were already released on the render thread.
+    ClearCpuState();
     hasTextures = false;
     
+    SetBaseDir(path);
+    std::cout << "Base directory for assets: " << baseDir << std::endl;
+    
+    // glTF files are binary already and need no mesh cache
+    if (IsGltfPath(path)) {
+        return LoadModelGltf(path);
+    }
+    
+    // A bundle built by assetc holds the finished meshes, unless the source
+    // was edited since (see LoadFromCache)
+    MeshCacheKey cacheKey;
+    GetMeshCacheKey(cacheKey);
+    if (options.useMeshCache && AssetBundle::Instance().Find(AssetKind::Mesh, path)) {
+        if (LoadFromCache(path, cacheKey, true)) {
+            StartTextureLoads();
+            return true;
+        }
+        std::cout << "Not using the asset bundle entry for " << path << std::endl;
+        ClearCpuState();
+    }
+    
+    // Reuse the preprocessed binary cache when it was built from this exact file
+    bool cacheable = options.useMeshCache &&
+        MakeMeshCacheKey(path, OBJ_LOADER_VERSION, CacheOptionFlags(), cacheKey);
+    std::string cachePath = MeshCachePath(path);
+    if (cacheable) {
+        if (LoadFromCache(path, cacheKey, false)) {
+            StartTextureLoads();
+            return true;
+        }
+        // Stale or corrupt cache: start over from the text file
+        ClearCpuState();
+    }
+    
+    keepMeshData = cacheable;
+    bool loaded = options.useLegacyParser ? LoadModelLegacy(path) : LoadModelMapped(path);
+    
+    if (loaded && cacheable) {
+        cacheKey.materialHash = HashMaterialLibraries(path, materialLibraries);
+        if (WriteMeshCache(cachePath, cacheKey, builtMeshes, materialLibraries)) {
+            std::cout << "Wrote mesh cache: " << cachePath << std::endl;
+        }
+    }
+    builtMeshes.clear();
+    builtMeshes.shrink_to_fit();
+    keepMeshData = false;
+    return loaded;
+}
+
+void OBJLoader::PrintMeshStats() const {
+    size_t vertexCount = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t floatIndexBytes = 0;
+    for (const Mesh& mesh : meshes) {
+        vertexBytes += mesh.vertexBytes;
+        indexBytes += mesh.indexBytes;
+        vertexCount += mesh.vertexCount;
+        size_t indexCount = mesh.lods.empty() ? mesh.indexCount : mesh.lods.back().firstIndex + mesh.lods.back().indexCount;
+        floatIndexBytes += indexCount * sizeof(unsigned int);
+    }
+    
+    // Compare against the 32-byte float layout with 32-bit indices
+    size_t floatBytes = vertexCount * MESH_VERTEX_FLOATS * sizeof(float) + floatIndexBytes;
+    std::cout << "Mesh GPU memory: " << std::fixed << std::setprecision(1)
+              << (vertexBytes / 1024.0f) << " KB vertices + " << (indexBytes / 1024.0f) << " KB indices";
+    if (options.quantizeVertices && floatBytes > 0) {
+        std::cout << " (quantized, " << (100.0f * (vertexBytes + indexBytes) / floatBytes)
+                  << "% of " << (floatBytes / 1024.0f) << " KB float layout)";
+    }
+    std::cout << std::endl;
+    
+    size_t meshletCount = 0;
+    size_t triangleCount = 0;
+    for (const Mesh& mesh : meshes) {
+        meshletCount += mesh.meshlets.size();
+        triangleCount += mesh.indexCount / 3;
+    }
+    if (meshletCount > 0) {
+        std::cout << "Meshlets: " << meshletCount << " (" << (static_cast<float>(triangleCount) / meshletCount)
+                  << " triangles on average)" << std::endl;
+    }
+}
+
+bool OBJLoader::LoadFromCache(const std::string& sourcePath, const MeshCacheKey& key, bool fromBundle) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    
+    MeshCacheReader cache;
+    std::string cacheName;
+    bool checkMaterials = true;
+    if (fromBundle) {
+        // assetc stamps entries with the source's size and time, so one stat
+        // catches a source edited since. Without the source (a shipped
+        // bundle) there is nothing to compare and the entry is used as is.
+        MeshCacheKey sourceKey = key;
+        bool sourceFound = MakeMeshCacheKey(sourcePath, key.loaderVersion, key.optionFlags, sourceKey);
+        const AssetBundleEntry* entry = AssetBundle::Instance().Find(AssetKind::Mesh, sourcePath);
+        if (!entry || !cache.Open(entry->data, entry->size, sourcePath, sourceKey, sourceFound)) {
+            return false;
+        }
+        cacheName = "asset bundle";
+        checkMaterials = sourceFound;
+    } else {
+        cacheName = "mesh cache " + MeshCachePath(sourcePath);
+        if (!cache.Open(MeshCachePath(sourcePath), key)) {
+            return false;
+        }
+    }
+    // The meshes' material indices only hold for the libraries they were
+    // built with, which are read next anyway
+    if (checkMaterials && cache.MaterialHash() != HashMaterialLibraries(sourcePath, cache.MaterialLibraries())) {
+        std::cout << "Mesh cache is stale (material libraries changed): " << cacheName << std::endl;
+        return false;
+    }
+    
+    for (const std::string& mtlFile : cache.MaterialLibraries()) {
+        LoadMaterialLibrary(mtlFile);
+    }
+    
+    // Upload straight from the mapped file
+    for (const MeshCacheEntry& entry : cache.Meshes()) {
+        UploadMesh(entry.vertices, entry.vertexFloatCount, entry.indices, entry.indexCount, entry.lods, entry.lodCount,
+                   entry.materialIndex, entry.boundsMin, entry.boundsMax);
+    }
+    
+    if (LoadedMeshCount() == 0) {
+        return false;
+    }
+    
+    std::cout << "Loaded " << LoadedMeshCount() << " meshes from " << cacheName << " ("
+              << std::fixed << std::setprecision(1) << (cache.FileSize() / (1024.0f * 1024.0f)) << " MB) in "
+              << (SecondsSince(startTime) * 1000.0f) << " ms" << std::endl;
+    return true;
+}
+
+void OBJLoader::LoadMaterialLibrary(const std::string& mtlFile) {
+    materialLibraries.push_back(mtlFile);
+    std::string fullMtlPath = baseDir + mtlFile;
+    std::cout << "Loading material library: " << fullMtlPath << std::endl;
+    if (!LoadMaterials(fullMtlPath)) {
+        std::cerr << "Failed to load material library: " << fullMtlPath << std::endl;
+    } else {
+        std::cout << "Successfully loaded " << materials.size() << " materials" << std::endl;
+    }
+}
+
+void OBJLoader::SetBaseDir(const std::string& path) {
     // Extract base directory from path
     size_t lastSlash = path.find_last_of("/\\");
     if (lastSlash != std::string::npos) {
@@ -95,8 +561,122 @@ bool OBJLoader::LoadModel(const std::string& path) {
     } else {
         baseDir = "./";
     }
-    std::cout << "Base directory for assets: " << baseDir << std::endl;
+}
+
+void OBJLoader::GetMeshCacheKey(MeshCacheKey& key) const {
+    key.loaderVersion = OBJ_LOADER_VERSION;
+    key.optionFlags = CacheOptionFlags();
+    key.optionHash = CacheOptionHash();
+}
+
+bool OBJLoader::BuildOffline(const std::string& path, std::vector<MeshData>& meshData,
+                             std::vector<std::string>& libraries, std::vector<std::string>& images) {
+    ClearCpuState();
+    SetBaseDir(path);
+    
+    // No GL context here (assetc workers): the deferred path prepares
+    // meshes without GL; they are dropped below
+    // and only the CPU copies are returned
+    deferUploads = true;
+    keepMeshData = true;
+    offlineBuild = true;
+    bool loaded = options.useLegacyParser ? LoadModelLegacy(path) : LoadModelMapped(path);
+    deferUploads = false;
+    keepMeshData = false;
+    offlineBuild = false;
     
+    meshData.swap(builtMeshes);
+    builtMeshes.clear();
+    libraries = materialLibraries;
+    images = texturePaths;
+    ClearCpuState();
+    return loaded;
+}
+
+void OBJLoader::ReadMaterialImages(const std::string& path, const std::vector<std::string>& libraries,
+                                   std::vector<std::string>& images) {
+    ClearCpuState();
+    SetBaseDir(path);
+    for (const std::string& mtlFile : libraries) {
+        LoadMaterialLibrary(mtlFile);
+    }
+    images = texturePaths;
+    ClearCpuState();
+}
+
+uint32_t OBJLoader::CacheOptionFlags() const {
+    uint32_t flags = 0;
+    // The legacy parser never deduplicates
+    if (options.deduplicateVertices && !options.useLegacyParser) {
+        flags |= CACHE_FLAG_DEDUPLICATED;
+    }
+    if (options.optimizeMeshes) {
+        flags |= CACHE_FLAG_OPTIMIZED;
+    }
+    if (options.generateLods) {
+        flags |= CACHE_FLAG_LODS;
+    }
+    if (options.clipToPlane) {
+        flags |= CACHE_FLAG_CLIPPED;
+    }
+    return flags;
+}
+
+uint32_t OBJLoader::CacheOptionHash() const {
+    if (!options.clipToPlane) {
+        return 0;
+    }
+    Checksum hash;
+    hash.Update(&options.clipPlane[0], 4 * sizeof(float));
+    uint64_t value = hash.Finish();
+    return static_cast<uint32_t>(value ^ (value >> 32));
+}
+
+bool OBJLoader::LoadModelMapped(const std::string& path) {
+    // Map the file and tokenize it in place
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    
+    size_t fileSize = file.Size();
+    PrintFileSize(path, fileSize);
+    
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    ObjData data;
+    ParseObjParallel(file.Data(), file.Data() + fileSize, options.parseThreads, data,
+                     [&](size_t bytesParsed) {
+        PrintLoadProgress(bytesParsed, fileSize, startTime);
+    });
+    PrintParseSummary("Mapped", fileSize, SecondsSince(startTime));
+    std::cout << "  Parse threads: "
+              << (options.parseThreads ? options.parseThreads : ThreadPool::DefaultThreadCount()) << std::endl;
+    file.Close();
+    
+    std::cout << "  Lines: " << data.lineCount << ", Vertices: " << data.positions.size()
+              << ", TexCoords: " << data.texCoords.size() << ", Normals: " << data.normals.size()
+              << ", Faces: " << data.faces.size() << std::endl;
+    
+    // Load material libraries
+    for (const std::string& mtlFile : data.materialLibraries) {
+        LoadMaterialLibrary(mtlFile);
+    }
+    StartTextureLoads();
+    
+    BuildMeshes(data);
+    
+    if (LoadedMeshCount() == 0) {
+        std::cerr << "ERROR: No meshes were created from the OBJ file!" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Successfully loaded model with " << LoadedMeshCount() << " meshes and " 
+              << materials.size() << " materials" << std::endl;
+    return true;
+}
+
+// Original stream-based parser, selected with OBJLoadOptions::useLegacyParser
+bool OBJLoader::LoadModelLegacy(const std::string& path) {
     // Try to open the file
     std::ifstream file(path);
     if (!file.is_open()) {
@@ -136,15 +716,7 @@ bool OBJLoader::LoadModel(const std::string& path) {
     size_t fileSize = static_cast<size_t>(file.tellg());
     file.seekg(0, std::ios::beg);
     
-    std::cout << "\n=== Loading OBJ file ===" << std::endl;
-    std::cout << "File: " << path << std::endl;
-    std::cout << "Size: ";
-    if (fileSize > 1024 * 1024) {
-        std::cout << (fileSize / (1024 * 1024)) << " MB";
-    } else {
-        std::cout << (fileSize / 1024) << " KB";
-    }
-    std::cout << std::endl;
+    PrintFileSize(path, fileSize);
     
     std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
     size_t lastPrintPos = 0;
@@ -158,22 +730,7 @@ bool OBJLoader::LoadModel(const std::string& path) {
         size_t currentPosSize = static_cast<size_t>(currentPos);
         
         if (currentPosSize - lastPrintPos >= PRINT_INTERVAL || currentPosSize >= fileSize) {
-            float progress = (static_cast<float>(currentPosSize) / fileSize) * 100.0f;
-            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-            float elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - startTime).count() / 1000.0f;
-            float speed = (currentPosSize / (1024.0f * 1024.0f)) / (elapsed > 0 ? elapsed : 1);
-            
-            std::cout << "\rProgress: [";
-            int pos = static_cast<int>(progress / 2);
-            for (int i = 0; i < 50; ++i) {
-                if (i < pos) std::cout << "=";
-                else if (i == pos) std::cout << ">";
-                else std::cout << " ";
-            }
-            std::cout << "] " << std::fixed << std::setprecision(1) << progress 
-                     << "% (" << speed << " MB/s)" << std::flush;
-            
+            PrintLoadProgress(currentPosSize, fileSize, startTime);
             lastPrintPos = currentPosSize;
         }
         
@@ -225,8 +782,10 @@ bool OBJLoader::LoadModel(const std::string& path) {
                 }
             }
             
-            // For now, just handle triangles
+            // Triangles and larger polygons
             if (faceVertices.size() >= 3) {
+                size_t faceStart = vertices.size();
+                
                 // For each vertex in the face
                 for (size_t i = 0; i < faceVertices.size(); i++) {
                     std::istringstream vertexIss(faceVertices[i]);
@@ -368,59 +927,26 @@ bool OBJLoader::LoadModel(const std::string& path) {
                             normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
                         }
                     }
-                    
-                    // Check if any vertex in this face is part of the base (Y < -0.1)
-                    bool isBase = false;
-                    for (int i = 0; i < faceVertices.size(); i++) {
-                        std::istringstream vertexIss(faceVertices[i]);
-                        std::vector<std::string> indicesStr;
-                        std::string indexStr;
-                        while (std::getline(vertexIss, indexStr, '/')) {
-                            indicesStr.push_back(indexStr);
-                        }
-                        int idx = std::stoi(indicesStr[0]) - 1;
-                        if (idx >= 0 && idx < tempVertices.size() && tempVertices[idx].y < -0.1f) {
-                            isBase = true;
-                            break;
-                        }
-                    }
-                    
-                    // Skip faces that are part of the base
-                    if (isBase) {
-                        continue;
-                    }
-                    
-                    // Add index
-                    indices.push_back(static_cast<unsigned int>(vertices.size() - 1));
                 }
                 
-                // If this is a quad, triangulate it
-                if (faceVertices.size() > 3) {
-                    // Add two more triangles to form a quad
-                    size_t base = vertices.size() - faceVertices.size();
-                    indices.push_back(static_cast<unsigned int>(base));
-                    indices.push_back(static_cast<unsigned int>(base + 2));
-                    indices.push_back(static_cast<unsigned int>(base + 3));
+                // Triangulate as a fan over the corners that were added
+                for (size_t i = faceStart + 1; i + 1 < vertices.size(); ++i) {
+                    indices.push_back(static_cast<unsigned int>(faceStart));
+                    indices.push_back(static_cast<unsigned int>(i));
+                    indices.push_back(static_cast<unsigned int>(i + 1));
                 }
             }
         } else if (prefix == "mtllib") {
             // Load material library
             std::string mtlFile;
             iss >> mtlFile;
-            std::string fullMtlPath = baseDir + mtlFile;
-            std::cout << "Loading material library: " << fullMtlPath << std::endl;
-            if (!LoadMaterials(fullMtlPath)) {
-                std::cerr << "Failed to load material library: " << fullMtlPath << std::endl;
-            } else {
-                std::cout << "Successfully loaded " << materials.size() << " materials" << std::endl;
-            }
+            LoadMaterialLibrary(mtlFile);
         } else if (prefix == "usemtl") {
             // If we have a mesh in progress, finalize it
             if (!vertices.empty()) {
                 std::cout << "Processing mesh with " << vertices.size() << " vertices, " 
                           << indices.size() << " indices, material: " << currentMtl << std::endl;
-                ProcessMesh(vertices, normals, texCoords, indices, 
-                          currentMtl.empty() ? -1 : 0); // Simple material handling for now
+                ProcessMesh(vertices, normals, texCoords, indices, FindMaterial(currentMtl));
                 vertices.clear();
                 normals.clear();
                 texCoords.clear();
@@ -430,20 +956,22 @@ bool OBJLoader::LoadModel(const std::string& path) {
         }
     }
     
+    PrintParseSummary("Legacy", fileSize, SecondsSince(startTime));
+    StartTextureLoads();
+    
     // Process any remaining vertices
     if (!vertices.empty()) {
         std::cout << "Processing final mesh with " << vertices.size() << " vertices, " 
                   << indices.size() << " indices, material: " << currentMtl << std::endl;
-        ProcessMesh(vertices, normals, texCoords, indices, 
-                   currentMtl.empty() ? -1 : 0);
+        ProcessMesh(vertices, normals, texCoords, indices, FindMaterial(currentMtl));
     }
     
-    if (meshes.empty()) {
+    if (LoadedMeshCount() == 0) {
         std::cerr << "ERROR: No meshes were created from the OBJ file!" << std::endl;
         return false;
     }
     
-    if (meshes.empty()) {
+    if (LoadedMeshCount() == 0) {
         std::cerr << "WARNING: No vertices were loaded from the OBJ file!" << std::endl;
         std::cerr << "  Total vertices in file: " << tempVertices.size() << std::endl;
         std::cerr << "  Total texture coordinates: " << tempTexCoords.size() << std::endl;
@@ -495,11 +1023,104 @@ bool OBJLoader::LoadModel(const std::string& path) {
         return false;
     }
     
-    std::cout << "Successfully loaded model with " << meshes.size() << " meshes and " 
+    std::cout << "Successfully loaded model with " << LoadedMeshCount() << " meshes and " 
               << materials.size() << " materials" << std::endl;
     return true;
 }
 
+// glTF 2.0 through tinygltf. Primitives GL can read as they are stored are
+// uploaded straight from the file's buffers (the mapped file for .glb); the
+// rest are decoded and go through the same optimization, LOD and meshlet
+// steps as OBJ meshes. No mesh cache is written for either.
+bool OBJLoader::LoadModelGltf(const std::string& path) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<GltfFile> file = std::make_shared<GltfFile>();
+    if (!file->Open(path)) {
+        return false;
+    }
+    std::cout << "Parsed glTF " << (file->IsBinary() ? "binary " : "") << "file ("
+              << std::fixed << std::setprecision(1) << (file->FileSize() / (1024.0f * 1024.0f)) << " MB) in "
+              << (SecondsSince(startTime) * 1000.0f) << " ms" << std::endl;
+    
+    // The file's material indices follow any materials already loaded
+    int firstMaterial = static_cast<int>(materials.size());
+    for (const GltfMaterial& source : file->ReadMaterials(baseDir)) {
+        materials.push_back(source.material);
+        if (!source.diffuseImage.empty()) {
+            materials.back().diffuseTexture = RequestTexture(source.diffuseImage, source.diffuseImageData);
+        }
+    }
+    int materialCount = static_cast<int>(materials.size()) - firstMaterial;
+    auto materialIndex = [&](int material) {
+        return material >= 0 && material < materialCount ? firstMaterial + material : -1;
+    };
+    StartTextureLoads();
+    
+    size_t directCount = 0;
+    size_t decodedCount = 0;
+    for (const GltfPrimitiveRef& ref : file->ScenePrimitives()) {
+        GltfDirectPrimitive direct;
+        if (file->GetDirectPrimitive(ref, direct)) {
+            UploadGltfPrimitive(direct, materialIndex(direct.material));
+            directCount++;
+            continue;
+        }
+        
+        GltfDecodedPrimitive decoded;
+        if (!file->DecodePrimitive(ref, decoded) || decoded.positions.empty()) {
+            std::cerr << "WARNING: Skipping unreadable glTF primitive " << ref.primitive << " of mesh "
+                      << ref.mesh << std::endl;
+            continue;
+        }
+        MeshData data = BuildMeshData(decoded.positions, decoded.normals, decoded.texCoords, decoded.indices,
+                                      materialIndex(decoded.material));
+        ProcessMeshData(data, false);
+        decodedCount++;
+    }
+    
+    if (LoadedMeshCount() == 0) {
+        std::cerr << "ERROR: No meshes were created from the glTF file!" << std::endl;
+        return false;
+    }
+    
+    // Deferred uploads read from the file until UploadPending has created them
+    if (deferUploads && directCount > 0) {
+        gltfSource = file;
+    }
+    std::cout << "Successfully loaded glTF model with " << directCount << " primitives uploaded in place, "
+              << decodedCount << " converted and " << materials.size() << " materials in "
+              << (SecondsSince(startTime) * 1000.0f) << " ms" << std::endl;
+    return true;
+}
+
+void OBJLoader::UploadGltfPrimitive(const GltfDirectPrimitive& primitive, int materialIndex) {
+    PreparedMesh prepared;
+    Mesh& mesh = prepared.mesh;
+    mesh.materialIndex = materialIndex;
+    mesh.indexCount = primitive.indexCount;
+    mesh.indexType = primitive.indexType;
+    mesh.boundsMin = primitive.boundsMin;
+    mesh.boundsMax = primitive.boundsMax;
+    mesh.positionOffset = primitive.positionOffset;
+    mesh.positionScale = primitive.positionScale;
+    // glTF's texture origin is the top left, OpenGL's the bottom left
+    mesh.texCoordOffset = glm::vec2(0.0f, 1.0f);
+    mesh.texCoordScale = glm::vec2(1.0f, -1.0f);
+    mesh.vertexCount = primitive.vertexCount;
+    mesh.vertexBytes = primitive.vertexBytes;
+    mesh.indexBytes = primitive.indexBytes;
+    prepared.vertexData = primitive.vertexData;
+    prepared.indexData = primitive.indexData;
+    prepared.attributes.assign(primitive.attributes, primitive.attributes + 3);
+    
+    // The data stays in the file (kept open as gltfSource), so no copy is needed
+    if (deferUploads) {
+        pendingMeshes.push_back(std::move(prepared));
+        return;
+    }
+    CreateMeshBuffers(prepared);
+}
+
 bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
     std::ifstream file(mtlPath);
     if (!file.is_open()) {
@@ -510,8 +1131,10 @@ bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
     Material currentMtl;
     std::string line;
     bool firstMaterial = true;
+    size_t firstNewMaterial = materials.size();
     
-    // Map material names to texture types for the butterfly model
+    // The butterfly's MTL file has no map statements; its textures are
+    // assigned by material name when a material names no maps of its own
     std::map<std::string, std::string> materialToTexture = {
         {"wire_154215229", "Alas_Corona_Beauty.jpg"},  // Wing material
         {"wire_184007009", "Venas_Corona_Beauty.jpg"},  // Vein material
@@ -524,6 +1147,10 @@ bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
     // Print base directory for debugging
     std::cout << "Base directory for textures: " << baseDir << std::endl;
     
+    auto texturePath = [this](const std::string& name) {
+        return !name.empty() && name[0] == '/' ? name : baseDir + name;
+    };
+    
     while (std::getline(file, line)) {
         // Skip comments and empty lines
         if (line.empty() || line[0] == '#') continue;
@@ -540,22 +1167,6 @@ bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
             }
             currentMtl = Material();
             iss >> currentMtl.name;
-            
-            // Assign appropriate texture based on material name
-            auto it = materialToTexture.find(currentMtl.name);
-            if (it != materialToTexture.end()) {
-                // Look for textures in the same directory as the OBJ file
-                std::string texPath = baseDir + it->second;
-                std::cout << "Loading texture: " << texPath << std::endl;
-                currentMtl.diffuseMap = LoadTexture(texPath);
-                
-                // For reflective parts, also load the reflection map
-                if (it->first == "wire_042116168" || it->first == "wire_000255000") {
-                    std::string reflectPath = baseDir + it->second;
-                    std::cout << "Loading reflection map: " << reflectPath << std::endl;
-                    currentMtl.specularMap = LoadTexture(reflectPath);
-                }
-            }
         } else if (prefix == "Ka") {
             // Ambient color
             iss >> currentMtl.ambient.r >> currentMtl.ambient.g >> currentMtl.ambient.b;
@@ -568,6 +1179,28 @@ bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
         } else if (prefix == "Ns") {
             // Shininess
             iss >> currentMtl.shininess;
+        } else if (prefix == "d") {
+            // Dissolve (opacity)
+            iss >> currentMtl.dissolve;
+        } else if (prefix == "Tr") {
+            // Transparency, the inverse of dissolve
+            float transparency = 0.0f;
+            iss >> transparency;
+            currentMtl.dissolve = 1.0f - transparency;
+        } else if (prefix == "map_Kd" || prefix == "map_Ks" || prefix == "map_d") {
+            std::string name = ParseTexturePath(iss);
+            if (name.empty()) {
+                std::cerr << "WARNING: " << prefix << " without a file name in " << mtlPath << std::endl;
+                continue;
+            }
+            int texture = RequestTexture(texturePath(name));
+            if (prefix == "map_Kd") {
+                currentMtl.diffuseTexture = texture;
+            } else if (prefix == "map_Ks") {
+                currentMtl.specularTexture = texture;
+            } else {
+                currentMtl.opacityTexture = texture;
+            }
         }
     }
     
@@ -576,76 +1209,320 @@ bool OBJLoader::LoadMaterials(const std::string& mtlPath) {
         materials.push_back(currentMtl);
     }
     
+    for (size_t i = firstNewMaterial; i < materials.size(); ++i) {
+        Material& material = materials[i];
+        auto it = materialToTexture.find(material.name);
+        if (it == materialToTexture.end() || material.diffuseTexture >= 0 || material.specularTexture >= 0) {
+            continue;
+        }
+        // Look for textures in the same directory as the OBJ file
+        material.diffuseTexture = RequestTexture(baseDir + it->second);
+        
+        // Reflective parts use the same image as their reflection map
+        if (it->first == "wire_042116168" || it->first == "wire_000255000") {
+            std::cout << "Using " << baseDir << it->second << " as reflection map" << std::endl;
+            material.specularTexture = material.diffuseTexture;
+        }
+    }
+    
     return !materials.empty();
 }
 
-GLuint OBJLoader::LoadTexture(const std::string& path) {
-    // Check if file exists and is readable
-    std::ifstream file(path, std::ios::binary);
-    if (!file.good()) {
-        std::cerr << "ERROR: Texture file does not exist or is not readable: " << path << std::endl;
-        return 0;
+int OBJLoader::RequestTexture(const std::string& path,
+                              const std::shared_ptr<const std::vector<unsigned char>>& bytes) {
+    // Materials that share an image share its layer
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        if (texturePaths[i] == path) {
+            return static_cast<int>(i);
+        }
+    }
+    std::cout << "Loading texture: " << path << std::endl;
+    texturePaths.push_back(path);
+    textureBytes.push_back(bytes);
+    return static_cast<int>(texturePaths.size() - 1);
+}
+
+int OBJLoader::FindMaterial(const std::string& name) const {
+    if (name.empty()) {
+        return -1;
+    }
+    for (size_t i = 0; i < materials.size(); ++i) {
+        if (materials[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    std::cerr << "WARNING: Unknown material " << name << ", using the default" << std::endl;
+    return -1;
+}
+
+void OBJLoader::StartTextureLoads() {
+    if (offlineBuild || texturePaths.empty() || textures || !textureDecodes.empty()) {
+        return;
     }
-    file.close();
     
-    // Set STBI to flip textures vertically (OpenGL expects textures to start from bottom-left)
-    SetSTBIFlipVertically(true);
+    // Another model with the same images (e.g. the quantized variant) already has them packed
+    textures = AssetCache::Instance().FindTextureSet(texturePaths);
+    if (textures) {
+        std::cout << "Sharing " << texturePaths.size() << " material textures with a loaded model" << std::endl;
+        return;
+    }
     
-    // Load image data using stb_image
-    int width, height, channels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    // Decode alongside the rest of the load; the arrays are filled by UploadTextures
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        std::string path = texturePaths[i];
+        std::shared_ptr<const std::vector<unsigned char>> bytes = textureBytes[i];
+        textureDecodes.push_back(TextureDecodePool().Submit([path, bytes]() {
+            return DecodeTexture(path, bytes.get());
+        }));
+    }
+}
+
+// Fill the texture arrays once every image is decoded, a layer at a time
+// until the deadline passes. With wait set, block on the decodes instead of
+// returning. Returns true once the model's textures are ready.
+bool OBJLoader::UploadTextures(std::chrono::steady_clock::time_point deadline, bool wait, bool& first) {
+    if (textures || textureDecodes.empty()) {
+        return true;
+    }
     
-    if (!data) {
-        std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
-        const char* error = GetSTBILoadError();
-        if (error) {
-            std::cerr << "  STBI Error: " << error << std::endl;
+    if (!pendingTextures) {
+        // Arrays are sized by their layer count, so every image has to be in first
+        for (std::future<DecodedTexture>& decode : textureDecodes) {
+            if (!wait && decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
         }
-        return 0;
+        std::vector<DecodedTexture> images;
+        for (std::future<DecodedTexture>& decode : textureDecodes) {
+            images.push_back(decode.get());
+        }
+        pendingTextures = std::make_shared<TextureArraySet>();
+        pendingTextures->Allocate(images);
+        first = false;
     }
     
-    std::cout << "Successfully loaded texture: " << path << std::endl;
-    std::cout << "  Dimensions: " << width << "x" << height << ", Channels: " << channels << std::endl;
+    while (!pendingTextures->IsComplete()) {
+        if (!first && std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        pendingTextures->UploadNext();
+        first = false;
+    }
+    
+    textures = AssetCache::Instance().AddTextureSet(texturePaths, pendingTextures);
+    pendingTextures.reset();
+    textureDecodes.clear();
+    return true;
+}
+
+void OBJLoader::CreateMaterialBuffer() {
+    size_t count = std::min(materials.size(), MATERIAL_BLOCK_CAPACITY - 1);
+    if (count < materials.size()) {
+        std::cerr << "WARNING: Only the first " << count << " of " << materials.size()
+                  << " materials fit in the material buffer" << std::endl;
+    }
+    
+    auto layerOf = [this](int texture) {
+        if (texture < 0 || !textures || static_cast<size_t>(texture) >= textures->ImageCount()) {
+            return glm::ivec2(-1, 0);
+        }
+        const TextureLayer& layer = textures->GetLayer(texture);
+        return glm::ivec2(layer.array, layer.layer);
+    };
+    
+    std::vector<MaterialBlock> blocks(count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        const Material& material = materials[i];
+        glm::ivec2 diffuseMap = layerOf(material.diffuseTexture);
+        glm::ivec2 specularMap = layerOf(material.specularTexture);
+        glm::ivec2 opacityMap = layerOf(material.opacityTexture);
+        blocks[i].ambient = glm::vec4(material.ambient, 1.0f);
+        blocks[i].diffuse = glm::vec4(material.diffuse, material.dissolve);
+        blocks[i].specular = glm::vec4(material.specular, material.shininess);
+        blocks[i].maps = glm::ivec4(diffuseMap, specularMap);
+        blocks[i].opacityMap = glm::ivec4(opacityMap, 0, 0);
+    }
     
-    // Generate and bind texture
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    // Meshes without a material
+    MaterialBlock& fallback = blocks[count];
+    fallback.ambient = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+    fallback.diffuse = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+    fallback.specular = glm::vec4(0.5f, 0.5f, 0.5f, 32.0f);
+    fallback.maps = glm::ivec4(-1, 0, -1, 0);
+    fallback.opacityMap = glm::ivec4(-1, 0, 0, 0);
+    defaultMaterialSlot = static_cast<int>(count);
     
-    // Determine the format based on number of channels
-    GLenum format = GL_RGB;
-    if (channels == 4) {
-        format = GL_RGBA;
-    } else if (channels == 1) {
-        format = GL_RED;
-    } else if (channels != 3) {
-        std::cerr << "WARNING: Unsupported number of channels (" << channels << ") in texture: " << path << std::endl;
+    if (materialBuffer == 0) {
+        glGenBuffers(1, &materialBuffer);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, blocks.size() * sizeof(MaterialBlock), blocks.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void OBJLoader::CreateMeshBlockBuffer() {
+    // Padded to whole blocks, so every range Draw binds covers meshDecodes[]
+    size_t blockCount = std::max<size_t>(1, (meshes.size() + MESH_BLOCK_CAPACITY - 1) / MESH_BLOCK_CAPACITY);
+    std::vector<MeshBlock> blocks(blockCount * MESH_BLOCK_CAPACITY);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = meshes[i];
+        bool hasMaterial = mesh.materialIndex >= 0 && mesh.materialIndex < defaultMaterialSlot;
+        blocks[i].positionOffset = glm::vec4(mesh.positionOffset, mesh.quantized ? 1.0f : 0.0f);
+        blocks[i].positionScale = glm::vec4(mesh.positionScale, 0.0f);
+        blocks[i].texCoordTransform = glm::vec4(mesh.texCoordOffset, mesh.texCoordScale);
+        blocks[i].material = glm::ivec4(hasMaterial ? mesh.materialIndex : defaultMaterialSlot, 0, 0, 0);
     }
     
-    // Upload texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    if (meshBlockBuffer == 0) {
+        glGenBuffers(1, &meshBlockBuffer);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, meshBlockBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, blocks.size() * sizeof(MeshBlock), blocks.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+DecodedTexture OBJLoader::DecodeTexture(const std::string& path, const std::vector<unsigned char>* bytes) {
+    // Check if file exists and is readable (embedded images have none)
+    if (!bytes) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.good()) {
+            std::cerr << "ERROR: Texture file does not exist or is not readable: " << path << std::endl;
+            DecodedTexture missing;
+            missing.path = path;
+            return missing;
+        }
+    }
+    
+    // Flip textures vertically (OpenGL expects textures to start from bottom-left)
+    ImageLoadOptions options(true, true, false);
+    DecodedTexture texture = bytes ? DecodeImageFromMemory(path, bytes->data(), bytes->size(), options)
+                                   : DecodeImage(path, options);
     
-    // Generate mipmaps
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (!texture.IsValid()) {
+        std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
+        if (!texture.error.empty()) {
+            std::cerr << "  STBI Error: " << texture.error << std::endl;
+        }
+        return texture;
+    }
     
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    std::cout << "Successfully loaded texture: " << path << std::endl;
+    std::cout << "  Dimensions: " << texture.width << "x" << texture.height << ", Channels: " << texture.channels << std::endl;
     
-    // Check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        std::cerr << "OpenGL error after loading texture " << path << ": " << error << std::endl;
+    // Texture array layers are RGBA8
+    if (!texture.compressed && texture.channels != 4) {
+        std::vector<unsigned char> rgba = ExpandToRGBA(texture.pixels.get(), texture.width, texture.height,
+                                                       texture.channels);
+        unsigned char* pixels = new unsigned char[rgba.size()];
+        std::copy(rgba.begin(), rgba.end(), pixels);
+        texture.pixels.reset(pixels, std::default_delete<unsigned char[]>());
+        texture.channels = 4;
     }
+    return texture;
+}
+
+// Expand parsed OBJ faces into per-material vertex streams, triangulating
+// polygons as fans from their first corner. Without deduplication this
+// matches the legacy parser's output exactly. With deduplication, corners
+// sharing the same v/vt/vn triplet become one vertex; the index stream still
+// describes the same triangles.
+void OBJLoader::BuildMeshes(const ObjData& data) {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
     
-    // Free the image data
-    stbi_image_free(data);
+    // Vertex emitted for each corner in legacy order; the fans refer to
+    // corners by that position
+    std::vector<unsigned int> cornerVertex;
+    CornerIndexMap cornerMap;
+    const bool dedup = options.deduplicateVertices;
+    size_t totalCorners = 0;
+    size_t totalVertices = 0;
     
-    std::cout << "  Texture ID: " << textureID << " (GL error: " << error << ")" << std::endl;
+    for (size_t g = 0; g < data.groups.size(); ++g) {
+        const ObjGroup& group = data.groups[g];
+        size_t faceEnd = (g + 1 < data.groups.size()) ? data.groups[g + 1].firstFace : data.faces.size();
+        
+        vertices.clear();
+        normals.clear();
+        texCoords.clear();
+        indices.clear();
+        cornerVertex.clear();
+        if (dedup && faceEnd > group.firstFace) {
+            const ObjFace& last = data.faces[faceEnd - 1];
+            cornerMap.Reset(last.firstCorner + last.cornerCount - data.faces[group.firstFace].firstCorner);
+        }
+        
+        for (size_t f = group.firstFace; f < faceEnd; ++f) {
+            const ObjFace& face = data.faces[f];
+            const ObjCorner* corners = data.corners.data() + face.firstCorner;
+            size_t faceStart = cornerVertex.size();
+            
+            for (uint32_t i = 0; i < face.cornerCount; ++i) {
+                const ObjCorner& corner = corners[i];
+                if (corner.v < 0) {
+                    continue;
+                }
+                
+                unsigned int vertexIndex = static_cast<unsigned int>(vertices.size());
+                bool isNew = true;
+                if (corner.vn >= 0) {
+                    if (dedup) {
+                        vertexIndex = cornerMap.FindOrInsert(corner.v, corner.vt, corner.vn, vertexIndex, isNew);
+                    }
+                    if (isNew) {
+                        normals.push_back(data.normals[corner.vn]);
+                    }
+                } else if (i >= 2 && cornerVertex.size() >= 2) {
+                    // Calculate face normal if not provided; these depend on
+                    // the neighbouring corners, so they are never shared
+                    glm::vec3 v0 = vertices[cornerVertex[cornerVertex.size()-2]];
+                    glm::vec3 v1 = vertices[cornerVertex[cornerVertex.size()-1]];
+                    glm::vec3 v2 = data.positions[corner.v];
+                    normals.push_back(glm::normalize(glm::cross(v1 - v0, v2 - v0)));
+                } else {
+                    normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+                }
+                
+                if (isNew) {
+                    vertices.push_back(data.positions[corner.v]);
+                    texCoords.push_back(corner.vt >= 0 ? data.texCoords[corner.vt] : glm::vec2(0.0f, 0.0f));
+                }
+                cornerVertex.push_back(vertexIndex);
+            }
+            
+            // Fan over the corners that were emitted: (c0, ci, ci+1)
+            size_t emitted = cornerVertex.size() - faceStart;
+            for (size_t i = 1; i + 1 < emitted; ++i) {
+                indices.push_back(cornerVertex[faceStart]);
+                indices.push_back(cornerVertex[faceStart + i]);
+                indices.push_back(cornerVertex[faceStart + i + 1]);
+            }
+        }
+        
+        if (!vertices.empty()) {
+            std::cout << "Processing mesh with " << vertices.size() << " vertices";
+            if (dedup) {
+                std::cout << " (" << cornerVertex.size() << " corners, saved "
+                          << std::fixed << std::setprecision(1)
+                          << ((cornerVertex.size() - vertices.size()) * MESH_VERTEX_FLOATS * sizeof(float) / 1024.0f)
+                          << " KB)";
+            }
+            std::cout << ", " << indices.size() << " indices, material: " << group.material << std::endl;
+            totalCorners += cornerVertex.size();
+            totalVertices += vertices.size();
+            
+            ProcessMesh(vertices, normals, texCoords, indices, FindMaterial(group.material));
+        }
+    }
     
-    return textureID;
+    if (dedup && totalCorners > 0) {
+        std::cout << "Vertex deduplication: " << totalCorners << " -> " << totalVertices << " vertices ("
+                  << std::fixed << std::setprecision(2) << (static_cast<float>(totalCorners) / totalVertices)
+                  << "x fewer, " << ((totalCorners - totalVertices) * MESH_VERTEX_FLOATS * sizeof(float) / (1024.0f * 1024.0f))
+                  << " MB saved)" << std::endl;
+    }
 }
 
 void OBJLoader::ProcessMesh(const std::vector<glm::vec3>& vertices,
@@ -655,88 +1532,176 @@ void OBJLoader::ProcessMesh(const std::vector<glm::vec3>& vertices,
                            int materialIndex) {
     if (vertices.empty()) return;
     
-    // Create and bind VAO
-    Mesh mesh;
-    mesh.materialIndex = materialIndex;
-    mesh.indexCount = indices.size();
+    MeshData data = BuildMeshData(vertices, normals, texCoords, indices, materialIndex);
+    ProcessMeshData(data, options.clipToPlane);
+}
+
+void OBJLoader::ProcessMeshData(MeshData& data, bool clip) {
+    // Cut away the geometry behind the clip plane (the butterfly's base) so
+    // the fragment shader does not have to discard it
+    if (clip && !data.indices.empty()) {
+        MeshClipStats stats = ClipMesh(data, options.clipPlane);
+        if (stats.trianglesClipped > 0 || stats.trianglesRemoved > 0) {
+            std::cout << "  Clipped mesh: " << stats.trianglesRemoved << " triangles removed, "
+                      << stats.trianglesClipped << " cut (" << stats.verticesAdded << " vertices added), "
+                      << stats.trianglesKept << " kept" << std::endl;
+        }
+    }
     
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
+    // Reorder for the post-transform cache, overdraw and vertex fetch; the
+    // result is what gets cached, so this only runs when the cache is rebuilt
+    if (options.optimizeMeshes && !data.indices.empty()) {
+        MeshOptimizeStats stats = OptimizeMesh(data);
+        std::cout << "  Optimized mesh: ACMR " << std::fixed << std::setprecision(3)
+                  << stats.before.acmr << " -> " << stats.after.acmr
+                  << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+                  << " (cache size " << VERTEX_CACHE_SIZE << ")" << std::endl;
+    }
     
-    // Create and bind VBO for vertices, normals, and texture coordinates
-    glGenBuffers(1, &mesh.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    if (options.generateLods && !data.indices.empty()) {
+        BuildLodChain(data);
+        for (size_t level = 1; level < data.lods.size(); ++level) {
+            std::cout << "  LOD " << level << ": " << (data.lods[level].indexCount / 3) << " triangles, error "
+                      << std::setprecision(5) << data.lods[level].error << std::endl;
+        }
+    }
+    UploadMesh(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size(),
+               data.lods.data(), data.lods.size(),
+               data.materialIndex, data.boundsMin, data.boundsMax);
     
-    // Interleave vertex data (position, normal, texCoord)
-    std::vector<float> vertexData;
-    std::vector<unsigned int> filteredIndices;
-    std::unordered_map<unsigned int, unsigned int> indexMap; // Maps old indices to new ones
+    // Keep the CPU copy around when it is going to be written to the mesh cache
+    if (keepMeshData) {
+        builtMeshes.push_back(std::move(data));
+    }
+}
+
+void OBJLoader::UploadMesh(const float* vertexData, size_t vertexFloatCount,
+                           const unsigned int* indexData, size_t indexCount,
+                           const MeshLod* lods, size_t lodCount,
+                           int materialIndex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    PreparedMesh prepared;
+    PrepareMesh(vertexData, vertexFloatCount, indexData, indexCount, lods, lodCount,
+                materialIndex, boundsMin, boundsMax, prepared);
     
-    // First pass: filter out vertices that are part of the base (Y < -0.1)
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        // Check if any vertex in this triangle is part of the base
-        bool skipTriangle = false;
-        for (int j = 0; j < 3; j++) {
-            unsigned int idx = indices[i + j];
-            if (vertices[idx].y < -0.1f) {
-                skipTriangle = true;
-                break;
-            }
+    if (deferUploads) {
+        // The caller's buffers do not outlive this call
+        if (prepared.ownedVertices.empty()) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(prepared.vertexData);
+            prepared.ownedVertices.assign(bytes, bytes + prepared.mesh.vertexBytes);
         }
-        
-        if (!skipTriangle) {
-            // Add all three indices of the triangle
-            for (int j = 0; j < 3; j++) {
-                unsigned int oldIdx = indices[i + j];
-                
-                // If we haven't seen this index before, add it to the vertex data
-                if (indexMap.find(oldIdx) == indexMap.end()) {
-                    // Position
-                    vertexData.push_back(vertices[oldIdx].x);
-                    vertexData.push_back(vertices[oldIdx].y);
-                    vertexData.push_back(vertices[oldIdx].z);
-                    
-                    // Normal
-                    vertexData.push_back(normals[oldIdx].x);
-                    vertexData.push_back(normals[oldIdx].y);
-                    vertexData.push_back(normals[oldIdx].z);
-                    
-                    // Texture coordinates
-                    vertexData.push_back(texCoords[oldIdx].s);
-                    vertexData.push_back(texCoords[oldIdx].t);
-                    
-                    // Map the old index to the new one
-                    indexMap[oldIdx] = filteredIndices.size();
-                }
-                
-                // Add the new index to the filtered indices
-                filteredIndices.push_back(indexMap[oldIdx]);
-            }
+        if (prepared.ownedIndices.empty()) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(prepared.indexData);
+            prepared.ownedIndices.assign(bytes, bytes + prepared.mesh.indexBytes);
         }
+        pendingMeshes.push_back(std::move(prepared));
+        return;
     }
     
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
-    
-    // Set up vertex attributes
-    // Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    CreateMeshBuffers(prepared);
+}
+
+void OBJLoader::PrepareMesh(const float* vertexData, size_t vertexFloatCount,
+                            const unsigned int* indexData, size_t indexCount,
+                            const MeshLod* lods, size_t lodCount,
+                            int materialIndex, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                            PreparedMesh& prepared) {
+    Mesh& mesh = prepared.mesh;
+    mesh.materialIndex = materialIndex;
+    mesh.vertexCount = vertexFloatCount / MESH_VERTEX_FLOATS;
+    mesh.indexCount = lodCount > 0 ? lods[0].indexCount : indexCount;
+    mesh.lods.assign(lods, lods + lodCount);
+    mesh.boundsMin = boundsMin;
+    mesh.boundsMax = boundsMax;
     
-    // Normal
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    if (options.buildMeshlets) {
+        BuildMeshlets(vertexData, vertexFloatCount / MESH_VERTEX_FLOATS, MESH_VERTEX_FLOATS,
+                      indexData, mesh.indexCount, mesh.meshlets);
+    }
     
-    // Texture coordinates
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    if (options.quantizeVertices) {
+        QuantizedMesh quantized;
+        QuantizeMesh(vertexData, vertexFloatCount, indexData, indexCount, boundsMin, boundsMax, quantized);
+        mesh.quantized = true;
+        mesh.positionOffset = quantized.positionOffset;
+        mesh.positionScale = quantized.positionScale;
+        mesh.vertexBytes = quantized.VertexBytes();
+        mesh.indexBytes = quantized.IndexBytes();
+        mesh.indexType = quantized.UsesShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        
+        const unsigned char* vertexBytes = reinterpret_cast<const unsigned char*>(quantized.vertices.data());
+        const unsigned char* indexBytes = quantized.UsesShortIndices()
+            ? reinterpret_cast<const unsigned char*>(quantized.shortIndices.data())
+            : reinterpret_cast<const unsigned char*>(quantized.indices.data());
+        prepared.ownedVertices.assign(vertexBytes, vertexBytes + mesh.vertexBytes);
+        prepared.ownedIndices.assign(indexBytes, indexBytes + mesh.indexBytes);
+    } else {
+        mesh.vertexBytes = vertexFloatCount * sizeof(float);
+        mesh.indexBytes = indexCount * sizeof(unsigned int);
+        prepared.vertexData = vertexData;
+        prepared.indexData = indexData;
+    }
+}
+
+void OBJLoader::CreateMeshBuffers(PreparedMesh& prepared) {
+    Mesh& mesh = prepared.mesh;
+    const void* vertexData = prepared.ownedVertices.empty() ? prepared.vertexData : prepared.ownedVertices.data();
+    const void* indexData = prepared.ownedIndices.empty() ? prepared.indexData : prepared.ownedIndices.data();
     
-    // Create and bind EBO with filtered indices
+    // Create and bind VAO
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
     glGenBuffers(1, &mesh.ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, filteredIndices.size() * sizeof(unsigned int), filteredIndices.data(), GL_STATIC_DRAW);
     
-    // Update the index count
-    mesh.indexCount = filteredIndices.size();
+    // Vertices, normals, and texture coordinates
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes, vertexData, GL_STATIC_DRAW);
+    
+    if (mesh.quantized) {
+        // Position: normalized to [0, 1] within the AABB
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+                              (void*)offsetof(QuantizedVertex, position));
+        
+        // Normal: octahedral x/y in the first two components
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(QuantizedVertex),
+                              (void*)offsetof(QuantizedVertex, normal));
+        
+        // Texture coordinates
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex),
+                              (void*)offsetof(QuantizedVertex, texCoord));
+    } else if (!prepared.attributes.empty()) {
+        // The file's own layout, read in place
+        for (size_t i = 0; i < prepared.attributes.size(); ++i) {
+            const VertexAttribute& attribute = prepared.attributes[i];
+            if (attribute.components == 0) {
+                continue;
+            }
+            GLuint location = static_cast<GLuint>(i);
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, attribute.components, attribute.type, attribute.normalized,
+                                  attribute.stride, reinterpret_cast<const void*>(attribute.offset));
+        }
+    } else {
+        // Set up vertex attributes
+        // Position
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)0);
+        
+        // Normal
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+        
+        // Texture coordinates
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(6 * sizeof(float)));
+    }
+    
+    // Fill the EBO with filtered indices
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBytes, indexData, GL_STATIC_DRAW);
     
     // Unbind VAO first, then VBO and EBO
     glBindVertexArray(0);
@@ -744,6 +1709,16 @@ void OBJLoader::ProcessMesh(const std::vector<glm::vec3>& vertices,
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     
     meshes.push_back(mesh);
+    meshBounds.push_back((mesh.boundsMin + mesh.boundsMax) * 0.5f, glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f);
+}
+
+bool OBJLoader::NeedsAlphaTest() const {
+    for (const Material& material : materials) {
+        if (material.opacityTexture >= 0 || material.dissolve < 0.5f) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void OBJLoader::Draw(Shader& shader) {
@@ -760,126 +1735,170 @@ void OBJLoader::Draw(Shader& shader) {
     shader.setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
     shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
     
-    // Draw all meshes
-    for (const auto& mesh : meshes) {
-        // Set material properties if material exists
-        if (mesh.materialIndex >= 0 && mesh.materialIndex < materials.size()) {
-            const auto& mat = materials[mesh.materialIndex];
-            shader.setVec3("material.ambient", mat.ambient);
-            shader.setVec3("material.diffuse", mat.diffuse);
-            shader.setVec3("material.specular", mat.specular);
-            shader.setFloat("material.shininess", mat.shininess);
-            
-            // Bind diffuse map
-            if (mat.diffuseMap > 0) {
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, mat.diffuseMap);
-                shader.setInt("material.diffuseMap", 0);
-                shader.setBool("material.hasDiffuseMap", true);
-            } else {
-                shader.setBool("material.hasDiffuseMap", false);
-            }
-            
-            // Bind specular map
-            if (mat.specularMap > 0) {
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, mat.specularMap);
-                shader.setInt("material.specularMap", 1);
-                shader.setBool("material.hasSpecularMap", true);
-            } else {
-                shader.setBool("material.hasSpecularMap", false);
-            }
-            
-            // Bind normal map
-            if (mat.normalMap > 0) {
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, mat.normalMap);
-                shader.setInt("material.normalMap", 2);
-                shader.setBool("material.hasNormalMap", true);
-            } else {
-                shader.setBool("material.hasNormalMap", false);
-            }
-        } else {
-            // Default material
-            shader.setVec3("material.ambient", 0.2f, 0.2f, 0.2f);
-            shader.setVec3("material.diffuse", 0.8f, 0.8f, 0.8f);
-            shader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
-            shader.setFloat("material.shininess", 32.0f);
-            shader.setBool("material.hasDiffuseMap", false);
-            shader.setBool("material.hasSpecularMap", false);
-            shader.setBool("material.hasNormalMap", false);
+    // Materials, per-mesh decoding and textures for every mesh, bound once
+    GLuint blockIndex = glGetUniformBlockIndex(shader.ID, "Materials");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.ID, blockIndex, MATERIAL_BLOCK_BINDING);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, materialBuffer);
+    GLuint meshBlockIndex = glGetUniformBlockIndex(shader.ID, "Meshes");
+    if (meshBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.ID, meshBlockIndex, MESH_BLOCK_BINDING);
+    }
+    if (meshIndexProgram != shader.ID) {
+        meshIndexLocation = glGetUniformLocation(shader.ID, "meshIndex");
+        meshIndexProgram = shader.ID;
+    }
+    for (size_t i = 0; i < TextureArraySet::MAX_ARRAYS; ++i) {
+        shader.setInt("materialTextures[" + std::to_string(i) + "]", static_cast<int>(i));
+    }
+    if (textures) {
+        textures->Bind(0);
+    }
+    
+    // Draw the meshes that passed culling, or all of them. Between meshes
+    // only meshIndex changes, plus the bound block every 256 meshes.
+    size_t drawCount = cullMeshes ? visibleMeshes.size() : meshes.size();
+    size_t boundBlock = SIZE_MAX;
+    for (size_t n = 0; n < drawCount; ++n) {
+        size_t meshIndex = cullMeshes ? visibleMeshes[n] : n;
+        size_t block = meshIndex / MESH_BLOCK_CAPACITY;
+        if (block != boundBlock) {
+            glBindBufferRange(GL_UNIFORM_BUFFER, MESH_BLOCK_BINDING, meshBlockBuffer,
+                              block * MESH_BLOCK_CAPACITY * sizeof(MeshBlock),
+                              MESH_BLOCK_CAPACITY * sizeof(MeshBlock));
+            boundBlock = block;
         }
-        
-        // Draw mesh
-        glBindVertexArray(mesh.vao);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        
-        // Reset texture units
-        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(meshIndexLocation, static_cast<GLint>(meshIndex % MESH_BLOCK_CAPACITY));
+        DrawMeshElements(meshes[meshIndex]);
     }
     
-    // Set up shader
-    shader.use();
-    std::cout << "OBJLoader: Drawing " << meshes.size() << " meshes with shader ID: " << shader.ID << std::endl;
+    // Unbind the arrays to prevent accidental reuse
+    for (GLuint i = 0; i < TextureArraySet::MAX_ARRAYS; ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MESH_BLOCK_BINDING, 0);
+}
+
+void OBJLoader::Draw(Shader& shader, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                     size_t lodLevel) {
+    // Cull in object space: planes come from the full transform
+    MeshletFrustum frustum(projection * view * model);
+    cullStats = MeshletCullStats();
+    CullMeshes(frustum);
+    cullMeshes = true;
     
-    // Draw all meshes
-    for (const auto& mesh : meshes) {
-        // Set material properties if material exists
-        if (mesh.materialIndex >= 0 && mesh.materialIndex < static_cast<int>(materials.size())) {
-            const auto& material = materials[mesh.materialIndex];
-            
-            // Set material properties
-            shader.setVec3("material.ambient", material.ambient);
-            shader.setVec3("material.diffuse", material.diffuse);
-            shader.setVec3("material.specular", material.specular);
-            shader.setFloat("material.shininess", material.shininess);
-            
-            // Enable/disable texture usage flags
-            shader.setBool("material.useDiffuseMap", material.diffuseMap != 0);
-            shader.setBool("material.useSpecularMap", material.specularMap != 0);
-            shader.setBool("material.useNormalMap", material.normalMap != 0);
-            
-            // Bind diffuse map
-            if (material.diffuseMap) {
-                glActiveTexture(GL_TEXTURE0);
-                shader.setInt("material.diffuseMap", 0);
-                glBindTexture(GL_TEXTURE_2D, material.diffuseMap);
+    drawLod = lodLevel;
+    cullMeshlets = lodLevel == 0;
+    if (cullMeshlets) {
+        CullMeshlets(frustum, view * model);
+    }
+    Draw(shader);
+    cullMeshes = false;
+    cullMeshlets = false;
+    drawLod = 0;
+}
+
+size_t OBJLoader::GetLodCount() const {
+    size_t count = 1;
+    for (const Mesh& mesh : meshes) {
+        count = std::max(count, mesh.lods.size());
+    }
+    return count;
+}
+
+float OBJLoader::GetLodError(size_t level) const {
+    float error = 0.0f;
+    for (const Mesh& mesh : meshes) {
+        if (!mesh.lods.empty()) {
+            error = std::max(error, mesh.lods[std::min(level, mesh.lods.size() - 1)].error);
+        }
+    }
+    return error;
+}
+
+void OBJLoader::CullMeshes(const MeshletFrustum& frustum) {
+    visibleMeshes.resize(meshBounds.size());
+    size_t count = CullSpheres(frustum, meshBounds.arrays(), 0, meshBounds.size(), visibleMeshes.data(),
+                               BestSimdKernel());
+    visibleMeshes.resize(count);
+    cullStats.meshesTested = meshBounds.size();
+    cullStats.meshesVisible = count;
+}
+
+void OBJLoader::CullMeshlets(const MeshletFrustum& frustum, const glm::mat4& modelView) {
+    // The camera is brought into the model's frame
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+    
+    drawLists.resize(meshes.size());
+    size_t nextVisible = 0;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = meshes[i];
+        
+        // Meshes outside the frustum are not drawn; their meshlets count as culled
+        if (nextVisible < visibleMeshes.size() && visibleMeshes[nextVisible] == i) {
+            nextVisible++;
+        } else {
+            cullStats.meshlets += mesh.meshlets.size();
+            cullStats.frustumCulled += mesh.meshlets.size();
+            for (const Meshlet& meshlet : mesh.meshlets) {
+                cullStats.trianglesTotal += meshlet.indexCount / 3;
             }
-            
-            // Bind specular map
-            if (material.specularMap) {
-                glActiveTexture(GL_TEXTURE1);
-                shader.setInt("material.specularMap", 1);
-                glBindTexture(GL_TEXTURE_2D, material.specularMap);
+            continue;
+        }
+        MeshletDrawList& list = drawLists[i];
+        list.counts.clear();
+        list.offsets.clear();
+        
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        uint32_t runEnd = 0;
+        for (const Meshlet& meshlet : mesh.meshlets) {
+            cullStats.meshlets++;
+            cullStats.trianglesTotal += meshlet.indexCount / 3;
+            if (!frustum.IsSphereVisible(meshlet.center, meshlet.radius)) {
+                cullStats.frustumCulled++;
+                continue;
+            }
+            if (options.meshletConeCulling && IsMeshletBackfacing(meshlet, cameraPosition)) {
+                cullStats.backfaceCulled++;
+                continue;
             }
+            cullStats.trianglesDrawn += meshlet.indexCount / 3;
             
-            // Bind normal map (not used for butterfly, but keeping for completeness)
-            if (material.normalMap) {
-                glActiveTexture(GL_TEXTURE2);
-                shader.setInt("material.normalMap", 2);
-                glBindTexture(GL_TEXTURE_2D, material.normalMap);
+            // Merge with the previous range when the meshlets are adjacent
+            if (!list.counts.empty() && runEnd == meshlet.firstIndex) {
+                list.counts.back() += static_cast<GLsizei>(meshlet.indexCount);
+            } else {
+                list.counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+                list.offsets.push_back(reinterpret_cast<const void*>(meshlet.firstIndex * indexSize));
             }
-        } else {
-            // Default material properties if no material is assigned
-            shader.setVec3("material.ambient", 0.2f, 0.2f, 0.2f);
-            shader.setVec3("material.diffuse", 0.8f, 0.8f, 0.8f);
-            shader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
-            shader.setFloat("material.shininess", 32.0f);
-            shader.setBool("material.useDiffuseMap", false);
-            shader.setBool("material.useSpecularMap", false);
-            shader.setBool("material.useNormalMap", false);
+            runEnd = meshlet.firstIndex + meshlet.indexCount;
         }
-        
-        // Draw mesh
-        glBindVertexArray(mesh.vao);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        
-        // Always unbind textures to prevent accidental reuse
-        for (GLuint i = 0; i < 3; ++i) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+void OBJLoader::DrawMeshElements(const Mesh& mesh) {
+    size_t meshIndex = &mesh - meshes.data();
+    glBindVertexArray(mesh.vao);
+    if (cullMeshlets && !mesh.meshlets.empty() && meshIndex < drawLists.size()) {
+        const MeshletDrawList& list = drawLists[meshIndex];
+        if (list.counts.size() == 1) {
+            glDrawElements(GL_TRIANGLES, list.counts[0], mesh.indexType, list.offsets[0]);
+        } else if (!list.counts.empty()) {
+            glMultiDrawElements(GL_TRIANGLES, list.counts.data(), mesh.indexType, list.offsets.data(),
+                                static_cast<GLsizei>(list.counts.size()));
         }
+    } else if (drawLod > 0 && !mesh.lods.empty()) {
+        // Meshes with fewer levels stay at their coarsest one
+        const MeshLod& lod = mesh.lods[std::min(drawLod, mesh.lods.size() - 1)];
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), mesh.indexType,
+                       reinterpret_cast<const void*>(lod.firstIndex * indexSize));
+    } else {
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), mesh.indexType, 0);
     }
+    glBindVertexArray(0);
 }
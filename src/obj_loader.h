@@ -9,7 +9,15 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <chrono>
+#include <future>
 #include "shader.h"
+#include "mesh_data.h"
+#include "meshlet.h"
+#include "frustum_cull.h"
+#include "asset_cache.h"
+#include "texture_loader.h"
+#include "texture_array.h"
 
 // STB Image wrapper
 #include "stb_image_wrapper.h"
@@ -21,9 +29,11 @@ struct Material {
     glm::vec3 diffuse;
     glm::vec3 specular;
     float shininess;
-    GLuint diffuseMap;
-    GLuint specularMap;
-    GLuint normalMap;
+    float dissolve;         // "d": 1 is opaque
+    // Images of the model's texture set (-1 for none)
+    int diffuseTexture;     // map_Kd
+    int specularTexture;    // map_Ks
+    int opacityTexture;     // map_d, red channel
     
     Material() : 
         name(""),
@@ -31,9 +41,22 @@ struct Material {
         diffuse(0.7f, 0.7f, 0.7f), 
         specular(0.5f, 0.5f, 0.5f), 
         shininess(32.0f),
-        diffuseMap(0),
-        specularMap(0),
-        normalMap(0) {}
+        dissolve(1.0f),
+        diffuseTexture(-1),
+        specularTexture(-1),
+        opacityTexture(-1) {}
+};
+
+// One vertex attribute as glVertexAttribPointer reads it, for meshes
+// uploaded in their file's own format
+struct VertexAttribute {
+    GLint components;       // 0 when the attribute is absent
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    size_t offset;          // Bytes from the start of the vertex buffer
+    
+    VertexAttribute() : components(0), type(GL_FLOAT), normalized(GL_FALSE), stride(0), offset(0) {}
 };
 
 // Structure to hold mesh data
@@ -41,30 +64,257 @@ struct Mesh {
     GLuint vao;
     GLuint vbo;
     GLuint ebo;
-    size_t indexCount;
+    size_t indexCount;      // Full-detail level only
     int materialIndex;
+    glm::vec3 boundsMin;    // Object-space AABB of the drawn vertices
+    glm::vec3 boundsMax;
+    GLenum indexType;       // GL_UNSIGNED_INT, or GL_UNSIGNED_SHORT for quantized meshes
+    bool quantized;         // Uses the QuantizedVertex layout (mesh_quantize.h)
+    glm::vec3 positionOffset;   // Dequantization of quantized positions (or a glTF node's
+    glm::vec3 positionScale;    // translation and scale), applied by the vertex shader
+    glm::vec2 texCoordOffset;   // Likewise for texture coordinates
+    glm::vec2 texCoordScale;
+    size_t vertexCount;
+    size_t vertexBytes;     // GPU memory used by the vertex and index buffers
+    size_t indexBytes;
+    std::vector<Meshlet> meshlets;  // Index ranges culled individually by Draw
+    std::vector<MeshLod> lods;      // Simplified levels in the same index buffer (empty if none)
+    
+    Mesh() : vao(0), vbo(0), ebo(0), indexCount(0), materialIndex(-1), boundsMin(0.0f), boundsMax(0.0f),
+             indexType(GL_UNSIGNED_INT), quantized(false), positionOffset(0.0f), positionScale(1.0f),
+             texCoordOffset(0.0f), texCoordScale(1.0f), vertexCount(0), vertexBytes(0), indexBytes(0) {}
+};
+
+// Loader settings, applied on the next LoadModel call
+struct OBJLoadOptions {
+    // Use the original std::getline/istringstream parser instead of the
+    // memory-mapped tokenizer (kept to compare load throughput)
+    bool useLegacyParser;
+    // Worker threads for the mapped parser (0 = one per core, 1 = serial)
+    unsigned parseThreads;
+    // Load preprocessed meshes from the open asset bundle, or from / to a
+    // binary .meshbin cache next to the OBJ file
+    bool useMeshCache;
+    // Share one vertex between face corners with the same v/vt/vn indices
+    // (mapped parser only)
+    bool deduplicateVertices;
+    // Reorder triangles and vertices for the post-transform vertex cache,
+    // overdraw and vertex fetch (see mesh_optimizer.h)
+    bool optimizeMeshes;
+    // Upload meshes in the 16-byte quantized vertex layout with 16-bit indices
+    // where possible. Shaders drawing the model must decode it (see butterfly.vert).
+    bool quantizeVertices;
+    // Split meshes into meshlets that Draw culls against the view frustum
+    bool buildMeshlets;
+    // Also skip meshlets whose normal cone faces away from the camera. Off by
+    // default: the renderer draws without GL_CULL_FACE, so back faces are
+    // visible (e.g. through the thin butterfly wings). Only for closed models.
+    bool meshletConeCulling;
+    // Generate simplified LOD levels (see mesh_simplify.h)
+    bool generateLods;
+    // Clip the geometry at load time, keeping the object-space half where
+    // dot(clipPlane.xyz, position) + clipPlane.w >= 0. The default plane cuts
+    // away the butterfly model's base below y = -0.1. OBJ models only.
+    bool clipToPlane;
+    glm::vec4 clipPlane;
     
-    Mesh() : vao(0), vbo(0), ebo(0), indexCount(0), materialIndex(-1) {}
+    OBJLoadOptions()
+        : useLegacyParser(false), parseThreads(0), useMeshCache(true), deduplicateVertices(true),
+          optimizeMeshes(true), quantizeVertices(false), buildMeshlets(true), meshletConeCulling(false),
+          generateLods(true), clipToPlane(true), clipPlane(0.0f, 1.0f, 0.0f, 0.1f) {}
+};
+
+// Progress of a model through LoadModelAsync
+enum class ModelLoadState {
+    Empty,      // Nothing requested
+    Loading,    // Parsing and decoding on a worker thread
+    Uploading,  // Creating GL objects on the render thread (UploadPending)
+    Resident,   // Ready to draw
+    Failed
 };
 
+// Mesh and meshlet culling results of the last Draw call that had camera
+// matrices. Meshlets of meshes outside the frustum count as frustum culled.
+struct MeshletCullStats {
+    size_t meshesTested;
+    size_t meshesVisible;
+    size_t meshlets;
+    size_t frustumCulled;
+    size_t backfaceCulled;
+    size_t trianglesDrawn;
+    size_t trianglesTotal;
+    
+    MeshletCullStats() : meshesTested(0), meshesVisible(0), meshlets(0), frustumCulled(0), backfaceCulled(0),
+                         trianglesDrawn(0), trianglesTotal(0) {}
+};
+
+struct ObjData;
+struct MeshCacheKey;
+class GltfFile;
+struct GltfDirectPrimitive;
+
 class OBJLoader {
 private:
-    Shader& shader;
+    Shader* shader;     // Null for offline builds
     std::vector<Mesh> meshes;
     std::vector<Material> materials;
     std::string baseDir; // Directory containing the OBJ file
     bool hasTextures = false;  // Add this line
+    OBJLoadOptions options;
+    std::vector<std::string> materialLibraries; // "mtllib" files referenced by the model
+    std::vector<std::string> texturePaths;      // Images the materials refer to, in request order
+    // Encoded bytes of texturePaths entries embedded in the model, null for files
+    std::vector<std::shared_ptr<const std::vector<unsigned char>>> textureBytes;
+    TextureHandle textures;                     // texturePaths packed into texture arrays
+    GLuint materialBuffer = 0;                  // Uniform buffer with every material (see butterfly.frag)
+    int defaultMaterialSlot = 0;                // Its entry for meshes without a material
+    GLuint meshBlockBuffer = 0;                 // Vertex decoding and material of every mesh (see butterfly.vert)
+    GLuint meshIndexProgram = 0;                // Program meshIndexLocation was looked up in
+    GLint meshIndexLocation = -1;
+    
+    // CPU copies of the uploaded meshes, kept only while a cache is being written
+    std::vector<MeshData> builtMeshes;
+    bool keepMeshData = false;
+    bool offlineBuild = false;  // BuildOffline: no GL objects and no texture decodes
+    
+    // Visible index ranges per mesh, rebuilt by each culled Draw call
+    struct MeshletDrawList {
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+    };
+    std::vector<MeshletDrawList> drawLists;
+    // Object-space bounding sphere of each mesh, derived from its AABB when
+    // it is created, and the meshes a culled Draw call draws
+    BoundingSphereSet meshBounds;
+    std::vector<uint32_t> visibleMeshes;
+    bool cullMeshes = false;
+    bool cullMeshlets = false;
+    size_t drawLod = 0;     // Level used by the current Draw call
+    MeshletCullStats cullStats;
+    
+    // A mesh ready for CreateMeshBuffers. vertexData/indexData point at the
+    // caller's buffers unless the owned copies are filled.
+    struct PreparedMesh {
+        Mesh mesh;
+        const void* vertexData = nullptr;
+        const void* indexData = nullptr;
+        std::vector<unsigned char> ownedVertices;
+        std::vector<unsigned char> ownedIndices;
+        std::vector<VertexAttribute> attributes;    // Empty for the float and quantized layouts
+    };
+    // Asynchronous loading: the worker fills the pending lists instead of
+    // touching GL, and UploadPending drains them on the render thread
+    bool deferUploads = false;
+    std::vector<PreparedMesh> pendingMeshes;
+    std::shared_ptr<GltfFile> gltfSource;       // Mapped file pending glTF meshes point into
+    std::vector<std::future<DecodedTexture>> textureDecodes;   // One per texturePaths entry
+    TextureHandle pendingTextures;              // Arrays being filled before they are shared
+    size_t pendingMeshCursor = 0;
+    std::future<bool> loadResult;
+    ModelLoadState loadState = ModelLoadState::Empty;
+    std::chrono::steady_clock::time_point loadStartTime;
+    
+    // Render thread only: GL objects and textures, then ClearCpuState
+    void ReleaseResources();
+    // Everything but GL objects and textures, which must already be gone;
+    // safe on worker threads
+    void ClearCpuState();
+    bool LoadModelData(const std::string& objPath);
+    size_t LoadedMeshCount() const;
+    bool LoadModelMapped(const std::string& objPath);
+    bool LoadModelLegacy(const std::string& objPath);
+    bool LoadModelGltf(const std::string& gltfPath);
+    void UploadGltfPrimitive(const GltfDirectPrimitive& primitive, int materialIndex);
+    // From the asset bundle entry for the source, or its .meshbin file
+    bool LoadFromCache(const std::string& sourcePath, const MeshCacheKey& key, bool fromBundle);
+    void SetBaseDir(const std::string& path);
+    void LoadMaterialLibrary(const std::string& mtlFile);
+    uint32_t CacheOptionFlags() const;
+    uint32_t CacheOptionHash() const;
+    void BuildMeshes(const ObjData& data);
+    void PrintMeshStats() const;
+    void CullMeshes(const MeshletFrustum& frustum);
+    void CullMeshlets(const MeshletFrustum& frustum, const glm::mat4& modelView);
+    void DrawMeshElements(const Mesh& mesh);
+    void UploadMesh(const float* vertexData, size_t vertexFloatCount,
+                    const unsigned int* indexData, size_t indexCount,
+                    const MeshLod* lods, size_t lodCount,
+                    int materialIndex, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    void PrepareMesh(const float* vertexData, size_t vertexFloatCount,
+                     const unsigned int* indexData, size_t indexCount,
+                     const MeshLod* lods, size_t lodCount,
+                     int materialIndex, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+                     PreparedMesh& prepared);
+    void CreateMeshBuffers(PreparedMesh& prepared);
+    void ProcessMeshData(MeshData& data, bool clip);
+    // bytes holds the image if it is embedded in the model; path then only names it
+    int RequestTexture(const std::string& path,
+                       const std::shared_ptr<const std::vector<unsigned char>>& bytes = nullptr);
+    int FindMaterial(const std::string& name) const;
+    void StartTextureLoads();
+    bool UploadTextures(std::chrono::steady_clock::time_point deadline, bool wait, bool& first);
+    void CreateMaterialBuffer();
+    // After every mesh is uploaded (and the material buffer created)
+    void CreateMeshBlockBuffer();
     
 public:
     OBJLoader(Shader& shader);
+    // A loader that only builds mesh data (BuildOffline); it cannot draw
+    OBJLoader();
     ~OBJLoader();
     
+    // Load an OBJ file, or a glTF 2.0 model if the path ends in .gltf or .glb
     bool LoadModel(const std::string& objPath);
+    // Parse, decode and prepare the model on a worker thread. GL objects are
+    // created by later UploadPending calls; the model is not drawable until
+    // IsResident(). Releases the current model immediately.
+    void LoadModelAsync(const std::string& objPath);
+    // Render thread only. Create pending GL objects until the deadline passes
+    // (at least one per call). Returns true once the model is resident.
+    bool UploadPending(std::chrono::steady_clock::time_point deadline);
+    ModelLoadState GetLoadState() const { return loadState; }
+    bool IsResident() const { return loadState == ModelLoadState::Resident; }
+    // Draw every mesh with one state setup: the shader reads materials from
+    // the "Materials" uniform block and textures from the model's arrays on
+    // units 0..TextureArraySet::MAX_ARRAYS-1, so only materialIndex changes
+    // between meshes
     void Draw(Shader& shader);
+    // Draw only the meshlets visible from the given camera. Levels above 0
+    // draw the simplified meshes whole (meshlets cover the full-detail level).
+    void Draw(Shader& shader, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+              size_t lodLevel = 0);
+    const MeshletCullStats& GetCullStats() const { return cullStats; }
+    // Whether a material cuts out fragments (opacity map or dissolve below
+    // the shader's 0.5 threshold), so Draw needs the ALPHA_TEST shader
+    bool NeedsAlphaTest() const;
+    
+    // Number of detail levels, including the full mesh
+    size_t GetLodCount() const;
+    // Largest object-space error of any mesh at the given level
+    float GetLodError(size_t level) const;
+    
+    void SetOptions(const OBJLoadOptions& opts) { options = opts; }
+    const OBJLoadOptions& GetOptions() const { return options; }
+    
+    // Offline preprocessing for the assetc tool. Parse an OBJ file and run
+    // the same clipping, optimization and LOD generation as LoadModel with
+    // the current options, without creating GL objects or decoding
+    // textures. Returns the meshes, the material libraries they reference
+    // and the images the materials use.
+    bool BuildOffline(const std::string& objPath, std::vector<MeshData>& meshData,
+                      std::vector<std::string>& libraries, std::vector<std::string>& images);
+    // Only the images the model's material libraries refer to
+    void ReadMaterialImages(const std::string& objPath, const std::vector<std::string>& libraries,
+                            std::vector<std::string>& images);
+    // Loader version and option bits of meshes built with the current
+    // options (the source size and time are left zero)
+    void GetMeshCacheKey(MeshCacheKey& key) const;
     
     // Helper methods
     bool LoadMaterials(const std::string& mtlPath);
-    GLuint LoadTexture(const std::string& path);
+    // Decode a material image as RGBA8 or block-compressed; safe on any thread.
+    // An embedded image is decoded from bytes instead of the file at path.
+    static DecodedTexture DecodeTexture(const std::string& path, const std::vector<unsigned char>* bytes);
     void ProcessMesh(const std::vector<glm::vec3>& vertices,
                     const std::vector<glm::vec3>& normals,
                     const std::vector<glm::vec2>& texCoords,
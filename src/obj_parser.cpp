@@ -0,0 +1,373 @@
+#include "obj_parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const size_t PROGRESS_INTERVAL = 5 * 1024 * 1024; // Report every 5MB
+    const size_t MIN_CHUNK_SIZE = 1024 * 1024;         // Smaller chunks are not worth a task
+    const unsigned CHUNKS_PER_THREAD = 4;              // Oversplit to balance uneven lines
+
+    inline bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline void SkipSpaces(const char*& p, const char* end) {
+        while (p < end && IsSpace(*p)) ++p;
+    }
+
+    // Advance past the next whitespace-delimited token and return its bounds
+    inline bool NextToken(const char*& p, const char* end, const char*& tokBegin, const char*& tokEnd) {
+        SkipSpaces(p, end);
+        if (p >= end) return false;
+        tokBegin = p;
+        while (p < end && !IsSpace(*p)) ++p;
+        tokEnd = p;
+        return true;
+    }
+
+    inline bool TokenIs(const char* b, const char* e, const char* literal) {
+        size_t len = std::strlen(literal);
+        return static_cast<size_t>(e - b) == len && std::memcmp(b, literal, len) == 0;
+    }
+
+    // Parse a float the way "stream >> float" does: leading whitespace and an
+    // explicit '+' are accepted, trailing garbage is left unconsumed
+    bool ParseFloat(const char*& p, const char* end, float& out) {
+        SkipSpaces(p, end);
+        if (p < end && *p == '+') ++p;
+        if (p >= end) return false;
+#if defined(__cpp_lib_to_chars)
+        std::from_chars_result res = std::from_chars(p, end, out);
+        if (res.ec != std::errc()) return false;
+        p = res.ptr;
+        return true;
+#else
+        // Standard libraries without floating-point from_chars: strtof needs a
+        // terminated string and the mapping is not, so copy the token first
+        char buf[64];
+        size_t n = 0;
+        while (p + n < end && n < sizeof(buf) - 1 && !IsSpace(p[n])) {
+            buf[n] = p[n];
+            ++n;
+        }
+        buf[n] = '\0';
+        char* stop = nullptr;
+        out = std::strtof(buf, &stop);
+        if (stop == buf) return false;
+        p += (stop - buf);
+        return true;
+#endif
+    }
+
+    // Parse the leading integer of [b, e) like std::stoi; returns 0 when the
+    // segment is empty, unparsable or out of range (0 is never a valid OBJ index)
+    inline int ParseIndex(const char* b, const char* e) {
+        if (b < e && *b == '+') ++b;
+        int value = 0;
+        std::from_chars_result res = std::from_chars(b, e, value);
+        if (res.ec != std::errc()) return 0;
+        return value;
+    }
+
+    void ParseFace(const char* p, const char* end, ObjData& out) {
+        ObjFace face;
+        face.firstCorner = static_cast<uint32_t>(out.corners.size());
+        face.cornerCount = 0;
+        face.vCount = static_cast<uint32_t>(out.positions.size());
+        face.vtCount = static_cast<uint32_t>(out.texCoords.size());
+        face.vnCount = static_cast<uint32_t>(out.normals.size());
+
+        const char* tokBegin;
+        const char* tokEnd;
+        while (NextToken(p, end, tokBegin, tokEnd)) {
+            // Split "v/vt/vn" in place
+            int fields[3] = {0, 0, 0};
+            const char* segBegin = tokBegin;
+            for (int f = 0; f < 3 && segBegin <= tokEnd; ++f) {
+                const char* segEnd = static_cast<const char*>(
+                    std::memchr(segBegin, '/', tokEnd - segBegin));
+                if (!segEnd) segEnd = tokEnd;
+                fields[f] = ParseIndex(segBegin, segEnd);
+                segBegin = segEnd + 1;
+            }
+
+            ObjCorner corner;
+            corner.v = fields[0];
+            corner.vt = fields[1];
+            corner.vn = fields[2];
+            corner.absolute = fields[0] > 0;
+            out.corners.push_back(corner);
+            face.cornerCount++;
+        }
+
+        // Only polygons are kept; shorter lines are ignored entirely
+        if (face.cornerCount >= 3) {
+            out.faces.push_back(face);
+        } else {
+            out.corners.resize(face.firstCorner);
+        }
+    }
+
+    void ParseLine(const char* p, const char* end, ObjData& out) {
+        // Skip empty lines and comments
+        if (p >= end || *p == '#') return;
+
+        const char* prefixBegin;
+        const char* prefixEnd;
+        if (!NextToken(p, end, prefixBegin, prefixEnd)) return;
+        size_t prefixLen = prefixEnd - prefixBegin;
+
+        if (prefixLen == 1 && *prefixBegin == 'v') {
+            // Vertex position
+            glm::vec3 vertex(0.0f, 0.0f, 0.0f);
+            if (!ParseFloat(p, end, vertex.x)) return;
+            if (!ParseFloat(p, end, vertex.y)) return;
+            if (!ParseFloat(p, end, vertex.z)) return;
+            out.positions.push_back(vertex);
+        } else if (prefixLen == 1 && *prefixBegin == 'f') {
+            ParseFace(p, end, out);
+        } else if (TokenIs(prefixBegin, prefixEnd, "vt")) {
+            // Texture coordinate
+            glm::vec2 texCoord(0.0f, 0.0f);
+            if (!ParseFloat(p, end, texCoord.s)) return;
+            if (!ParseFloat(p, end, texCoord.t)) return;
+            texCoord.t = 1.0f - texCoord.t; // Flip V coordinate
+            out.texCoords.push_back(texCoord);
+        } else if (TokenIs(prefixBegin, prefixEnd, "vn")) {
+            // Vertex normal; missing components stay zero
+            glm::vec3 normal(0.0f, 0.0f, 0.0f);
+            if (ParseFloat(p, end, normal.x) && ParseFloat(p, end, normal.y)) {
+                ParseFloat(p, end, normal.z);
+            }
+            out.normals.push_back(normal);
+        } else if (TokenIs(prefixBegin, prefixEnd, "usemtl")) {
+            // A statement without a name keeps the current material; that is
+            // filled in once all groups are known
+            ObjGroup group{std::string(), static_cast<uint32_t>(out.faces.size()), false};
+            const char* nameBegin;
+            const char* nameEnd;
+            if (NextToken(p, end, nameBegin, nameEnd)) {
+                group.material.assign(nameBegin, nameEnd);
+                group.named = true;
+            }
+            out.groups.push_back(group);
+        } else if (TokenIs(prefixBegin, prefixEnd, "mtllib")) {
+            const char* nameBegin;
+            const char* nameEnd;
+            if (NextToken(p, end, nameBegin, nameEnd)) {
+                out.materialLibraries.emplace_back(nameBegin, nameEnd);
+            }
+        }
+    }
+
+    inline int ResolveIndex(int raw, uint32_t count) {
+        if (raw > 0) {
+            uint32_t idx = static_cast<uint32_t>(raw) - 1;
+            return idx < count ? static_cast<int>(idx) : -1;
+        }
+        if (raw < 0) {
+            int64_t idx = static_cast<int64_t>(count) + raw;
+            return idx >= 0 ? static_cast<int>(idx) : -1;
+        }
+        return -1;
+    }
+    
+    void ResolveFaces(const ObjFace* faces, size_t faceCount, ObjCorner* corners) {
+        for (size_t f = 0; f < faceCount; ++f) {
+            const ObjFace& face = faces[f];
+            ObjCorner* corner = corners + face.firstCorner;
+            for (uint32_t i = 0; i < face.cornerCount; ++i, ++corner) {
+                corner->v = ResolveIndex(corner->v, face.vCount);
+                corner->vt = ResolveIndex(corner->vt, face.vtCount);
+                corner->vn = ResolveIndex(corner->vn, face.vnCount);
+            }
+        }
+    }
+    
+    void ResolveGroupNames(std::vector<ObjGroup>& groups) {
+        std::string current;
+        for (ObjGroup& group : groups) {
+            if (group.named) {
+                current = group.material;
+            } else {
+                group.material = current;
+                group.named = true;
+            }
+        }
+    }
+    
+    // Running totals of every record type, used for the chunk prefix sums
+    struct ObjCounts {
+        size_t positions = 0;
+        size_t texCoords = 0;
+        size_t normals = 0;
+        size_t faces = 0;
+        size_t corners = 0;
+        
+        void Add(const ObjData& data) {
+            positions += data.positions.size();
+            texCoords += data.texCoords.size();
+            normals += data.normals.size();
+            faces += data.faces.size();
+            corners += data.corners.size();
+        }
+    };
+    
+    // Copy one chunk into its slot of the merged arrays, rebasing its face
+    // records onto the global counts, then resolve its corners in place
+    void MergeChunk(ObjData& chunk, const ObjCounts& base, ObjData& out) {
+        std::copy(chunk.positions.begin(), chunk.positions.end(), out.positions.begin() + base.positions);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), out.texCoords.begin() + base.texCoords);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), out.normals.begin() + base.normals);
+        std::copy(chunk.corners.begin(), chunk.corners.end(), out.corners.begin() + base.corners);
+        
+        ObjFace* faces = out.faces.data() + base.faces;
+        for (size_t f = 0; f < chunk.faces.size(); ++f) {
+            ObjFace face = chunk.faces[f];
+            face.firstCorner += static_cast<uint32_t>(base.corners);
+            face.vCount += static_cast<uint32_t>(base.positions);
+            face.vtCount += static_cast<uint32_t>(base.texCoords);
+            face.vnCount += static_cast<uint32_t>(base.normals);
+            faces[f] = face;
+        }
+        ResolveFaces(faces, chunk.faces.size(), out.corners.data());
+        
+        // Release the chunk as soon as it has been merged
+        chunk = ObjData();
+    }
+}
+
+void ObjData::Clear() {
+    positions.clear();
+    texCoords.clear();
+    normals.clear();
+    faces.clear();
+    corners.clear();
+    groups.clear();
+    materialLibraries.clear();
+    lineCount = 0;
+}
+
+void TokenizeObj(const char* begin, const char* end, ObjData& out,
+                 const ObjProgressCallback& progress) {
+    // Faces before the first "usemtl" belong to an unnamed group
+    if (out.groups.empty()) {
+        out.groups.push_back(ObjGroup{std::string(), static_cast<uint32_t>(out.faces.size()), false});
+    }
+
+    const char* p = begin;
+    const char* nextReport = begin + PROGRESS_INTERVAL;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+
+        ParseLine(p, lineEnd, out);
+        out.lineCount++;
+
+        p = lineEnd + 1;
+        if (progress && (p >= nextReport || p >= end)) {
+            progress(static_cast<size_t>((p < end ? p : end) - begin));
+            nextReport = p + PROGRESS_INTERVAL;
+        }
+    }
+}
+
+void ResolveObjIndices(ObjData& data) {
+    ResolveFaces(data.faces.data(), data.faces.size(), data.corners.data());
+    ResolveGroupNames(data.groups);
+}
+
+void ParseObj(const char* begin, const char* end, ObjData& out,
+              const ObjProgressCallback& progress) {
+    TokenizeObj(begin, end, out, progress);
+    ResolveObjIndices(out);
+}
+
+void ParseObjParallel(const char* begin, const char* end, unsigned threadCount, ObjData& out,
+                      const ObjProgressCallback& progress) {
+    if (threadCount == 0) {
+        threadCount = ThreadPool::DefaultThreadCount();
+    }
+    
+    size_t size = static_cast<size_t>(end - begin);
+    size_t chunkCount = std::min<size_t>(static_cast<size_t>(threadCount) * CHUNKS_PER_THREAD,
+                                         size / MIN_CHUNK_SIZE);
+    if (threadCount <= 1 || chunkCount <= 1) {
+        ParseObj(begin, end, out, progress);
+        return;
+    }
+    
+    // Cut at the first newline after each even split point so no line straddles two chunks
+    std::vector<const char*> bounds;
+    bounds.push_back(begin);
+    for (size_t i = 1; i < chunkCount; ++i) {
+        const char* target = std::max(begin + (size * i) / chunkCount, bounds.back());
+        const char* newline = static_cast<const char*>(std::memchr(target, '\n', end - target));
+        const char* cut = newline ? newline + 1 : end;
+        if (cut > bounds.back() && cut < end) {
+            bounds.push_back(cut);
+        }
+    }
+    bounds.push_back(end);
+    chunkCount = bounds.size() - 1;
+    
+    ThreadPool pool(threadCount);
+    std::vector<ObjData> chunks(chunkCount);
+    std::vector<std::future<void>> pending;
+    pending.reserve(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        pending.push_back(pool.Submit([&chunks, &bounds, i]() {
+            TokenizeObj(bounds[i], bounds[i + 1], chunks[i]);
+        }));
+    }
+    for (size_t i = 0; i < chunkCount; ++i) {
+        pending[i].get();
+        if (progress) {
+            progress(static_cast<size_t>(bounds[i + 1] - begin));
+        }
+    }
+    
+    // Exclusive prefix sum of the per-chunk record counts
+    std::vector<ObjCounts> bases(chunkCount);
+    ObjCounts total;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        bases[i] = total;
+        total.Add(chunks[i]);
+    }
+    
+    // Small serial bookkeeping: groups, material libraries and line counts.
+    // Every chunk after the first starts with an implicit group that simply
+    // continues the previous chunk's last group, so it is dropped.
+    out.Clear();
+    for (size_t i = 0; i < chunkCount; ++i) {
+        ObjData& chunk = chunks[i];
+        for (size_t g = (i == 0 ? 0 : 1); g < chunk.groups.size(); ++g) {
+            ObjGroup group = std::move(chunk.groups[g]);
+            group.firstFace += static_cast<uint32_t>(bases[i].faces);
+            out.groups.push_back(std::move(group));
+        }
+        out.materialLibraries.insert(out.materialLibraries.end(),
+                                     chunk.materialLibraries.begin(), chunk.materialLibraries.end());
+        out.lineCount += chunk.lineCount;
+    }
+    ResolveGroupNames(out.groups);
+    
+    out.positions.resize(total.positions);
+    out.texCoords.resize(total.texCoords);
+    out.normals.resize(total.normals);
+    out.faces.resize(total.faces);
+    out.corners.resize(total.corners);
+    
+    pending.clear();
+    for (size_t i = 0; i < chunkCount; ++i) {
+        pending.push_back(pool.Submit([&chunks, &bases, &out, i]() {
+            MergeChunk(chunks[i], bases[i], out);
+        }));
+    }
+    for (std::future<void>& done : pending) {
+        done.get();
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// One "v/vt/vn" corner of a face.
+// Straight out of the tokenizer the fields hold the raw (1-based or negative)
+// indices from the file, with 0 meaning missing or unparsable. After
+// ResolveObjIndices they hold 0-based indices into ObjData, or -1 if invalid.
+struct ObjCorner {
+    int v;
+    int vt;
+    int vn;
+    bool absolute;  // position index was written as a positive index
+};
+
+// A face line with at least three corner tokens
+struct ObjFace {
+    uint32_t firstCorner;
+    uint32_t cornerCount;   // corner tokens on the line, including unusable ones
+    // Attribute counts at the point the face was read, used to resolve
+    // relative indices and to reject forward references
+    uint32_t vCount;
+    uint32_t vtCount;
+    uint32_t vnCount;
+};
+
+// Run of faces following a "usemtl" statement (the first group is implicit)
+struct ObjGroup {
+    std::string material;
+    uint32_t firstFace;
+    bool named;     // false for a nameless statement until it inherits the previous material
+};
+
+// Everything the loader needs from an OBJ file, still in OBJ's separate-index form
+struct ObjData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;   // V already flipped for OpenGL
+    std::vector<glm::vec3> normals;
+    std::vector<ObjFace> faces;
+    std::vector<ObjCorner> corners;
+    std::vector<ObjGroup> groups;
+    std::vector<std::string> materialLibraries;
+    size_t lineCount = 0;
+
+    void Clear();
+};
+
+// Called with the number of bytes consumed so far (roughly every few MB)
+using ObjProgressCallback = std::function<void(size_t bytesParsed)>;
+
+// Tokenize an in-memory OBJ file without copying lines or building streams.
+// The records are appended to out as-is; call ResolveObjIndices afterwards.
+void TokenizeObj(const char* begin, const char* end, ObjData& out,
+                 const ObjProgressCallback& progress = nullptr);
+
+// Convert raw corner indices into 0-based indices (or -1) using each face's counts
+void ResolveObjIndices(ObjData& data);
+
+// TokenizeObj + ResolveObjIndices
+void ParseObj(const char* begin, const char* end, ObjData& out,
+              const ObjProgressCallback& progress = nullptr);
+
+// Split the buffer into newline-aligned chunks and tokenize them on threadCount
+// workers (0 = one per core). Chunks are stitched together with prefix sums over
+// their record counts, so the result is identical to ParseObj.
+void ParseObjParallel(const char* begin, const char* end, unsigned threadCount, ObjData& out,
+                      const ObjProgressCallback& progress = nullptr);
+
+#endif // OBJ_PARSER_H
@@ -0,0 +1,177 @@
+#include "scene_generator.h"
+#include "job_system.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+    const float GRID_SPACING = 2.0f;
+    const float GRID_JITTER = 0.5f;
+    // Grid boxes generated per job
+    const size_t GENERATE_GRAIN = 4096;
+
+    void PrintUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --seed N             Scene seed (default 1)\n"
+                  << "  --boxes N            Boxes spread over the grid (default one per cell)\n"
+                  << "  --grid XxYxZ         Grid cells, 2 units apart (default 5x5x5)\n"
+                  << "  --butterflies N      Butterflies (default 1)\n"
+                  << "  --fixed-step SECONDS Advance the simulation by a fixed step every frame\n"
+                  << "                       instead of the frame time, for exact replays\n"
+                  << "  --gpu-boxes          Move the boxes on the GPU (G toggles)" << std::endl;
+    }
+
+    bool ParseCount(const char* text, size_t& value) {
+        char* end = nullptr;
+        unsigned long long parsed = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0' || text[0] == '-') {
+            return false;
+        }
+        value = static_cast<size_t>(parsed);
+        return true;
+    }
+
+    glm::vec3 RandomColor(SceneRandom& random) {
+        // Avoid very dark colors
+        float r = random.Float(0.2f, 1.0f);
+        float g = random.Float(0.2f, 1.0f);
+        float b = random.Float(0.2f, 1.0f);
+        return glm::vec3(r, g, b);
+    }
+
+    // Same ranges the boxes always moved with
+    Box::InstanceData MovingBox(SceneRandom& random, const glm::vec3& position, const glm::vec3& color,
+                                float scale) {
+        float vx = random.Float(-0.05f, 0.05f);
+        float vy = random.Float(-0.05f, 0.05f);
+        float vz = random.Float(-0.05f, 0.05f);
+        float rotationSpeed = random.Float(0.001f, 0.1f);
+        return Box::InstanceData(position, color, scale, glm::vec3(vx, vy, vz), rotationSpeed);
+    }
+
+    void HashBytes(uint64_t& hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    }
+}
+
+bool ParseSceneOptions(int argc, char** argv, SceneOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (option == "--gpu-boxes") {
+            options.gpuSimulation = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+        const char* value = argv[++i];
+        bool valid = false;
+        size_t count = 0;
+        if (option == "--seed") {
+            valid = ParseCount(value, count);
+            options.seed = count;
+        } else if (option == "--boxes") {
+            valid = ParseCount(value, options.boxCount);
+        } else if (option == "--butterflies") {
+            valid = ParseCount(value, options.butterflyCount);
+        } else if (option == "--grid") {
+            char end = '\0';
+            valid = std::sscanf(value, "%dx%dx%d%c", &options.gridX, &options.gridY, &options.gridZ, &end) == 3 &&
+                    options.gridX > 0 && options.gridY > 0 && options.gridZ > 0;
+        } else if (option == "--fixed-step") {
+            char* end = nullptr;
+            options.fixedStep = std::strtof(value, &end);
+            valid = end != value && *end == '\0' && options.fixedStep >= 0.0f;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (!valid) {
+            std::cerr << "Bad value for " << option << ": " << value << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void GenerateSceneBoxes(const SceneOptions& options, std::vector<Box::InstanceData>& boxes) {
+    // Cell offsets run from -size/2, so an odd grid is centered on the
+    // butterfly; the cell at offset (0, 0, 0) stays empty unless it is the
+    // only one
+    size_t cellCount = static_cast<size_t>(options.gridX) * options.gridY * options.gridZ;
+    size_t centerCell = (static_cast<size_t>(options.gridX / 2) * options.gridY + options.gridY / 2) * options.gridZ +
+                        options.gridZ / 2;
+    size_t usableCells = cellCount > 1 ? cellCount - 1 : 1;
+    size_t gridBoxes = options.boxCount > 0 ? options.boxCount : usableCells;
+
+    size_t first = boxes.size();
+    boxes.resize(first + gridBoxes, Box::InstanceData(glm::vec3(0.0f), glm::vec3(0.0f), 0.0f));
+    JobSystem::Instance().ParallelFor(0, gridBoxes, GENERATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            // Boxes beyond the cell count go round the grid again
+            size_t cell = i % usableCells;
+            if (cellCount > 1 && cell >= centerCell) {
+                cell++;
+            }
+            int x = static_cast<int>(cell / (static_cast<size_t>(options.gridY) * options.gridZ)) - options.gridX / 2;
+            int y = static_cast<int>(cell / options.gridZ % options.gridY) - options.gridY / 2;
+            int z = static_cast<int>(cell % options.gridZ) - options.gridZ / 2;
+
+            SceneRandom random(options.seed, SceneRandom::Stream(SceneRandom::Boxes, i));
+            float jitterX = random.Float(-GRID_JITTER, GRID_JITTER);
+            float jitterY = random.Float(-GRID_JITTER, GRID_JITTER);
+            float jitterZ = random.Float(-GRID_JITTER, GRID_JITTER);
+            glm::vec3 position(x * GRID_SPACING + jitterX, y * GRID_SPACING + jitterY + 0.5f,
+                               z * GRID_SPACING + jitterZ - 3.0f);
+            glm::vec3 color = RandomColor(random);
+            float scale = random.Float(0.01f, 0.05f);
+            boxes[first + i] = MovingBox(random, position, color, scale);
+        }
+    });
+
+    // One special box above the butterfly
+    SceneRandom special(options.seed, SceneRandom::Stream(SceneRandom::LitBoxes, 0));
+    boxes.push_back(MovingBox(special, glm::vec3(0.0f, 1.5f, -3.0f), glm::vec3(1.0f), 0.1f));
+
+    // A stationary light source at the top of the scene
+    boxes.push_back(Box::InstanceData(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(1.0f, 0.9f, 0.5f), 0.5f, true));
+
+    // A few boxes to be illuminated by the light
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            SceneRandom random(options.seed, SceneRandom::Stream(SceneRandom::LitBoxes, 1 + i * 3 + j));
+            glm::vec3 color = RandomColor(random);
+            boxes.push_back(MovingBox(random, glm::vec3((i - 1) * 2.0f, 0.5f, (j - 1) * 2.0f - 5.0f), color,
+                                      0.2f + (i + j) * 0.1f));
+        }
+    }
+}
+
+SceneRandom ButterflyRandom(const SceneOptions& options, size_t index) {
+    return SceneRandom(options.seed, SceneRandom::Stream(SceneRandom::Butterflies, index));
+}
+
+uint64_t HashSceneBoxes(const std::vector<Box::InstanceData>& boxes) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const Box::InstanceData& box : boxes) {
+        HashBytes(hash, &box.position[0], sizeof(float) * 3);
+        HashBytes(hash, &box.velocity[0], sizeof(float) * 3);
+        HashBytes(hash, &box.color[0], sizeof(float) * 3);
+        HashBytes(hash, &box.scale, sizeof(float));
+        HashBytes(hash, &box.rotationSpeed, sizeof(float));
+        HashBytes(hash, &box.isLightSource, sizeof(bool));
+    }
+    return hash;
+}
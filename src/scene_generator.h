@@ -0,0 +1,38 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "box.h"
+#include "scene_random.h"
+
+// What to generate; the defaults reproduce the original scene layout
+struct SceneOptions {
+    uint64_t seed = 1;
+    int gridX = 5, gridY = 5, gridZ = 5;    // Cells of the box grid, 2 units apart
+    size_t boxCount = 0;                    // Grid boxes; 0 puts one in every cell
+    size_t butterflyCount = 1;
+    float fixedStep = 0.0f;                 // Simulated seconds per frame; 0 uses the frame time
+    bool gpuSimulation = false;             // Move the boxes with transform feedback (Box::setGpuSimulation)
+};
+
+// Read --seed N, --boxes N, --grid XxYxZ, --butterflies N,
+// --fixed-step SECONDS and --gpu-boxes. Returns false, after printing the
+// usage, on --help or a bad option.
+bool ParseSceneOptions(int argc, char** argv, SceneOptions& options);
+
+// Boxes of the scene: the jittered grid (the center cell left free for the
+// butterfly), the box above the butterfly, the light source and the boxes
+// around it. Every box draws from its own SceneRandom stream, so the grid
+// is generated in parallel and the result depends only on the options.
+void GenerateSceneBoxes(const SceneOptions& options, std::vector<Box::InstanceData>& boxes);
+
+// Random stream of butterfly i
+SceneRandom ButterflyRandom(const SceneOptions& options, size_t index);
+
+// FNV-1a over the generated boxes, printed so runs can be checked to replay
+// the same scene
+uint64_t HashSceneBoxes(const std::vector<Box::InstanceData>& boxes);
+
+#endif // SCENE_GENERATOR_H
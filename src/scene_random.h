@@ -0,0 +1,46 @@
+#ifndef SCENE_RANDOM_H
+#define SCENE_RANDOM_H
+
+#include <cstdint>
+
+// Counter-based random numbers: value n of a stream is a hash of (seed,
+// stream, n), so every entity gets its own stream, entities can be
+// generated in any order or in parallel, and a seed gives bit-identical
+// scenes on every platform (no std:: distributions, whose output differs
+// between standard libraries).
+class SceneRandom {
+public:
+    // Stream kinds, combined with an entity index by Stream()
+    enum Kind : uint64_t {
+        Boxes = 1,
+        LitBoxes = 2,
+        Butterflies = 3
+    };
+
+    static uint64_t Stream(Kind kind, uint64_t index) { return (static_cast<uint64_t>(kind) << 40) ^ index; }
+
+    SceneRandom() : key(Mix(0)), counter(0) {}
+    SceneRandom(uint64_t seed, uint64_t stream) : key(Mix(seed ^ Mix(stream))), counter(0) {}
+
+    // SplitMix64 over the counter
+    uint64_t Next() { return Mix(key + GOLDEN * counter++); }
+    // Uniform in [0, 1), from the top 24 bits so every value is exact
+    float Float() { return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f); }
+    // Uniform in [min, max)
+    float Float(float min, float max) { return min + (max - min) * Float(); }
+
+private:
+    static const uint64_t GOLDEN = 0x9E3779B97F4A7C15ull;
+
+    static uint64_t Mix(uint64_t z) {
+        z += GOLDEN;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t key;
+    uint64_t counter;
+};
+
+#endif // SCENE_RANDOM_H
@@ -44,7 +44,18 @@ public:
         }
     }
 
-    Shader(const char* vertexPath, const char* fragmentPath) {
+    // Insert preprocessor lines (e.g. "#define ALPHA_TEST\n") after the #version
+    // line, to build variants of one source file
+    static void injectDefines(std::string& code, const std::string& defines) {
+        if (defines.empty()) {
+            return;
+        }
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        code.insert(lineEnd == std::string::npos ? 0 : lineEnd + 1, defines);
+    }
+
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "") {
         // 1. Retrieve shader source code from file
         std::string vertexCode;
         std::string fragmentCode;
@@ -71,6 +82,8 @@ public:
             // Convert stream into string
             vertexCode = vShaderStream.str();
             fragmentCode = fShaderStream.str();
+            injectDefines(vertexCode, defines);
+            injectDefines(fragmentCode, defines);
             
             std::cout << "Successfully loaded shader files:\n" << vertexPath << "\n" << fragmentPath << std::endl;
             
@@ -10,6 +10,7 @@ ShaderPtr ourShader;
 ShaderPtr skyboxShader;
 ShaderPtr lightShader;
 ShaderPtr butterflyShader;
+ShaderPtr butterflyAlphaTestShader;
 ShaderPtr textShader;
 
 // Map of shader names to shader pointers
@@ -44,6 +45,14 @@ void initShaders() {
             (shaderPath + "butterfly.frag").c_str()
         );
         
+        // Variant that can discard fragments, only used where a material or
+        // LOD cross-fade needs it so the plain one keeps early depth testing
+        butterflyAlphaTestShader = std::make_shared<Shader>(
+            (shaderPath + "butterfly.vert").c_str(),
+            (shaderPath + "butterfly.frag").c_str(),
+            "#define ALPHA_TEST\n"
+        );
+        
         // Initialize text shader
         textShader = std::make_shared<Shader>(
             (shaderPath + "text.vert").c_str(),
@@ -55,6 +64,7 @@ void initShaders() {
         shaderCache["skybox"] = skyboxShader;
         shaderCache["light"] = lightShader;
         shaderCache["butterfly"] = butterflyShader;
+        shaderCache["butterflyAlphaTest"] = butterflyAlphaTestShader;
         shaderCache["text"] = textShader;  // Make sure text shader is in cache
         
         // Cache all shaders
@@ -78,6 +88,7 @@ void cleanupShaders()
     skyboxShader.reset();
     lightShader.reset();
     butterflyShader.reset();
+    butterflyAlphaTestShader.reset();
     textShader.reset();
     shaderCache.clear();
     
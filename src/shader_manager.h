@@ -15,6 +15,7 @@ extern ShaderPtr ourShader;
 extern ShaderPtr skyboxShader;
 extern ShaderPtr lightShader;
 extern ShaderPtr butterflyShader;
+extern ShaderPtr butterflyAlphaTestShader;   // butterfly.frag with ALPHA_TEST (discards)
 extern ShaderPtr textShader;
 
 // Function to initialize all shaders
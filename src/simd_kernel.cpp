@@ -0,0 +1,45 @@
+#include "simd_kernel.h"
+
+bool IsSimdKernelSupported(SimdKernel kernel) {
+    switch (kernel) {
+    case SimdKernel::Scalar:
+        return true;
+    case SimdKernel::SSE2:
+#ifdef SIMD_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case SimdKernel::AVX2:
+#if defined(SIMD_AVX2) && defined(__AVX2__)
+        return true;
+#elif defined(SIMD_AVX2)
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+SimdKernel BestSimdKernel() {
+    if (IsSimdKernelSupported(SimdKernel::AVX2)) {
+        return SimdKernel::AVX2;
+    }
+    if (IsSimdKernelSupported(SimdKernel::SSE2)) {
+        return SimdKernel::SSE2;
+    }
+    return SimdKernel::Scalar;
+}
+
+const char* SimdKernelName(SimdKernel kernel) {
+    switch (kernel) {
+    case SimdKernel::SSE2:
+        return "SSE2";
+    case SimdKernel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef SIMD_KERNEL_H
+#define SIMD_KERNEL_H
+
+// Instruction sets the vectorized kernels (box_update.h, frustum_cull.h)
+// come in, and which of them this build and CPU can run.
+//
+// SSE2 is part of every x86-64 target. AVX2 is compiled per function and
+// only used when the CPU reports it, so the build needs no -mavx2: kernel
+// sources include this header, guard their vector code with SIMD_SSE2 and
+// SIMD_AVX2, and mark AVX2 functions with SIMD_AVX2_TARGET.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+#if defined(SIMD_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(__AVX2__))
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SIMD_AVX2_TARGET
+#endif
+#endif
+
+enum class SimdKernel {
+    Scalar,
+    SSE2,   // 4 floats per step
+    AVX2    // 8 floats per step
+};
+
+// Whether this build and CPU can run a kernel; Scalar always can
+bool IsSimdKernelSupported(SimdKernel kernel);
+// The widest supported kernel
+SimdKernel BestSimdKernel();
+const char* SimdKernelName(SimdKernel kernel);
+
+#endif // SIMD_KERNEL_H
@@ -2,6 +2,9 @@
 #include "shader.h"
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include "texture_loader.h"
+#include "texture_compress.h"
 
 // Include OpenGL headers
 #include "glad/gl.h"
@@ -93,7 +96,7 @@ Skybox::Skybox(const std::vector<std::string>& faces, Shader& shader)
     if (cubemapTexture == 0) {
         std::cerr << "Failed to load cubemap textures" << std::endl;
     } else {
-        std::cout << "Successfully loaded cubemap texture with ID: " << cubemapTexture << std::endl;
+        std::cout << "Created cubemap texture with ID: " << cubemapTexture << " (faces decoding)" << std::endl;
     }
 }
 
@@ -110,6 +113,11 @@ void Skybox::Draw(glm::mat4 view, glm::mat4 projection) {
         return;
     }
     
+    // Faces still decoding; the clear colour shows until they are in
+    if (!UploadReadyFaces()) {
+        return;
+    }
+    
     // Save current depth function state
     GLint oldDepthFunc;
     glGetIntegerv(GL_DEPTH_FUNC, &oldDepthFunc);
@@ -159,11 +167,6 @@ void Skybox::Draw(glm::mat4 view, glm::mat4 projection) {
     }
 }
 
-// STB image wrapper
-#include "stb_image_wrapper.h"
-
-// STB image implementation is now in stb_image_wrapper.h
-
 
 unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
     unsigned int textureID = 0;
@@ -192,55 +195,74 @@ unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
         return 0;
     }
     
-    // Load each face of the cubemap
-    bool allFacesLoaded = true;
-    int width = 0, height = 0, nrChannels = 0;
+    // Unbind the texture
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     
+    // Decode all faces in parallel; UploadReadyFaces uploads them as they finish
+    faceDecodes.clear();
     for (unsigned int i = 0; i < faces.size(); i++) {
         std::cout << "Loading cubemap texture: " << faces[i] << std::endl;
+        faceDecodes.push_back(DecodeImageAsync(faces[i], ImageLoadOptions(false, false, true))); // No flip for cubemaps; faces must share one format
+    }
+    facesUploaded = 0;
+    allFacesLoaded = true;
+    
+    return textureID;
+}
+
+bool Skybox::UploadReadyFaces() {
+    if (facesUploaded == faceDecodes.size()) {
+        return true;
+    }
+    
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    while (facesUploaded < faceDecodes.size()) {
+        // Faces complete in any order but are uploaded in order; never wait
+        std::future<DecodedTexture>& decode = faceDecodes[facesUploaded];
+        if (decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            break;
+        }
+        unsigned int i = static_cast<unsigned int>(facesUploaded++);
+        DecodedTexture face = decode.get();
         
-        // Load image data
-        stbi_set_flip_vertically_on_load(false); // Important for cubemaps
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        
-        if (data) {
-            std::cout << "  Success! Dimensions: " << width << "x" << height 
-                      << ", Channels: " << nrChannels << std::endl;
+        if (face.IsValid()) {
+            std::cout << "  Success! " << face.path << " dimensions: " << face.width << "x" << face.height 
+                      << ", Channels: " << face.channels << std::endl;
             
-            // Determine the format
-            GLenum format = GL_RGB;
-            if (nrChannels == 1) {
-                format = GL_RED;
-            } else if (nrChannels == 3) {
-                format = GL_RGB;
-            } else if (nrChannels == 4) {
-                format = GL_RGBA;
+            if (face.compressed) {
+                // Faces are decoded opaque, so all six are BC1
+                const CompressedLevel& level = face.compressed->levels[0];
+                TextureStreamer::Instance().UploadCompressed(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, CompressedTextureFormat(*face.compressed),
+                    level.width, level.height, level.data.data(), level.data.size());
+                RecordTextureMemory(level.data.size(), UncompressedTextureBytes(face.width, face.height, false));
+            } else {
+                // Determine the format
+                GLenum format = TextureFormat(face.channels);
+                
+                // Upload the texture data
+                TextureStreamer::Instance().Upload(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
+                    0,                  // mipmap level
+                    format,             // internal format
+                    face.width, face.height,
+                    format,             // format
+                    face.pixels.get(),  // pixel data
+                    face.ByteSize()
+                );
+                RecordTextureMemory(UncompressedTextureBytes(face.width, face.height, false),
+                                    UncompressedTextureBytes(face.width, face.height, false));
             }
             
-            // Upload the texture data
-            glTexImage2D(
-                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                0,                  // mipmap level
-                format,             // internal format
-                width, height,      // dimensions
-                0,                  // border (must be 0)
-                format,             // format
-                GL_UNSIGNED_BYTE,   // type
-                data                // pixel data
-            );
-            
             // Check for errors after uploading texture data
-            err = glGetError();
+            GLenum err = glGetError();
             if (err != GL_NO_ERROR) {
                 std::cerr << "  OpenGL error uploading texture data for face " << i 
                           << ": " << err << std::endl;
                 allFacesLoaded = false;
             }
-            
-            // Free the loaded image data
-            stbi_image_free(data);
         } else {
-            std::cerr << "  Cubemap texture failed to load at path: " << faces[i] << std::endl;
+            std::cerr << "  Cubemap texture failed to load at path: " << face.path << std::endl;
             allFacesLoaded = false;
             
             // Fall back to a solid color if loading fails
@@ -255,14 +277,17 @@ unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
             );
         }
     }
-    
-    // Unbind the texture
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     
+    if (facesUploaded < faceDecodes.size()) {
+        return false;
+    }
+    
     // Check if all faces loaded successfully
     if (!allFacesLoaded) {
         std::cerr << "Warning: Not all cubemap faces loaded successfully" << std::endl;
     }
-    
-    return textureID;
+    faceDecodes.clear();
+    facesUploaded = 0;
+    return true;
 }
@@ -3,11 +3,13 @@
 
 #include <vector>
 #include <string>
+#include <future>
 
 // Include OpenGL headers
 #include "glad/gl.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "texture_loader.h"
 
 // Forward declaration of Shader class
 class Shader;
@@ -19,9 +21,16 @@ public:
     
     void Draw(glm::mat4 view, glm::mat4 projection);
     
+    // Upload the faces whose decoding has finished (Draw does this too).
+    // Returns true once all faces are in the cube map.
+    bool UploadReadyFaces();
+    
 private:
     unsigned int VAO, VBO;
     unsigned int cubemapTexture;
+    std::vector<std::future<DecodedTexture>> faceDecodes;  // Running on TextureDecodePool
+    size_t facesUploaded = 0;
+    bool allFacesLoaded = true;
     Shader& shader;
     
     unsigned int loadCubemap(const std::vector<std::string>& faces);
@@ -0,0 +1,80 @@
+#include "slot_map.h"
+
+SlotHandle SlotMap::Insert() {
+    uint32_t slot = freeHead;
+    if (slot == NONE) {
+        slot = static_cast<uint32_t>(slots.size());
+        Slot fresh = {0, 0};
+        slots.push_back(fresh);
+    } else {
+        freeHead = slots[slot].index;
+    }
+    slots[slot].index = static_cast<uint32_t>(denseSlots.size());
+    denseSlots.push_back(slot);
+    return SlotHandle(slot, slots[slot].generation);
+}
+
+bool SlotMap::Remove(SlotHandle handle, size_t& index, size_t& last) {
+    if (!Find(handle, index)) {
+        return false;
+    }
+    last = denseSlots.size() - 1;
+    uint32_t moved = denseSlots[last];
+    denseSlots[index] = moved;
+    slots[moved].index = static_cast<uint32_t>(index);
+    denseSlots.pop_back();
+    Release(handle.slot);
+    return true;
+}
+
+bool SlotMap::Find(SlotHandle handle, size_t& index) const {
+    if (handle.slot >= slots.size()) {
+        return false;
+    }
+    const Slot& slot = slots[handle.slot];
+    // A free slot's generation has not been handed out yet, so only a live
+    // element's handle can match
+    if (slot.generation != handle.generation) {
+        return false;
+    }
+    index = slot.index;
+    return true;
+}
+
+bool SlotMap::Contains(SlotHandle handle) const {
+    size_t index = 0;
+    return Find(handle, index);
+}
+
+SlotHandle SlotMap::HandleAt(size_t index) const {
+    uint32_t slot = denseSlots[index];
+    return SlotHandle(slot, slots[slot].generation);
+}
+
+void SlotMap::Clear() {
+    for (uint32_t slot : denseSlots) {
+        slots[slot].generation++;
+    }
+    denseSlots.clear();
+    freeHead = NONE;
+    for (size_t i = slots.size(); i-- > 0;) {
+        if (slots[i].generation != RETIRED) {
+            slots[i].index = freeHead;
+            freeHead = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+void SlotMap::Release(uint32_t slot) {
+    // A new generation, so no handle to the removed element matches the
+    // slot's next one. Wrapping around would revive the oldest handles, so
+    // a slot that reaches the last generation is never reused.
+    Slot& freed = slots[slot];
+    freed.generation++;
+    if (freed.generation == RETIRED) {
+        freed.index = NONE;
+        return;
+    }
+    freed.index = freeHead;
+    freeHead = slot;
+}
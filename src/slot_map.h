@@ -0,0 +1,67 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Refers to one element of a SlotMap for as long as it lives, wherever the
+// element moves; once it is removed the handle stops matching, even after
+// its slot is reused
+struct SlotHandle {
+    uint32_t slot;
+    uint32_t generation;
+
+    SlotHandle() : slot(0xFFFFFFFFu), generation(0) {}
+    SlotHandle(uint32_t slot, uint32_t generation) : slot(slot), generation(generation) {}
+    bool operator==(const SlotHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Generational slot map over elements the caller stores densely (e.g. as a
+// structure of arrays): handles go through a slot holding the element's
+// current index and a generation that changes when it is removed. Insert
+// appends, Remove swaps the last element into the hole, so the storage
+// stays contiguous and every operation is O(1). A slot whose generation
+// runs out is retired rather than wrapping back to a generation an old
+// handle may still hold.
+class SlotMap {
+public:
+    SlotMap() : freeHead(NONE) {}
+
+    // A new element, stored by the caller at index Size() - 1
+    SlotHandle Insert();
+    // Remove an element. The caller then moves its element at `last` to
+    // `index` (unless they are equal) and drops the last one. Returns false,
+    // changing nothing, if the handle is stale.
+    bool Remove(SlotHandle handle, size_t& index, size_t& last);
+    // Index of a live element; false if the handle is stale
+    bool Find(SlotHandle handle, size_t& index) const;
+    bool Contains(SlotHandle handle) const;
+    SlotHandle HandleAt(size_t index) const;
+    size_t Size() const { return denseSlots.size(); }
+    // Remove every element; all handles go stale
+    void Clear();
+
+private:
+    friend class SlotMapTest;   // Ages slots to test retirement
+
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    // Generation of a retired slot, never handed out
+    static const uint32_t RETIRED = 0xFFFFFFFFu;
+
+    struct Slot {
+        uint32_t index;         // The element's index, or the next free slot
+        uint32_t generation;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> denseSlots;   // Slot of each element, in storage order
+    uint32_t freeHead;
+
+    // Bump a removed element's generation and free its slot, unless that
+    // used up the slot's last generation
+    void Release(uint32_t slot);
+};
+
+#endif // SLOT_MAP_H
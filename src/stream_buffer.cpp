@@ -0,0 +1,276 @@
+#include "stream_buffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// GL 4.4 / ARB_buffer_storage
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace {
+    typedef void (GLAD_API_PTR* BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    BufferStorageProc bufferStorage = nullptr;
+    bool persistentEnabled = false;
+
+    const GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    // Region sizes are rounded up to this, so every region starts aligned
+    const size_t REGION_ALIGNMENT = 256;
+
+    // The buffers EndFrame moves on
+    std::vector<StreamBuffer*>& LiveBuffers() {
+        static std::vector<StreamBuffer*> buffers;
+        return buffers;
+    }
+
+    size_t RoundUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool DetectPersistentMapping(GLADloadfunc load) {
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 4);
+    if (!supported) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count && !supported; ++i) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            supported = name && std::strcmp(name, "GL_ARB_buffer_storage") == 0;
+        }
+    }
+    if (!supported) {
+        return false;
+    }
+    bufferStorage = reinterpret_cast<BufferStorageProc>(load("glBufferStorage"));
+    return bufferStorage != nullptr;
+}
+
+void SetPersistentMapping(bool enabled) {
+    persistentEnabled = enabled && bufferStorage != nullptr;
+}
+
+bool IsPersistentMappingEnabled() {
+    return persistentEnabled;
+}
+
+StreamBuffer::StreamBuffer()
+    : buffer(0), regionSize(0), persistent(false), mapped(nullptr), mappedRange(false),
+      region(0), head(0), acquired(false), written(false) {
+    for (size_t i = 0; i < REGION_COUNT; ++i) {
+        fences[i] = nullptr;
+    }
+    LiveBuffers().push_back(this);
+}
+
+StreamBuffer::~StreamBuffer() {
+    // GL objects are left to Destroy; the context may already be gone here
+    std::vector<StreamBuffer*>& buffers = LiveBuffers();
+    buffers.erase(std::remove(buffers.begin(), buffers.end(), this), buffers.end());
+}
+
+void StreamBuffer::Create(size_t size) {
+    Destroy();
+    AllocateStorage(size);
+}
+
+void StreamBuffer::Destroy() {
+    ReleaseStorage();
+    region = 0;
+    head = 0;
+    acquired = false;
+    written = false;
+}
+
+void StreamBuffer::AllocateStorage(size_t size) {
+    regionSize = RoundUp(std::max<size_t>(size, 1), REGION_ALIGNMENT);
+    size_t totalSize = regionSize * REGION_COUNT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    persistent = persistentEnabled;
+    if (persistent) {
+        bufferStorage(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(totalSize), nullptr, PERSISTENT_FLAGS);
+        mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(totalSize),
+                                                     PERSISTENT_FLAGS));
+        if (!mapped) {
+            // Immutable storage cannot be respecified; start over with a mutable buffer
+            std::cerr << "StreamBuffer: persistent mapping failed, using unsynchronized maps" << std::endl;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(totalSize), nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::ReleaseStorage() {
+    for (size_t i = 0; i < REGION_COUNT; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = nullptr;
+        }
+    }
+    if (buffer != 0) {
+        // Deleting a buffer unmaps it
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    mapped = nullptr;
+    mappedRange = false;
+}
+
+void StreamBuffer::AcquireRegion() {
+    acquired = true;
+    GLsync& fence = fences[region];
+    if (!fence) {
+        return;
+    }
+    if (glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        glDeleteSync(fence);
+        fence = nullptr;
+        return;
+    }
+
+    if (persistent) {
+        // The GPU is REGION_COUNT frames behind; nothing to do but wait
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.stalls++;
+        glDeleteSync(fence);
+        fence = nullptr;
+        return;
+    }
+
+    // Orphan: draws still reading keep the old storage, and the new storage
+    // has no readers, so every fence is moot
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(regionSize * REGION_COUNT), nullptr, GL_STREAM_DRAW);
+    stats.orphans++;
+    for (size_t i = 0; i < REGION_COUNT; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = nullptr;
+        }
+    }
+}
+
+void* StreamBuffer::Allocate(size_t bytes, size_t alignment, size_t& offset) {
+    if (buffer == 0) {
+        AllocateStorage(bytes);
+    }
+    if (!acquired) {
+        AcquireRegion();
+    }
+    if (alignment == 0) {
+        alignment = 1;
+    }
+
+    size_t regionStart = region * regionSize;
+    size_t start = RoundUp(regionStart + head, alignment);
+    if (start + bytes > regionStart + regionSize) {
+        // Outgrown: earlier draws keep the old buffer alive until they finish
+        size_t size = std::max(regionSize * 2, RoundUp(bytes, alignment));
+        ReleaseStorage();
+        AllocateStorage(size);
+        stats.reallocations++;
+        region = 0;
+        head = 0;
+        acquired = true;
+        start = 0;
+    }
+
+    offset = start;
+    head = start + bytes - region * regionSize;
+    written = true;
+    stats.allocations++;
+    stats.bytesWritten += bytes;
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (persistent) {
+        return mapped + offset;
+    }
+    // Unsynchronized: the range belongs to this frame, so no draw reads it
+    void* data = glMapBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes),
+                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (!data) {
+        std::cerr << "StreamBuffer: mapping " << bytes << " bytes failed" << std::endl;
+    }
+    mappedRange = data != nullptr;
+    return data;
+}
+
+void StreamBuffer::Commit() {
+    if (!mappedRange) {
+        return; // Persistent and coherent
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+        std::cerr << "StreamBuffer: buffer contents were lost" << std::endl;
+    }
+    mappedRange = false;
+}
+
+void StreamBuffer::NextRegion() {
+    if (!written) {
+        return; // Nothing drawn from it, so the region is still free
+    }
+    if (fences[region]) {
+        glDeleteSync(fences[region]);
+    }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % REGION_COUNT;
+    head = 0;
+    acquired = false;
+    written = false;
+    stats.frames++;
+}
+
+void StreamBuffer::EndFrame() {
+    for (StreamBuffer* buffer : LiveBuffers()) {
+        if (buffer->IsCreated()) {
+            buffer->NextRegion();
+        }
+    }
+}
+
+StreamBufferStats StreamBuffer::TotalStats() {
+    StreamBufferStats total;
+    for (const StreamBuffer* buffer : LiveBuffers()) {
+        const StreamBufferStats& stats = buffer->stats;
+        total.frames = std::max(total.frames, stats.frames);
+        total.allocations += stats.allocations;
+        total.bytesWritten += stats.bytesWritten;
+        total.stalls += stats.stalls;
+        total.stallMs += stats.stallMs;
+        total.orphans += stats.orphans;
+        total.reallocations += stats.reallocations;
+    }
+    return total;
+}
+
+void StreamBuffer::PrintStats() {
+    StreamBufferStats total = TotalStats();
+    if (total.frames == 0) {
+        return;
+    }
+    std::cout << "Stream buffers (" << (persistentEnabled ? "persistent" : "unsynchronized maps") << "): "
+              << std::fixed << std::setprecision(1) << (total.bytesWritten / 1024.0 / total.frames) << " KB/frame in "
+              << (static_cast<double>(total.allocations) / total.frames) << " writes, " << total.stalls
+              << " stalls (" << std::setprecision(2) << total.stallMs << " ms), " << total.orphans << " orphans, "
+              << total.reallocations << " reallocations over " << total.frames << " frames" << std::endl;
+}
@@ -0,0 +1,102 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/gl.h>
+#include <cstddef>
+
+// Load glBufferStorage (GL 4.4 or ARB_buffer_storage, which the GL 3.3
+// loader does not cover) through the window system's loader. Call after
+// gladLoadGL; returns whether persistent mapping is available.
+bool DetectPersistentMapping(GLADloadfunc load);
+// Whether stream buffers created from now on map persistently
+void SetPersistentMapping(bool enabled);
+bool IsPersistentMappingEnabled();
+
+// How often streaming had to synchronize with the GPU. In a healthy frame
+// loop stalls and orphans stay at zero.
+struct StreamBufferStats {
+    size_t frames;
+    size_t allocations;
+    size_t bytesWritten;
+    size_t stalls;          // Waits for a region the GPU was still reading (persistent)
+    double stallMs;
+    size_t orphans;         // Storage replaced instead of waiting (fallback)
+    size_t reallocations;   // The buffer grew
+
+    StreamBufferStats()
+        : frames(0), allocations(0), bytesWritten(0), stalls(0), stallMs(0.0), orphans(0), reallocations(0) {}
+};
+
+// A vertex buffer for data rewritten every frame, split into one region per
+// frame in flight. Each frame writes into its own region, and a fence
+// placed at the end of the frame tells when the GPU is done with it, so
+// writing never waits for draws of earlier frames unless the GPU is more
+// than REGION_COUNT - 1 frames behind.
+//
+// With persistent mapping the buffer stays mapped and coherent and
+// Allocate returns a pointer into it. Otherwise each allocation maps its
+// range unsynchronized, and a region still in use is not waited for: the
+// buffer is orphaned and the driver hands out fresh storage.
+//
+//   size_t offset;
+//   void* data = stream.Allocate(bytes, stride, offset);
+//   ... write bytes to data ...
+//   stream.Commit();
+//   ... point attributes at stream.Buffer() + offset and draw ...
+//   StreamBuffer::EndFrame();    // once per frame, before swapping
+class StreamBuffer {
+public:
+    static const size_t REGION_COUNT = 3;
+
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Allocate the buffer with regionSize bytes per frame; needs a context
+    void Create(size_t regionSize);
+    // Delete the buffer and fences; call while the GL context still exists
+    void Destroy();
+    bool IsCreated() const { return buffer != 0; }
+
+    // Reserve bytes in this frame's region at a multiple of alignment. The
+    // buffer is left bound to GL_ARRAY_BUFFER and offset is where the bytes
+    // start in it. A region too small for the frame makes the buffer grow,
+    // so draw from one allocation before making the next.
+    void* Allocate(size_t bytes, size_t alignment, size_t& offset);
+    // Make the written bytes visible to GL (unmaps in the fallback)
+    void Commit();
+
+    // Fence the regions written this frame and move every stream buffer to
+    // its next region
+    static void EndFrame();
+    // Stats of all stream buffers together
+    static StreamBufferStats TotalStats();
+    static void PrintStats();
+
+    GLuint Buffer() const { return buffer; }
+    bool IsPersistent() const { return persistent; }
+    const StreamBufferStats& GetStats() const { return stats; }
+
+private:
+    void AllocateStorage(size_t size);
+    void ReleaseStorage();
+    // Make the current region safe to write: wait for its fence, or orphan
+    void AcquireRegion();
+    void NextRegion();
+
+    GLuint buffer;
+    size_t regionSize;
+    bool persistent;
+    char* mapped;               // The whole buffer, when persistent
+    bool mappedRange;           // A fallback range is mapped until Commit
+    GLsync fences[REGION_COUNT];
+    size_t region;
+    size_t head;                // Next free byte of the region
+    bool acquired;              // The region was made safe this frame
+    bool written;
+    StreamBufferStats stats;
+};
+
+#endif // STREAM_BUFFER_H
@@ -1,12 +1,20 @@
 #include "text_renderer.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include <cstring>
 #include <iostream>
+#include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 #include "shader_manager.h"
 
+// Vertices of one glyph quad: two triangles of (x, y, u, v)
+const size_t GLYPH_VERTICES = 6;
+const size_t GLYPH_VERTEX_SIZE = 4 * sizeof(float);
+// Room for this many glyphs per frame before the stream buffer grows
+const size_t GLYPHS_PER_FRAME = 256;
+
 TextRenderer::TextRenderer(unsigned int width, unsigned int height) 
-    : Width(width), Height(height) {
+    : Width(width), Height(height), VAO(0) {
     // Load text shader
     this->TextShader = GetShader("text");
     if (!this->TextShader) {
@@ -25,14 +33,37 @@ TextRenderer::TextRenderer(unsigned int width, unsigned int height)
         return;
     }
     
-    // Configure VAO/VBO for texture quads
+    setupBuffers();
+}
+
+TextRenderer::~TextRenderer() {
+    releaseGlyphs();
+    if (this->VAO != 0) {
+        glDeleteVertexArrays(1, &this->VAO);
+        this->VAO = 0;
+    }
+    this->vertexStream.Destroy();
+}
+
+void TextRenderer::releaseGlyphs() {
+    for (const auto& glyph : this->Characters) {
+        glDeleteTextures(1, &glyph.second.TextureID);
+    }
+    this->Characters.clear();
+}
+
+void TextRenderer::setupBuffers() {
+    if (this->VAO != 0) {
+        return;
+    }
+    
+    // Configure VAO and stream buffer for texture quads
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &this->VBO);
+    this->vertexStream.Create(GLYPHS_PER_FRAME * GLYPH_VERTICES * GLYPH_VERTEX_SIZE);
     glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexStream.Buffer());
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, GLYPH_VERTEX_SIZE, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
@@ -41,7 +72,7 @@ bool TextRenderer::Load(std::string font, unsigned int fontSize) {
     std::cout << "Attempting to load font: " << font << " at size: " << fontSize << std::endl;
     
     // First clear the previously loaded Characters
-    this->Characters.clear();
+    releaseGlyphs();
     
     // Initialize and load the FreeType library
     FT_Library ft;    
@@ -113,16 +144,7 @@ bool TextRenderer::Load(std::string font, unsigned int fontSize) {
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
     
-    // Configure VAO/VBO for texture quads
-    glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &this->VBO);
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    setupBuffers();
     
     return true;
 }
@@ -154,8 +176,19 @@ void TextRenderer::RenderText(std::string text, float x, float y, float scale, g
     this->TextShader->setVec3("textColor", color);
     this->TextShader->setInt("text", 0);
     
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+    if (text.empty()) {
+        return;
+    }
+    
+    // Write every glyph's quad into this frame's region first, then draw
+    size_t offset = 0;
+    float (*quads)[GLYPH_VERTICES][4] = static_cast<float (*)[GLYPH_VERTICES][4]>(
+        this->vertexStream.Allocate(text.size() * GLYPH_VERTICES * GLYPH_VERTEX_SIZE, GLYPH_VERTEX_SIZE, offset));
+    if (!quads) {
+        return;
+    }
+    std::vector<unsigned int> textures;
+    textures.reserve(text.size());
     
     // Iterate through all characters
     std::string::const_iterator c;
@@ -168,8 +201,8 @@ void TextRenderer::RenderText(std::string text, float x, float y, float scale, g
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
         
-        // Update VBO for each character
-        float vertices[6][4] = {
+        // Quad of this character
+        float vertices[GLYPH_VERTICES][4] = {
             { xpos,     ypos + h, 0.0f, 0.0f },            
             { xpos,     ypos,     0.0f, 1.0f },
             { xpos + w, ypos,     1.0f, 1.0f },
@@ -178,21 +211,26 @@ void TextRenderer::RenderText(std::string text, float x, float y, float scale, g
             { xpos + w, ypos,     1.0f, 1.0f },
             { xpos + w, ypos + h, 1.0f, 0.0f }           
         };
-        
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        
-        // Update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        
-        // Render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        std::memcpy(quads[textures.size()], vertices, sizeof(vertices));
+        textures.push_back(ch.TextureID);
         
         // Advance cursors for next glyph (advance is 1/64 pixels)
         x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64)
     }
+    this->vertexStream.Commit();
+    
+    // The buffer may have been reallocated, so point the VAO at it again
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->vertexStream.Buffer());
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, GLYPH_VERTEX_SIZE, (void*)offset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Render each glyph texture over its quad
+    for (size_t i = 0; i < textures.size(); ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glDrawArrays(GL_TRIANGLES, static_cast<GLint>(i * GLYPH_VERTICES), GLYPH_VERTICES);
+    }
     
     // Clean up
     glBindVertexArray(0);
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glad/gl.h>
 #include "shader.h"
+#include "stream_buffer.h"
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
@@ -26,6 +27,11 @@ public:
     std::shared_ptr<Shader> TextShader;
     // Constructor
     TextRenderer(unsigned int width, unsigned int height);
+    // Releases the glyph textures, VAO and stream buffer; destroy while the
+    // GL context still exists
+    ~TextRenderer();
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
     // Pre-compiles a list of characters from the given font
     // Returns true if the font was loaded successfully, false otherwise
     bool Load(std::string font, unsigned int fontSize);
@@ -37,7 +43,12 @@ public:
     
 private:
     // Render state
-    unsigned int VAO, VBO;
+    unsigned int VAO;
+    // Glyph quads of every RenderText call, written in place each frame
+    StreamBuffer vertexStream;
+    
+    void setupBuffers();
+    void releaseGlyphs();
 };
 
 #endif
@@ -0,0 +1,146 @@
+#include "texture_array.h"
+#include <iostream>
+#include "load_timeline.h"
+#include "texture_compress.h"
+
+TextureArraySet::~TextureArraySet() {
+    for (const ArrayInfo& array : arrays) {
+        glDeleteTextures(1, &array.id);
+    }
+}
+
+void TextureArraySet::Allocate(const std::vector<DecodedTexture>& decoded) {
+    images = decoded;
+    layers.assign(images.size(), TextureLayer());
+    nextImage = 0;
+
+    // Images can only share an array when size, format and mip count match
+    for (size_t i = 0; i < images.size(); ++i) {
+        const DecodedTexture& image = images[i];
+        if (!image.IsValid()) {
+            continue;
+        }
+        ArrayInfo info;
+        info.width = image.width;
+        info.height = image.height;
+        if (image.compressed) {
+            info.internalFormat = CompressedTextureFormat(*image.compressed);
+            info.levels = image.compressed->levels.size();
+        } else {
+            info.internalFormat = GL_RGBA8;
+        }
+
+        size_t a = 0;
+        while (a < arrays.size() && !(arrays[a].internalFormat == info.internalFormat &&
+                                      arrays[a].width == info.width && arrays[a].height == info.height &&
+                                      arrays[a].levels == info.levels)) {
+            ++a;
+        }
+        if (a == arrays.size()) {
+            if (arrays.size() == MAX_ARRAYS) {
+                std::cerr << "WARNING: More than " << MAX_ARRAYS << " texture sizes/formats in one model, "
+                          << "dropping " << image.path << " (" << image.width << "x" << image.height << ")" << std::endl;
+                continue;
+            }
+            arrays.push_back(info);
+        }
+        layers[i].array = static_cast<int>(a);
+        layers[i].layer = arrays[a].layers++;
+    }
+
+    for (ArrayInfo& array : arrays) {
+        glGenTextures(1, &array.id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+        if (array.internalFormat == GL_RGBA8) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, array.layers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        } else {
+            BlockFormat format = array.internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? BlockFormat::BC3
+                                                                                          : BlockFormat::BC1;
+            int width = array.width;
+            int height = array.height;
+            for (size_t level = 0; level < array.levels; ++level) {
+                GLsizei bytes = static_cast<GLsizei>(CompressedLevelBytes(format, width, height) * array.layers);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), array.internalFormat,
+                                       width, height, array.layers, 0, bytes, nullptr);
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(array.levels) - 1);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        std::cout << "Texture array " << array.id << ": " << array.layers << " layers of "
+                  << array.width << "x" << array.height
+                  << (array.internalFormat == GL_RGBA8 ? " RGBA8" : " S3TC") << std::endl;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    SkipMissing();
+}
+
+bool TextureArraySet::UploadNext() {
+    if (IsComplete()) {
+        return false;
+    }
+
+    size_t index = nextImage++;
+    const DecodedTexture& image = images[index];
+    const TextureLayer& location = layers[index];
+    const ArrayInfo& array = arrays[location.array];
+    LoadTimelineScope timeline("upload layer " + image.path.substr(image.path.find_last_of("/\\") + 1));
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+    if (image.compressed) {
+        const CompressedTexture& compressed = *image.compressed;
+        for (size_t level = 0; level < compressed.levels.size(); ++level) {
+            const CompressedLevel& data = compressed.levels[level];
+            TextureStreamer::Instance().UploadCompressedLayer(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level),
+                                                              location.layer, array.internalFormat,
+                                                              data.width, data.height,
+                                                              data.data.data(), data.data.size());
+        }
+        RecordTextureMemory(compressed.ByteSize(), UncompressedTextureBytes(image.width, image.height, true));
+    } else {
+        TextureStreamer::Instance().UploadLayer(GL_TEXTURE_2D_ARRAY, 0, location.layer, image.width, image.height,
+                                                GL_RGBA, image.pixels.get(), image.ByteSize());
+        size_t bytes = UncompressedTextureBytes(image.width, image.height, true);
+        RecordTextureMemory(bytes, bytes);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Free the pixels as soon as they are on the GPU
+    images[index] = DecodedTexture();
+    SkipMissing();
+    return true;
+}
+
+void TextureArraySet::SkipMissing() {
+    while (nextImage < images.size() && layers[nextImage].array < 0) {
+        nextImage++;
+    }
+    if (IsComplete()) {
+        Finish();
+    }
+}
+
+void TextureArraySet::Finish() {
+    for (const ArrayInfo& array : arrays) {
+        if (array.internalFormat == GL_RGBA8) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    images.clear();
+    images.shrink_to_fit();
+}
+
+void TextureArraySet::Bind(GLuint firstUnit) const {
+    for (size_t i = 0; i < MAX_ARRAYS; ++i) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + static_cast<GLuint>(i));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, i < arrays.size() ? arrays[i].id : 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
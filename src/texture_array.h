@@ -0,0 +1,70 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "texture_loader.h"
+
+// Where an image of a TextureArraySet ended up
+struct TextureLayer {
+    int array;      // Index into the set's arrays, -1 if the image is missing
+    int layer;
+
+    TextureLayer() : array(-1), layer(0) {}
+};
+
+// A model's material images packed into GL_TEXTURE_2D_ARRAYs, one array per
+// size and format, so every material samples from the same few textures and
+// a draw binds them once instead of once per mesh. Layers are uploaded one at
+// a time so loading can spread over frames. Render thread only; the arrays
+// are deleted with the set.
+class TextureArraySet {
+public:
+    // Texture units the material shader samples arrays from (0..MAX_ARRAYS-1)
+    static const size_t MAX_ARRAYS = 4;
+
+    TextureArraySet() = default;
+    ~TextureArraySet();
+
+    TextureArraySet(const TextureArraySet&) = delete;
+    TextureArraySet& operator=(const TextureArraySet&) = delete;
+
+    // Group the images and create storage for every array. Invalid images
+    // get no layer. Uncompressed images must be RGBA8.
+    void Allocate(const std::vector<DecodedTexture>& images);
+
+    // Upload the next layer; returns false if all were already in. Mipmaps
+    // of uncompressed arrays are generated after the last one.
+    bool UploadNext();
+    bool IsComplete() const { return nextImage >= images.size(); }
+
+    // Bind array i to texture unit firstUnit + i for all MAX_ARRAYS units
+    void Bind(GLuint firstUnit) const;
+
+    size_t ImageCount() const { return layers.size(); }
+    const TextureLayer& GetLayer(size_t image) const { return layers[image]; }
+    size_t ArrayCount() const { return arrays.size(); }
+
+private:
+    struct ArrayInfo {
+        GLuint id = 0;
+        GLenum internalFormat = 0;  // GL_RGBA8 or an S3TC format
+        int width = 0;
+        int height = 0;
+        size_t levels = 1;          // Stored levels; uncompressed arrays generate the rest
+        int layers = 0;
+    };
+
+    // Move past images without a layer; generate mipmaps once all are in
+    void SkipMissing();
+    void Finish();
+
+    std::vector<ArrayInfo> arrays;
+    std::vector<TextureLayer> layers;
+    std::vector<DecodedTexture> images;     // Kept until uploaded
+    size_t nextImage = 0;
+};
+
+#endif // TEXTURE_ARRAY_H
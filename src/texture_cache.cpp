@@ -0,0 +1,218 @@
+#include "texture_cache.h"
+#include <sys/stat.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include "checksum.h"
+#include "mapped_file.h"
+
+namespace {
+    const char TEXTURE_CACHE_MAGIC[8] = {'B', 'C', 'T', 'E', 'X', '\0', '\0', '\0'};
+    const uint32_t TEXTURE_CACHE_FORMAT = 1;
+    // Largest supported level count (a 65536 texel edge)
+    const uint32_t MAX_LEVELS = 17;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t encoderVersion;
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint32_t optionFlags;
+        uint32_t blockFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t reserved;
+        uint64_t payloadSize;   // Bytes following the header
+        uint64_t checksum;      // Of the payload
+    };
+
+    struct LevelRecord {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;        // From the start of the file
+        uint64_t size;
+    };
+
+    static_assert(sizeof(FileHeader) == 72, "Unexpected texture cache header layout");
+    static_assert(sizeof(LevelRecord) == 24, "Unexpected texture cache level layout");
+}
+
+bool MakeTextureCacheKey(const std::string& sourcePath, uint32_t encoderVersion,
+                         uint32_t optionFlags, TextureCacheKey& key) {
+    struct stat st;
+    if (stat(sourcePath.c_str(), &st) != 0) {
+        return false;
+    }
+    key.sourceSize = static_cast<uint64_t>(st.st_size);
+    key.sourceMtime = static_cast<int64_t>(st.st_mtime);
+    key.encoderVersion = encoderVersion;
+    key.optionFlags = optionFlags;
+    return true;
+}
+
+std::string TextureCachePath(const std::string& sourcePath) {
+    return sourcePath + ".btex";
+}
+
+void SerializeTextureCache(const TextureCacheKey& key, const CompressedTexture& texture, std::vector<char>& out) {
+    std::vector<LevelRecord> records(texture.levels.size());
+    uint64_t offset = sizeof(FileHeader) + records.size() * sizeof(LevelRecord);
+    for (size_t i = 0; i < texture.levels.size(); ++i) {
+        records[i].width = static_cast<uint32_t>(texture.levels[i].width);
+        records[i].height = static_cast<uint32_t>(texture.levels[i].height);
+        records[i].offset = offset;
+        records[i].size = texture.levels[i].data.size();
+        offset += records[i].size;
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.formatVersion = TEXTURE_CACHE_FORMAT;
+    header.encoderVersion = key.encoderVersion;
+    header.sourceSize = key.sourceSize;
+    header.sourceMtime = key.sourceMtime;
+    header.optionFlags = key.optionFlags;
+    header.blockFormat = static_cast<uint32_t>(texture.format);
+    header.width = static_cast<uint32_t>(texture.width);
+    header.height = static_cast<uint32_t>(texture.height);
+    header.levelCount = static_cast<uint32_t>(texture.levels.size());
+    header.payloadSize = offset - sizeof(FileHeader);
+
+    Checksum checksum;
+    checksum.Update(records.data(), records.size() * sizeof(LevelRecord));
+    for (const CompressedLevel& level : texture.levels) {
+        checksum.Update(level.data.data(), level.data.size());
+    }
+    header.checksum = checksum.Finish();
+
+    out.clear();
+    out.reserve(static_cast<size_t>(offset));
+    const char* headerBytes = reinterpret_cast<const char*>(&header);
+    out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+    const char* recordBytes = reinterpret_cast<const char*>(records.data());
+    out.insert(out.end(), recordBytes, recordBytes + records.size() * sizeof(LevelRecord));
+    for (const CompressedLevel& level : texture.levels) {
+        out.insert(out.end(), level.data.begin(), level.data.end());
+    }
+}
+
+bool StampTextureCacheSource(const TextureCacheKey& key, std::vector<char>& bytes) {
+    // Outside the checksummed payload, so the rest stays valid
+    if (bytes.size() < sizeof(FileHeader)) {
+        return false;
+    }
+    std::memcpy(bytes.data() + offsetof(FileHeader, sourceSize), &key.sourceSize, sizeof(key.sourceSize));
+    std::memcpy(bytes.data() + offsetof(FileHeader, sourceMtime), &key.sourceMtime, sizeof(key.sourceMtime));
+    return true;
+}
+
+bool WriteTextureCache(const std::string& cachePath, const TextureCacheKey& key,
+                       const CompressedTexture& texture) {
+    std::vector<char> bytes;
+    SerializeTextureCache(key, texture, bytes);
+
+    // Textures are compressed on several threads; keep their temporaries apart
+    std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to create texture cache: " << tempPath << std::endl;
+        return false;
+    }
+    out.write(bytes.data(), bytes.size());
+    out.close();
+
+    if (!out) {
+        std::cerr << "Failed to write texture cache: " << tempPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Failed to move texture cache into place: " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ReadTextureCache(const std::string& cachePath, const TextureCacheKey& expectedKey,
+                      CompressedTexture& texture) {
+    struct stat st;
+    if (stat(cachePath.c_str(), &st) != 0) {
+        return false; // No cache yet
+    }
+    MappedFile file;
+    if (!file.Open(cachePath)) {
+        return false;
+    }
+    return ParseTextureCache(file.Data(), file.Size(), cachePath, expectedKey, true, texture);
+}
+
+bool ParseTextureCache(const char* base, size_t size, const std::string& cachePath,
+                       const TextureCacheKey& expectedKey, bool checkSource, CompressedTexture& texture) {
+    FileHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Texture cache is truncated: " << cachePath << std::endl;
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.formatVersion != TEXTURE_CACHE_FORMAT) {
+        std::cerr << "Texture cache has an unknown format: " << cachePath << std::endl;
+        return false;
+    }
+    if (header.encoderVersion != expectedKey.encoderVersion ||
+        (checkSource && (header.sourceSize != expectedKey.sourceSize ||
+                         header.sourceMtime != expectedKey.sourceMtime)) ||
+        header.optionFlags != expectedKey.optionFlags) {
+        std::cout << "Texture cache is stale: " << cachePath << std::endl;
+        return false;
+    }
+    if (header.payloadSize != size - sizeof(header)) {
+        std::cerr << "Texture cache size mismatch: " << cachePath << std::endl;
+        return false;
+    }
+
+    Checksum checksum;
+    checksum.Update(base + sizeof(header), header.payloadSize);
+    if (checksum.Finish() != header.checksum) {
+        std::cerr << "Texture cache checksum mismatch: " << cachePath << std::endl;
+        return false;
+    }
+
+    BlockFormat format = static_cast<BlockFormat>(header.blockFormat);
+    if ((format != BlockFormat::BC1 && format != BlockFormat::BC3) ||
+        header.levelCount == 0 || header.levelCount > MAX_LEVELS ||
+        header.levelCount * sizeof(LevelRecord) > header.payloadSize) {
+        std::cerr << "Texture cache header is invalid: " << cachePath << std::endl;
+        return false;
+    }
+
+    texture.format = format;
+    texture.width = static_cast<int>(header.width);
+    texture.height = static_cast<int>(header.height);
+    texture.levels.resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        LevelRecord record;
+        std::memcpy(&record, base + sizeof(header) + i * sizeof(LevelRecord), sizeof(record));
+        bool valid = record.offset <= size && record.size <= size - record.offset &&
+                     record.size == CompressedLevelBytes(format, record.width, record.height);
+        if (!valid) {
+            std::cerr << "Texture cache level " << i << " is out of bounds: " << cachePath << std::endl;
+            texture.levels.clear();
+            return false;
+        }
+        CompressedLevel& level = texture.levels[i];
+        level.width = static_cast<int>(record.width);
+        level.height = static_cast<int>(record.height);
+        level.data.assign(base + record.offset, base + record.offset + record.size);
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "texture_compress.h"
+
+// Identifies the source image and encoder settings a .btex file was built
+// from; the cache is only used when every field matches
+struct TextureCacheKey {
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint32_t encoderVersion;   // Bumped whenever the encoder's output changes
+    uint32_t optionFlags;      // Flip, mipmaps, ... (chosen by the caller)
+
+    TextureCacheKey() : sourceSize(0), sourceMtime(0), encoderVersion(0), optionFlags(0) {}
+};
+
+// Build the key for a source file; returns false if the file cannot be stat'ed
+bool MakeTextureCacheKey(const std::string& sourcePath, uint32_t encoderVersion,
+                         uint32_t optionFlags, TextureCacheKey& key);
+
+// Cache file that sits next to the source image
+std::string TextureCachePath(const std::string& sourcePath);
+
+// The bytes of a .btex file (also stored as-is in asset bundles)
+void SerializeTextureCache(const TextureCacheKey& key, const CompressedTexture& texture, std::vector<char>& out);
+// Replace the source size and time recorded in .btex bytes with the key's.
+// Returns false if the bytes are too short to hold a header.
+bool StampTextureCacheSource(const TextureCacheKey& key, std::vector<char>& bytes);
+
+// Write a compressed texture and its mip chain. Written to a temporary file
+// and renamed, so concurrent readers never see a partial cache.
+bool WriteTextureCache(const std::string& cachePath, const TextureCacheKey& key,
+                       const CompressedTexture& texture);
+
+// Read and validate a cache; fails on a key mismatch, truncation or corruption
+bool ReadTextureCache(const std::string& cachePath, const TextureCacheKey& expectedKey,
+                      CompressedTexture& texture);
+
+// Validate and copy out .btex bytes held in memory. Without checkSource the
+// source size and time are ignored (an asset bundle entry whose source image
+// is not there to stat).
+bool ParseTextureCache(const char* data, size_t size, const std::string& name,
+                       const TextureCacheKey& expectedKey, bool checkSource, CompressedTexture& texture);
+
+#endif // TEXTURE_CACHE_H
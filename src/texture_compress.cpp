@@ -0,0 +1,431 @@
+#include "texture_compress.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include "thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESS_SSE2 1
+#endif
+
+namespace {
+    // Smallest number of block rows worth handing to a worker
+    const int MIN_ROWS_PER_TASK = 4;
+
+    struct SrgbTables {
+        float toLinear[256];
+        unsigned char fromLinear[4096];     // Indexed by linear value * 4095
+
+        SrgbTables() {
+            for (int i = 0; i < 256; ++i) {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; ++i) {
+                float l = i / 4095.0f;
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<unsigned char>(std::min(255.0f, c * 255.0f + 0.5f));
+            }
+        }
+    };
+
+    const SrgbTables& Srgb() {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    int Clamp255(int value) {
+        return value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+
+    uint16_t To565(const int* rgb) {
+        int r = (rgb[0] * 31 + 127) / 255;
+        int g = (rgb[1] * 63 + 127) / 255;
+        int b = (rgb[2] * 31 + 127) / 255;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void From565(uint16_t color, int* rgb) {
+        int r = color >> 11;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Nearest of the four palette steps along the endpoint line for each pixel,
+    // as 0 (endpoint 0) to 3 (endpoint 1). Integer arithmetic so the SIMD and
+    // scalar paths produce the same blocks.
+    void ProjectPixels(const unsigned char* block, const int* origin, const int* axis, int* steps) {
+        int axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+#ifdef TEXTURE_COMPRESS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i originWords = _mm_setr_epi16(
+            static_cast<short>(origin[0]), static_cast<short>(origin[1]), static_cast<short>(origin[2]), 0,
+            static_cast<short>(origin[0]), static_cast<short>(origin[1]), static_cast<short>(origin[2]), 0);
+        const __m128i axisWords = _mm_setr_epi16(
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), 0,
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), 0);
+        const __m128i threshold1 = _mm_set1_epi32(axisLength - 1);
+        const __m128i threshold3 = _mm_set1_epi32(3 * axisLength - 1);
+        const __m128i threshold5 = _mm_set1_epi32(5 * axisLength - 1);
+
+        for (int i = 0; i < 16; i += 4) {
+            // Four RGBA pixels: widen to 16 bits, subtract the origin and
+            // multiply-add with the axis to get (r*dr + g*dg, b*db) pairs
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4));
+            __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), originWords);
+            __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), originWords);
+            __m128 lowSums = _mm_castsi128_ps(_mm_madd_epi16(low, axisWords));
+            __m128 highSums = _mm_castsi128_ps(_mm_madd_epi16(high, axisWords));
+            __m128i dots = _mm_add_epi32(
+                _mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(3, 1, 3, 1))));
+
+            // step = (6 dot >= len) + (6 dot >= 3 len) + (6 dot >= 5 len)
+            __m128i scaled = _mm_add_epi32(_mm_slli_epi32(dots, 2), _mm_slli_epi32(dots, 1));
+            __m128i count = _mm_add_epi32(_mm_add_epi32(_mm_cmpgt_epi32(scaled, threshold1),
+                                                        _mm_cmpgt_epi32(scaled, threshold3)),
+                                          _mm_cmpgt_epi32(scaled, threshold5));
+            int lanes[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_sub_epi32(zero, count));
+            steps[i + 0] = lanes[0];
+            steps[i + 1] = lanes[1];
+            steps[i + 2] = lanes[2];
+            steps[i + 3] = lanes[3];
+        }
+#else
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p = block + i * 4;
+            int dot = (p[0] - origin[0]) * axis[0] + (p[1] - origin[1]) * axis[1] + (p[2] - origin[2]) * axis[2];
+            int scaled = 6 * dot;
+            steps[i] = (scaled >= axisLength) + (scaled >= 3 * axisLength) + (scaled >= 5 * axisLength);
+        }
+#endif
+    }
+
+    // Encode the block with the given endpoints and return the squared error
+    int EncodeColorEndpoints(const unsigned char* block, const int* end0, const int* end1, unsigned char* out) {
+        static const unsigned STEP_TO_INDEX[4] = {0, 2, 3, 1};
+
+        uint16_t color0 = To565(end0);
+        uint16_t color1 = To565(end1);
+        // Four-colour mode needs color0 > color1
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        int palette[4][3];
+        From565(color0, palette[0]);
+        From565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            int axis[3] = {palette[1][0] - palette[0][0], palette[1][1] - palette[0][1], palette[1][2] - palette[0][2]};
+            int steps[16];
+            ProjectPixels(block, palette[0], axis, steps);
+            for (int i = 0; i < 16; ++i) {
+                indices |= STEP_TO_INDEX[steps[i]] << (2 * i);
+            }
+        }
+
+        int error = 0;
+        for (int i = 0; i < 16; ++i) {
+            const int* chosen = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 3; ++c) {
+                int d = block[i * 4 + c] - chosen[c];
+                error += d * d;
+            }
+        }
+
+        out[0] = static_cast<unsigned char>(color0 & 0xFF);
+        out[1] = static_cast<unsigned char>(color0 >> 8);
+        out[2] = static_cast<unsigned char>(color1 & 0xFF);
+        out[3] = static_cast<unsigned char>(color1 >> 8);
+        for (int i = 0; i < 4; ++i) {
+            out[4 + i] = static_cast<unsigned char>((indices >> (8 * i)) & 0xFF);
+        }
+        return error;
+    }
+
+    // Least-squares endpoints for the palette assignment in an encoded block
+    // (weights 1, 0, 2/3, 1/3 of endpoint 0 per index). Returns false if the
+    // assignment does not determine them.
+    bool RefineEndpoints(const unsigned char* block, const unsigned char* encoded, int* end0, int* end1) {
+        static const int WEIGHT[4] = {3, 0, 2, 1};   // Thirds of endpoint 0
+        uint32_t indices = encoded[4] | (encoded[5] << 8) | (encoded[6] << 16) | (static_cast<uint32_t>(encoded[7]) << 24);
+
+        long long aa = 0, bb = 0, ab = 0;
+        long long ax[3] = {0, 0, 0};
+        long long bx[3] = {0, 0, 0};
+        for (int i = 0; i < 16; ++i) {
+            int a = WEIGHT[(indices >> (2 * i)) & 3];
+            int b = 3 - a;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            for (int c = 0; c < 3; ++c) {
+                ax[c] += a * block[i * 4 + c];
+                bx[c] += b * block[i * 4 + c];
+            }
+        }
+        long long determinant = aa * bb - ab * ab;
+        if (determinant == 0) {
+            return false;
+        }
+        for (int c = 0; c < 3; ++c) {
+            end0[c] = Clamp255(static_cast<int>((3 * (ax[c] * bb - bx[c] * ab)) / determinant));
+            end1[c] = Clamp255(static_cast<int>((3 * (bx[c] * aa - ax[c] * ab)) / determinant));
+        }
+        return true;
+    }
+
+    void CompressColorBlock(const unsigned char* block, unsigned char* out) {
+        // Bounding box of the block's colours, inset by 1/16 of its size
+        int low[3] = {255, 255, 255};
+        int high[3] = {0, 0, 0};
+        int sum[3] = {0, 0, 0};
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                low[c] = std::min(low[c], static_cast<int>(block[i * 4 + c]));
+                high[c] = std::max(high[c], static_cast<int>(block[i * 4 + c]));
+                sum[c] += block[i * 4 + c];
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            int inset = (high[c] - low[c]) >> 4;
+            low[c] += inset;
+            high[c] -= inset;
+        }
+
+        // Pick the box diagonal that follows the colour distribution: flip
+        // green and blue where they fall as red rises
+        int covarianceG = 0;
+        int covarianceB = 0;
+        for (int i = 0; i < 16; ++i) {
+            int r = block[i * 4 + 0] * 16 - sum[0];
+            covarianceG += r * (block[i * 4 + 1] * 16 - sum[1]) / 256;
+            covarianceB += r * (block[i * 4 + 2] * 16 - sum[2]) / 256;
+        }
+        if (covarianceG < 0) std::swap(low[1], high[1]);
+        if (covarianceB < 0) std::swap(low[2], high[2]);
+
+        int error = EncodeColorEndpoints(block, high, low, out);
+        if (error == 0) {
+            return;
+        }
+
+        // One least-squares pass usually lowers the error noticeably
+        int refined0[3];
+        int refined1[3];
+        if (RefineEndpoints(block, out, refined0, refined1)) {
+            unsigned char candidate[8];
+            if (EncodeColorEndpoints(block, refined0, refined1, candidate) < error) {
+                std::memcpy(out, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    void CompressAlphaBlock(const unsigned char* block, unsigned char* out) {
+        int low = 255;
+        int high = 0;
+        for (int i = 0; i < 16; ++i) {
+            low = std::min(low, static_cast<int>(block[i * 4 + 3]));
+            high = std::max(high, static_cast<int>(block[i * 4 + 3]));
+        }
+
+        // Eight-value mode: alpha0 = high, alpha1 = low, codes 2-7 step from
+        // high towards low
+        uint64_t codes = 0;
+        if (high != low) {
+            int range = high - low;
+            for (int i = 0; i < 16; ++i) {
+                int t = ((block[i * 4 + 3] - low) * 7 + range / 2) / range;
+                uint64_t code = t == 7 ? 0 : (t == 0 ? 1 : 8 - t);
+                codes |= code << (3 * i);
+            }
+        }
+
+        out[0] = static_cast<unsigned char>(high);
+        out[1] = static_cast<unsigned char>(low);
+        for (int i = 0; i < 6; ++i) {
+            out[2 + i] = static_cast<unsigned char>((codes >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // Compress block rows [firstRow, lastRow) of one level
+    void CompressRows(const unsigned char* rgba, int width, int height, BlockFormat format,
+                      int firstRow, int lastRow, unsigned char* out) {
+        int blocksX = (width + 3) / 4;
+        size_t blockBytes = BlockBytes(format);
+        unsigned char block[64];
+
+        for (int by = firstRow; by < lastRow; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                // Edge blocks repeat the last row/column
+                for (int y = 0; y < 4; ++y) {
+                    int sy = std::min(by * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x) {
+                        int sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+                unsigned char* target = out + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+                if (format == BlockFormat::BC3) {
+                    CompressBlockBC3(block, target);
+                } else {
+                    CompressBlockBC1(block, target);
+                }
+            }
+        }
+    }
+
+    void CompressLevel(const unsigned char* rgba, int width, int height, BlockFormat format,
+                       ThreadPool* pool, CompressedLevel& level) {
+        level.width = width;
+        level.height = height;
+        level.data.resize(CompressedLevelBytes(format, width, height));
+
+        int blocksY = (height + 3) / 4;
+        unsigned workers = pool ? pool->Size() : 1;
+        if (workers <= 1 || blocksY < 2 * MIN_ROWS_PER_TASK) {
+            CompressRows(rgba, width, height, format, 0, blocksY, level.data.data());
+            return;
+        }
+
+        // A few tasks per worker so uneven blocks balance out
+        int rowsPerTask = std::max(MIN_ROWS_PER_TASK, static_cast<int>(blocksY / (workers * 4)));
+        std::vector<std::future<void>> tasks;
+        unsigned char* out = level.data.data();
+        for (int row = 0; row < blocksY; row += rowsPerTask) {
+            int last = std::min(blocksY, row + rowsPerTask);
+            tasks.push_back(pool->Submit([=]() {
+                CompressRows(rgba, width, height, format, row, last, out);
+            }));
+        }
+        for (std::future<void>& task : tasks) {
+            task.get();
+        }
+    }
+}
+
+size_t BlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC3 ? 16 : 8;
+}
+
+size_t CompressedLevelBytes(BlockFormat format, int width, int height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+size_t CompressedTexture::ByteSize() const {
+    size_t bytes = 0;
+    for (const CompressedLevel& level : levels) {
+        bytes += level.data.size();
+    }
+    return bytes;
+}
+
+std::vector<unsigned char> ExpandToRGBA(const unsigned char* pixels, int width, int height, int channels) {
+    size_t count = static_cast<size_t>(width) * height;
+    std::vector<unsigned char> rgba(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* p = pixels + i * channels;
+        unsigned char* q = rgba.data() + i * 4;
+        if (channels >= 3) {
+            q[0] = p[0];
+            q[1] = p[1];
+            q[2] = p[2];
+        } else {
+            // GL_RED textures sample as (r, 0, 0)
+            q[0] = p[0];
+            q[1] = 0;
+            q[2] = 0;
+        }
+        q[3] = channels == 4 ? p[3] : 255;
+    }
+    return rgba;
+}
+
+std::vector<unsigned char> DownsampleRGBA(const unsigned char* rgba, int width, int height,
+                                          int& outWidth, int& outHeight) {
+    const SrgbTables& srgb = Srgb();
+    outWidth = std::max(1, width / 2);
+    outHeight = std::max(1, height / 2);
+    std::vector<unsigned char> result(static_cast<size_t>(outWidth) * outHeight * 4);
+
+    for (int y = 0; y < outHeight; ++y) {
+        int y0 = std::min(2 * y, height - 1);
+        int y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < outWidth; ++x) {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            const unsigned char* samples[4] = {
+                rgba + (static_cast<size_t>(y0) * width + x0) * 4,
+                rgba + (static_cast<size_t>(y0) * width + x1) * 4,
+                rgba + (static_cast<size_t>(y1) * width + x0) * 4,
+                rgba + (static_cast<size_t>(y1) * width + x1) * 4
+            };
+            unsigned char* out = result.data() + (static_cast<size_t>(y) * outWidth + x) * 4;
+            for (int c = 0; c < 3; ++c) {
+                float linear = 0.25f * (srgb.toLinear[samples[0][c]] + srgb.toLinear[samples[1][c]] +
+                                        srgb.toLinear[samples[2][c]] + srgb.toLinear[samples[3][c]]);
+                out[c] = srgb.fromLinear[static_cast<int>(linear * 4095.0f + 0.5f)];
+            }
+            out[3] = static_cast<unsigned char>((samples[0][3] + samples[1][3] + samples[2][3] + samples[3][3] + 2) / 4);
+        }
+    }
+    return result;
+}
+
+void CompressBlockBC1(const unsigned char* block, unsigned char* out) {
+    CompressColorBlock(block, out);
+}
+
+void CompressBlockBC3(const unsigned char* block, unsigned char* out) {
+    CompressAlphaBlock(block, out);
+    CompressColorBlock(block, out + 8);
+}
+
+void CompressTexture(const unsigned char* rgba, int width, int height, BlockFormat format,
+                     bool generateMips, ThreadPool* pool, CompressedTexture& result) {
+    result.format = format;
+    result.width = width;
+    result.height = height;
+    result.levels.clear();
+
+    std::vector<unsigned char> mip;
+    const unsigned char* current = rgba;
+    int levelWidth = width;
+    int levelHeight = height;
+    for (;;) {
+        result.levels.push_back(CompressedLevel());
+        CompressLevel(current, levelWidth, levelHeight, format, pool, result.levels.back());
+        if (!generateMips || (levelWidth == 1 && levelHeight == 1)) {
+            break;
+        }
+        int nextWidth;
+        int nextHeight;
+        std::vector<unsigned char> next = DownsampleRGBA(current, levelWidth, levelHeight, nextWidth, nextHeight);
+        mip.swap(next);
+        current = mip.data();
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+}
+
+BlockFormat ChooseBlockFormat(const unsigned char* rgba, int width, int height) {
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; ++i) {
+        if (rgba[i * 4 + 3] != 255) {
+            return BlockFormat::BC3;
+        }
+    }
+    return BlockFormat::BC1;
+}
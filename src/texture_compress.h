@@ -0,0 +1,62 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// S3TC / BCn block formats the encoder produces. Values are stored in the
+// texture cache, so they must not change.
+enum class BlockFormat : uint32_t {
+    BC1 = 1,    // RGB, 8 bytes per 4x4 block (DXT1)
+    BC3 = 3     // RGBA, 16 bytes per block: BC1 colour plus interpolated alpha (DXT5)
+};
+
+size_t BlockBytes(BlockFormat format);
+
+// Bytes of one compressed mip level
+size_t CompressedLevelBytes(BlockFormat format, int width, int height);
+
+struct CompressedLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> data;
+};
+
+// Block-compressed image with its mip chain (level 0 first)
+struct CompressedTexture {
+    BlockFormat format;
+    int width;
+    int height;
+    std::vector<CompressedLevel> levels;
+
+    CompressedTexture() : format(BlockFormat::BC1), width(0), height(0) {}
+    size_t ByteSize() const;
+};
+
+// Expand 1, 3 or 4 channel pixels to RGBA8
+std::vector<unsigned char> ExpandToRGBA(const unsigned char* pixels, int width, int height, int channels);
+
+// Downsample an RGBA8 image to half size (rounded down, at least 1). Colour
+// is averaged in linear light, treating the input as sRGB-encoded, so mips
+// do not darken the way a plain average of encoded values does. Alpha is
+// averaged as is.
+std::vector<unsigned char> DownsampleRGBA(const unsigned char* rgba, int width, int height,
+                                          int& outWidth, int& outHeight);
+
+// Encode one 4x4 block of RGBA8 pixels (row-major, 64 bytes)
+void CompressBlockBC1(const unsigned char* block, unsigned char* out);
+void CompressBlockBC3(const unsigned char* block, unsigned char* out);
+
+// Compress an RGBA8 image, optionally with a full mip chain. Block rows are
+// split across the pool when one is given; the call returns once all are
+// done, so it must not run on a thread of the same pool.
+void CompressTexture(const unsigned char* rgba, int width, int height, BlockFormat format,
+                     bool generateMips, ThreadPool* pool, CompressedTexture& result);
+
+// BC3 if any pixel is not fully opaque, otherwise BC1
+BlockFormat ChooseBlockFormat(const unsigned char* rgba, int width, int height);
+
+#endif // TEXTURE_COMPRESS_H
@@ -0,0 +1,387 @@
+#include "texture_loader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include "asset_bundle.h"
+#include "load_timeline.h"
+#include "texture_cache.h"
+#include "texture_compress.h"
+#include "thread_pool.h"
+
+// STB image wrapper
+#include "stb_image_wrapper.h"
+
+namespace {
+    // Bumped whenever the encoder or mip filter output changes
+    const uint32_t TEXTURE_ENCODER_VERSION = 1;
+    
+    // Cache key option bits
+    const uint32_t TEXTURE_FLAG_FLIPPED = 1u << 0;
+    const uint32_t TEXTURE_FLAG_MIPMAPPED = 1u << 1;
+    const uint32_t TEXTURE_FLAG_OPAQUE = 1u << 2;
+    
+    std::atomic<bool> compressionEnabled(false);
+    TextureMemoryStats memoryStats;
+    
+    std::string FileName(const std::string& path) {
+        return path.substr(path.find_last_of("/\\") + 1);
+    }
+    
+    // Block rows of large textures are encoded here; separate from the decode
+    // pool because decode tasks wait for these
+    ThreadPool& TextureCompressPool() {
+        static ThreadPool pool;
+        return pool;
+    }
+    
+    void SetCompressed(DecodedTexture& texture, const std::shared_ptr<CompressedTexture>& compressed) {
+        texture.width = compressed->width;
+        texture.height = compressed->height;
+        texture.channels = compressed->format == BlockFormat::BC3 ? 4 : 3;
+        texture.compressed = compressed;
+    }
+    
+    void CompressPixels(const unsigned char* data, int width, int height, int channels, const std::string& path,
+                        const ImageLoadOptions& options, ThreadPool* pool, CompressedTexture& texture) {
+        LoadTimelineScope timeline("compress " + FileName(path));
+        std::vector<unsigned char> rgba = ExpandToRGBA(data, width, height, channels);
+        BlockFormat format = options.opaque ? BlockFormat::BC1 : ChooseBlockFormat(rgba.data(), width, height);
+        CompressTexture(rgba.data(), width, height, format, options.mipmapped, pool, texture);
+    }
+    
+    // Fill texture.compressed from the asset bundle or the cache, or encode
+    // the image and cache it. Returns false to fall back to uncompressed pixels.
+    bool CompressDecodedImage(DecodedTexture& texture, const ImageLoadOptions& options) {
+        TextureCacheKey key;
+        key.encoderVersion = TextureEncoderVersion();
+        key.optionFlags = TextureCacheFlags(options);
+        std::shared_ptr<CompressedTexture> compressed = std::make_shared<CompressedTexture>();
+        
+        // Prebuilt by assetc and stamped with the image's size and time: one
+        // stat, no file open, catches an image edited since. Without the
+        // image (a shipped bundle) the entry is used as is.
+        bool cacheable = MakeTextureCacheKey(texture.path, key.encoderVersion, key.optionFlags, key);
+        const AssetBundleEntry* bundled = AssetBundle::Instance().Find(AssetKind::Texture, texture.path);
+        if (bundled) {
+            if (ParseTextureCache(bundled->data, bundled->size, texture.path, key, cacheable, *compressed)) {
+                SetCompressed(texture, compressed);
+                return true;
+            }
+            std::cout << "Not using the asset bundle entry for " << texture.path << std::endl;
+        }
+        
+        std::string cachePath = TextureCachePath(texture.path);
+        if (cacheable && ReadTextureCache(cachePath, key, *compressed)) {
+            SetCompressed(texture, compressed);
+            return true;
+        }
+        
+        // Cache miss: decode and encode
+        if (!CompressImage(texture.path, options, &TextureCompressPool(), *compressed)) {
+            return false;
+        }
+        if (cacheable && WriteTextureCache(cachePath, key, *compressed)) {
+            std::cout << "Wrote texture cache: " << cachePath << std::endl;
+        }
+        SetCompressed(texture, compressed);
+        return true;
+    }
+}
+
+uint32_t TextureCacheFlags(const ImageLoadOptions& options) {
+    return (options.flipVertically ? TEXTURE_FLAG_FLIPPED : 0) |
+           (options.mipmapped ? TEXTURE_FLAG_MIPMAPPED : 0) |
+           (options.opaque ? TEXTURE_FLAG_OPAQUE : 0);
+}
+
+uint32_t TextureEncoderVersion() {
+    return TEXTURE_ENCODER_VERSION;
+}
+
+bool CompressImage(const std::string& path, const ImageLoadOptions& options, ThreadPool* pool,
+                   CompressedTexture& texture) {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_set_flip_vertically_on_load_thread(options.flipVertically ? 1 : 0);
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!data) {
+        return false;
+    }
+    
+    CompressPixels(data, width, height, channels, path, options, pool, texture);
+    stbi_image_free(data);
+    return true;
+}
+
+DecodedTexture DecodeImage(const std::string& path, const ImageLoadOptions& options) {
+    LoadTimelineScope timeline("decode " + FileName(path));
+    
+    DecodedTexture texture;
+    texture.path = path;
+    
+    if (IsTextureCompressionEnabled() && CompressDecodedImage(texture, options)) {
+        return texture;
+    }
+    
+    // Flipping and the failure reason are per-thread in stb_image
+    stbi_set_flip_vertically_on_load_thread(options.flipVertically ? 1 : 0);
+    unsigned char* data = stbi_load(path.c_str(), &texture.width, &texture.height, &texture.channels, 0);
+    if (!data) {
+        const char* reason = stbi_failure_reason();
+        texture.error = reason ? reason : "unknown error";
+        return texture;
+    }
+    texture.pixels.reset(data, stbi_image_free);
+    return texture;
+}
+
+DecodedTexture DecodeImageFromMemory(const std::string& name, const unsigned char* bytes, size_t size,
+                                     const ImageLoadOptions& options) {
+    LoadTimelineScope timeline("decode " + FileName(name));
+    
+    DecodedTexture texture;
+    texture.path = name;
+    
+    stbi_set_flip_vertically_on_load_thread(options.flipVertically ? 1 : 0);
+    unsigned char* data = stbi_load_from_memory(bytes, static_cast<int>(size), &texture.width, &texture.height,
+                                                &texture.channels, 0);
+    if (!data) {
+        const char* reason = stbi_failure_reason();
+        texture.error = reason ? reason : "unknown error";
+        return texture;
+    }
+    texture.pixels.reset(data, stbi_image_free);
+    
+    // No file to key a cache on, so the image is encoded every time
+    if (IsTextureCompressionEnabled()) {
+        std::shared_ptr<CompressedTexture> compressed = std::make_shared<CompressedTexture>();
+        CompressPixels(data, texture.width, texture.height, texture.channels, name, options,
+                       &TextureCompressPool(), *compressed);
+        texture.pixels.reset();
+        SetCompressed(texture, compressed);
+    }
+    return texture;
+}
+
+ThreadPool& TextureDecodePool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+std::future<DecodedTexture> DecodeImageAsync(const std::string& path, const ImageLoadOptions& options) {
+    return TextureDecodePool().Submit([path, options]() {
+        return DecodeImage(path, options);
+    });
+}
+
+bool DetectTextureCompressionSupport() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SetTextureCompression(bool enabled) {
+    compressionEnabled = enabled;
+}
+
+bool IsTextureCompressionEnabled() {
+    return compressionEnabled;
+}
+
+GLenum CompressedTextureFormat(const CompressedTexture& texture) {
+    return texture.format == BlockFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+size_t UncompressedTextureBytes(int width, int height, bool mipmapped) {
+    size_t bytes = 0;
+    for (;;) {
+        bytes += static_cast<size_t>(width) * height * 4;
+        if (!mipmapped || (width == 1 && height == 1)) {
+            return bytes;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
+
+void RecordTextureMemory(size_t residentBytes, size_t uncompressedBytes) {
+    memoryStats.textures++;
+    memoryStats.residentBytes += residentBytes;
+    memoryStats.uncompressedBytes += uncompressedBytes;
+}
+
+const TextureMemoryStats& GetTextureMemoryStats() {
+    return memoryStats;
+}
+
+void PrintTextureMemoryReport() {
+    if (memoryStats.textures == 0) {
+        return;
+    }
+    float resident = memoryStats.residentBytes / (1024.0f * 1024.0f);
+    float uncompressed = memoryStats.uncompressedBytes / (1024.0f * 1024.0f);
+    std::cout << "Texture VRAM: " << std::fixed << std::setprecision(2) << resident << " MB in "
+              << memoryStats.textures << " textures (" << (IsTextureCompressionEnabled() ? "BC1/BC3" : "uncompressed")
+              << "), " << uncompressed << " MB as RGBA8";
+    if (memoryStats.uncompressedBytes > 0) {
+        std::cout << " (" << std::setprecision(1)
+                  << (100.0f * (1.0f - static_cast<float>(memoryStats.residentBytes) / memoryStats.uncompressedBytes))
+                  << "% saved)";
+    }
+    std::cout << std::endl;
+    std::cout << "TextureStreamer: " << TextureStreamer::Instance().GetUploadCount() << " uploads, "
+              << TextureStreamer::Instance().GetOrphanCount() << " orphaned buffers, no stalls" << std::endl;
+}
+
+GLenum TextureFormat(int channels) {
+    if (channels == 1) {
+        return GL_RED;
+    } else if (channels == 4) {
+        return GL_RGBA;
+    }
+    return GL_RGB;
+}
+
+TextureStreamer& TextureStreamer::Instance() {
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+TextureStreamer::Slot* TextureStreamer::Stage(const unsigned char* data, size_t rowBytes, size_t stride, int rows) {
+    Slot& slot = slots[nextSlot];
+    nextSlot = (nextSlot + 1) % RING_SIZE;
+    
+    // Never wait for the GPU to finish the last upload from this buffer:
+    // if it has not, orphan the storage. The pending upload keeps the old
+    // storage, which the driver frees once it completes.
+    bool inUse = false;
+    if (slot.fence) {
+        inUse = glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    
+    size_t bufferBytes = stride * rows;
+    if (slot.buffer == 0) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    if (bufferBytes > slot.capacity || inUse) {
+        slot.capacity = std::max(slot.capacity, bufferBytes);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+        if (inUse) {
+            orphanCount++;
+        }
+    }
+    
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferBytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped && stride == rowBytes) {
+        std::memcpy(mapped, data, bufferBytes);
+    } else if (mapped) {
+        unsigned char* destination = static_cast<unsigned char*>(mapped);
+        for (int y = 0; y < rows; ++y) {
+            std::memcpy(destination + y * stride, data + y * rowBytes, rowBytes);
+        }
+    }
+    if (!mapped || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+        // Mapping failed or the contents were lost; the caller uploads from client memory
+        std::cerr << "TextureStreamer: PBO mapping failed, uploading directly" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return nullptr;
+    }
+    return &slot;
+}
+
+void TextureStreamer::Fence(Slot* slot) {
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::Upload(GLenum target, GLint level, GLenum internalFormat, int width, int height,
+                             GLenum format, const unsigned char* pixels, size_t bytes) {
+    LoadTimelineScope timeline("upload " + std::to_string(width) + "x" + std::to_string(height));
+    uploadCount++;
+    
+    // Rows are tightly packed; lay them out at the stride GL will read with
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    size_t rowBytes = height > 0 ? bytes / height : 0;
+    size_t stride = (rowBytes + alignment - 1) / alignment * alignment;
+    
+    Slot* slot = Stage(pixels, rowBytes, stride, height);
+    if (!slot) {
+        glTexImage2D(target, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        return;
+    }
+    glTexImage2D(target, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    Fence(slot);
+}
+
+void TextureStreamer::UploadCompressed(GLenum target, GLint level, GLenum internalFormat, int width, int height,
+                                       const unsigned char* data, size_t bytes) {
+    LoadTimelineScope timeline("upload compressed " + std::to_string(width) + "x" + std::to_string(height));
+    uploadCount++;
+    
+    Slot* slot = Stage(data, bytes, bytes, 1);
+    if (!slot) {
+        glCompressedTexImage2D(target, level, internalFormat, width, height, 0, static_cast<GLsizei>(bytes), data);
+        return;
+    }
+    glCompressedTexImage2D(target, level, internalFormat, width, height, 0, static_cast<GLsizei>(bytes), nullptr);
+    Fence(slot);
+}
+
+void TextureStreamer::UploadLayer(GLenum target, GLint level, int layer, int width, int height,
+                                  GLenum format, const unsigned char* pixels, size_t bytes) {
+    LoadTimelineScope timeline("upload " + std::to_string(width) + "x" + std::to_string(height));
+    uploadCount++;
+    
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    size_t rowBytes = height > 0 ? bytes / height : 0;
+    size_t stride = (rowBytes + alignment - 1) / alignment * alignment;
+    
+    Slot* slot = Stage(pixels, rowBytes, stride, height);
+    glTexSubImage3D(target, level, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, slot ? nullptr : pixels);
+    if (slot) {
+        Fence(slot);
+    }
+}
+
+void TextureStreamer::UploadCompressedLayer(GLenum target, GLint level, int layer, GLenum internalFormat,
+                                            int width, int height, const unsigned char* data, size_t bytes) {
+    LoadTimelineScope timeline("upload compressed " + std::to_string(width) + "x" + std::to_string(height));
+    uploadCount++;
+    
+    Slot* slot = Stage(data, bytes, bytes, 1);
+    glCompressedTexSubImage3D(target, level, 0, 0, layer, width, height, 1, internalFormat,
+                              static_cast<GLsizei>(bytes), slot ? nullptr : data);
+    if (slot) {
+        Fence(slot);
+    }
+}
+
+void TextureStreamer::Release() {
+    for (Slot& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.buffer) {
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        slot = Slot();
+    }
+    if (uploadCount > 0) {
+        std::cout << "TextureStreamer: " << uploadCount << " uploads, " << orphanCount << " orphaned buffers" << std::endl;
+    }
+}
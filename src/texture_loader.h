@@ -0,0 +1,165 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+struct CompressedTexture;
+
+// S3TC formats are an extension; glad here only loads core 3.3
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Pixels decoded from an image file, not yet uploaded
+struct DecodedTexture {
+    std::string path;
+    int width;
+    int height;
+    int channels;
+    std::shared_ptr<unsigned char> pixels;  // Tightly packed rows
+    std::shared_ptr<CompressedTexture> compressed;  // Instead of pixels when compression is on
+    std::string error;                      // stb_image's reason when nothing was loaded
+    
+    DecodedTexture() : width(0), height(0), channels(0) {}
+    bool IsValid() const { return pixels != nullptr || compressed != nullptr; }
+    size_t ByteSize() const { return static_cast<size_t>(width) * height * channels; }
+};
+
+// How an image will be used; part of the compressed cache key
+struct ImageLoadOptions {
+    bool flipVertically;
+    bool mipmapped;     // Compressed images carry a full mip chain
+    bool opaque;        // Always compress without alpha (e.g. cube map faces must share a format)
+    
+    ImageLoadOptions(bool flip = false, bool mips = false, bool opaqueOnly = false)
+        : flipVertically(flip), mipmapped(mips), opaque(opaqueOnly) {}
+};
+
+// Decode an image with stb_image. Safe on any thread. When texture
+// compression is enabled the result is block-compressed instead, read from
+// the open asset bundle, the .btex cache next to the image, or encoded and
+// written to that cache.
+DecodedTexture DecodeImage(const std::string& path, const ImageLoadOptions& options);
+
+// Decode an encoded image held in memory (e.g. embedded in a model file);
+// name only labels it. Compressed when compression is enabled, but never
+// cached or read from the bundle.
+DecodedTexture DecodeImageFromMemory(const std::string& name, const unsigned char* bytes, size_t size,
+                                     const ImageLoadOptions& options);
+
+// Option bits and encoder version compressed images are cached under; a
+// cache or bundle entry is only used when both match
+uint32_t TextureCacheFlags(const ImageLoadOptions& options);
+uint32_t TextureEncoderVersion();
+
+// Decode and block-compress an image the way DecodeImage does, without
+// touching any cache. Block rows are encoded on pool if one is given.
+// Returns false if the image cannot be decoded. Safe on any thread.
+bool CompressImage(const std::string& path, const ImageLoadOptions& options, ThreadPool* pool,
+                   CompressedTexture& texture);
+
+// Workers that decode images, one per core
+ThreadPool& TextureDecodePool();
+
+// Decode on TextureDecodePool
+std::future<DecodedTexture> DecodeImageAsync(const std::string& path, const ImageLoadOptions& options);
+
+// Check for GL_EXT_texture_compression_s3tc (needs a current context)
+bool DetectTextureCompressionSupport();
+
+// Whether DecodeImage produces compressed textures; off until enabled
+void SetTextureCompression(bool enabled);
+bool IsTextureCompressionEnabled();
+
+// GL internal format of a compressed texture
+GLenum CompressedTextureFormat(const CompressedTexture& texture);
+
+// GPU memory taken by textures, and what the same textures would take as
+// RGBA8 (drivers store RGB textures with four bytes per texel)
+struct TextureMemoryStats {
+    size_t textures;
+    size_t residentBytes;
+    size_t uncompressedBytes;
+    
+    TextureMemoryStats() : textures(0), residentBytes(0), uncompressedBytes(0) {}
+};
+
+// Bytes of an RGBA8 texture, with its mip chain if mipmapped
+size_t UncompressedTextureBytes(int width, int height, bool mipmapped);
+
+// Count a created texture in the memory report. Render thread only.
+void RecordTextureMemory(size_t residentBytes, size_t uncompressedBytes);
+const TextureMemoryStats& GetTextureMemoryStats();
+void PrintTextureMemoryReport();
+
+// GL_RED, GL_RGB or GL_RGBA for a channel count (GL_RGB if unsupported)
+GLenum TextureFormat(int channels);
+
+// Streams pixel data to textures through a small ring of pixel buffer
+// objects: the pixels are copied into a mapped PBO and glTexImage2D reads
+// from it, so the driver can return before the transfer has finished. A
+// fence per PBO tells whether the GPU may still read a buffer; if so it is
+// orphaned (fresh storage from glBufferData) instead of waited on, so a
+// burst of uploads (a mip chain, six cube faces) never blocks. Render
+// thread only.
+class TextureStreamer {
+public:
+    static TextureStreamer& Instance();
+    
+    // Upload level `level` of the texture bound to `target` (GL_TEXTURE_2D
+    // or a cube map face) from tightly packed rows of `bytes` in total. For
+    // row sizes that are a multiple of GL_UNPACK_ALIGNMENT the result is the
+    // same as glTexImage2D from client memory.
+    void Upload(GLenum target, GLint level, GLenum internalFormat, int width, int height,
+                GLenum format, const unsigned char* pixels, size_t bytes);
+    
+    // Same for one level of block-compressed data (glCompressedTexImage2D)
+    void UploadCompressed(GLenum target, GLint level, GLenum internalFormat, int width, int height,
+                          const unsigned char* data, size_t bytes);
+    
+    // Same for one layer of a texture array (glTexSubImage3D and
+    // glCompressedTexSubImage3D into storage that already exists)
+    void UploadLayer(GLenum target, GLint level, int layer, int width, int height,
+                     GLenum format, const unsigned char* pixels, size_t bytes);
+    void UploadCompressedLayer(GLenum target, GLint level, int layer, GLenum internalFormat, int width, int height,
+                               const unsigned char* data, size_t bytes);
+    
+    // Delete the PBOs; call while the GL context still exists
+    void Release();
+    
+    size_t GetUploadCount() const { return uploadCount; }
+    size_t GetOrphanCount() const { return orphanCount; }    // PBOs reallocated while still in use
+    
+private:
+    static const size_t RING_SIZE = 3;
+    
+    struct Slot {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+    };
+    
+    TextureStreamer() = default;
+    
+    // Copy rows into the next PBO (bound on return) laid out at `stride`.
+    // Returns the slot, or null if mapping failed and nothing is bound.
+    Slot* Stage(const unsigned char* data, size_t rowBytes, size_t stride, int rows);
+    void Fence(Slot* slot);
+    
+    Slot slots[RING_SIZE];
+    size_t nextSlot = 0;
+    size_t uploadCount = 0;
+    size_t orphanCount = 0;
+};
+
+#endif // TEXTURE_LOADER_H
@@ -0,0 +1,223 @@
+// gltf_loader_test: a small binary glTF goes through GltfFile the way
+// OBJLoader reads it. Writes a quad (float positions and normals, 16-bit
+// indices) as a .glb and checks it is detected as binary by its magic under
+// a mixed-case extension, taken by the zero-copy path with its indices read
+// in place from the BIN chunk, and decoded to the same triangles. The same
+// quad with an index past its last vertex must be refused by both paths,
+// and a PNG stored in a bufferView must reach the material as its bytes and
+// decode from them.
+//
+//   gltf_loader_test
+//
+// Writes gltf_loader_test.Glb in the working directory.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "gltf_loader.h"
+#include "texture_loader.h"
+
+namespace {
+    const float POSITIONS[4][3] = { {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0} };
+    const uint16_t INDICES[6] = { 0, 1, 2, 0, 2, 3 };
+    const uint16_t BAD_INDICES[6] = { 0, 1, 2, 0, 2, 4 };     // One past the last vertex
+    const size_t VERTEX_COUNT = 4;
+    const size_t INDEX_COUNT = 6;
+
+    // Positions and normals share one strided bufferView, the indices follow
+    const char* TEST_JSON =
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}],"
+        "\"buffers\":[{\"byteLength\":108}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":96,\"byteStride\":12,\"target\":34962},"
+        "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":12,\"target\":34963}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\","
+        "\"min\":[0,0,0],\"max\":[1,1,0]},"
+        "{\"bufferView\":0,\"byteOffset\":48,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"}]}";
+
+    // The quad with a material whose base color is a PNG in a bufferView after the indices
+    const char* TEXTURED_JSON =
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"material\":0}]}],"
+        "\"materials\":[{\"name\":\"painted\",\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":0}}}],"
+        "\"textures\":[{\"source\":0}],"
+        "\"images\":[{\"bufferView\":2,\"mimeType\":\"image/png\"}],"
+        "\"buffers\":[{\"byteLength\":178}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":96,\"byteStride\":12,\"target\":34962},"
+        "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":12,\"target\":34963},"
+        "{\"buffer\":0,\"byteOffset\":108,\"byteLength\":70}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\","
+        "\"min\":[0,0,0],\"max\":[1,1,0]},"
+        "{\"bufferView\":0,\"byteOffset\":48,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"}]}";
+
+    // 1x2 RGB: red on top, blue below
+    const unsigned char TEST_PNG[70] = {
+        0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x08, 0x02, 0x00, 0x00, 0x00, 0x16, 0xE3, 0x21,
+        0x70, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0xF8, 0xCF, 0x00, 0x02,
+        0xFF, 0x01, 0x08, 0x00, 0x01, 0xFF, 0xD9, 0x90, 0xBB, 0x35, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+        0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+    };
+
+    void AppendU32(std::vector<unsigned char>& out, uint32_t value) {
+        unsigned char bytes[4];
+        std::memcpy(bytes, &value, sizeof(bytes));
+        out.insert(out.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    void AppendBytes(std::vector<unsigned char>& out, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    // Header, JSON chunk padded with spaces and BIN chunk padded with zeros
+    bool WriteGlb(const std::string& path, const std::string& json, const std::vector<unsigned char>& bin) {
+        std::string paddedJson = json;
+        paddedJson.resize((json.size() + 3) & ~size_t(3), ' ');
+        std::vector<unsigned char> paddedBin = bin;
+        paddedBin.resize((bin.size() + 3) & ~size_t(3), 0);
+
+        std::vector<unsigned char> glb;
+        AppendU32(glb, 0x46546C67);     // "glTF"
+        AppendU32(glb, 2);
+        AppendU32(glb, static_cast<uint32_t>(12 + 8 + paddedJson.size() + 8 + paddedBin.size()));
+        AppendU32(glb, static_cast<uint32_t>(paddedJson.size()));
+        AppendU32(glb, 0x4E4F534A);     // "JSON"
+        AppendBytes(glb, paddedJson.data(), paddedJson.size());
+        AppendU32(glb, static_cast<uint32_t>(paddedBin.size()));
+        AppendU32(glb, 0x004E4942);     // "BIN"
+        AppendBytes(glb, paddedBin.data(), paddedBin.size());
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        return file && std::fwrite(glb.data(), 1, glb.size(), file) == glb.size() && std::fclose(file) == 0;
+    }
+
+    std::vector<unsigned char> QuadBuffer(const uint16_t* indices) {
+        const float normal[3] = { 0, 0, 1 };
+        std::vector<unsigned char> bin;
+        AppendBytes(bin, POSITIONS, sizeof(POSITIONS));
+        for (size_t i = 0; i < VERTEX_COUNT; ++i) {
+            AppendBytes(bin, normal, sizeof(normal));
+        }
+        AppendBytes(bin, indices, INDEX_COUNT * sizeof(uint16_t));
+        return bin;
+    }
+
+    bool Fail(const std::string& name, const std::string& what) {
+        std::cout << name << ": FAILED, " << what << std::endl;
+        return false;
+    }
+
+    bool CheckQuad(const std::string& path) {
+        const std::string name = "quad";
+        if (!WriteGlb(path, TEST_JSON, QuadBuffer(INDICES))) {
+            return Fail(name, "could not write " + path);
+        }
+        GltfFile file;
+        if (!file.Open(path) || !file.IsBinary()) {
+            return Fail(name, "not opened as a binary glTF");
+        }
+        std::vector<GltfPrimitiveRef> primitives = file.ScenePrimitives();
+        if (primitives.size() != 1) {
+            return Fail(name, "expected one primitive");
+        }
+
+        GltfDirectPrimitive direct;
+        if (!file.GetDirectPrimitive(primitives[0], direct)) {
+            return Fail(name, "not taken by the direct path");
+        }
+        if (direct.vertexCount != VERTEX_COUNT || direct.indexCount != INDEX_COUNT ||
+            direct.indexType != GL_UNSIGNED_SHORT || direct.indexBytes != sizeof(INDICES) ||
+            std::memcmp(direct.indexData, INDICES, sizeof(INDICES)) != 0) {
+            return Fail(name, "direct indices differ from the file");
+        }
+        if (direct.boundsMin != glm::vec3(0.0f) || direct.boundsMax != glm::vec3(1.0f, 1.0f, 0.0f)) {
+            return Fail(name, "direct bounds differ from the accessor");
+        }
+
+        GltfDecodedPrimitive decoded;
+        if (!file.DecodePrimitive(primitives[0], decoded) || decoded.positions.size() != VERTEX_COUNT ||
+            decoded.indices.size() != INDEX_COUNT) {
+            return Fail(name, "not decoded");
+        }
+        for (size_t i = 0; i < INDEX_COUNT; ++i) {
+            const float* expected = POSITIONS[INDICES[i]];
+            if (decoded.indices[i] != INDICES[i] ||
+                decoded.positions[decoded.indices[i]] != glm::vec3(expected[0], expected[1], expected[2])) {
+                return Fail(name, "decoded corner " + std::to_string(i) + " differs from the file");
+            }
+        }
+        std::cout << name << ": ok (" << INDEX_COUNT / 3 << " triangles, " << VERTEX_COUNT << " vertices)"
+                  << std::endl;
+        return true;
+    }
+
+    bool CheckIndexRange(const std::string& path) {
+        const std::string name = "out-of-range index";
+        if (!WriteGlb(path, TEST_JSON, QuadBuffer(BAD_INDICES))) {
+            return Fail(name, "could not write " + path);
+        }
+        GltfFile file;
+        if (!file.Open(path)) {
+            return Fail(name, "not opened");
+        }
+        std::vector<GltfPrimitiveRef> primitives = file.ScenePrimitives();
+        GltfDirectPrimitive direct;
+        GltfDecodedPrimitive decoded;
+        if (primitives.size() != 1 || file.GetDirectPrimitive(primitives[0], direct)) {
+            return Fail(name, "taken by the direct path");
+        }
+        if (file.DecodePrimitive(primitives[0], decoded)) {
+            return Fail(name, "decoded");
+        }
+        std::cout << name << ": ok (rejected)" << std::endl;
+        return true;
+    }
+
+    bool CheckEmbeddedImage(const std::string& path) {
+        const std::string name = "embedded image";
+        std::vector<unsigned char> bin = QuadBuffer(INDICES);
+        AppendBytes(bin, TEST_PNG, sizeof(TEST_PNG));
+        if (!WriteGlb(path, TEXTURED_JSON, bin)) {
+            return Fail(name, "could not write " + path);
+        }
+        GltfFile file;
+        if (!file.Open(path)) {
+            return Fail(name, "not opened");
+        }
+        std::vector<GltfMaterial> materials = file.ReadMaterials("");
+        if (materials.size() != 1 || materials[0].diffuseImage.empty() || !materials[0].diffuseImageData) {
+            return Fail(name, "material has no embedded image");
+        }
+        const std::vector<unsigned char>& bytes = *materials[0].diffuseImageData;
+        if (bytes.size() != sizeof(TEST_PNG) || std::memcmp(bytes.data(), TEST_PNG, sizeof(TEST_PNG)) != 0) {
+            return Fail(name, "image bytes differ from the bufferView");
+        }
+
+        // As OBJLoader::DecodeTexture loads it: flipped, so the bottom row comes first
+        DecodedTexture texture = DecodeImageFromMemory(materials[0].diffuseImage, bytes.data(), bytes.size(),
+                                                       ImageLoadOptions(true, true, false));
+        const unsigned char* pixels = texture.pixels.get();
+        if (!pixels || texture.width != 1 || texture.height != 2 || texture.channels != 3 ||
+            pixels[0] != 0 || pixels[2] != 255 || pixels[3] != 255 || pixels[5] != 0) {
+            return Fail(name, "image not decoded from its bytes");
+        }
+        std::cout << name << ": ok (" << bytes.size() << " bytes as " << materials[0].diffuseImage << ")"
+                  << std::endl;
+        return true;
+    }
+}
+
+int main() {
+    std::string path = "gltf_loader_test.Glb";
+    bool ok = CheckQuad(path);
+    ok = CheckIndexRange(path) && ok;
+    ok = CheckEmbeddedImage(path) && ok;
+    std::remove(path.c_str());
+    return ok ? 0 : 1;
+}
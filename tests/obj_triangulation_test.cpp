@@ -0,0 +1,107 @@
+// obj_triangulation_test: polygons in OBJ faces come out as fans from their
+// first corner, with every later triangle still aligned. Loads a quad, a
+// pentagon and a trailing triangle through OBJLoader::BuildOffline with the
+// mapped parser (with and without deduplication) and the legacy parser, and
+// compares each triangle's corner positions with the expected fan.
+//
+//   obj_triangulation_test
+//
+// Writes obj_triangulation_test.obj in the working directory.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "mesh_data.h"
+#include "obj_loader.h"
+
+namespace {
+    const char* TEST_OBJ =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "v 2 0 0\n"
+        "v 3 0 0\n"
+        "v 3.5 1 0\n"
+        "v 2.5 2 0\n"
+        "v 1.5 1 0\n"
+        "vn 0 0 1\n"
+        "f 1//1 2//1 3//1 4//1\n"
+        "f 5//1 6//1 7//1 8//1 9//1\n"
+        "f 1//1 2//1 3//1\n";
+
+    // 1-based position indices of the triangles, in order
+    const int EXPECTED[][3] = {
+        {1, 2, 3}, {1, 3, 4},               // Quad
+        {5, 6, 7}, {5, 7, 8}, {5, 8, 9},    // Pentagon
+        {1, 2, 3}                           // Still aligned after them
+    };
+    const size_t EXPECTED_TRIANGLES = sizeof(EXPECTED) / sizeof(EXPECTED[0]);
+
+    const float POSITIONS[][3] = {
+        {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+        {2, 0, 0}, {3, 0, 0}, {3.5f, 1, 0}, {2.5f, 2, 0}, {1.5f, 1, 0}
+    };
+
+    bool SamePosition(const float* vertex, int position) {
+        const float* expected = POSITIONS[position - 1];
+        return vertex[0] == expected[0] && vertex[1] == expected[1] && vertex[2] == expected[2];
+    }
+
+    bool Check(const std::string& path, const std::string& name, bool legacy, bool deduplicate) {
+        OBJLoadOptions options;
+        options.useLegacyParser = legacy;
+        options.deduplicateVertices = deduplicate;
+        options.parseThreads = 1;
+        options.optimizeMeshes = false;
+        options.generateLods = false;
+        options.clipToPlane = false;
+
+        OBJLoader loader;
+        loader.SetOptions(options);
+        std::vector<MeshData> meshes;
+        std::vector<std::string> libraries;
+        std::vector<std::string> images;
+        if (!loader.BuildOffline(path, meshes, libraries, images) || meshes.size() != 1) {
+            std::cout << name << ": FAILED to build one mesh" << std::endl;
+            return false;
+        }
+
+        const MeshData& mesh = meshes[0];
+        if (mesh.indices.size() != EXPECTED_TRIANGLES * 3) {
+            std::cout << name << ": FAILED, " << mesh.indices.size() << " indices, expected "
+                      << EXPECTED_TRIANGLES * 3 << std::endl;
+            return false;
+        }
+        for (size_t t = 0; t < EXPECTED_TRIANGLES; ++t) {
+            for (int j = 0; j < 3; ++j) {
+                unsigned int index = mesh.indices[t * 3 + j];
+                if (index >= mesh.VertexCount() ||
+                    !SamePosition(&mesh.vertices[index * MESH_VERTEX_FLOATS], EXPECTED[t][j])) {
+                    std::cout << name << ": FAILED, triangle " << t << " corner " << j << " is not vertex "
+                              << EXPECTED[t][j] << std::endl;
+                    return false;
+                }
+            }
+        }
+        std::cout << name << ": ok (" << EXPECTED_TRIANGLES << " triangles, " << mesh.VertexCount()
+                  << " vertices)" << std::endl;
+        return true;
+    }
+}
+
+int main() {
+    std::string path = "obj_triangulation_test.obj";
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file || std::fputs(TEST_OBJ, file) < 0 || std::fclose(file) != 0) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+
+    bool ok = Check(path, "mapped, deduplicated", false, true);
+    ok = Check(path, "mapped", false, false) && ok;
+    ok = Check(path, "legacy", true, false) && ok;
+    std::remove(path.c_str());
+    return ok ? 0 : 1;
+}
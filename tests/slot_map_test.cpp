@@ -0,0 +1,234 @@
+// slot_map_test: SlotMap handles stay valid through insert/remove churn and
+// go stale once their element is removed, cleared or their slot retired.
+// Mirrors the Box storage: a dense array the map indexes, swap-removed on
+// Remove, with a LooseOctree kept in step by SwapRemove and Refit. A seeded
+// random sequence of inserts, removes and clears is compared against a
+// reference list of live and removed handles, and radius queries against a
+// brute-force scan. A slot aged to its last generation must be retired
+// rather than wrap around and revive old handles.
+//
+//   slot_map_test [operations (default 200000)] [seed]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "frustum_cull.h"
+#include "loose_octree.h"
+#include "slot_map.h"
+
+// Lets the test age a slot without 2^32 removes
+class SlotMapTest {
+public:
+    static void SetGeneration(SlotMap& map, uint32_t slot, uint32_t generation) {
+        map.slots[slot].generation = generation;
+    }
+    static uint32_t LastGeneration() { return SlotMap::RETIRED - 1; }
+};
+
+namespace {
+    const float SCENE_SIZE = 50.0f;
+    const size_t CHECK_INTERVAL = 97;
+    const size_t CLEAR_INTERVAL = 20011;
+
+    struct Live {
+        SlotHandle handle;
+        uint32_t id;
+    };
+
+    bool Fail(const std::string& name, const std::string& what, size_t step) {
+        std::cout << name << ": FAILED at step " << step << ", " << what << std::endl;
+        return false;
+    }
+
+    // Removing or finding a stale handle must fail and change nothing
+    bool Rejects(SlotMap& map, SlotHandle handle) {
+        size_t index = 0;
+        size_t last = 0;
+        size_t size = map.Size();
+        return !map.Contains(handle) && !map.Find(handle, index) && !map.Remove(handle, index, last) &&
+               map.Size() == size;
+    }
+
+    bool CheckChurn(size_t operations, unsigned seed) {
+        const std::string name = "churn";
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> coordinate(-SCENE_SIZE, SCENE_SIZE);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        SlotMap map;
+        std::vector<uint32_t> ids;          // Dense storage, as Box keeps its arrays
+        BoundingSphereSet spheres;
+        LooseOctree index(glm::vec3(0.0f), SCENE_SIZE, 4);
+        std::vector<Live> live;
+        std::vector<SlotHandle> removed;
+        uint32_t nextId = 0;
+        size_t peak = 0;
+
+        for (size_t step = 1; step <= operations; ++step) {
+            // Drift towards inserting while small and removing while large
+            float insertChance = live.size() < 64 ? 0.9f : (live.size() > 4096 ? 0.3f : 0.55f);
+            if (live.empty() || unit(random) < insertChance) {
+                SlotHandle handle = map.Insert();
+                if (map.Size() != ids.size() + 1) {
+                    return Fail(name, "insert did not append", step);
+                }
+                ids.push_back(nextId);
+                spheres.push_back(glm::vec3(coordinate(random), coordinate(random), coordinate(random)),
+                                  0.1f + unit(random));
+                live.push_back(Live{handle, nextId++});
+            } else {
+                size_t pick = random() % live.size();
+                Live gone = live[pick];
+                size_t at = 0;
+                size_t last = 0;
+                if (!map.Remove(gone.handle, at, last) || last != ids.size() - 1 || ids[at] != gone.id) {
+                    return Fail(name, "remove of a live handle", step);
+                }
+                ids[at] = ids[last];
+                ids.pop_back();
+                spheres.centerX[at] = spheres.centerX[last];
+                spheres.centerY[at] = spheres.centerY[last];
+                spheres.centerZ[at] = spheres.centerZ[last];
+                spheres.radius[at] = spheres.radius[last];
+                spheres.centerX.pop_back();
+                spheres.centerY.pop_back();
+                spheres.centerZ.pop_back();
+                spheres.radius.pop_back();
+                if (index.ObjectCount() == last + 1) {
+                    index.SwapRemove(static_cast<uint32_t>(at));
+                }
+                live[pick] = live.back();
+                live.pop_back();
+                removed.push_back(gone.handle);
+                if (!Rejects(map, gone.handle)) {
+                    return Fail(name, "removed handle still accepted", step);
+                }
+            }
+            peak = std::max(peak, live.size());
+
+            if (step % CLEAR_INTERVAL == 0) {
+                map.Clear();
+                ids.clear();
+                spheres.clear();
+                index.Clear();
+                for (const Live& element : live) {
+                    removed.push_back(element.handle);
+                }
+                live.clear();
+                if (map.Size() != 0) {
+                    return Fail(name, "clear left elements", step);
+                }
+            }
+
+            if (step % CHECK_INTERVAL != 0) {
+                continue;
+            }
+            if (map.Size() != live.size()) {
+                return Fail(name, "size differs from the reference", step);
+            }
+            for (const Live& element : live) {
+                size_t at = 0;
+                if (!map.Find(element.handle, at) || at >= ids.size() || ids[at] != element.id ||
+                    map.HandleAt(at) != element.handle) {
+                    return Fail(name, "live handle lost its element", step);
+                }
+            }
+            // Old handles stay stale however often their slot is reused
+            for (int i = 0; i < 32 && !removed.empty(); ++i) {
+                if (!Rejects(map, removed[random() % removed.size()])) {
+                    return Fail(name, "stale handle accepted after slot reuse", step);
+                }
+            }
+
+            // Move a few spheres, refit, and query around a random point
+            for (size_t i = 0; i < spheres.size(); i += 7) {
+                spheres.centerX[i] = coordinate(random);
+            }
+            index.Refit(spheres.arrays(), spheres.size());
+            glm::vec3 center(coordinate(random), coordinate(random), coordinate(random));
+            float radius = 2.0f + 10.0f * unit(random);
+            std::vector<uint32_t> found;
+            index.QueryRadius(center, radius, found);
+            std::vector<uint32_t> expected;
+            SphereArrays arrays = spheres.arrays();
+            for (size_t i = 0; i < spheres.size(); ++i) {
+                glm::vec3 offset = glm::vec3(arrays.centerX[i], arrays.centerY[i], arrays.centerZ[i]) - center;
+                float reach = radius + arrays.radius[i] * arrays.radiusScale;
+                if (glm::dot(offset, offset) <= reach * reach) {
+                    expected.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            std::sort(found.begin(), found.end());
+            if (found != expected) {
+                return Fail(name, "radius query differs from brute force", step);
+            }
+        }
+
+        std::cout << name << ": ok (" << operations << " operations, up to " << peak << " live, "
+                  << removed.size() << " stale handles)" << std::endl;
+        return true;
+    }
+
+    bool CheckRetirement() {
+        const std::string name = "generation wraparound";
+        SlotMap map;
+        size_t at = 0;
+        size_t last = 0;
+
+        // One generation left: the slot is still reused once
+        SlotHandle first = map.Insert();
+        SlotMapTest::SetGeneration(map, first.slot, SlotMapTest::LastGeneration() - 1);
+        SlotHandle aged = map.HandleAt(0);
+        if (!map.Remove(aged, at, last)) {
+            return Fail(name, "remove of an aged handle", 1);
+        }
+        SlotHandle lastUse = map.Insert();
+        if (lastUse.slot != first.slot || lastUse.generation != SlotMapTest::LastGeneration()) {
+            return Fail(name, "slot not reused for its last generation", 2);
+        }
+
+        // Removing the last generation retires the slot instead of wrapping
+        // to generation 0, which the first handle still holds
+        if (!map.Remove(lastUse, at, last)) {
+            return Fail(name, "remove of the last generation", 3);
+        }
+        SlotHandle next = map.Insert();
+        if (next.slot == first.slot) {
+            return Fail(name, "retired slot reused", 4);
+        }
+        if (!Rejects(map, first) || !Rejects(map, aged) || !Rejects(map, lastUse)) {
+            return Fail(name, "handle to a retired slot accepted", 5);
+        }
+
+        // Clear retires a live slot on its last generation too, and keeps
+        // retired slots off the free list
+        SlotMapTest::SetGeneration(map, next.slot, SlotMapTest::LastGeneration());
+        SlotHandle agedLive = map.HandleAt(0);
+        map.Clear();
+        SlotHandle fresh = map.Insert();
+        if (fresh.slot == first.slot || fresh.slot == next.slot || map.Size() != 1) {
+            return Fail(name, "retired slot reused after clear", 6);
+        }
+        if (!Rejects(map, first) || !Rejects(map, agedLive) || !Rejects(map, SlotHandle(next.slot, 0))) {
+            return Fail(name, "handle to a retired slot accepted after clear", 7);
+        }
+        if (!map.Contains(fresh)) {
+            return Fail(name, "fresh handle rejected", 8);
+        }
+
+        std::cout << name << ": ok" << std::endl;
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t operations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 12345u;
+
+    bool ok = CheckChurn(operations, seed);
+    ok = CheckRetirement() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+// assetc: offline asset compiler. Runs the load-time preprocessing of OBJ
+// models (parsing, vertex deduplication, clipping, optimization, LODs) and
+// block-compresses their material textures and the skybox faces, then writes
+// everything to one bundle the program maps at startup (see asset_bundle.h).
+//
+//   assetc [-o assets.bundle] [-j N] [--force] [--skybox right left top bottom front back] model.obj...
+//
+// Entries whose sources are unchanged since the previous bundle (same
+// content hash over the source bytes, their material libraries and the build
+// settings) are copied over instead of being rebuilt. Every entry records its
+// source's current size and time, which the program stats to notice sources
+// edited after the bundle was built.
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "asset_bundle.h"
+#include "checksum.h"
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "obj_loader.h"
+#include "texture_cache.h"
+#include "texture_compress.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
+
+namespace {
+    // Must match how the program loads each kind of image
+    const ImageLoadOptions MATERIAL_IMAGE_OPTIONS(true, true, false);    // OBJLoader::DecodeTexture
+    const ImageLoadOptions SKYBOX_FACE_OPTIONS(false, false, true);     // Skybox
+    const size_t SKYBOX_FACE_COUNT = 6;
+
+    struct CompilerOptions {
+        std::string output = "assets.bundle";
+        unsigned jobs = 0;
+        bool force = false;
+        std::vector<std::string> models;
+        std::vector<std::string> skyboxFaces;
+    };
+
+    // An entry of the new bundle, rebuilt or reused
+    struct CompiledEntry {
+        AssetKind kind = AssetKind::Mesh;
+        std::string name;
+        uint64_t contentHash = 0;
+        std::vector<char> data;
+        const AssetBundleEntry* reused = nullptr;   // In the previous bundle (data is its restamped copy)
+        std::vector<std::string> images;            // Material images of a model
+        bool ok = false;
+    };
+
+    struct TextureRequest {
+        std::string path;
+        ImageLoadOptions options;
+    };
+
+    void PrintUsage() {
+        std::cout << "Usage: assetc [options] model.obj...\n"
+                  << "  -o, --output FILE   bundle to write (default assets.bundle)\n"
+                  << "  -j, --jobs N        worker threads (default: one per core)\n"
+                  << "  --skybox F1 ... F6  cube map faces: right left top bottom front back\n"
+                  << "  --force             rebuild every entry, even if its sources are unchanged" << std::endl;
+    }
+
+    bool ParseArguments(int argc, char** argv, CompilerOptions& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+                options.output = argv[++i];
+            } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+                options.jobs = static_cast<unsigned>(std::atoi(argv[++i]));
+            } else if (arg.compare(0, 7, "--jobs=") == 0) {
+                options.jobs = static_cast<unsigned>(std::atoi(arg.c_str() + 7));
+            } else if (arg == "--force") {
+                options.force = true;
+            } else if (arg == "--skybox") {
+                if (i + static_cast<int>(SKYBOX_FACE_COUNT) >= argc) {
+                    std::cerr << "--skybox needs " << SKYBOX_FACE_COUNT << " face images" << std::endl;
+                    return false;
+                }
+                for (size_t face = 0; face < SKYBOX_FACE_COUNT; ++face) {
+                    options.skyboxFaces.push_back(argv[++i]);
+                }
+            } else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+                return false;
+            } else {
+                options.models.push_back(arg);
+            }
+        }
+        return !options.models.empty() || !options.skyboxFaces.empty();
+    }
+
+    // Hash a file's bytes; a missing file hashes differently from an empty one
+    void HashFile(const std::string& path, Checksum& hash) {
+        MappedFile file;
+        uint64_t size = 0;
+        if (file.Open(path)) {
+            size = file.Size();
+            hash.Update(&size, sizeof(size));
+            hash.Update(file.Data(), file.Size());
+        } else {
+            size = ~0ull;
+            hash.Update(&size, sizeof(size));
+        }
+    }
+
+    uint64_t MeshContentHash(const std::string& path, const std::vector<std::string>& libraries,
+                             const MeshCacheKey& key) {
+        Checksum hash;
+        uint32_t settings[3] = {key.loaderVersion, key.optionFlags, key.optionHash};
+        hash.Update(settings, sizeof(settings));
+        HashFile(path, hash);
+        uint64_t materialHash = HashMaterialLibraries(path, libraries);
+        hash.Update(&materialHash, sizeof(materialHash));
+        return hash.Finish();
+    }
+
+    uint64_t TextureContentHash(const std::string& path, const TextureCacheKey& key) {
+        Checksum hash;
+        uint32_t settings[2] = {key.encoderVersion, key.optionFlags};
+        hash.Update(settings, sizeof(settings));
+        HashFile(path, hash);
+        return hash.Finish();
+    }
+
+    CompiledEntry CompileModel(const std::string& path, const OBJLoadOptions& loadOptions,
+                               const MeshCacheKey& key, const AssetBundle& previous) {
+        CompiledEntry entry;
+        entry.kind = AssetKind::Mesh;
+        entry.name = path;
+
+        OBJLoader loader;
+        loader.SetOptions(loadOptions);
+
+        // Stamped with the source's size and time
+        MeshCacheKey entryKey = key;
+        MakeMeshCacheKey(path, key.loaderVersion, key.optionFlags, entryKey);
+
+        // The previous entry names the material libraries it was built from.
+        // Its stamp may be older than the (unchanged) source, so it is copied.
+        const AssetBundleEntry* old = previous.Find(AssetKind::Mesh, path);
+        MeshCacheReader oldMeshes;
+        if (old && oldMeshes.Open(old->data, old->size, path, key, false)) {
+            entry.contentHash = MeshContentHash(path, oldMeshes.MaterialLibraries(), key);
+            if (entry.contentHash == old->contentHash) {
+                loader.ReadMaterialImages(path, oldMeshes.MaterialLibraries(), entry.images);
+                entry.data.assign(old->data, old->data + old->size);
+                StampMeshCacheSource(entryKey, entry.data);
+                entry.reused = old;
+                entry.ok = true;
+                return entry;
+            }
+        }
+
+        std::vector<MeshData> meshes;
+        std::vector<std::string> libraries;
+        if (!loader.BuildOffline(path, meshes, libraries, entry.images)) {
+            std::cerr << "Failed to build model: " << path << std::endl;
+            return entry;
+        }
+        entryKey.materialHash = HashMaterialLibraries(path, libraries);
+        SerializeMeshCache(entryKey, meshes, libraries, entry.data);
+        entry.contentHash = MeshContentHash(path, libraries, key);
+        entry.ok = true;
+        return entry;
+    }
+
+    CompiledEntry CompileTexture(const TextureRequest& request, const AssetBundle& previous) {
+        CompiledEntry entry;
+        entry.kind = AssetKind::Texture;
+        entry.name = request.path;
+
+        TextureCacheKey key;
+        key.encoderVersion = TextureEncoderVersion();
+        key.optionFlags = TextureCacheFlags(request.options);
+        MakeTextureCacheKey(request.path, key.encoderVersion, key.optionFlags, key);
+        entry.contentHash = TextureContentHash(request.path, key);
+
+        const AssetBundleEntry* old = previous.Find(AssetKind::Texture, request.path);
+        if (old && old->contentHash == entry.contentHash) {
+            entry.data.assign(old->data, old->data + old->size);
+            StampTextureCacheSource(key, entry.data);
+            entry.reused = old;
+            entry.ok = true;
+            return entry;
+        }
+
+        // Parallel across images rather than within one
+        CompressedTexture texture;
+        if (!CompressImage(request.path, request.options, nullptr, texture)) {
+            std::cerr << "Failed to compress texture: " << request.path << std::endl;
+            return entry;
+        }
+        SerializeTextureCache(key, texture, entry.data);
+        entry.ok = true;
+        return entry;
+    }
+}
+
+int main(int argc, char** argv) {
+    CompilerOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    AssetBundle previous;
+    if (!options.force && previous.Open(options.output)) {
+        std::cout << "Previous bundle: " << previous.Entries().size() << " entries" << std::endl;
+    }
+
+    // Same settings the program loads models with; the work is spread over
+    // assets, so each parse is serial
+    OBJLoadOptions loadOptions;
+    loadOptions.parseThreads = 1;
+    MeshCacheKey meshKey;
+    {
+        OBJLoader probe;
+        probe.SetOptions(loadOptions);
+        probe.GetMeshCacheKey(meshKey);
+    }
+
+    ThreadPool pool(options.jobs);
+    std::cout << "Compiling with " << pool.Size() << " jobs" << std::endl;
+
+    std::vector<std::future<CompiledEntry>> modelJobs;
+    for (const std::string& path : options.models) {
+        modelJobs.push_back(pool.Submit([&, path]() {
+            return CompileModel(path, loadOptions, meshKey, previous);
+        }));
+    }
+    std::vector<CompiledEntry> compiled;
+    for (std::future<CompiledEntry>& job : modelJobs) {
+        compiled.push_back(job.get());
+    }
+
+    // Every image once; the bundle is keyed by path, so one image cannot be
+    // stored with two sets of options
+    std::vector<TextureRequest> textures;
+    std::set<std::string> texturePaths;
+    for (const std::string& face : options.skyboxFaces) {
+        if (texturePaths.insert(face).second) {
+            textures.push_back(TextureRequest{face, SKYBOX_FACE_OPTIONS});
+        }
+    }
+    for (const CompiledEntry& model : compiled) {
+        for (const std::string& image : model.images) {
+            if (texturePaths.insert(image).second) {
+                textures.push_back(TextureRequest{image, MATERIAL_IMAGE_OPTIONS});
+            }
+        }
+    }
+
+    std::vector<std::future<CompiledEntry>> textureJobs;
+    for (const TextureRequest& request : textures) {
+        textureJobs.push_back(pool.Submit([&, request]() {
+            return CompileTexture(request, previous);
+        }));
+    }
+    for (std::future<CompiledEntry>& job : textureJobs) {
+        compiled.push_back(job.get());
+    }
+
+    AssetBundleWriter writer;
+    size_t built = 0;
+    size_t reused = 0;
+    size_t failed = 0;
+    for (const CompiledEntry& entry : compiled) {
+        if (!entry.ok) {
+            failed++;
+        } else {
+            writer.Add(entry.kind, entry.name, entry.contentHash, entry.data.data(), entry.data.size());
+            if (entry.reused) {
+                reused++;
+            } else {
+                built++;
+            }
+        }
+    }
+    if (!writer.Write(options.output)) {
+        return 1;
+    }
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Wrote " << options.output << ": " << built << " built, " << reused << " unchanged, "
+              << failed << " failed in " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// frustum_cull_bench: throughput of the frustum culling kernels
+// (frustum_cull.h). Culls the same spheres with every kernel the CPU
+// supports, checks that each produces the scalar kernel's visible list and
+// reports spheres per ns.
+//
+//   frustum_cull_bench [spheres (default 1048576)] [frames (default 100)]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include "frustum_cull.h"
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? static_cast<size_t>(std::atoll(argv[1])) : (1u << 20);
+    int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    // Boxes scattered like the scene's, from a fixed seed
+    BoundingSphereSet spheres;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> radius(0.05f, 0.5f);
+    for (size_t i = 0; i < count; ++i) {
+        spheres.push_back(glm::vec3(position(random), position(random), position(random)), radius(random));
+    }
+    SphereArrays arrays = spheres.arrays();
+
+    // The program's camera, turning a little every frame so the visible set changes
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    std::vector<MeshletFrustum> frustums;
+    for (int frame = 0; frame < frames; ++frame) {
+        float angle = frame * 0.05f;
+        glm::vec3 eye(0.0f, 0.0f, 3.0f);
+        glm::vec3 front(std::sin(angle), 0.0f, -std::cos(angle));
+        frustums.push_back(MeshletFrustum(projection * glm::lookAt(eye, eye + front, glm::vec3(0.0f, 1.0f, 0.0f))));
+    }
+
+    std::cout << "Culling " << count << " spheres for " << frames << " frames" << std::endl;
+
+    std::vector<uint32_t> reference;
+    std::vector<size_t> referenceCounts;
+    const SimdKernel kernels[3] = {SimdKernel::Scalar, SimdKernel::SSE2, SimdKernel::AVX2};
+    for (SimdKernel kernel : kernels) {
+        if (!IsSimdKernelSupported(kernel)) {
+            std::cout << std::setw(8) << SimdKernelName(kernel) << ": not supported" << std::endl;
+            continue;
+        }
+
+        std::vector<uint32_t> visible(count);
+        std::vector<size_t> counts;
+        size_t visibleTotal = 0;
+        bool matches = true;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            size_t visibleCount = CullSpheres(frustums[frame], arrays, 0, count, visible.data(), kernel);
+            visibleTotal += visibleCount;
+            counts.push_back(visibleCount);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        // The scalar run is the reference: same counts, and the same list for the last frame
+        if (kernel == SimdKernel::Scalar) {
+            reference = visible;
+            referenceCounts = counts;
+        } else {
+            matches = counts == referenceCounts &&
+                      std::equal(visible.begin(), visible.begin() + counts.back(), reference.begin());
+        }
+
+        double tested = static_cast<double>(count) * frames;
+        std::cout << std::setw(8) << SimdKernelName(kernel) << ": " << std::fixed << std::setprecision(3)
+                  << (tested / ns) << " spheres/ns, " << std::setprecision(1) << (ns / frames / 1e3)
+                  << " us/frame, " << std::setprecision(1) << (100.0 * visibleTotal / tested) << "% visible"
+                  << (matches ? "" : "  MISMATCH against scalar") << std::endl;
+        if (!matches) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+// gpu_box_sim_bench: per-frame cost of moving the boxes on the CPU and
+// uploading them (what Box does by default) against stepping them on the
+// GPU with transform feedback (gpu_box_simulation.h). Runs in a hidden
+// window; both paths start from the same boxes and take the same steps, and
+// at the end the GPU's positions are read back and compared with the CPU's.
+//
+//   gpu_box_sim_bench [frames (default 100)] [box counts (default 1000000 4000000)]
+//
+// Run from the build directory so shaders/box_simulate.vert is found.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include "box_update.h"
+#include "gpu_box_simulation.h"
+#include "job_system.h"
+#include "stream_buffer.h"
+
+namespace {
+    const float STEP = 1.0f / 60.0f;
+    // As in Box::updateInstances
+    const size_t UPDATE_BLOCK = 8;
+    const size_t UPDATE_GRAIN_BLOCKS = 2048;
+    // Positions further apart than this count as diverged (CPU and GPU
+    // rounding differ slightly, and a box may then wrap a frame apart)
+    const float TOLERANCE = 1e-3f;
+
+    // Box's per-instance layout
+    struct GpuInstance {
+        glm::vec3 position;
+        float scale;
+        glm::vec3 color;
+        float rotation;
+    };
+
+    struct Boxes {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> rotation, rotationSpeed, scale;
+        std::vector<glm::vec3> color;
+
+        explicit Boxes(size_t count) {
+            // Same ranges as the scene generator, from a fixed seed
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> position(-BOX_WRAP_BOUNDARY, BOX_WRAP_BOUNDARY);
+            std::uniform_real_distribution<float> velocity(-0.05f, 0.05f);
+            std::uniform_real_distribution<float> speed(0.001f, 0.1f);
+            std::uniform_real_distribution<float> size(0.01f, 0.05f);
+            std::uniform_real_distribution<float> shade(0.2f, 1.0f);
+            for (size_t i = 0; i < count; ++i) {
+                positionX.push_back(position(random));
+                positionY.push_back(position(random));
+                positionZ.push_back(position(random));
+                velocityX.push_back(velocity(random));
+                velocityY.push_back(velocity(random));
+                velocityZ.push_back(velocity(random));
+                rotation.push_back(0.0f);
+                rotationSpeed.push_back(speed(random));
+                scale.push_back(size(random));
+                color.push_back(glm::vec3(shade(random), shade(random), shade(random)));
+            }
+        }
+
+        size_t size() const { return positionX.size(); }
+
+        BoxMotionArrays Motion() {
+            return BoxMotionArrays{positionX.data(), positionY.data(), positionZ.data(),
+                                   velocityX.data(), velocityY.data(), velocityZ.data(),
+                                   rotation.data(), rotationSpeed.data()};
+        }
+    };
+
+    // What one frame of the default path costs before drawing: the parallel
+    // SIMD update, then every instance written to the stream buffer
+    void CpuFrame(Boxes& boxes, StreamBuffer& stream) {
+        BoxMotionArrays motion = boxes.Motion();
+        size_t count = boxes.size();
+        size_t blockCount = (count + UPDATE_BLOCK - 1) / UPDATE_BLOCK;
+        JobSystem::Instance().ParallelFor(0, blockCount, UPDATE_GRAIN_BLOCKS, [&](size_t first, size_t last) {
+            UpdateBoxMotion(motion, first * UPDATE_BLOCK, std::min(last * UPDATE_BLOCK, count), STEP,
+                            BestSimdKernel());
+        });
+
+        size_t offset = 0;
+        GpuInstance* instances = static_cast<GpuInstance*>(
+            stream.Allocate(count * sizeof(GpuInstance), sizeof(GpuInstance), offset));
+        if (!instances) {
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            instances[i].position = glm::vec3(boxes.positionX[i], boxes.positionY[i], boxes.positionZ[i]);
+            instances[i].scale = boxes.scale[i];
+            instances[i].color = boxes.color[i];
+            instances[i].rotation = boxes.rotation[i];
+        }
+        stream.Commit();
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+    std::vector<size_t> counts;
+    for (int i = 2; i < argc; ++i) {
+        counts.push_back(static_cast<size_t>(std::atoll(argv[i])));
+    }
+    if (counts.empty()) {
+        counts = {1000000, 4000000};
+    }
+
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "gpu_box_sim_bench", NULL, NULL);
+    if (!window) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGL(glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+    SetPersistentMapping(DetectPersistentMapping(glfwGetProcAddress));
+
+    GpuBoxSimulation simulation;
+    if (!simulation.Create()) {
+        return 1;
+    }
+    // One timer per frame, read after the loop so timing never stalls it
+    std::vector<GLuint> timers(frames);
+    glGenQueries(frames, timers.data());
+
+    std::cout << frames << " frames of " << STEP << " s. CPU: " << SimdKernelName(BestSimdKernel())
+              << " update on " << JobSystem::Instance().ThreadCount() << " threads + "
+              << (IsPersistentMappingEnabled() ? "persistent" : "mapped") << " upload; GPU: transform feedback. "
+              << "Wall ms per frame include glFinish." << std::endl;
+
+    int status = 0;
+    for (size_t count : counts) {
+        Boxes cpuBoxes(count);
+        Boxes start = cpuBoxes;
+
+        // Default path
+        StreamBuffer stream;
+        stream.Create(count * sizeof(GpuInstance));
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            CpuFrame(cpuBoxes, stream);
+            StreamBuffer::EndFrame();
+        }
+        glFinish();
+        double cpuMs = MillisecondsSince(begin) / frames;
+        stream.Destroy();
+
+        // Transform feedback
+        simulation.Upload(start.Motion(), start.scale.data(), start.color.data(), count);
+        glFinish();
+        begin = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            glBeginQuery(GL_TIME_ELAPSED, timers[frame]);
+            simulation.Step(STEP);
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+        glFinish();
+        double gpuWallMs = MillisecondsSince(begin) / frames;
+        GLuint64 gpuNs = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(timers[frame], GL_QUERY_RESULT, &elapsed);
+            gpuNs += elapsed;
+        }
+
+        // Same steps, same result?
+        simulation.Download(start.Motion());
+        size_t diverged = 0;
+        for (size_t i = 0; i < count; ++i) {
+            float dx = std::fabs(start.positionX[i] - cpuBoxes.positionX[i]);
+            float dy = std::fabs(start.positionY[i] - cpuBoxes.positionY[i]);
+            float dz = std::fabs(start.positionZ[i] - cpuBoxes.positionZ[i]);
+            if (std::max(dx, std::max(dy, dz)) > TOLERANCE) {
+                diverged++;
+            }
+        }
+
+        std::cout << std::setw(8) << count << " boxes: CPU " << std::fixed << std::setprecision(2) << cpuMs
+                  << " ms | GPU " << gpuWallMs << " ms (" << (gpuNs / 1e6 / frames) << " ms on the GPU) | "
+                  << std::setprecision(1) << (cpuMs / gpuWallMs) << "x | " << diverged << " diverged" << std::endl;
+        // Rounding can carry a few boxes across a wrap a frame apart; more
+        // than that is a bug
+        if (diverged > count / 1000) {
+            status = 1;
+        }
+    }
+
+    glDeleteQueries(frames, timers.data());
+    simulation.Destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return status;
+}
@@ -0,0 +1,124 @@
+// job_scaling_bench: how the Box update scales over the job system
+// (job_system.h). Runs the same update as Box::updateInstances with 1, 2, ...
+// threads, checks that every run ends in the single-threaded state bit for
+// bit and reports frame time, speedup, memory bandwidth and steals.
+//
+//   job_scaling_bench [instances (default 1048576)] [frames (default 200)] [max threads (default: cores)] [--pin]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "box_update.h"
+#include "job_system.h"
+
+namespace {
+    // Same split as Box::updateInstances
+    const size_t BLOCK = 8;
+    const size_t GRAIN_BLOCKS = 2048;
+    // Read: position, velocity, rotation and rotation speed; written: position and rotation
+    const double BYTES_PER_BOX = 12 * sizeof(float);
+
+    struct Boxes {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> rotation, rotationSpeed;
+
+        explicit Boxes(size_t count) {
+            // Same ranges as the scene generator, from a fixed seed
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> position(-BOX_WRAP_BOUNDARY, BOX_WRAP_BOUNDARY);
+            std::uniform_real_distribution<float> velocity(-0.05f, 0.05f);
+            std::uniform_real_distribution<float> speed(0.001f, 0.1f);
+            for (size_t i = 0; i < count; ++i) {
+                positionX.push_back(position(random));
+                positionY.push_back(position(random));
+                positionZ.push_back(position(random));
+                velocityX.push_back(velocity(random));
+                velocityY.push_back(velocity(random));
+                velocityZ.push_back(velocity(random));
+                rotation.push_back(0.0f);
+                rotationSpeed.push_back(speed(random));
+            }
+        }
+
+        BoxMotionArrays Motion() {
+            return BoxMotionArrays{positionX.data(), positionY.data(), positionZ.data(),
+                                   velocityX.data(), velocityY.data(), velocityZ.data(),
+                                   rotation.data(), rotationSpeed.data()};
+        }
+
+        bool SameState(const Boxes& other) const {
+            size_t bytes = positionX.size() * sizeof(float);
+            return std::memcmp(positionX.data(), other.positionX.data(), bytes) == 0 &&
+                   std::memcmp(positionY.data(), other.positionY.data(), bytes) == 0 &&
+                   std::memcmp(positionZ.data(), other.positionZ.data(), bytes) == 0 &&
+                   std::memcmp(rotation.data(), other.rotation.data(), bytes) == 0;
+        }
+    };
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args;
+    bool pin = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--pin") {
+            pin = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    size_t count = args.size() > 0 ? static_cast<size_t>(std::atoll(args[0].c_str())) : (1u << 20);
+    int frames = args.size() > 1 ? std::atoi(args[1].c_str()) : 200;
+    unsigned maxThreads = args.size() > 2 ? static_cast<unsigned>(std::atoi(args[2].c_str()))
+                                          : std::max(1u, std::thread::hardware_concurrency());
+    const float deltaTimes[4] = {1.0f / 60.0f, 1.0f / 30.0f, 1.0f / 144.0f, 0.25f};
+    SimdKernel kernel = BestSimdKernel();
+
+    std::cout << "Updating " << count << " boxes for " << frames << " frames with the "
+              << SimdKernelName(kernel) << " kernel" << (pin ? ", threads pinned" : "") << std::endl;
+
+    Boxes reference(count);
+    double baseMs = 0.0;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        JobSystem jobs(threads, pin);
+        Boxes boxes(count);
+        BoxMotionArrays motion = boxes.Motion();
+        size_t blockCount = (count + BLOCK - 1) / BLOCK;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            float deltaTime = deltaTimes[frame % 4];
+            jobs.ParallelFor(0, blockCount, GRAIN_BLOCKS, [&](size_t first, size_t last) {
+                UpdateBoxMotion(motion, first * BLOCK, std::min(last * BLOCK, count), deltaTime, kernel);
+            });
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        // The single-threaded run is the reference for the others
+        bool matches = true;
+        if (threads == 1) {
+            reference = boxes;
+            baseMs = ms;
+        } else {
+            matches = boxes.SameState(reference);
+        }
+
+        JobSystemStats stats = jobs.GetStats();
+        std::cout << std::setw(3) << threads << " threads: " << std::fixed << std::setprecision(3) << ms
+                  << " ms/frame, " << std::setprecision(2) << (baseMs / ms) << "x, "
+                  << std::setprecision(1) << (count * BYTES_PER_BOX / (ms * 1e6)) << " GB/s, "
+                  << stats.steals << " steals" << (pin && !jobs.ArePinned() ? " (pinning failed)" : "")
+                  << (matches ? "" : "  MISMATCH against 1 thread") << std::endl;
+        if (!matches) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+// obj_parse_bench: thread scaling of the chunked OBJ parser
+// (ParseObjParallel in obj_parser.h). Writes a synthetic grid mesh with
+// positions, texture coordinates, normals, relative indices and usemtl
+// runs, then parses it with 1, 2, 4, ... threads, checks every run against
+// the serial ParseObj and reports load time, speedup and MB/s.
+//
+//   obj_parse_bench [triangles (default 10000000)] [file (default obj_parse_bench.obj)] [thread counts (default 1 2 4 8 16)]
+//
+// The file is kept and reused by later runs with the same triangle count.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "obj_parser.h"
+
+namespace {
+    // Faces between usemtl statements, so the merge has groups to stitch
+    const size_t FACES_PER_MATERIAL = 100000;
+    // Runs per thread count; the fastest one is reported
+    const int RUNS = 3;
+
+    // Grid of side x side vertices with two triangles per cell. Every other
+    // face uses relative indices. Returns false if the file can't be written.
+    bool WriteGrid(const std::string& path, size_t triangles) {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        size_t side = static_cast<size_t>(std::ceil(std::sqrt(triangles / 2.0))) + 1;
+        std::fprintf(file, "# obj_parse_bench %zu\n", triangles);
+        for (size_t y = 0; y < side; ++y) {
+            for (size_t x = 0; x < side; ++x) {
+                float u = static_cast<float>(x) / (side - 1);
+                float v = static_cast<float>(y) / (side - 1);
+                std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\n", u * 10.0f, std::sin(u * 6.0f + v * 4.0f),
+                             v * 10.0f, u, v);
+            }
+        }
+        std::fprintf(file, "vn 0 1 0\n");
+
+        long long vertexCount = static_cast<long long>(side * side);
+        size_t written = 0;
+        for (size_t y = 0; y + 1 < side && written < triangles; ++y) {
+            for (size_t x = 0; x + 1 < side && written < triangles; ++x) {
+                long long a = static_cast<long long>(y * side + x) + 1;
+                long long b = a + 1;
+                long long c = a + static_cast<long long>(side);
+                long long d = c + 1;
+                long long cell[2][3] = {{a, c, b}, {b, c, d}};
+                for (int t = 0; t < 2 && written < triangles; ++t, ++written) {
+                    if (written % FACES_PER_MATERIAL == 0) {
+                        std::fprintf(file, "usemtl material%zu\n", (written / FACES_PER_MATERIAL) % 4);
+                    }
+                    // Relative indices count back from the last vertex read
+                    long long offset = (written % 2) ? -(vertexCount + 1) : 0;
+                    std::fprintf(file, "f %lld/%lld/%d %lld/%lld/%d %lld/%lld/%d\n",
+                                 cell[t][0] + offset, cell[t][0] + offset, offset ? -1 : 1,
+                                 cell[t][1] + offset, cell[t][1] + offset, offset ? -1 : 1,
+                                 cell[t][2] + offset, cell[t][2] + offset, offset ? -1 : 1);
+                }
+            }
+        }
+        return std::fclose(file) == 0;
+    }
+
+    // The file already holds a grid of this size?
+    bool HasGrid(const std::string& path, size_t triangles) {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        char header[64] = {};
+        bool found = std::fgets(header, sizeof(header), file) != nullptr;
+        std::fclose(file);
+        std::string expected = "# obj_parse_bench " + std::to_string(triangles) + "\n";
+        return found && expected == header;
+    }
+
+    template <typename T>
+    bool SameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    bool SameCorners(const std::vector<ObjCorner>& a, const std::vector<ObjCorner>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].v != b[i].v || a[i].vt != b[i].vt || a[i].vn != b[i].vn || a[i].absolute != b[i].absolute) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SameData(const ObjData& a, const ObjData& b) {
+        if (a.faces.size() != b.faces.size() || a.groups.size() != b.groups.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.faces.size(); ++i) {
+            if (a.faces[i].firstCorner != b.faces[i].firstCorner || a.faces[i].cornerCount != b.faces[i].cornerCount) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < a.groups.size(); ++i) {
+            if (a.groups[i].material != b.groups[i].material || a.groups[i].firstFace != b.groups[i].firstFace) {
+                return false;
+            }
+        }
+        return SameBytes(a.positions, b.positions) && SameBytes(a.texCoords, b.texCoords) &&
+               SameBytes(a.normals, b.normals) && SameCorners(a.corners, b.corners);
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t triangles = argc > 1 ? static_cast<size_t>(std::atoll(argv[1])) : 10000000;
+    std::string path = argc > 2 ? argv[2] : "obj_parse_bench.obj";
+    std::vector<unsigned> threadCounts;
+    for (int i = 3; i < argc; ++i) {
+        threadCounts.push_back(static_cast<unsigned>(std::atoi(argv[i])));
+    }
+    if (threadCounts.empty()) {
+        threadCounts = {1, 2, 4, 8, 16};
+    }
+
+    if (!HasGrid(path, triangles)) {
+        std::cout << "Writing " << triangles << " triangles to " << path << std::endl;
+        if (!WriteGrid(path, triangles)) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return 1;
+        }
+    }
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cerr << "Failed to map " << path << std::endl;
+        return 1;
+    }
+    const char* begin = file.Data();
+    const char* end = begin + file.Size();
+    double megabytes = file.Size() / (1024.0 * 1024.0);
+
+    ObjData reference;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ParseObj(begin, end, reference);
+    double serialMs = MillisecondsSince(start);
+    std::cout << std::fixed << std::setprecision(1) << megabytes << " MB, " << reference.faces.size()
+              << " faces. ParseObj: " << serialMs << " ms (" << (megabytes * 1000.0 / serialMs) << " MB/s)"
+              << std::endl;
+
+    int status = 0;
+    for (unsigned threads : threadCounts) {
+        double bestMs = 0.0;
+        bool matches = true;
+        for (int run = 0; run < RUNS; ++run) {
+            ObjData data;
+            start = std::chrono::steady_clock::now();
+            ParseObjParallel(begin, end, threads, data);
+            double ms = MillisecondsSince(start);
+            bestMs = run == 0 ? ms : std::min(bestMs, ms);
+            matches = matches && SameData(data, reference);
+        }
+        std::cout << std::setw(3) << threads << " threads: " << std::setprecision(1) << bestMs << " ms, "
+                  << std::setprecision(2) << (serialMs / bestMs) << "x, " << std::setprecision(1)
+                  << (megabytes * 1000.0 / bestMs) << " MB/s" << (matches ? "" : "  MISMATCH against ParseObj")
+                  << std::endl;
+        if (!matches) {
+            status = 1;
+        }
+    }
+    return status;
+}
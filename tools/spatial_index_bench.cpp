@@ -0,0 +1,212 @@
+// spatial_index_bench: cost of keeping the Box spatial index (loose_octree.h)
+// up to date and querying it, against brute-force scans of the same boxes.
+// Every frame moves the boxes (wrapping at the scene bounds), refits the
+// index and runs one frustum query, plus radius queries and ray casts from
+// random points; each result is checked against the brute-force one.
+//
+//   spatial_index_bench [frames (default 20)] [box counts (default 10000 100000 1000000)]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include "box_update.h"
+#include "frustum_cull.h"
+#include "loose_octree.h"
+
+namespace {
+    // Same as Box
+    const float BOUNDING_RADIUS = 0.8660254f;
+    const int QUERIES_PER_FRAME = 16;
+    const float QUERY_RADIUS = 1.0f;
+    const float RAY_LENGTH = 40.0f;
+
+    struct Boxes {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> rotation, rotationSpeed, scale;
+
+        explicit Boxes(size_t count) {
+            // Same ranges as the scene's boxes, from a fixed seed
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> position(-BOX_WRAP_BOUNDARY, BOX_WRAP_BOUNDARY);
+            std::uniform_real_distribution<float> velocity(-0.05f, 0.05f);
+            std::uniform_real_distribution<float> speed(0.001f, 0.1f);
+            std::uniform_real_distribution<float> size(0.01f, 0.05f);
+            for (size_t i = 0; i < count; ++i) {
+                positionX.push_back(position(random));
+                positionY.push_back(position(random));
+                positionZ.push_back(position(random));
+                velocityX.push_back(velocity(random));
+                velocityY.push_back(velocity(random));
+                velocityZ.push_back(velocity(random));
+                rotation.push_back(0.0f);
+                rotationSpeed.push_back(speed(random));
+                scale.push_back(size(random));
+            }
+        }
+
+        BoxMotionArrays Motion() {
+            return BoxMotionArrays{positionX.data(), positionY.data(), positionZ.data(),
+                                   velocityX.data(), velocityY.data(), velocityZ.data(),
+                                   rotation.data(), rotationSpeed.data()};
+        }
+
+        SphereArrays Spheres() const {
+            SphereArrays spheres = {positionX.data(), positionY.data(), positionZ.data(), scale.data(),
+                                    BOUNDING_RADIUS};
+            return spheres;
+        }
+    };
+
+    void BruteRadius(const SphereArrays& spheres, size_t count, const glm::vec3& center, float radius,
+                     std::vector<uint32_t>& out) {
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 offset = glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) - center;
+            float reach = radius + spheres.radius[i] * spheres.radiusScale;
+            if (glm::dot(offset, offset) <= reach * reach) {
+                out.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    bool BruteRaycast(const SphereArrays& spheres, size_t count, const glm::vec3& origin,
+                      const glm::vec3& direction, float maxDistance, float& distance) {
+        distance = maxDistance;
+        bool found = false;
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 toCenter = glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) - origin;
+            float radius = spheres.radius[i] * spheres.radiusScale;
+            float along = glm::dot(toCenter, direction);
+            float missSquared = glm::dot(toCenter, toCenter) - along * along;
+            if (missSquared > radius * radius) {
+                continue;
+            }
+            float halfChord = std::sqrt(radius * radius - missSquared);
+            float t = along - halfChord;
+            if (t < 0.0f) {
+                t = along + halfChord;
+            }
+            if (t >= 0.0f && t <= distance) {
+                distance = t;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    bool SameSet(std::vector<uint32_t> a, std::vector<uint32_t> b) {
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    }
+
+    double MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 20;
+    std::vector<size_t> counts;
+    for (int i = 2; i < argc; ++i) {
+        counts.push_back(static_cast<size_t>(std::atoll(argv[i])));
+    }
+    if (counts.empty()) {
+        counts = {10000, 100000, 1000000};
+    }
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    SimdKernel kernel = BestSimdKernel();
+
+    std::cout << frames << " frames; per frame: refit, 1 frustum query, " << QUERIES_PER_FRAME
+              << " radius queries (r = " << QUERY_RADIUS << "), " << QUERIES_PER_FRAME
+              << " ray casts. Times in us per frame; brute force frustum uses the " << SimdKernelName(kernel)
+              << " kernel" << std::endl;
+
+    for (size_t count : counts) {
+        Boxes boxes(count);
+        BoxMotionArrays motion = boxes.Motion();
+        LooseOctree index(glm::vec3(0.0f), BOX_WRAP_BOUNDARY);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        index.Build(boxes.Spheres(), count);
+        double buildUs = MicrosecondsSince(start);
+
+        std::mt19937 random(99);
+        std::uniform_real_distribution<float> position(-BOX_WRAP_BOUNDARY, BOX_WRAP_BOUNDARY);
+        std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+        double refitUs = 0, frustumUs = 0, bruteFrustumUs = 0, radiusUs = 0, bruteRadiusUs = 0;
+        double rayUs = 0, bruteRayUs = 0;
+        size_t moved = 0;
+        size_t mismatches = 0;
+        std::vector<uint32_t> found, expected(count);
+        for (int frame = 0; frame < frames; ++frame) {
+            UpdateBoxMotion(motion, 0, count, 1.0f / 60.0f, BestSimdKernel());
+            SphereArrays spheres = boxes.Spheres();
+
+            start = std::chrono::steady_clock::now();
+            moved += index.Refit(spheres, count);
+            refitUs += MicrosecondsSince(start);
+
+            // A camera on the edge of the scene, turning
+            float angle = frame * 0.3f;
+            glm::vec3 eye(0.0f, 0.0f, BOX_WRAP_BOUNDARY);
+            glm::vec3 front(std::sin(angle), 0.0f, -std::cos(angle));
+            MeshletFrustum frustum(projection * glm::lookAt(eye, eye + front, glm::vec3(0.0f, 1.0f, 0.0f)));
+            found.clear();
+            start = std::chrono::steady_clock::now();
+            index.QueryFrustum(frustum, found);
+            frustumUs += MicrosecondsSince(start);
+            start = std::chrono::steady_clock::now();
+            size_t visible = CullSpheres(frustum, spheres, 0, count, expected.data(), kernel);
+            bruteFrustumUs += MicrosecondsSince(start);
+            if (!SameSet(found, std::vector<uint32_t>(expected.begin(), expected.begin() + visible))) {
+                mismatches++;
+            }
+
+            for (int query = 0; query < QUERIES_PER_FRAME; ++query) {
+                glm::vec3 center(position(random), position(random), position(random));
+                std::vector<uint32_t> near, bruteNear;
+                start = std::chrono::steady_clock::now();
+                index.QueryRadius(center, QUERY_RADIUS, near);
+                radiusUs += MicrosecondsSince(start);
+                start = std::chrono::steady_clock::now();
+                BruteRadius(spheres, count, center, QUERY_RADIUS, bruteNear);
+                bruteRadiusUs += MicrosecondsSince(start);
+                if (!SameSet(near, bruteNear)) {
+                    mismatches++;
+                }
+
+                glm::vec3 direction = glm::normalize(glm::vec3(axis(random), axis(random), axis(random)) + 1e-3f);
+                uint32_t hit = 0;
+                float distance = 0.0f, bruteDistance = 0.0f;
+                start = std::chrono::steady_clock::now();
+                bool hitIndex = index.Raycast(center, direction, RAY_LENGTH, hit, distance);
+                rayUs += MicrosecondsSince(start);
+                start = std::chrono::steady_clock::now();
+                bool hitBrute = BruteRaycast(spheres, count, center, direction, RAY_LENGTH, bruteDistance);
+                bruteRayUs += MicrosecondsSince(start);
+                if (hitIndex != hitBrute || (hitIndex && distance != bruteDistance)) {
+                    mismatches++;
+                }
+            }
+        }
+
+        std::cout << std::setw(8) << count << " boxes: build " << std::fixed << std::setprecision(0) << buildUs
+                  << ", refit " << (refitUs / frames) << " (" << (moved / frames) << " moved)"
+                  << " | frustum " << (frustumUs / frames) << " vs " << (bruteFrustumUs / frames)
+                  << " | radius " << std::setprecision(1) << (radiusUs / frames) << " vs " << (bruteRadiusUs / frames)
+                  << " | ray " << (rayUs / frames) << " vs " << (bruteRayUs / frames)
+                  << (mismatches ? "  MISMATCHES: " : "") << (mismatches ? std::to_string(mismatches) : "")
+                  << std::endl;
+        if (mismatches) {
+            return 1;
+        }
+    }
+    return 0;
+}